@@ -0,0 +1,395 @@
+/* Compares the execution engines, and times the lexer,
+on the programs given on the command line, or on the
+generated workloads in workloads.c (with -g, or if no
+programs are given). Each program is lexed `reps`
+times, both on one thread and split between `-t` of
+them (one per core by default), then decoded once and run `reps` times on a
+fresh VM with every engine, after `warmup` untimed
+runs. Output goes to an arena that's emptied before
+every run, so printing is timed without the terminal
+getting involved.
+
+Every engine's last run is also checked against the
+interpreter's, state and output, so running this on
+the examples doubles as a differential test.
+
+With -j, results are printed as a single JSON object
+instead, for tracking over time. */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "strvm.h"
+#include "lexer.h"
+#include "decoder.h"
+#include "batch.h"
+#include "jit.h"
+#include "recorder.h"
+#include "verifier.h"
+#include "workloads.h"
+
+#include "fiesta/str.h"
+
+#define DEFAULT_REPS          2000
+#define DEFAULT_WORKLOAD_REPS 100
+#define DEFAULT_WARMUP        10
+#define BATCH_LANES           256
+
+typedef enum {
+    ENGINE_INTERP,
+    ENGINE_VERIFIED, // The interpreter again, without checks if the program passes the verifier
+    ENGINE_DECODED,
+    ENGINE_RECORDED, // The decoded engine's loop, logging into a ring for replaying later
+    ENGINE_JIT,
+    ENGINE_BATCH,
+    NUM_ENGINES
+} Engine;
+
+static const char* engine_names[NUM_ENGINES] = {"interp", "verified", "decoded", "recorded", "jit",
+                                                "batch"};
+
+// Everything needed to run one program on any engine
+typedef struct {
+    const char* name;
+    LexerState lexed;
+    int num_instrs;
+    bool verified;
+    DecodedProgram program;
+    JitProgram jit;
+    VM_Batch batch;
+    Recording recording; // Started over for every run
+    OutputSink sink;
+    VM vm; // The state of the last run
+} Bench;
+
+typedef struct {
+    size_t bytes;
+    double lex_mb_per_s;
+    double lex_parallel_mb_per_s;
+    int lex_threads;
+    double instrs_per_run;
+    int reps;
+    double ns_per_instr[NUM_ENGINES];
+    double log_bytes_per_instr; // Written by the recorder, including anything the ring has since dropped
+} BenchResult;
+
+static double now_ns() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Of the whole process so far, or -1 where there's no way to tell
+static long peak_rss_kb() {
+#if defined(_WIN32)
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static bool same_flags(const VM* a, const VM* b) {
+    return a->status_register.carry == b->status_register.carry
+        && a->status_register.overflow == b->status_register.overflow
+        && a->status_register.not_zero == b->status_register.not_zero
+        && a->compare_register.not_equal == b->compare_register.not_equal
+        && a->compare_register.equal == b->compare_register.equal
+        && a->compare_register.greater_than == b->compare_register.greater_than
+        && a->compare_register.less_than == b->compare_register.less_than;
+}
+
+// Output isn't compared if `output` is NULL
+static bool same_run(const VM* vm, const OutputSink* output,
+                     const VM* expected, const OutputSink* expected_output) {
+    if (memcmp(vm->registers, expected->registers, sizeof(vm->registers))
+        || memcmp(vm->memory, expected->memory, sizeof(vm->memory))
+        || !same_flags(vm, expected)
+        || vm->program_counter != expected->program_counter
+        || vm->instr_ptr != expected->instr_ptr)
+        return false;
+    return output == NULL || (output->len == expected_output->len
+                              && !memcmp(output->data, expected_output->data, output->len));
+}
+
+static bool check(const char* name, const char* engine, const VM* vm, const OutputSink* output,
+                  const VM* expected, const OutputSink* expected_output) {
+    if (same_run(vm, output, expected, expected_output))
+        return true;
+    fprintf(stderr, "Error: \"%s\" ran differently with %s than with interp\n", name, engine);
+    return false;
+}
+
+/* Runs the program once from the start, or once per
+lane for the batch engine. Returns how many runs that was. */
+static int run_once(Bench* b, Engine engine) {
+    b->vm = vm_init(b->lexed.labels, b->lexed.num_labels);
+    b->vm.output = &b->sink;
+    b->sink.len = 0;
+    switch (engine) {
+        case ENGINE_INTERP:
+            vm_run(&b->vm, b->lexed.instrs, b->num_instrs);
+            return 1;
+        case ENGINE_VERIFIED: {
+            VM_Budget budget = {.fuel = VM_UNLIMITED_FUEL};
+            if (b->verified)
+                vm_run_verified(&b->vm, b->lexed.instrs, b->num_instrs, &budget);
+            else
+                vm_run(&b->vm, b->lexed.instrs, b->num_instrs);
+            return 1;
+        }
+        case ENGINE_DECODED:
+            vm_run_decoded(&b->vm, &b->program);
+            return 1;
+        case ENGINE_RECORDED:
+            recorder_reset(&b->recording, &b->vm);
+            vm_run_recorded(&b->vm, &b->program, &b->recording);
+            return 1;
+        case ENGINE_JIT:
+            vm_run_jit(&b->vm, &b->jit);
+            return 1;
+        default:
+            for (int lane = 0; lane < BATCH_LANES; lane++)
+                vm_batch_load(&b->batch, lane, &b->vm);
+            vm_batch_run(&b->batch, &b->program);
+            return BATCH_LANES;
+    }
+}
+
+// Every batch run covers BATCH_LANES runs, so it does fewer of them
+static double time_engine(Bench* b, Engine engine, int warmup, int reps, double instrs_per_run) {
+    int calls = engine == ENGINE_BATCH ? reps / BATCH_LANES : reps;
+    if (calls < 1)
+        calls = 1;
+
+    for (int i = 0; i < warmup && i < calls; i++)
+        run_once(b, engine);
+    double runs = 0;
+    double start = now_ns();
+    for (int i = 0; i < calls; i++)
+        runs += run_once(b, engine);
+    return (now_ns() - start) / (runs * instrs_per_run);
+}
+
+// Single-threaded for `threads` 1, which lexer_lex_parallel() also is for small sources
+static double time_lexer(str src, int threads, int warmup, int reps) {
+    for (int i = 0; i < warmup && i < reps; i++) {
+        LexerState lexed = threads > 1 ? lexer_lex_parallel(src, threads) : lexer_lex(src);
+        lexer_free(&lexed);
+    }
+    double start = now_ns();
+    for (int i = 0; i < reps; i++) {
+        LexerState lexed = threads > 1 ? lexer_lex_parallel(src, threads) : lexer_lex(src);
+        lexer_free(&lexed);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    return (double)src.len * reps / (1024 * 1024) / seconds;
+}
+
+// Blank lines and comments lex to nops, so a file with nothing else in it has no instructions
+static bool has_instructions(const LexerState* lexed) {
+    for (int i = 0; i <= lexed->cur_instr; i++) {
+        if (lexed->instrs[i].type != NOP)
+            return true;
+    }
+    return false;
+}
+
+static bool bench_source(const char* name, str src, int threads, int warmup, int reps,
+                         BenchResult* result) {
+    Bench b = {.name = name, .lexed = lexer_lex(src)};
+    if (b.lexed.had_error) {
+        fprintf(stderr, "Error: \"%s\" couldn't be parsed\n", name);
+        lexer_free(&b.lexed);
+        return false;
+    }
+    // Otherwise a lexer that reads nothing would pass, with every engine running nothing
+    if (!has_instructions(&b.lexed)) {
+        fprintf(stderr, "Error: \"%s\" has no instructions\n", name);
+        lexer_free(&b.lexed);
+        return false;
+    }
+    *result = (BenchResult){.bytes = src.len, .reps = reps, .lex_threads = threads};
+    result->lex_mb_per_s = time_lexer(src, 1, warmup, reps);
+    result->lex_parallel_mb_per_s = time_lexer(src, threads, warmup, reps);
+
+    b.num_instrs = b.lexed.cur_instr + 1;
+    VerifyResult verified = verifier_verify(b.lexed.instrs, b.num_instrs,
+                                            b.lexed.labels, b.lexed.num_labels);
+    b.verified = verified.verified;
+    verifier_free(&verified);
+    b.program = decoder_decode(b.lexed.instrs, b.num_instrs, b.lexed.labels, b.lexed.num_labels);
+    b.jit = jit_compile(&b.program);
+    b.batch = vm_batch_create(BATCH_LANES, decoder_memory_reach(&b.program));
+    b.sink = output_sink_arena();
+    b.recording = recorder_create(&b.vm, RECORDER_DEFAULT_CAPACITY, RECORDER_DEFAULT_INTERVAL);
+
+    // One untimed run to count instructions, and check the others against
+    OutputSink expected_output = output_sink_arena();
+    VM expected = vm_init(b.lexed.labels, b.lexed.num_labels);
+    expected.output = &expected_output;
+    vm_run(&expected, b.lexed.instrs, b.num_instrs);
+    result->instrs_per_run = expected.program_counter > 0 ? expected.program_counter : 1;
+
+    bool ok = true;
+    for (int engine = 0; engine < NUM_ENGINES && ok; engine++) {
+        result->ns_per_instr[engine] = time_engine(&b, engine, warmup, reps,
+                                                   result->instrs_per_run);
+        if (engine == ENGINE_BATCH) {
+            // Lanes print over each other, so only their state can be checked
+            for (int lane = 0; lane < BATCH_LANES && ok; lane++) {
+                vm_batch_store(&b.batch, lane, &b.vm);
+                ok = check(name, engine_names[engine], &b.vm, NULL, &expected, &expected_output);
+            }
+        }
+        else
+            ok = check(name, engine_names[engine], &b.vm, &b.sink, &expected, &expected_output);
+        if (engine == ENGINE_RECORDED)
+            result->log_bytes_per_instr = b.recording.end / result->instrs_per_run;
+    }
+
+    output_free(&expected_output);
+    output_free(&b.sink);
+    vm_batch_free(&b.batch);
+    recorder_free(&b.recording);
+    jit_free(&b.jit);
+    decoder_free(&b.program);
+    lexer_free(&b.lexed);
+    return ok;
+}
+
+static void print_text(const char* name, const BenchResult* r) {
+    printf("%s: %.0f instructions/run, %d runs\n", name, r->instrs_per_run, r->reps);
+    printf("  lexer   : %6.2f MB/s, %.2f MB/s on %d threads (%zu bytes)\n",
+           r->lex_mb_per_s, r->lex_parallel_mb_per_s, r->lex_threads, r->bytes);
+    double interp_ns = r->ns_per_instr[ENGINE_INTERP];
+    printf("  interp  : %6.2f ns/instr\n", interp_ns);
+    for (int engine = ENGINE_INTERP + 1; engine < NUM_ENGINES; engine++) {
+        double ns = r->ns_per_instr[engine];
+        printf("  %-8s: %6.2f ns/instr (%.2fx", engine_names[engine], ns, interp_ns / ns);
+        if (engine == ENGINE_BATCH)
+            printf(", %d lanes", BATCH_LANES);
+        if (engine == ENGINE_RECORDED)
+            printf(", %.2f bytes/instr logged", r->log_bytes_per_instr);
+        printf(")\n");
+    }
+}
+
+static void print_json(const char* name, const BenchResult* r, bool first) {
+    printf("%s\n    {\"name\": \"%s\", \"bytes\": %zu, \"lex_mb_per_s\": %.3f, "
+           "\"lex_parallel_mb_per_s\": %.3f, \"lex_threads\": %d, "
+           "\"instructions_per_run\": %.0f, \"runs\": %d, \"log_bytes_per_instruction\": %.3f, "
+           "\"engines\": {",
+           first ? "" : ",", name, r->bytes, r->lex_mb_per_s, r->lex_parallel_mb_per_s,
+           r->lex_threads, r->instrs_per_run, r->reps, r->log_bytes_per_instr);
+    for (int engine = 0; engine < NUM_ENGINES; engine++) {
+        double ns = r->ns_per_instr[engine];
+        printf("%s\"%s\": {\"ns_per_instruction\": %.4f, \"instructions_per_second\": %.0f}",
+               engine ? ", " : "", engine_names[engine], ns, 1e9 / ns);
+    }
+    printf("}}");
+}
+
+static int default_threads() {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0)
+        return count;
+#endif
+    return 1;
+}
+
+static void print_usage() {
+    printf("Usage: bench [-n <reps>] [-w <warmup>] [-s <scale>] [-t <threads>] [-g] [-j] [<file>...]\n");
+}
+
+int main(int argc, char* argv[]) {
+    int reps = -1;
+    int warmup = DEFAULT_WARMUP;
+    int scale = 1;
+    int threads = default_threads();
+    bool generated = false;
+    bool json = false;
+    const char** filenames = malloc(sizeof(char*) * argc);
+    int num_files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+            warmup = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            scale = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-g"))
+            generated = true;
+        else if (!strcmp(argv[i], "-j"))
+            json = true;
+        else if (argv[i][0] == '-') {
+            print_usage();
+            return 1;
+        }
+        else
+            filenames[num_files++] = argv[i];
+    }
+    if (num_files == 0)
+        generated = true;
+
+    if (json)
+        printf("{\"warmup\": %d, \"scale\": %d, \"results\": [", warmup, scale);
+
+    int num_done = 0;
+    for (int i = 0; i < num_files; i++) {
+        str src = read_file_to_str(filenames[i]);
+        if (src.data == NULL) {
+            fprintf(stderr, "Error: couldn't read \"%s\"\n", filenames[i]);
+            return 1;
+        }
+        BenchResult result;
+        if (!bench_source(filenames[i], src, threads, warmup,
+                          reps > 0 ? reps : DEFAULT_REPS, &result))
+            return 1;
+        if (json)
+            print_json(filenames[i], &result, num_done == 0);
+        else
+            print_text(filenames[i], &result);
+        num_done++;
+        str_free(&src);
+    }
+
+    for (int i = 0; generated && i < num_workloads; i++) {
+        str src = workloads[i].generate(scale);
+        BenchResult result;
+        if (!bench_source(workloads[i].name, src, threads, warmup,
+                          reps > 0 ? reps : DEFAULT_WORKLOAD_REPS, &result))
+            return 1;
+        if (json)
+            print_json(workloads[i].name, &result, num_done == 0);
+        else
+            print_text(workloads[i].name, &result);
+        num_done++;
+        free(src.data);
+    }
+
+    if (json)
+        printf("\n], \"peak_rss_kb\": %ld}\n", peak_rss_kb());
+    else
+        printf("peak RSS: %ld KB\n", peak_rss_kb());
+    free(filenames);
+    return 0;
+}
\ No newline at end of file
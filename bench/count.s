@@ -0,0 +1,12 @@
+; Two nested counting loops and no output, so
+; that only dispatch and ALU work get measured
+mov r0, 0
+outer:
+    mov r1, 0
+inner:
+    add r1, 1
+    jnz inner
+    add r0, 1
+    cmp r0, 100
+    jlt outer
+hlt
\ No newline at end of file
@@ -0,0 +1,15 @@
+; Prints every byte value, space separated, fifty
+; times over, so that output dominates the run
+mov r2, 0
+outer:
+    mov r0, 0
+inner:
+    ptu r0
+    ptc 32
+    add r0, 1
+    jnz inner
+    ptc 10
+    add r2, 1
+    cmp r2, 50
+    jlt outer
+hlt
\ No newline at end of file
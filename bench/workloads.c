@@ -0,0 +1,237 @@
+/* Programs for bench.c to run, generated at any size.
+Everything but `labels` wraps its work in a loop that
+runs `scale` times, so that its instruction count
+grows without the program getting any longer. `labels`
+is there for the lexer, so it grows the source instead:
+it's one long run of labelled blocks, each jumping to
+the next. */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "output.h"
+#include "workloads.h"
+
+#include "fiesta/str.h"
+
+#define LABEL_BLOCKS_PER_SCALE 5000
+// Bytes the wide and bulk workloads sweep over, which has to fit in memory twice
+#define SWEEP_SIZE (MEMORY_SIZE / 2 < 16384 ? MEMORY_SIZE / 2 : 16384)
+
+static void emit(OutputSink* out, const char* format, ...) {
+    char line[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    output_put(out, line, len);
+}
+
+static int clamp_scale(int scale) {
+    return scale < 1 ? 1 : scale > WORKLOAD_MAX_SCALE ? WORKLOAD_MAX_SCALE : scale;
+}
+
+// r7 is kept for counting repeats
+static void begin_repeat(OutputSink* out) {
+    emit(out, "mov r7, 0\n");
+    emit(out, "repeat:\n");
+}
+
+static void end_repeat(OutputSink* out, int scale) {
+    emit(out, "    add r7, 1\n");
+    emit(out, "    cmp r7, %d\n", clamp_scale(scale));
+    emit(out, "    jlt repeat\n");
+    emit(out, "hlt\n");
+}
+
+static str finish(OutputSink* out) {
+    return (str){.data = out->data, .len = out->len};
+}
+
+// Nested loops of arithmetic, about 100k instructions per repeat
+static str generate_alu(int scale) {
+    OutputSink out = output_sink_arena();
+    emit(&out, "; arithmetic in nested loops, with no memory or output\n");
+    begin_repeat(&out);
+    emit(&out, "    mov r0, 0\n");
+    emit(&out, "outer:\n");
+    emit(&out, "    mov r1, 0\n");
+    emit(&out, "inner:\n");
+    emit(&out, "    add r2, r1\n");
+    emit(&out, "    mul r3, 3\n");
+    emit(&out, "    shr r3, 1\n");
+    emit(&out, "    sub r4, r2\n");
+    emit(&out, "    add r1, 1\n");
+    emit(&out, "    jnz inner\n");
+    emit(&out, "    add r0, 1\n");
+    emit(&out, "    cmp r0, 64\n");
+    emit(&out, "    jlt outer\n");
+    end_repeat(&out, scale);
+    return finish(&out);
+}
+
+// Fills the first 256 bytes of memory, then sums them, about 115k instructions per repeat
+static str generate_memory(int scale) {
+    OutputSink out = output_sink_arena();
+    emit(&out, "; sweeps of str and ld over every byte a register can address\n");
+    begin_repeat(&out);
+    emit(&out, "    mov r0, 0\n");
+    emit(&out, "pass:\n");
+    emit(&out, "    mov r1, 0\n");
+    emit(&out, "fill:\n");
+    emit(&out, "    str r1, r0\n");
+    emit(&out, "    add r1, 1\n");
+    emit(&out, "    jnz fill\n");
+    emit(&out, "sum:\n");
+    emit(&out, "    ld r2, r1\n");
+    emit(&out, "    add r3, r2\n");
+    emit(&out, "    add r1, 1\n");
+    emit(&out, "    jnz sum\n");
+    emit(&out, "    add r0, 1\n");
+    emit(&out, "    cmp r0, 64\n");
+    emit(&out, "    jlt pass\n");
+    end_repeat(&out, scale);
+    return finish(&out);
+}
+
+// Every byte value as a number and as a character, about 75k instructions per repeat
+static str generate_print(int scale) {
+    OutputSink out = output_sink_arena();
+    emit(&out, "; mostly printing, in all three formats\n");
+    begin_repeat(&out);
+    emit(&out, "    mov r0, 0\n");
+    emit(&out, "line:\n");
+    emit(&out, "    mov r1, 0\n");
+    emit(&out, "value:\n");
+    emit(&out, "    ptu r1\n");
+    emit(&out, "    ptc 32\n");
+    emit(&out, "    ptn r1\n");
+    emit(&out, "    ptc r1\n");
+    emit(&out, "    add r1, 1\n");
+    emit(&out, "    jnz value\n");
+    emit(&out, "    ptc 10\n");
+    emit(&out, "    add r0, 1\n");
+    emit(&out, "    cmp r0, 48\n");
+    emit(&out, "    jlt line\n");
+    end_repeat(&out, scale);
+    return finish(&out);
+}
+
+/* Steps a generator whose top two bits pick one of
+four arms each time, so that no two trips round the
+loop in a row are likely to go the same way, about 185k
+instructions per repeat */
+static str generate_branches(int scale) {
+    OutputSink out = output_sink_arena();
+    emit(&out, "; data-dependent branches, with a different path taken most trips\n");
+    begin_repeat(&out);
+    emit(&out, "    mov r6, 0\n");
+    emit(&out, "outer:\n");
+    emit(&out, "    mov r0, 0\n");
+    emit(&out, "step:\n");
+    emit(&out, "    mul r1, 5\n");
+    emit(&out, "    add r1, 3\n");
+    emit(&out, "    mov r2, r1\n");
+    emit(&out, "    shr r2, 6\n");
+    emit(&out, "    cmp r2, 1\n");
+    emit(&out, "    jlt zero\n");
+    emit(&out, "    je one\n");
+    emit(&out, "    cmp r2, 2\n");
+    emit(&out, "    je two\n");
+    emit(&out, "    add r3, 7\n");
+    emit(&out, "    jmp joined\n");
+    emit(&out, "zero:\n");
+    emit(&out, "    sub r3, 1\n");
+    emit(&out, "    jmp joined\n");
+    emit(&out, "one:\n");
+    emit(&out, "    add r4, r1\n");
+    emit(&out, "    jmp joined\n");
+    emit(&out, "two:\n");
+    emit(&out, "    mov r5, r1\n");
+    emit(&out, "    shr r5, 1\n");
+    emit(&out, "joined:\n");
+    emit(&out, "    add r0, 1\n");
+    emit(&out, "    jnz step\n");
+    emit(&out, "    add r6, 1\n");
+    emit(&out, "    cmp r6, 64\n");
+    emit(&out, "    jlt outer\n");
+    end_repeat(&out, scale);
+    return finish(&out);
+}
+
+/* Fills SWEEP_SIZE bytes of memory a word at a time,
+then sums it, about 4.5 instructions per byte per
+repeat. Without .w, every add here would be an add and
+an adc. */
+static str generate_wide(int scale) {
+    OutputSink out = output_sink_arena();
+    emit(&out, "; 16-bit sweeps over memory past what a byte can address\n");
+    begin_repeat(&out);
+    emit(&out, "    mov.w r4, 0\n");
+    emit(&out, "fill:\n");
+    emit(&out, "    str.w r4, r4\n");
+    emit(&out, "    add.w r4, 2\n");
+    emit(&out, "    cmp.w r4, %d\n", SWEEP_SIZE);
+    emit(&out, "    jlt fill\n");
+    emit(&out, "    mov.w r0, 0\n");
+    emit(&out, "    mov.w r4, 0\n");
+    emit(&out, "sum:\n");
+    emit(&out, "    ld.w r2, r4\n");
+    emit(&out, "    add.w r0, r2\n");
+    emit(&out, "    add.w r4, 2\n");
+    emit(&out, "    cmp.w r4, %d\n", SWEEP_SIZE);
+    emit(&out, "    jlt sum\n");
+    end_repeat(&out, scale);
+    return finish(&out);
+}
+
+/* Copies, combines and compares SWEEP_SIZE ranges,
+about 450 instructions per repeat, most of which go
+through every byte of one or two of them */
+static str generate_bulk(int scale) {
+    OutputSink out = output_sink_arena();
+    emit(&out, "; bulk memory instructions over ranges past what a byte can address\n");
+    begin_repeat(&out);
+    emit(&out, "    mset.w 0, 1, %d\n", SWEEP_SIZE);
+    emit(&out, "    mov r0, 0\n");
+    emit(&out, "pass:\n");
+    emit(&out, "    mcpy.w %d, 0, %d\n", SWEEP_SIZE, SWEEP_SIZE);
+    emit(&out, "    madd.w %d, 0, %d\n", SWEEP_SIZE, SWEEP_SIZE);
+    emit(&out, "    mxor.w 0, %d, %d\n", SWEEP_SIZE, SWEEP_SIZE);
+    emit(&out, "    mcmp.w 0, %d, %d\n", SWEEP_SIZE, SWEEP_SIZE);
+    emit(&out, "    add r0, 1\n");
+    emit(&out, "    cmp r0, 64\n");
+    emit(&out, "    jlt pass\n");
+    end_repeat(&out, scale);
+    return finish(&out);
+}
+
+// Runs straight through, so it's mostly there to be lexed
+static str generate_labels(int scale) {
+    OutputSink out = output_sink_arena();
+    int num_blocks = LABEL_BLOCKS_PER_SCALE * (scale < 1 ? 1 : scale);
+    emit(&out, "; %d labelled blocks, each referring to the next before it's defined\n",
+         num_blocks);
+    for (int i = 0; i < num_blocks; i++) {
+        emit(&out, "block%d:\n", i);
+        emit(&out, "    mov r%d, %d ; a comment to skip\n", i % 8, i % 256);
+        emit(&out, "    cmp r%d, %d\n", i % 8, i * 7 % 256);
+        emit(&out, "    jgt block%d\n", i + 1);
+    }
+    emit(&out, "block%d:\n", num_blocks);
+    emit(&out, "hlt\n");
+    return finish(&out);
+}
+
+const Workload workloads[] = {
+    {"alu", generate_alu},
+    {"memory", generate_memory},
+    {"print", generate_print},
+    {"branches", generate_branches},
+    {"wide", generate_wide},
+    {"bulk", generate_bulk},
+    {"labels", generate_labels}
+};
+const int num_workloads = sizeof(workloads) / sizeof(workloads[0]);
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "fiesta/str.h"
+
+// Loops can only count to 255, so that's as far as they scale
+#define WORKLOAD_MAX_SCALE 255
+
+/* Generates the source of a workload. The program it
+describes does `scale` times as much work as at scale
+1, and the returned str has to be free()d. */
+typedef str (*WorkloadGenerator)(int scale);
+
+typedef struct {
+    const char* name;
+    WorkloadGenerator generate;
+} Workload;
+
+extern const Workload workloads[];
+extern const int num_workloads;
\ No newline at end of file
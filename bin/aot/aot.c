@@ -0,0 +1,129 @@
+/* Compiled from bin/fuzz/fuzz99.s by strvm */
+
+#define MEMORY_SIZE 1024
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static uint8_t memory[MEMORY_SIZE];
+static char output[65536];
+static size_t output_len;
+
+static void flush(void) {
+    fwrite(output, 1, output_len, stdout);
+    fflush(stdout);
+    output_len = 0;
+}
+
+static void put_char(uint8_t c) {
+    if (output_len == sizeof(output))
+        flush();
+    output[output_len++] = c;
+}
+
+static void put_u8(uint8_t value) {
+    if (value >= 100)
+        put_char('0' + value / 100);
+    if (value >= 10)
+        put_char('0' + value / 10 % 10);
+    put_char('0' + value % 10);
+}
+
+// Wide values are little-endian, and wrap around the end of memory
+static uint32_t load_wide(uint32_t address, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint32_t)memory[(address + i) & (MEMORY_SIZE - 1)] << 8 * i;
+    return value;
+}
+
+static void store_wide(uint32_t address, int bytes, uint32_t value) {
+    for (int i = 0; i < bytes; i++)
+        memory[(address + i) & (MEMORY_SIZE - 1)] = value >> 8 * i;
+}
+
+// Bulk ranges have to lie wholly within memory
+static int in_bounds(uint32_t address, uint32_t len) {
+    return address <= MEMORY_SIZE && len <= MEMORY_SIZE - address;
+}
+
+// madd and mxor, backward if the destination starts partway into the source
+static void combine(uint32_t dst, uint32_t src, uint32_t len, int is_xor) {
+    if (dst > src) {
+        while (len-- > 0)
+            memory[dst + len] = is_xor ? memory[dst + len] ^ memory[src + len]
+                                       : memory[dst + len] + memory[src + len];
+        return;
+    }
+    for (uint32_t i = 0; i < len; i++)
+        memory[dst + i] = is_xor ? memory[dst + i] ^ memory[src + i] : memory[dst + i] + memory[src + i];
+}
+
+int main(void) {
+    uint8_t r0 = 0, r1 = 0, r2 = 0, r3 = 0, r4 = 0, r5 = 0, r6 = 0, r7 = 0;
+    uint8_t carry = 0, overflow = 0, not_zero = 0;
+    uint8_t not_equal = 0, equal = 0, greater_than = 0, less_than = 0;
+    // Not every program uses everything
+    (void)r0; (void)r1; (void)r2; (void)r3; (void)r4; (void)r5; (void)r6; (void)r7;
+    (void)carry; (void)overflow; (void)not_zero;
+    (void)not_equal; (void)equal; (void)greater_than; (void)less_than;
+    (void)memory; (void)put_u8; (void)load_wide; (void)store_wide;
+    (void)in_bounds; (void)combine;
+
+    r3 = -r3;
+    r4 = 0;
+    overflow = 0;
+    r6 = r6 + 94; not_zero = r6 != 0;
+    { uint32_t b = 30557u; uint32_t v = (b) & 0xFFFF; r3 = v >> 0; r4 = v >> 8; }
+    if (not_equal) goto i44;
+    if (not_equal) goto i11;
+    { uint32_t b = 10u; uint32_t v = ((r2 | (uint32_t)r3 << 8 | (uint32_t)r4 << 16 | (uint32_t)r5 << 24) >> (b & 31)); r2 = v >> 0; r3 = v >> 8; r4 = v >> 16; r5 = v >> 24; not_zero = v != 0; }
+    r6 = r6 >> (0 & 31); not_zero = r6 != 0;
+    r0 = memory[r7];
+i11:
+    {
+        uint32_t a = 180u, b = 170u, len = 73u;
+        if (!in_bounds(a, len) || !in_bounds(b, len)) {
+            flush();
+            printf("Error: invalid operand\n");
+            return 1;
+        }
+        memmove(memory + a, memory + b, len);
+    }
+    { uint8_t a = r4, b = 16; unsigned sum = a + b + carry; r4 = sum; carry = sum >> 8; overflow = ((a ^ r4) & (b ^ r4)) >> 7; not_zero = r4 != 0; }
+    if (not_equal) goto i18;
+    { uint32_t b = 60065u; uint32_t v = (load_wide(b, 2)) & 0xFFFF; r2 = v >> 0; r3 = v >> 8; }
+i18:
+    r5 = -r5;
+    if (!not_zero) goto i23;
+    r5 = r4;
+    r3 = memory[32];
+    r0 = r0 - 0; not_zero = r0 != 0;
+i23:
+    r6 = r6 - r7; not_zero = r6 != 0;
+    if (greater_than) goto i29;
+    memory[90] = 255;
+    { uint8_t a = r5, b = 255; unsigned sum = a + b + carry; r5 = sum; carry = sum >> 8; overflow = ((a ^ r5) & (b ^ r5)) >> 7; not_zero = r5 != 0; }
+    r1 = r3;
+i29:
+    memory[127] = 255;
+    if (greater_than) goto i44;
+    if (not_equal) goto i35;
+    r2 = r2 * r5; not_zero = r2 != 0;
+    r5 = r5 / 227; not_zero = r5 != 0;
+i35:
+    r1 = r1 << (13 & 31); not_zero = r1 != 0;
+    r0 = -r0;
+    if (less_than) goto i42;
+    r0 = r0 - 83; not_zero = r0 != 0;
+    put_u8(255);
+    r5 = r5 >> (5 & 31); not_zero = r5 != 0;
+    { uint32_t a = 1020u, b = 32767u; store_wide(a, 4, b); }
+i42:
+    { uint32_t a = (r1 | (uint32_t)r2 << 8 | (uint32_t)r3 << 16 | (uint32_t)r4 << 24), b = (r4 | (uint32_t)r5 << 8 | (uint32_t)r6 << 16 | (uint32_t)r7 << 24); store_wide(a, 4, b); }
+    r0 = r0 - 91; not_zero = r0 != 0;
+i44:
+    flush();
+    return 0;
+}
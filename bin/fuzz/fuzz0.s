@@ -0,0 +1,36 @@
+; program 0
+    je p0l1
+    cmp rz, 0
+    ptc r6
+    mset.w 860, 157, r1
+    ptn 255
+p0l1:
+    str.w r3, 255
+    mov r7, 93
+p0l2:
+    sub r2, 164
+    add.w r5, r1
+    nop
+    ptc 255
+    shl r3, 13
+    ptc 252
+    shl r5, 12
+    sub r7, 1
+    jnz p0l2
+    mov r7, 17
+p0l3:
+    neg r3
+    mul.w r4, r4
+    div r4, 25
+    str r4, 255
+    nop
+    str.d r2, r4
+    sub.d r0, 65535
+    clc
+    div.d r2, 65536
+    sbc r0, 86
+    sub r7, 1
+    jnz p0l3
+    nop
+    jlt p0l0
+p0l0:
@@ -0,0 +1,25 @@
+; program 1
+    div r2, 160
+    clv
+    div.w r1, 58770
+    ld r1, r2
+    mul r4, rz
+    mov r7, 93
+p1l1:
+    mul r5, 38
+    cmp r3, r7
+    cmp.w 127, r3
+    mov r5, r6
+    str r6, 255
+    add r1, r5
+    add.d r0, 3641768504
+    jnz p1l2
+    cmp.w 0, r0
+    mul r4, 202
+    add r5, 63
+p1l2:
+    sbc r3, r6
+    shr r0, 6
+    sub r7, 1
+    jnz p1l1
+p1l0:
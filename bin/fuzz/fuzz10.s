@@ -0,0 +1,22 @@
+; program 10
+    mov r7, 86
+p10l1:
+    ld r3, 11
+    sub.d r0, r4
+    add r5, 255
+    mul r6, 0
+    sub r7, 1
+    jnz p10l1
+    jgt p10l2
+    clv
+p10l2:
+    mov r5, r5
+    div r0, 168
+    ld.w r2, 1020
+    hlt
+    nop
+    nop
+    nop
+    ld.w r1, r0
+    ld r6, 255
+p10l0:
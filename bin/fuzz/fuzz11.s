@@ -0,0 +1,6 @@
+; program 11
+    str r1, r6
+    clv
+    shl r0, 11
+    div r3, 188
+p11l0:
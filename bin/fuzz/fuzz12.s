@@ -0,0 +1,9 @@
+; program 12
+    jz p12l1
+    mov r4, 53
+    cmp r1, 102
+    ld r6, 249
+    div r2, 214
+p12l1:
+    str 46, 128
+p12l0:
@@ -0,0 +1,67 @@
+; program 13
+    mov r7, 40
+p13l1:
+    mset.w 973, 0, 3
+    nop
+    jne p13l2
+    mov.d r1, r4
+    mov.d r0, r4
+p13l2:
+    adc r5, 46
+    mov r1, r6
+    str 54, 233
+    sub r7, 1
+    jnz p13l1
+    mov r7, 95
+p13l3:
+    str.d r1, r3
+    jmp p13l4
+    nop
+    add r1, 255
+    neg r2
+    cmp 0, 255
+p13l4:
+    str r1, r5
+    je p13l5
+    cmp r0, 128
+    adc r3, rz
+    sbc r3, r1
+p13l5:
+    sub r7, 1
+    jnz p13l3
+    str.w 1022, 8190
+    clv
+    je p13l6
+    ld.d r1, 32768
+    sub r6, 128
+    adc r3, 59
+p13l6:
+    clc
+    ld.d r1, r0
+    mov r5, 0
+    mul.d r2, 3122393397
+    str r5, 5
+    nop
+    mxor 229, 34, 256
+    mov r7, 65
+p13l7:
+    add r3, r7
+    mul.d r1, r1
+    mul.d r0, r0
+    add r1, r3
+    str 233, r6
+    ld r3, 255
+    sub r7, 1
+    jnz p13l7
+    mov r7, 8
+p13l8:
+    adc r4, 37
+    cmp 128, rz
+    shl.d r0, 7
+    sbc r0, 120
+    sbc r3, 1
+    cmp r7, 255
+    sub r7, 1
+    jnz p13l8
+    jmp p13l0
+p13l0:
@@ -0,0 +1,35 @@
+; program 14
+    str.d 2147483647, 938508942
+    mov r7, 49
+p14l1:
+    jgt p14l2
+    mul r0, r6
+p14l2:
+    jnz p14l3
+    adc r1, r4
+    adc r3, r4
+    cmp r2, r1
+    div r0, 66
+p14l3:
+    nop
+    mset 174, 0, 33
+    jne p14l4
+    ld r0, 1
+    cmp r0, rz
+    mcmp.w 65, 161, 189
+p14l4:
+    str 0, 255
+    neg r4
+    shl r5, 7
+    jne p14l5
+    cmp.w r3, 49112
+    nop
+p14l5:
+    sub r7, 1
+    jnz p14l1
+    jmp p14l6
+    cmp 56, r2
+p14l6:
+    adc r6, r7
+    neg r4
+p14l0:
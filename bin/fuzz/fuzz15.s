@@ -0,0 +1,12 @@
+; program 15
+    mcmp.w 847, 594, 0
+    madd 56, 212, 42
+    shl r2, 13
+    adc r0, 88
+    ptn 0
+    je p15l0
+    neg r6
+    str 134, rz
+    div r2, 111
+    sub.w r1, 18584
+p15l0:
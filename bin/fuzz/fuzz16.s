@@ -0,0 +1,70 @@
+; program 16
+    ptu r2
+    ptn 153
+    cmp.w r6, r4
+    sbc r4, r5
+    nop
+    str 146, 111
+    add r4, r2
+    je p16l0
+    mul r6, r3
+    neg r0
+    shl.d r3, 1
+    sbc r3, r5
+    nop
+    jne p16l1
+    div r6, 50
+    neg r2
+    str.w 1020, 65535
+    mul r2, 149
+p16l1:
+    jnz p16l2
+    str.w r6, r5
+    sbc r1, r6
+p16l2:
+    neg r6
+    jnz p16l3
+    div r6, 112
+    add.w r3, 26303
+    div r2, 107
+p16l3:
+    jz p16l4
+    cmp rz, rz
+    str 239, r2
+    sub r5, 224
+p16l4:
+    mov r7, 91
+p16l5:
+    jz p16l6
+    neg r3
+    add r3, 237
+    mov r5, r7
+p16l6:
+    cmp 255, r2
+    mov r3, 117
+    mov r6, 84
+    mul r6, r5
+    cmp.w 40001, 59187
+    sub r7, 1
+    jnz p16l5
+    mov r7, 76
+p16l7:
+    jne p16l8
+    shr.w r5, 15
+    div r1, 70
+    add.d r1, 4080384087
+p16l8:
+    jmp p16l9
+    add.d r2, 2673662126
+    ptu 1
+p16l9:
+    str 255, 73
+    sub r4, 128
+    nop
+    mov.d r0, 2924557634
+    mov r3, 171
+    pts 218, 5
+    div r3, 57
+    sub r7, 1
+    jnz p16l7
+p16l0:
@@ -0,0 +1,17 @@
+; program 17
+    mov r7, 33
+p17l1:
+    str 146, 255
+    jnz p17l2
+    nop
+    shr.d r3, 8
+    cmp 0, 255
+    shr r5, 11
+p17l2:
+    neg r3
+    shl r6, 5
+    shl r1, 0
+    cmp r1, 230
+    sub r7, 1
+    jnz p17l1
+p17l0:
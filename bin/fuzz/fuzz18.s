@@ -0,0 +1,28 @@
+; program 18
+    shl.d r3, 11
+    mul.d r0, r0
+    mset.w 54, 255, 274
+    sub.d r1, 1105071906
+    str.d 1022, r1
+    nop
+    shr r0, 5
+    cmp 51, r1
+    jgt p18l1
+    sbc r4, 127
+    neg r2
+p18l1:
+    cmp.w r1, r1
+    neg r6
+    mov r3, 218
+    neg r5
+    ptn r1
+    add r6, r6
+    cmp r7, r4
+    ld.d r0, 1020
+    adc r1, r6
+    sub r5, r4
+    div r3, 10
+    pts 100, 36
+    cmp.d 2147483648, 3599866472
+    mul r1, 255
+p18l0:
@@ -0,0 +1,19 @@
+; program 19
+    cmp.d 65535, 2403492467
+    ld r5, r7
+    nop
+    shr.w r3, 14
+    hlt
+    mov r7, 2
+p19l1:
+    jz p19l2
+    shr.w r4, 2
+    add.d r2, r3
+    sub.d r0, r2
+    str 139, 255
+p19l2:
+    mov r5, r1
+    mov r2, 255
+    sub r7, 1
+    jnz p19l1
+p19l0:
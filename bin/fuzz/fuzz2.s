@@ -0,0 +1,10 @@
+; program 2
+    mov r7, 87
+p2l1:
+    sub r4, 86
+    jne p2l2
+    clv
+p2l2:
+    sub r7, 1
+    jnz p2l1
+p2l0:
@@ -0,0 +1,4 @@
+; program 20
+    neg r3
+    shr.d r0, 1
+p20l0:
@@ -0,0 +1,11 @@
+; program 21
+    mov r7, 17
+p21l1:
+    sub.d r2, 3108738322
+    sub r7, 1
+    jnz p21l1
+    ptu 0
+    shr r5, 1
+    mov r0, 255
+    ptc 255
+p21l0:
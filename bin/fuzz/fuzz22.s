@@ -0,0 +1,48 @@
+; program 22
+    cmp 0, 173
+    neg r6
+    add.w r4, 50553
+    mov r1, 109
+    jz p22l1
+    cmp.w 25824, 0
+    str.d 1023, r4
+    neg r5
+p22l1:
+    nop
+    je p22l2
+    adc r6, 133
+p22l2:
+    jne p22l3
+    mov r0, 255
+    shr r6, 7
+    shr r0, 6
+p22l3:
+    ld r3, r3
+    clc
+    jne p22l4
+    str r1, 74
+    ptn 199
+    mov.d r1, r3
+    cmp r1, r1
+p22l4:
+    cmp.w 47503, 1
+    neg r6
+    cmp.d r1, 32767
+    shl.d r3, 15
+    mov r7, 39
+p22l5:
+    jlt p22l6
+    nop
+    add r5, r3
+p22l6:
+    ptc r0
+    sub r7, 1
+    jnz p22l5
+    cmp.d r4, 2147483647
+    shr.d r0, 5
+    jnz p22l7
+    cmp r0, 0
+    mov r5, r0
+p22l7:
+    mul r6, 0
+p22l0:
@@ -0,0 +1,32 @@
+; program 23
+    mov r7, 15
+p23l1:
+    mxor 243, 179, 5
+    nop
+    cmp r6, r0
+    je p23l2
+    cmp.d 3803140954, 3578261016
+p23l2:
+    str r4, r4
+    mset 252, r3, 1
+    sub r7, 1
+    jnz p23l1
+    mov r7, 9
+p23l3:
+    sbc r1, r1
+    str 64, 26
+    neg r0
+    je p23l4
+    sub r2, 89
+p23l4:
+    cmp 127, 86
+    shl.w r2, 15
+    neg r2
+    ptu r1
+    mul.d r1, r4
+    ld r5, r5
+    sub r7, 1
+    jnz p23l3
+    str.d 1023, 2279656099
+    shr r2, 7
+p23l0:
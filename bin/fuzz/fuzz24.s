@@ -0,0 +1,10 @@
+; program 24
+    shr r1, 4
+    ptu 0
+    jz p24l1
+    neg r0
+    cmp.w r3, r1
+    ld r6, 190
+    mov r6, r2
+p24l1:
+p24l0:
@@ -0,0 +1,21 @@
+; program 25
+    shr r0, 13
+    mset 45, 223, 17
+    jnz p25l1
+    neg r4
+    mcmp.w 931, 17, 69
+    cmp 128, 25
+p25l1:
+    cmp.w 65535, r4
+    str r0, 28
+    ld.d r2, 1020
+    cmp r1, r4
+    cmp r1, rz
+    cmp.w 19635, 127
+    jlt p25l2
+    add r1, r0
+p25l2:
+    cmp 169, r0
+    sbc r1, r7
+    mul r5, r2
+p25l0:
@@ -0,0 +1,20 @@
+; program 26
+    sbc r6, r4
+    mul.w r1, 128
+    nop
+    jmp p26l1
+    str 1, r2
+    mov.w r2, 53433
+p26l1:
+    ptu 93
+    neg r5
+    cmp 238, 39
+    add.w r0, r5
+    nop
+    ptu r6
+    str.d 1020, r4
+    neg r6
+    cmp 9, 0
+    nop
+    neg r1
+p26l0:
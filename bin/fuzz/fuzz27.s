@@ -0,0 +1,44 @@
+; program 27
+    mxor 149, 243, 13
+    add r1, 232
+    clv
+    jne p27l1
+    sbc r3, r2
+    mov r5, r4
+    ptn 230
+p27l1:
+    jlt p27l2
+    sub.w r3, 39273
+    clc
+    mov.d r3, 80640640
+    mov r6, r5
+p27l2:
+    sbc r2, r6
+    mov r7, 33
+p27l3:
+    nop
+    ld.d r1, 32768
+    ld.d r2, r1
+    cmp 134, 1
+    je p27l4
+    sub.w r2, 0
+    div r5, 180
+p27l4:
+    ld.w r0, 1023
+    neg r5
+    sub r7, 1
+    jnz p27l3
+    mov r3, r6
+    cmp r4, 0
+    cmp 255, 1
+    jnz p27l5
+    div r0, 98
+    str r7, rz
+    cmp 255, r4
+    mset.w r6, 127, r0
+p27l5:
+    add.w r3, r5
+    cmp.w r5, r6
+    add r0, 241
+    div r3, 60
+p27l0:
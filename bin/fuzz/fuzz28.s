@@ -0,0 +1,78 @@
+; program 28
+    str 70, r3
+    cmp 128, r1
+    mov r7, 35
+p28l1:
+    jne p28l2
+    ptn 82
+    sub.w r3, r0
+p28l2:
+    jmp p28l3
+    cmp r5, 0
+    cmp.d r2, r0
+    div r0, 193
+    neg r1
+p28l3:
+    nop
+    cmp.d r0, 1535674280
+    jne p28l4
+    nop
+    add r6, 131
+p28l4:
+    jnz p28l5
+    sub.w r0, r3
+    shr r4, 12
+    ld r2, r1
+    shr r2, 5
+p28l5:
+    mov.d r0, r4
+    str r7, r0
+    sub r7, 1
+    jnz p28l1
+    shl r6, 2
+    div r2, 98
+    jmp p28l6
+    ld.d r0, 65535
+    cmp 157, rz
+    mul.w r1, 65535
+    cmp rz, r2
+p28l6:
+    shr.d r1, 1
+    cmp.d 1616926606, 32767
+    jnz p28l7
+    add r2, rz
+    ptu r6
+    adc r0, 127
+    sub.w r2, r2
+p28l7:
+    je p28l0
+    mov r7, 56
+p28l8:
+    add r2, r5
+    str 86, r6
+    neg r4
+    div r1, 42
+    sub r7, 1
+    jnz p28l8
+    mov r7, 1
+p28l9:
+    ld r3, 52
+    jgt p28l10
+    div.d r0, 256
+    add.w r4, r0
+    mov r6, 0
+    div r5, 68
+p28l10:
+    sub r7, 1
+    jnz p28l9
+    jlt p28l0
+    adc r0, 0
+    shr r2, 7
+    mul r4, r7
+    shr r1, 8
+    add r3, 159
+    shl.w r2, 2
+    mset 110, r1, 20
+    div r2, 123
+    mov r2, 255
+p28l0:
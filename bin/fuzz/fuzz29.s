@@ -0,0 +1,46 @@
+; program 29
+    mov r7, 67
+p29l1:
+    nop
+    jne p29l2
+    mul.w r0, r1
+    add r2, r7
+    shl.d r1, 6
+    sbc r0, 127
+p29l2:
+    jlt p29l3
+    sub r2, 0
+    str r2, 127
+    clc
+p29l3:
+    mxor 9, 254, 2
+    cmp 1, 128
+    shr.w r4, 2
+    str r3, r0
+    mov r3, r5
+    cmp r7, rz
+    sub r7, 1
+    jnz p29l1
+    mov r7, 94
+p29l4:
+    shl.w r0, 2
+    sub r7, 1
+    jnz p29l4
+    div r3, 29
+    ptu r6
+    je p29l5
+    mul r0, 255
+p29l5:
+    div r6, 133
+    jz p29l6
+    cmp r7, 255
+    cmp.d 1, 0
+p29l6:
+    mov.w r2, r2
+    div.d r0, 3751243146
+    shl r5, 2
+    clc
+    cmp.w 12031, r5
+    sub.w r4, r3
+    adc r6, 255
+p29l0:
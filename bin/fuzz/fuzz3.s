@@ -0,0 +1,66 @@
+; program 3
+    adc r0, 255
+    adc r6, r4
+    clc
+    adc r2, 255
+    mov r7, 2
+p3l1:
+    str.d 1023, 65535
+    ld r4, 0
+    sub r7, 1
+    jnz p3l1
+    mov r7, 21
+p3l2:
+    ld r1, 84
+    div r0, 133
+    ld r6, 5
+    clv
+    neg r3
+    shl r4, 8
+    neg r5
+    ld r1, r3
+    sub r7, 1
+    jnz p3l2
+    mov r7, 15
+p3l3:
+    mcpy 12, 133, 93
+    sub r6, 104
+    sub r7, 1
+    jnz p3l3
+    je p3l4
+    ld r1, 0
+    ld r1, r1
+    shl r3, 10
+p3l4:
+    jz p3l5
+    cmp r7, r6
+    mov.w r5, 5052
+    div r3, 223
+    shr.w r2, 6
+p3l5:
+    sbc r0, r1
+    add.d r0, r3
+    sub.d r3, 3884737409
+    mov r7, 29
+p3l6:
+    jne p3l7
+    neg r2
+    madd 173, 208, 41
+    sub.w r4, 58505
+    mset.w 168, 255, 445
+p3l7:
+    hlt
+    neg r0
+    mcpy 227, 244, 8
+    jne p3l8
+    adc r0, r3
+    ptu rz
+    cmp rz, r6
+    mcpy.w 922, 786, 55
+p3l8:
+    adc r5, r5
+    sub.d r0, 850468321
+    nop
+    sub r7, 1
+    jnz p3l6
+p3l0:
@@ -0,0 +1,59 @@
+; program 30
+    mov r7, 28
+p30l1:
+    jlt p30l2
+    sub.d r2, r4
+    add r2, r6
+    shr r0, 1
+p30l2:
+    cmp.w r4, 41042
+    sub r4, 191
+    sbc r2, r5
+    jgt p30l3
+    shl r1, 2
+    mov.w r3, 65535
+    mov r3, 205
+    ld.w r3, r0
+p30l3:
+    jmp p30l4
+    ld r3, r1
+p30l4:
+    shl r5, 14
+    sub r7, 1
+    jnz p30l1
+    str 255, rz
+    add r2, r6
+    jmp p30l5
+    str r0, r4
+    div.d r2, 2
+    cmp 155, 214
+p30l5:
+    div.d r2, 2147483648
+    mul.d r0, 300948043
+    jne p30l0
+    shr r0, 6
+    mul r6, 90
+    neg r5
+    cmp 250, 0
+    mcpy 119, 106, 111
+    neg r6
+    mov.w r0, r4
+    mov r1, r6
+    nop
+    mov r7, 65
+p30l6:
+    add r5, 255
+    clv
+    cmp 255, 128
+    mov r6, r4
+    jlt p30l7
+    clv
+    ld.w r5, 1020
+    ptu 106
+    cmp.d 3896215030, 2748598104
+p30l7:
+    ptn 255
+    str 223, r1
+    sub r7, 1
+    jnz p30l6
+p30l0:
@@ -0,0 +1,10 @@
+; program 31
+    div r3, 83
+    cmp 255, 132
+    ptc 52
+    ld r4, r2
+    div r4, 98
+    je p31l1
+    neg r3
+p31l1:
+p31l0:
@@ -0,0 +1,38 @@
+; program 32
+    mov r7, 15
+p32l1:
+    mcmp 191, 77, 37
+    sub r7, 1
+    jnz p32l1
+    jnz p32l0
+    mov r7, 85
+p32l2:
+    clv
+    jz p32l3
+    mul r1, r7
+    sbc r4, r7
+p32l3:
+    clc
+    add r0, r1
+    jmp p32l4
+    shl r0, 4
+    shr r5, 8
+    clc
+    nop
+p32l4:
+    ld.d r2, 758915908
+    cmp.d 2479896668, r2
+    cmp.w 32767, 52189
+    sub r7, 1
+    jnz p32l2
+    mov r7, 8
+p32l5:
+    neg r5
+    ld r1, 216
+    mxor 195, 90, 53
+    ld r3, 255
+    mov.w r3, r6
+    clc
+    sub r7, 1
+    jnz p32l5
+p32l0:
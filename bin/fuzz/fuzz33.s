@@ -0,0 +1,21 @@
+; program 33
+    neg r1
+    div r1, 106
+    cmp 248, r6
+    shr r5, 9
+    neg r6
+    ptn r2
+    mov r7, 52
+p33l1:
+    str.d r4, r1
+    ld r4, r1
+    mul.d r1, 350813638
+    div r0, 22
+    shr r4, 14
+    sub r7, 1
+    jnz p33l1
+    nop
+    div.d r1, 2
+    sub r4, r1
+    neg r1
+p33l0:
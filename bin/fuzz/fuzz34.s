@@ -0,0 +1,21 @@
+; program 34
+    neg r2
+    jnz p34l1
+    div r2, 252
+    str 255, 226
+    sbc r2, r4
+    str 93, 0
+p34l1:
+    ptc 214
+    sbc r2, r7
+    neg r0
+    nop
+    jnz p34l2
+    nop
+    sbc r3, 255
+    ptu 176
+    adc r2, 224
+p34l2:
+    nop
+    adc r5, r1
+p34l0:
@@ -0,0 +1,13 @@
+; program 35
+    mov r7, 73
+p35l1:
+    add r4, r6
+    nop
+    sbc r0, r2
+    ptu r0
+    cmp rz, r3
+    sub.d r2, r0
+    ld.w r5, 1023
+    sub r7, 1
+    jnz p35l1
+p35l0:
@@ -0,0 +1,9 @@
+; program 36
+    mov r7, 82
+p36l1:
+    shl.w r4, 9
+    ld r6, 244
+    cmp r4, r4
+    sub r7, 1
+    jnz p36l1
+p36l0:
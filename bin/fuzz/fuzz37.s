@@ -0,0 +1,28 @@
+; program 37
+    mov r7, 76
+p37l1:
+    cmp 127, 128
+    pts.w 867, 29
+    sub r7, 1
+    jnz p37l1
+    jmp p37l0
+    str.d r2, 50965478
+    mset.w r0, 128, r5
+    jne p37l0
+    div r5, 129
+    ld.d r2, 1022
+    mov r6, 104
+    mov r0, r1
+    nop
+    nop
+    mul r3, r6
+    pts 103, 3
+    ptc r0
+    mov.w r1, r6
+    nop
+    jne p37l2
+    sub.d r0, r4
+p37l2:
+    mul r0, r4
+    nop
+p37l0:
@@ -0,0 +1,31 @@
+; program 38
+    cmp.d r2, r0
+    mov r7, 95
+p38l1:
+    je p38l2
+    ld r5, 255
+    cmp.d r1, r3
+p38l2:
+    mov.w r1, r3
+    shl r5, 15
+    shl r5, 13
+    cmp r6, 1
+    mov r0, r1
+    sub r6, 131
+    div r2, 192
+    shr r6, 13
+    mul r3, r5
+    sub r7, 1
+    jnz p38l1
+    add r1, r2
+    ptc r5
+    str.w 1021, 0
+    div r6, 185
+    shl.w r4, 12
+    clv
+    cmp.d 563848996, 2910447867
+    sbc r3, r4
+    pts.w 331, 11
+    pts 237, 6
+    ld r6, 120
+p38l0:
@@ -0,0 +1,39 @@
+; program 39
+    neg r6
+    div r5, 222
+    shl r5, 13
+    adc r6, r3
+    shl r2, 9
+    ptu r3
+    ld r6, r1
+    ld r5, r5
+    mul.d r1, r3
+    mset r4, 203, 8
+    sbc r1, r7
+    adc r4, r1
+    ld r5, r6
+    cmp 5, 0
+    nop
+    cmp r4, r5
+    str rz, r6
+    div r5, 20
+    mul r6, r0
+    jnz p39l1
+    cmp.d r3, 2147483648
+p39l1:
+    mul r4, 72
+    ptc 123
+    neg r2
+    madd 254, r4, 1
+    mul.w r1, 1723
+    str.d 1022, 2147483647
+    jgt p39l0
+    ld r6, r1
+    add r2, r0
+    jnz p39l2
+    nop
+p39l2:
+    mcpy.w 41, r2, 111
+    ptu r7
+    str r0, r7
+p39l0:
@@ -0,0 +1,20 @@
+; program 4
+    mov r7, 53
+p4l1:
+    div.w r1, 21679
+    jnz p4l2
+    nop
+p4l2:
+    jnz p4l3
+    sub r5, r2
+    add.w r0, 32768
+    cmp 0, 255
+    mov r6, 1
+p4l3:
+    mov r5, r4
+    sbc r2, 151
+    ptn 255
+    nop
+    sub r7, 1
+    jnz p4l1
+p4l0:
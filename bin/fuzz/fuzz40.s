@@ -0,0 +1,8 @@
+; program 40
+    ld r3, 128
+    madd.w 694, 893, 81
+    ptn r0
+    nop
+    cmp rz, 171
+    cmp 0, r5
+p40l0:
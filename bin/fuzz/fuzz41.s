@@ -0,0 +1,30 @@
+; program 41
+    adc r6, r3
+    jmp p41l1
+    cmp.w 32114, 23771
+    nop
+    mul.w r2, r6
+    sub.w r1, r4
+p41l1:
+    mov r7, 32
+p41l2:
+    div r0, 67
+    ld r3, rz
+    cmp.d r0, r1
+    ld r0, rz
+    shr.d r1, 3
+    str r2, 84
+    cmp 131, r2
+    div.w r4, 64768
+    sub r7, 1
+    jnz p41l2
+    clv
+    mov.w r0, 255
+    str.w 1020, r0
+    mcmp.w 175, 263, 404
+    add.d r3, 2108844951
+    jlt p41l3
+    mul.d r0, r1
+    str 208, r4
+p41l3:
+p41l0:
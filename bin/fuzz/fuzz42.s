@@ -0,0 +1,53 @@
+; program 42
+    jne p42l1
+    sub.w r4, 43910
+    ptn 192
+    cmp 255, 255
+    ld r0, 255
+p42l1:
+    add.w r2, r0
+    pts 189, r1
+    jne p42l2
+    ptu r7
+    cmp r4, 223
+p42l2:
+    jmp p42l3
+    mul r0, 0
+p42l3:
+    nop
+    jne p42l0
+    shr.w r3, 3
+    mov.w r0, 32925
+    mov r7, 79
+p42l4:
+    adc r6, rz
+    add r2, 24
+    str 19, r3
+    sub r4, 91
+    mul.d r2, 1756674998
+    nop
+    cmp 1, r4
+    jgt p42l5
+    neg r1
+    sub r3, 255
+p42l5:
+    jnz p42l6
+    hlt
+    sbc r3, r7
+    adc r0, r5
+p42l6:
+    ld r4, 255
+    sub r7, 1
+    jnz p42l4
+    ptn rz
+    neg r1
+    cmp 159, 56
+    jz p42l7
+    sub.d r3, 4111240294
+    nop
+    mov.d r3, 4294967295
+    cmp.w 0, 41983
+p42l7:
+    clv
+    jgt p42l0
+p42l0:
@@ -0,0 +1,41 @@
+; program 43
+    neg r3
+    cmp r7, r6
+    jnz p43l1
+    div r2, 85
+    shl r0, 8
+    clv
+p43l1:
+    neg r4
+    mov r7, 39
+p43l2:
+    ld r3, r0
+    cmp.w 25044, r0
+    sub r7, 1
+    jnz p43l2
+    mov r7, 21
+p43l3:
+    jne p43l4
+    cmp.d r1, r4
+p43l4:
+    sub r7, 1
+    jnz p43l3
+    sbc r2, r6
+    mul r1, 5
+    jgt p43l5
+    shl.d r0, 3
+    div r0, 174
+    neg r4
+    clv
+p43l5:
+    jgt p43l6
+    add r4, r5
+    add r6, r4
+p43l6:
+    cmp 118, 255
+    shl r0, 11
+    nop
+    mul r0, r4
+    add.w r3, 18845
+    nop
+p43l0:
@@ -0,0 +1,7 @@
+; program 44
+    clv
+    ld r1, r7
+    str 255, 3
+    div r2, 25
+    str 255, r2
+p44l0:
@@ -0,0 +1,81 @@
+; program 45
+    mov r7, 31
+p45l1:
+    str.d 1021, r0
+    add r5, r1
+    mul r2, r7
+    cmp r4, 98
+    cmp r0, r2
+    mul.d r2, r1
+    jmp p45l2
+    shl r5, 8
+p45l2:
+    str 0, r5
+    jmp p45l3
+    cmp r7, 255
+    mcpy.w 226, 655, r1
+    ld r6, 10
+    shl.w r3, 1
+p45l3:
+    ld r6, r4
+    sub r7, 1
+    jnz p45l1
+    mov r7, 24
+p45l4:
+    mov.w r5, r0
+    shl.d r1, 1
+    cmp.d 65535, 127
+    shr r6, 4
+    shl.w r1, 2
+    jz p45l5
+    mul.w r4, r0
+    add.w r2, r3
+    shr.w r4, 2
+    div r3, 93
+p45l5:
+    sub.d r0, 32767
+    jnz p45l6
+    nop
+p45l6:
+    mul r1, 255
+    sub r7, 1
+    jnz p45l4
+    jmp p45l0
+    mov r7, 96
+p45l7:
+    jlt p45l8
+    sub r0, r5
+    mov r4, r7
+p45l8:
+    sub r7, 1
+    jnz p45l7
+    mov r7, 55
+p45l9:
+    div r3, 45
+    div r5, 39
+    cmp.w 65535, 9218
+    jmp p45l10
+    nop
+    ptu 0
+    sub.w r4, 59338
+    shl r4, 0
+p45l10:
+    neg r3
+    mul.d r2, r3
+    cmp 144, 4
+    cmp r3, 86
+    sub r7, 1
+    jnz p45l9
+    hlt
+    mov.d r0, r2
+    shr.w r3, 13
+    neg r2
+    sub r5, 245
+    pts.w 946, 16
+    mul r3, 1
+    adc r2, 127
+    str 128, r2
+    nop
+    mov r5, 0
+    sub r3, r0
+p45l0:
@@ -0,0 +1,48 @@
+; program 46
+    mul r4, r4
+    adc r5, r4
+    ld r3, 255
+    cmp 11, 128
+    add r6, 164
+    jgt p46l1
+    cmp.w r4, 32768
+    neg r2
+    str 138, r4
+p46l1:
+    cmp.w 21324, r4
+    jnz p46l2
+    cmp.w 35526, 14348
+p46l2:
+    shr r3, 4
+    mov r7, 59
+p46l3:
+    div r5, 28
+    jz p46l4
+    shl r6, 10
+    neg r3
+    cmp r7, 0
+    pts.w r6, r1
+p46l4:
+    shl r0, 4
+    jnz p46l5
+    str 255, r1
+    ld r0, 128
+    div r0, 238
+    mov.d r1, r2
+p46l5:
+    sub r7, 1
+    jnz p46l3
+    jne p46l0
+    sbc r5, 0
+    cmp r1, r2
+    clc
+    jmp p46l6
+    str 12, r2
+    mul r3, 125
+    sbc r6, 138
+p46l6:
+    ld r1, 0
+    jnz p46l0
+    madd 166, 127, 13
+    sub.d r1, 3838314859
+p46l0:
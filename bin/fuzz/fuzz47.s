@@ -0,0 +1,30 @@
+; program 47
+    mcmp.w 849, 860, r0
+    sub.d r2, 0
+    jmp p47l1
+    neg r3
+    adc r4, rz
+    mov.d r1, r1
+    ld r0, rz
+p47l1:
+    jne p47l2
+    ptn r2
+    neg r0
+    ptu r0
+    clc
+p47l2:
+    str.w 34498, r2
+    hlt
+    mov r7, 7
+p47l3:
+    nop
+    sub r3, r7
+    ld.w r1, 32768
+    cmp.d r2, r4
+    cmp r5, rz
+    mul r0, 120
+    cmp 190, r1
+    mcpy r5, 46, r7
+    sub r7, 1
+    jnz p47l3
+p47l0:
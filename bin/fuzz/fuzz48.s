@@ -0,0 +1,12 @@
+; program 48
+    neg r1
+    ld.w r0, r1
+    sub.w r0, 128
+    mul r0, 125
+    mov.w r5, r0
+    mov r7, 51
+p48l1:
+    ld r5, r4
+    sub r7, 1
+    jnz p48l1
+p48l0:
@@ -0,0 +1,52 @@
+; program 49
+    mov r7, 25
+p49l1:
+    jlt p49l2
+    nop
+    mov r3, r7
+    cmp r5, r2
+p49l2:
+    mset 65, 164, 177
+    ld r6, 25
+    mset r2, 188, r6
+    clv
+    cmp 223, rz
+    shl.w r1, 13
+    ld r2, r0
+    add.d r0, r2
+    div r0, 39
+    sub r7, 1
+    jnz p49l1
+    mxor r1, 27, 137
+    div.w r1, 27928
+    ptn r2
+    mov r7, 56
+p49l3:
+    str.w 1022, r0
+    mul.d r3, 1478867386
+    ptu r4
+    ld r6, 255
+    nop
+    div.d r0, 358358852
+    jnz p49l4
+    mul r3, r3
+    shl.d r3, 0
+p49l4:
+    sub r7, 1
+    jnz p49l3
+    sub.d r0, 128
+    neg r1
+    mov r7, 30
+p49l5:
+    cmp rz, r0
+    ptn 92
+    mov.w r1, 13956
+    mov.w r3, 255
+    sub r7, 1
+    jnz p49l5
+    mov r6, 143
+    ld.w r2, 65535
+    nop
+    str.w 1022, 65535
+    div.w r0, 54344
+p49l0:
@@ -0,0 +1,11 @@
+; program 5
+    neg r0
+    clc
+    jz p5l1
+    hlt
+p5l1:
+    nop
+    str r2, r0
+    shl r5, 3
+    cmp r7, 255
+p5l0:
@@ -0,0 +1,19 @@
+; program 50
+    mov r7, 21
+p50l1:
+    add r0, r1
+    sub r7, 1
+    jnz p50l1
+    cmp r1, 210
+    mxor 73, 250, 0
+    div r3, 59
+    mov r6, r3
+    jgt p50l2
+    mcmp r2, 191, 28
+    mov r3, 51
+    ptu 255
+p50l2:
+    ptu r5
+    shl.w r0, 10
+    ld.w r1, 255
+p50l0:
@@ -0,0 +1,18 @@
+; program 51
+    str r7, r6
+    shr.w r1, 2
+    mov r7, 43
+p51l1:
+    str r4, r1
+    str.d r1, 32767
+    nop
+    neg r5
+    je p51l2
+    ld r4, r1
+p51l2:
+    mov r1, r3
+    neg r0
+    str 0, rz
+    sub r7, 1
+    jnz p51l1
+p51l0:
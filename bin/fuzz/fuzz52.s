@@ -0,0 +1,18 @@
+; program 52
+    cmp r3, r2
+    cmp r4, r7
+    sbc r1, 215
+    cmp.w r2, 65535
+    str r6, r3
+    ld.d r3, 4294967295
+    shr r6, 1
+    neg r2
+    ptu 255
+    mcmp 122, 39, 41
+    cmp 47, 255
+    cmp r7, 206
+    sub.w r4, 65164
+    cmp.d 1000193350, r3
+    ptn r1
+    str r1, r2
+p52l0:
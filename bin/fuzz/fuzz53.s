@@ -0,0 +1,4 @@
+; program 53
+    nop
+    cmp r6, 255
+p53l0:
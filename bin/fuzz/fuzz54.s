@@ -0,0 +1,48 @@
+; program 54
+    mov r7, 33
+p54l1:
+    jne p54l2
+    nop
+    clv
+    sub r3, 78
+    hlt
+p54l2:
+    nop
+    cmp.d r1, 677928834
+    jgt p54l3
+    sub.w r5, 44794
+    shr r6, 5
+p54l3:
+    cmp 9, r6
+    neg r3
+    clv
+    sub r7, 1
+    jnz p54l1
+    div r3, 132
+    str 255, 42
+    cmp 183, 97
+    jmp p54l4
+    clv
+    shr r6, 5
+p54l4:
+    cmp r0, 255
+    str r4, r4
+    mov r3, 0
+    nop
+    ptc r5
+    mcpy.w 927, r4, 58
+    nop
+    jlt p54l0
+    neg r3
+    sbc r1, r5
+    je p54l5
+    cmp r1, rz
+    mov r0, 189
+    add.d r1, 32768
+    mcpy.w 708, r2, r4
+p54l5:
+    adc r1, 39
+    jmp p54l6
+    sub r0, 88
+p54l6:
+p54l0:
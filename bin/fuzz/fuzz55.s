@@ -0,0 +1,37 @@
+; program 55
+    nop
+    jmp p55l1
+    mxor 12, 64, 115
+    add r5, r4
+p55l1:
+    jnz p55l2
+    sub.d r2, 1963245302
+    ld.w r5, 1023
+    nop
+    nop
+p55l2:
+    nop
+    cmp r0, 213
+    str r1, rz
+    cmp.d r1, r1
+    jz p55l3
+    neg r1
+p55l3:
+    cmp.d 3480871465, 255
+    je p55l4
+    sub r2, r2
+p55l4:
+    jz p55l5
+    add.w r5, 1
+    mcpy.w 550, 45, 415
+p55l5:
+    mul r6, 167
+    neg r0
+    div r2, 14
+    je p55l6
+    cmp 35, r2
+    str.w r6, 65535
+p55l6:
+    str.d 3018112289, 65535
+    pts 158, 21
+p55l0:
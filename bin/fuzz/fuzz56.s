@@ -0,0 +1,35 @@
+; program 56
+    jne p56l1
+    nop
+    mul r0, 101
+    mov r0, r1
+p56l1:
+    jlt p56l2
+    str 163, r5
+    mul.w r2, 43028
+    cmp.w r3, r0
+    cmp.d 1429875773, 2356002828
+p56l2:
+    sbc r0, 255
+    add r5, r5
+    ld.w r0, r0
+    mov r7, 91
+p56l3:
+    cmp r1, r0
+    str 7, 41
+    mul r0, 32
+    mov r4, r7
+    ptu rz
+    cmp r5, 112
+    sub r7, 1
+    jnz p56l3
+    div r0, 118
+    je p56l4
+    mul.w r2, r1
+    cmp r7, 106
+    sub.w r1, 42921
+p56l4:
+    div r5, 102
+    mul r4, r7
+    adc r0, 255
+p56l0:
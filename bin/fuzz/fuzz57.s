@@ -0,0 +1,44 @@
+; program 57
+    mov r7, 17
+p57l1:
+    mov.d r0, 32767
+    mcpy.w 374, 322, r1
+    nop
+    ld r3, 255
+    sub r7, 1
+    jnz p57l1
+    madd r0, 69, 50
+    clc
+    cmp r7, rz
+    mcmp 71, 113, 14
+    shl.d r3, 7
+    mov r7, 48
+p57l2:
+    sub r3, 0
+    ptc 180
+    cmp 255, r3
+    sub r7, 1
+    jnz p57l2
+    mov r7, 93
+p57l3:
+    cmp.d 127, 4581481
+    mov.d r1, r1
+    ld r5, r0
+    mcmp r3, 11, 0
+    neg r6
+    str 104, 127
+    ptu 205
+    sub r7, 1
+    jnz p57l3
+    ld.d r0, 1021
+    neg r6
+    mset 200, r2, r6
+    jz p57l4
+    str r2, 59
+    madd.w 215, 715, 251
+p57l4:
+    str.d 2147483647, r2
+    jz p57l5
+    mul.d r0, 3390245743
+p57l5:
+p57l0:
@@ -0,0 +1,30 @@
+; program 58
+    mov r7, 85
+p58l1:
+    jlt p58l2
+    nop
+p58l2:
+    sub r7, 1
+    jnz p58l1
+    add r4, r1
+    mul r1, 22
+    str.d 1360564405, 2208428204
+    je p58l3
+    shl.w r4, 10
+    shl.w r2, 3
+p58l3:
+    ptc 75
+    str.w 29097, r0
+    je p58l0
+    jz p58l4
+    ld r4, r7
+    nop
+    str 50, r4
+    nop
+p58l4:
+    add r4, r1
+    je p58l5
+    clc
+    mul r4, r7
+p58l5:
+p58l0:
@@ -0,0 +1,34 @@
+; program 59
+    mul.w r4, 33070
+    neg r5
+    jne p59l1
+    shl r1, 4
+p59l1:
+    shr r3, 7
+    mov r7, 96
+p59l2:
+    ptc 212
+    mul.d r3, r3
+    ptu rz
+    cmp.d r1, 65535
+    ptn 204
+    mul r1, r6
+    nop
+    clc
+    sub r7, 1
+    jnz p59l2
+    ld r3, 0
+    jne p59l3
+    clc
+    str r0, 204
+    shr.d r3, 10
+    ld r0, rz
+p59l3:
+    add r6, r0
+    jgt p59l4
+    mul r2, rz
+    str r2, 45
+    div r1, 74
+p59l4:
+    ld r5, r3
+p59l0:
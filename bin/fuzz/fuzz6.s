@@ -0,0 +1,22 @@
+; program 6
+    mov r7, 40
+p6l1:
+    nop
+    cmp r4, 0
+    sbc r0, 160
+    sub r7, 1
+    jnz p6l1
+    mov r7, 1
+p6l2:
+    madd.w 453, 690, 331
+    ld r5, 121
+    sub r1, 41
+    sub r7, 1
+    jnz p6l2
+    ld.d r1, 58310692
+    nop
+    jnz p6l3
+    ptn 199
+p6l3:
+    ld.d r2, 1020
+p6l0:
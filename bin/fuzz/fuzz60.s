@@ -0,0 +1,19 @@
+; program 60
+    mov r7, 87
+p60l1:
+    mul r3, 128
+    sub r7, 1
+    jnz p60l1
+    jmp p60l2
+    clv
+    div r2, 59
+    str 123, 238
+    add r5, r6
+p60l2:
+    jne p60l3
+    div r2, 89
+    ld r4, r3
+    mov.d r3, r3
+    str.w 22270, 127
+p60l3:
+p60l0:
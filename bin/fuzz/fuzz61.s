@@ -0,0 +1,4 @@
+; program 61
+    str 255, rz
+    ld r6, 255
+p61l0:
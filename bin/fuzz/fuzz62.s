@@ -0,0 +1,47 @@
+; program 62
+    mov r7, 59
+p62l1:
+    sub.d r3, 0
+    str 255, r3
+    clc
+    mov.w r3, r5
+    cmp.w r5, 21076
+    ptn 255
+    shl.w r4, 2
+    sub r7, 1
+    jnz p62l1
+    div r4, 243
+    jgt p62l2
+    div r6, 54
+p62l2:
+    mov.w r1, 46107
+    shl.w r1, 13
+    jmp p62l3
+    str 255, r5
+    sbc r5, 128
+p62l3:
+    ld r1, r0
+    ld r2, r5
+    cmp.d 2147483648, r0
+    cmp.w 18489, r0
+    neg r2
+    cmp.w r2, 6405
+    cmp r5, 55
+    add.w r0, 43918
+    adc r1, rz
+    mov r7, 59
+p62l4:
+    cmp 89, 255
+    cmp r2, 255
+    mul r3, r4
+    jnz p62l5
+    add r3, 161
+    shr r3, 3
+    div r3, 227
+p62l5:
+    cmp r0, rz
+    sub r7, 1
+    jnz p62l4
+    clv
+    shl r2, 2
+p62l0:
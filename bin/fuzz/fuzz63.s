@@ -0,0 +1,32 @@
+; program 63
+    mov r7, 90
+p63l1:
+    mov.w r2, r0
+    adc r3, 0
+    ptn r4
+    sbc r0, r1
+    adc r1, r1
+    mov r2, r1
+    add r3, r6
+    je p63l2
+    neg r3
+    div r4, 58
+    add r6, r1
+    shr r6, 7
+p63l2:
+    cmp r7, r5
+    mov.w r0, r4
+    sub r7, 1
+    jnz p63l1
+    ld r3, 0
+    cmp.d 704946449, 2147483647
+    mov.w r4, 42295
+    mov r7, 35
+p63l3:
+    sub r6, 255
+    jmp p63l4
+    clc
+p63l4:
+    sub r7, 1
+    jnz p63l3
+p63l0:
@@ -0,0 +1,64 @@
+; program 64
+    mov r7, 51
+p64l1:
+    neg r5
+    cmp 96, r1
+    mul r3, rz
+    jnz p64l2
+    mul r0, 0
+    mov r6, 135
+    mul r2, 1
+    mul r6, r3
+p64l2:
+    mov r1, 128
+    str.d 1022, r0
+    nop
+    mul r4, r1
+    ptc 54
+    sub r7, 1
+    jnz p64l1
+    mov r7, 72
+p64l3:
+    clc
+    shl r2, 9
+    mul r5, 0
+    clv
+    nop
+    sub r7, 1
+    jnz p64l3
+    mov r7, 40
+p64l4:
+    jmp p64l5
+    clc
+    shl r5, 13
+    mul r4, 255
+p64l5:
+    sub r7, 1
+    jnz p64l4
+    add r1, r4
+    jmp p64l6
+    cmp 1, 37
+    mset.w 895, r3, r4
+    str 127, 0
+p64l6:
+    div r4, 113
+    div r2, 178
+    jz p64l7
+    nop
+    clv
+    str r6, 242
+p64l7:
+    add r0, r5
+    sbc r2, 1
+    mov r7, 84
+p64l8:
+    jlt p64l9
+    div r6, 246
+    cmp r5, 97
+    ld r2, 8
+p64l9:
+    sub r2, rz
+    shr.w r2, 8
+    sub r7, 1
+    jnz p64l8
+p64l0:
@@ -0,0 +1,48 @@
+; program 65
+    ptu 26
+    neg r0
+    sub.w r5, r3
+    pts 131, 12
+    mov r7, 64
+p65l1:
+    jmp p65l2
+    adc r6, 0
+    sub r5, 77
+    sub.d r3, 1824325690
+    mov r3, 0
+p65l2:
+    jmp p65l3
+    add.w r0, r3
+    cmp r6, 212
+p65l3:
+    shr r0, 9
+    cmp.d 1146121438, r3
+    shr r6, 7
+    sub r7, 1
+    jnz p65l1
+    mov r7, 37
+p65l4:
+    jnz p65l5
+    nop
+    clv
+    mov r4, r5
+    cmp 255, r4
+p65l5:
+    cmp.w r6, r1
+    clv
+    mov.d r1, r0
+    shr.w r4, 15
+    mov.d r3, r3
+    sub r7, 1
+    jnz p65l4
+    ld.w r3, r0
+    cmp rz, r4
+    adc r0, 238
+    ld r4, 1
+    mov.w r1, r2
+    clc
+    jz p65l6
+    sub r5, r4
+p65l6:
+    cmp.d r4, 0
+p65l0:
@@ -0,0 +1,70 @@
+; program 66
+    shl.w r4, 11
+    add r4, r2
+    jz p66l1
+    sub r6, r5
+    mov r0, r6
+    ptc r0
+p66l1:
+    shr r2, 11
+    mov.d r2, r2
+    div r0, 22
+    nop
+    sbc r5, 243
+    shl r5, 10
+    clc
+    mov r6, r3
+    cmp 217, r2
+    jmp p66l2
+    mov.d r1, 4294967295
+p66l2:
+    shr r5, 0
+    cmp 222, 127
+    mov r7, 68
+p66l3:
+    cmp r4, 49
+    ptc 255
+    nop
+    nop
+    add r4, r2
+    ld.w r2, r1
+    str.w 1020, r4
+    add r4, r6
+    adc r6, r0
+    sub r7, 1
+    jnz p66l3
+    jnz p66l0
+    ld r2, 182
+    nop
+    add r3, r5
+    shl r2, 12
+    shr r0, 7
+    mov r7, 96
+p66l4:
+    mov r3, 201
+    ptu 148
+    shr r6, 3
+    sub.d r2, r2
+    sub r7, 1
+    jnz p66l4
+    mov r7, 38
+p66l5:
+    neg r3
+    ld.w r4, 1
+    sbc r5, r6
+    mov r1, 193
+    cmp r0, 178
+    cmp 190, r0
+    sub r7, 1
+    jnz p66l5
+    mov r7, 76
+p66l6:
+    ld.d r1, 3395152175
+    jmp p66l7
+    mov.w r0, r1
+    sub r0, r5
+p66l7:
+    cmp 93, 1
+    sub r7, 1
+    jnz p66l6
+p66l0:
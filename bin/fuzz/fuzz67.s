@@ -0,0 +1,18 @@
+; program 67
+    mov r4, r0
+    clv
+    cmp.w 127, r4
+    mul r4, r0
+    mul r5, 0
+    mov r7, 21
+p67l1:
+    cmp r7, r1
+    sub.w r2, 4129
+    je p67l2
+    cmp r6, r6
+p67l2:
+    cmp 201, 74
+    mov r3, r0
+    sub r7, 1
+    jnz p67l1
+p67l0:
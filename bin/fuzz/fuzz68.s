@@ -0,0 +1,42 @@
+; program 68
+    mov r7, 33
+p68l1:
+    neg r5
+    madd 253, 192, 1
+    shl.w r1, 2
+    nop
+    nop
+    cmp.w 1, r3
+    sub r7, 1
+    jnz p68l1
+    add.d r3, r0
+    str 255, 255
+    cmp r5, r7
+    adc r1, r4
+    mov.w r0, 65535
+    str 120, 222
+    jlt p68l0
+    sub.d r2, r1
+    jz p68l2
+    add.d r3, r4
+p68l2:
+    je p68l3
+    adc r6, r2
+p68l3:
+    shl.d r3, 2
+    ld r5, 255
+    ptc r4
+    shr r5, 2
+    neg r1
+    mov r0, r6
+    jlt p68l4
+    neg r3
+    mset 128, 230, 110
+    nop
+    cmp.w 48239, r0
+p68l4:
+    jgt p68l5
+    div.d r2, 3411104739
+    shr.w r3, 0
+p68l5:
+p68l0:
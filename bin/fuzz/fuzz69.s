@@ -0,0 +1,78 @@
+; program 69
+    mcpy.w 261, r1, 370
+    mul.w r3, r3
+    cmp.d 2321475695, r4
+    str.w r5, r6
+    jnz p69l1
+    cmp.d 3156702039, 127
+    neg r4
+    ld r6, 255
+    madd.w 970, 622, 28
+p69l1:
+    ld r3, r0
+    nop
+    ptc r5
+    mov r7, 44
+p69l2:
+    cmp r2, 0
+    ld.w r4, r2
+    nop
+    cmp r6, r0
+    jz p69l3
+    str r3, 158
+    nop
+p69l3:
+    cmp r5, 204
+    nop
+    neg r5
+    cmp.d r2, r3
+    cmp 255, 255
+    sub r7, 1
+    jnz p69l2
+    jne p69l4
+    nop
+    div r5, 125
+    madd.w 298, 917, 106
+p69l4:
+    jnz p69l5
+    str 92, r6
+    mov r5, 196
+    mov.d r2, 465741697
+p69l5:
+    jnz p69l6
+    mov r0, r0
+    cmp 225, r5
+    shl r1, 6
+    nop
+p69l6:
+    add.d r3, 2147483648
+    jz p69l7
+    neg r6
+p69l7:
+    clc
+    mov r7, 31
+p69l8:
+    mul.w r1, 56812
+    mul.d r1, r4
+    shr.d r0, 3
+    sbc r4, 57
+    neg r4
+    add.d r0, r4
+    sub r7, 1
+    jnz p69l8
+    div r4, 18
+    mul r1, 255
+    mov r7, 32
+p69l9:
+    jz p69l10
+    neg r2
+    cmp r5, 203
+    nop
+p69l10:
+    div r5, 162
+    sub r7, 1
+    jnz p69l9
+    ld.d r2, 1022
+    mul.w r5, 28547
+    jgt p69l0
+p69l0:
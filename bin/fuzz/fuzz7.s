@@ -0,0 +1,35 @@
+; program 7
+    mov r7, 85
+p7l1:
+    madd 59, 42, 7
+    cmp r6, 1
+    shr r0, 15
+    mov r5, r6
+    jnz p7l2
+    add.w r2, 32768
+    cmp 26, 255
+    add r4, 202
+p7l2:
+    sbc r6, 255
+    jgt p7l3
+    mcpy r2, r5, 15
+    nop
+p7l3:
+    sub r7, 1
+    jnz p7l1
+    mov r7, 51
+p7l4:
+    add r4, r3
+    ld.d r1, 1021
+    neg r1
+    cmp 255, r0
+    sbc r4, r0
+    sub r7, 1
+    jnz p7l4
+    mov r7, 26
+p7l5:
+    neg r4
+    str 202, 42
+    sub r7, 1
+    jnz p7l5
+p7l0:
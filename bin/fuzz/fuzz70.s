@@ -0,0 +1,77 @@
+; program 70
+    mov r7, 38
+p70l1:
+    ptc r0
+    jz p70l2
+    madd 189, 245, 7
+p70l2:
+    div r5, 81
+    sub.w r5, 255
+    neg r6
+    cmp 66, r7
+    sbc r2, 0
+    je p70l3
+    mov r5, 204
+p70l3:
+    sub r7, 1
+    jnz p70l1
+    pts.w 199, 19
+    shl r4, 7
+    shr.d r2, 11
+    ld.d r2, 1021
+    shr r4, 4
+    mov r7, 33
+p70l4:
+    mset.w 428, 136, 1
+    jne p70l5
+    clc
+    sub r3, 97
+    shl.d r0, 14
+    ptc r6
+p70l5:
+    clv
+    sub r7, 1
+    jnz p70l4
+    mov r7, 63
+p70l6:
+    str r7, r5
+    add.d r3, 1053177129
+    jgt p70l7
+    mul.d r0, 1272559205
+    mxor.w r0, 878, r3
+    cmp r4, r3
+p70l7:
+    jne p70l8
+    nop
+    ld.w r3, r4
+    nop
+    mov r1, r1
+p70l8:
+    str r1, r5
+    sub r7, 1
+    jnz p70l6
+    mov r7, 47
+p70l9:
+    sub.w r5, r2
+    jnz p70l10
+    ptn 100
+    cmp r3, 51
+    clv
+    nop
+p70l10:
+    neg r0
+    cmp.d 1563048686, r4
+    nop
+    mcpy 176, 8, 45
+    sub.w r0, r3
+    shr.d r1, 15
+    str.d 1021, 3889767219
+    sub r7, 1
+    jnz p70l9
+    cmp 32, r2
+    jgt p70l11
+    ptc 255
+    sub.d r1, r1
+    shr r1, 4
+p70l11:
+p70l0:
@@ -0,0 +1,48 @@
+; program 71
+    shl r4, 5
+    cmp r7, 129
+    cmp 127, 104
+    div r3, 255
+    clv
+    ptn 1
+    mov.w r0, 9730
+    jnz p71l1
+    shl r5, 15
+    str r0, 1
+    cmp 127, r6
+p71l1:
+    mov r7, 63
+p71l2:
+    cmp r5, r0
+    nop
+    cmp r3, 132
+    je p71l3
+    add r2, 232
+    adc r3, r1
+    mul.d r1, 1
+    div r2, 195
+p71l3:
+    div r5, 119
+    cmp.w 32768, r1
+    sub r7, 1
+    jnz p71l2
+    madd 237, 63, 14
+    neg r6
+    div r3, 91
+    jgt p71l0
+    mov r7, 60
+p71l4:
+    neg r3
+    cmp.w 16181, r4
+    cmp rz, 255
+    jnz p71l5
+    str.d 1021, 1676556471
+    mov.w r3, r5
+    nop
+    ld r4, 177
+p71l5:
+    sbc r4, r1
+    shr r3, 6
+    sub r7, 1
+    jnz p71l4
+p71l0:
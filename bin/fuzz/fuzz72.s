@@ -0,0 +1,46 @@
+; program 72
+    jlt p72l1
+    mul.d r2, 2147483648
+    add r4, r6
+p72l1:
+    mov r7, 22
+p72l2:
+    ld r4, 204
+    sub r2, r2
+    ld.d r0, 1021
+    sub r7, 1
+    jnz p72l2
+    shr r5, 14
+    cmp r5, r4
+    mul r4, 216
+    shr r3, 5
+    jne p72l3
+    nop
+p72l3:
+    cmp.w r6, r0
+    shl.d r0, 5
+    ld r3, 1
+    mul.w r5, r5
+    neg r2
+    cmp.d 1802281695, r0
+    ld r4, r4
+    mul.w r4, r2
+    cmp 255, 140
+    jz p72l4
+    str.w r2, r6
+    neg r0
+    cmp 234, 59
+p72l4:
+    jnz p72l5
+    ptu r6
+p72l5:
+    add.w r1, 23530
+    mov r7, 75
+p72l6:
+    adc r4, r6
+    sub r7, 1
+    jnz p72l6
+    mul r3, 1
+    cmp rz, 79
+    jlt p72l0
+p72l0:
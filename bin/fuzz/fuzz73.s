@@ -0,0 +1,9 @@
+; program 73
+    ld.w r0, 1022
+    cmp 47, 1
+    sub.w r2, 32767
+    str 123, 1
+    cmp 255, r4
+    cmp.d 65535, 3169720963
+    cmp.w 32767, 11653
+p73l0:
@@ -0,0 +1,64 @@
+; program 74
+    mov r7, 68
+p74l1:
+    jmp p74l2
+    sub r0, 255
+p74l2:
+    jlt p74l3
+    nop
+p74l3:
+    je p74l4
+    sub r6, 58
+p74l4:
+    cmp.w 18518, r5
+    ld.d r1, 1022
+    shr.d r0, 12
+    sub r7, 1
+    jnz p74l1
+    mov r7, 32
+p74l5:
+    ptn r7
+    ptu r5
+    ptu 240
+    div.d r3, 3376896936
+    mul r6, r0
+    ld.d r0, 1022
+    str.d 32768, r0
+    sub r7, 1
+    jnz p74l5
+    je p74l0
+    add r1, r1
+    jz p74l0
+    mov r7, 84
+p74l6:
+    shl r3, 2
+    sub r7, 1
+    jnz p74l6
+    mov r7, 17
+p74l7:
+    jmp p74l8
+    mul r5, r6
+    str 83, r1
+    nop
+p74l8:
+    ld r6, 1
+    shr.w r4, 3
+    sub r7, 1
+    jnz p74l7
+    mov r7, 47
+p74l9:
+    add.w r5, 30909
+    mov r6, 255
+    jne p74l10
+    str.w 1022, 65535
+    sub r6, r3
+    cmp r1, r3
+    mov r2, r1
+p74l10:
+    clc
+    sub r7, 1
+    jnz p74l9
+    jmp p74l0
+    madd 40, 80, 73
+    shl.d r3, 8
+p74l0:
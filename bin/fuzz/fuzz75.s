@@ -0,0 +1,25 @@
+; program 75
+    jmp p75l1
+    nop
+    add.w r4, 127
+    div.w r5, 36378
+p75l1:
+    shl r2, 3
+    nop
+    nop
+    cmp 255, r7
+    adc r5, 5
+    nop
+    mul r5, rz
+    mov r7, 99
+p75l2:
+    jmp p75l3
+    clc
+    shr.d r3, 5
+p75l3:
+    ptc 128
+    ld r6, 0
+    cmp r0, 255
+    sub r7, 1
+    jnz p75l2
+p75l0:
@@ -0,0 +1,63 @@
+; program 76
+    mov r7, 19
+p76l1:
+    mul.d r3, r4
+    ptn 255
+    je p76l2
+    clc
+    cmp.d 3056441028, r0
+    str 255, rz
+p76l2:
+    ld r3, r4
+    sub r7, 1
+    jnz p76l1
+    cmp r2, r3
+    add r5, 0
+    je p76l3
+    mul.d r2, 2208133465
+    add.d r0, r1
+    mov r3, 251
+    nop
+p76l3:
+    clc
+    div r6, 90
+    sub.w r1, 30813
+    sub r5, r5
+    add r0, rz
+    sub.w r2, r4
+    jnz p76l0
+    jne p76l4
+    str r5, r0
+p76l4:
+    cmp.d 761769214, 4294967295
+    div r5, 225
+    cmp r0, r2
+    jmp p76l5
+    clv
+    ptc r2
+    sub r4, r7
+    nop
+p76l5:
+    cmp.d r0, 72449378
+    mxor.w 51, 12, r4
+    str.d 1020, 0
+    neg r2
+    sbc r4, rz
+    nop
+    shl.d r2, 1
+    sbc r6, r7
+    jmp p76l6
+    pts 199, 7
+    shr.w r4, 9
+    madd.w 123, 2, 497
+p76l6:
+    jlt p76l0
+    adc r0, 0
+    str r7, 117
+    jgt p76l7
+    cmp.w 38978, 38530
+    div r1, 178
+    shl r0, 13
+p76l7:
+    add.w r1, r6
+p76l0:
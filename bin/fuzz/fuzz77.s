@@ -0,0 +1,42 @@
+; program 77
+    cmp r3, r3
+    cmp r5, 255
+    shl r3, 13
+    mov r7, 23
+p77l1:
+    cmp 255, r2
+    sbc r2, r0
+    mul r6, 222
+    adc r2, 55
+    div r6, 86
+    jne p77l2
+    cmp 209, r5
+    str 128, 0
+    ld.w r5, 1020
+    madd 159, 143, 63
+p77l2:
+    jlt p77l3
+    sbc r6, 1
+p77l3:
+    clv
+    sub r0, 29
+    sub r7, 1
+    jnz p77l1
+    je p77l0
+    mov r7, 7
+p77l4:
+    str.d 3839293076, r3
+    sub.w r5, 41286
+    sub r7, 1
+    jnz p77l4
+    jmp p77l5
+    shl r2, 7
+    cmp 54, r4
+    div r2, 90
+    mov r5, 254
+p77l5:
+    jz p77l6
+    ptu r5
+    div r3, 251
+p77l6:
+p77l0:
@@ -0,0 +1,73 @@
+; program 78
+    nop
+    cmp.w 65535, r0
+    sub r2, r2
+    mov r7, 41
+p78l1:
+    div r3, 40
+    nop
+    str.d 1023, 1240216078
+    jlt p78l2
+    cmp r0, 63
+    mov r3, r7
+    neg r0
+    shl.w r4, 6
+p78l2:
+    ptu 141
+    jgt p78l3
+    neg r0
+    sub r4, 164
+    cmp 229, r1
+p78l3:
+    mov r5, 255
+    neg r4
+    clv
+    sub r7, 1
+    jnz p78l1
+    mov r7, 6
+p78l4:
+    neg r5
+    adc r3, r2
+    jlt p78l5
+    ld r5, r3
+p78l5:
+    cmp 62, r2
+    mov r5, r1
+    cmp r5, r7
+    mul.w r3, 127
+    str.d 1022, r2
+    str.d 1260114086, 1219665170
+    mset.w 337, 240, 192
+    sub r7, 1
+    jnz p78l4
+    clv
+    sbc r3, rz
+    jne p78l6
+    cmp r6, 0
+p78l6:
+    jlt p78l0
+    div r3, 62
+    je p78l7
+    sbc r4, r3
+    str.w 32768, r1
+p78l7:
+    je p78l0
+    shr r0, 14
+    div r4, 44
+    je p78l8
+    div r6, 186
+    clc
+    sub.d r3, 255
+    str.w 1023, 255
+p78l8:
+    cmp r3, r2
+    jlt p78l9
+    cmp 89, 221
+    ptc 53
+    nop
+    clv
+p78l9:
+    mov.d r0, 344387053
+    cmp.d r0, r3
+    ld r6, r1
+p78l0:
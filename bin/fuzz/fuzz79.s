@@ -0,0 +1,63 @@
+; program 79
+    cmp 255, r2
+    str r6, r0
+    mov r2, r4
+    mov r1, 255
+    cmp 255, 255
+    cmp.d r0, 32768
+    ptc 152
+    mov r7, 33
+p79l1:
+    str.d r2, r2
+    jlt p79l2
+    nop
+    neg r1
+    cmp r7, r6
+p79l2:
+    cmp r1, 255
+    jmp p79l3
+    div r1, 253
+    shr r6, 8
+    mset 156, 63, 32
+p79l3:
+    div.d r2, 2147483649
+    jne p79l4
+    adc r4, r5
+    add.d r3, r3
+p79l4:
+    cmp rz, r6
+    jnz p79l5
+    sbc r4, r3
+p79l5:
+    cmp r0, 25
+    nop
+    sub r7, 1
+    jnz p79l1
+    nop
+    mov r7, 92
+p79l6:
+    add r4, r3
+    mul.w r1, 1
+    je p79l7
+    sbc r4, 101
+    mov.w r5, 0
+p79l7:
+    str.w 1022, r3
+    sub r7, 1
+    jnz p79l6
+    mov r7, 38
+p79l8:
+    jgt p79l9
+    cmp.d r4, 4294967295
+    cmp.d r1, r1
+    clc
+p79l9:
+    str r0, r2
+    sub r7, 1
+    jnz p79l8
+    sub r3, 0
+    str.w 1023, 65535
+    shr.d r3, 12
+    jlt p79l0
+    adc r2, 68
+p79l0:
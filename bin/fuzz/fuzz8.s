@@ -0,0 +1,76 @@
+; program 8
+    mov r7, 78
+p8l1:
+    add.d r3, 372903367
+    add r3, r4
+    cmp.d r1, 822057227
+    div r0, 75
+    str.d 1021, r3
+    clv
+    str r0, r0
+    jgt p8l2
+    neg r3
+    str 0, r1
+    div r3, 77
+    str rz, r5
+p8l2:
+    div.w r2, 32769
+    sub r7, 1
+    jnz p8l1
+    jnz p8l0
+    mov r7, 38
+p8l3:
+    clv
+    sub r5, 127
+    str 240, r1
+    div.w r0, 32769
+    shr.w r1, 3
+    shl.d r2, 12
+    sub r7, 1
+    jnz p8l3
+    mov r7, 89
+p8l4:
+    mul r2, 185
+    jmp p8l5
+    nop
+    add r3, 58
+    sub.w r4, r5
+    ld r6, 0
+p8l5:
+    cmp.w 0, r0
+    jne p8l6
+    cmp r4, 51
+    str.w r2, 18964
+p8l6:
+    add r5, 27
+    sub r7, 1
+    jnz p8l4
+    mov r7, 89
+p8l7:
+    mul r0, 0
+    mul r5, 0
+    mov.d r1, 2957979120
+    div r1, 44
+    sub r6, 102
+    ptu 10
+    sub r7, 1
+    jnz p8l7
+    sbc r6, r7
+    shl r2, 5
+    cmp 1, 139
+    je p8l0
+    neg r1
+    shr r0, 3
+    cmp 75, r1
+    div r4, 60
+    cmp 225, r7
+    div.w r0, 48667
+    mov.d r2, 32767
+    sub r0, r3
+    jlt p8l8
+    str.d 32767, 32767
+    div.w r0, 20461
+    shr r0, 9
+    ptu 29
+p8l8:
+p8l0:
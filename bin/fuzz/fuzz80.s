@@ -0,0 +1,39 @@
+; program 80
+    sbc r4, r3
+    mov r3, 0
+    madd 6, 34, 52
+    mov r7, 94
+p80l1:
+    cmp 225, rz
+    shl.d r2, 6
+    jmp p80l2
+    sub r1, 168
+p80l2:
+    sub r7, 1
+    jnz p80l1
+    mov r7, 53
+p80l3:
+    sub r5, 255
+    mov r5, r4
+    sub r7, 1
+    jnz p80l3
+    mov r7, 63
+p80l4:
+    mxor.w 623, 494, 222
+    mul.d r0, 32767
+    jnz p80l5
+    adc r2, r4
+p80l5:
+    add.w r3, r2
+    str.w 128, 64865
+    str.d 1021, r2
+    cmp 111, rz
+    cmp 73, 246
+    str.w 1021, r5
+    jmp p80l6
+    str 0, 1
+    sub.w r3, 0
+p80l6:
+    sub r7, 1
+    jnz p80l4
+p80l0:
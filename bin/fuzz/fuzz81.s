@@ -0,0 +1,9 @@
+; program 81
+    div.w r2, 30568
+    cmp 125, r2
+    jgt p81l0
+    cmp r7, r0
+    mov r0, r3
+    sbc r5, 1
+    str.d r4, 3959186032
+p81l0:
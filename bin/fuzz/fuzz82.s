@@ -0,0 +1,6 @@
+; program 82
+    ptn 203
+    cmp.d 4294967295, r4
+    shr r6, 9
+    jlt p82l0
+p82l0:
@@ -0,0 +1,57 @@
+; program 83
+    mov r7, 98
+p83l1:
+    mov r6, 28
+    ld.w r3, r2
+    je p83l2
+    cmp 127, r4
+    clv
+p83l2:
+    ld r2, 132
+    pts.w 632, 7
+    sub r7, 1
+    jnz p83l1
+    ld r1, r7
+    add.w r5, 6053
+    madd r0, 223, r1
+    cmp.w r0, 127
+    str 56, 0
+    neg r5
+    mov r7, 12
+p83l3:
+    mcpy 144, 168, 85
+    ld r6, r1
+    shl r5, 13
+    add r0, 255
+    clv
+    adc r2, r7
+    shl r6, 13
+    div r2, 191
+    sbc r4, r0
+    jmp p83l4
+    mov.w r2, r0
+    neg r5
+p83l4:
+    sub r7, 1
+    jnz p83l3
+    jz p83l0
+    add r4, r7
+    jlt p83l5
+    add r0, 163
+    clv
+    str.d 1020, 2147483647
+p83l5:
+    mov.w r0, 63711
+    str r6, r0
+    ld.w r0, 1022
+    jnz p83l6
+    cmp 210, 166
+    cmp r7, r1
+    ld r5, r4
+p83l6:
+    adc r1, r7
+    jnz p83l7
+    cmp r4, r7
+p83l7:
+    cmp r1, 61
+p83l0:
@@ -0,0 +1,38 @@
+; program 84
+    cmp 163, r0
+    sbc r6, 0
+    mov r7, 29
+p84l1:
+    jlt p84l2
+    ptc 0
+    mov.d r0, 1940129186
+p84l2:
+    mul.w r3, r2
+    div r2, 238
+    sub r7, 1
+    jnz p84l1
+    mov r7, 22
+p84l3:
+    jnz p84l4
+    cmp r4, 124
+p84l4:
+    sub r7, 1
+    jnz p84l3
+    mov r7, 7
+p84l5:
+    shr.d r1, 9
+    div r6, 193
+    cmp r2, r0
+    str.w r0, r2
+    mcmp.w 439, 541, 420
+    div r4, 122
+    jnz p84l6
+    mul r0, r2
+    mset.w 180, r5, 236
+    nop
+p84l6:
+    sbc r2, r5
+    div r0, 170
+    sub r7, 1
+    jnz p84l5
+p84l0:
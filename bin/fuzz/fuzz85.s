@@ -0,0 +1,56 @@
+; program 85
+    jnz p85l1
+    shr.w r3, 9
+    ld.w r0, 1022
+    shr r6, 1
+    sub r0, 65
+p85l1:
+    shr r5, 0
+    jz p85l2
+    mset 241, 112, 9
+    neg r6
+    div.d r1, 128
+    cmp r3, r1
+p85l2:
+    mul.w r1, 1
+    hlt
+    nop
+    div r5, 66
+    neg r6
+    mov r4, 0
+    mov.d r2, 2011653606
+    ptn 1
+    sbc r0, 249
+    mov r2, 171
+    jgt p85l3
+    div r6, 8
+    cmp r7, 67
+    clv
+    sbc r3, 170
+p85l3:
+    sub.d r0, r2
+    mxor.w 299, 428, 275
+    jne p85l4
+    nop
+    add.d r0, r0
+p85l4:
+    str r5, r0
+    mov.w r4, 127
+    str.w 1021, 0
+    mov r7, 67
+p85l5:
+    nop
+    mul r3, 168
+    sub r7, 1
+    jnz p85l5
+    mul r4, r3
+    jmp p85l0
+    jnz p85l6
+    ld r4, 56
+    cmp 241, r1
+    add r5, r4
+p85l6:
+    ptn r4
+    str.d r2, r1
+    nop
+p85l0:
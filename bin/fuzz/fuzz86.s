@@ -0,0 +1,60 @@
+; program 86
+    adc r4, 188
+    jmp p86l1
+    cmp.w r1, r6
+    cmp 23, r1
+p86l1:
+    add r4, 255
+    sub r6, rz
+    shl r4, 4
+    jmp p86l2
+    div r4, 36
+    mov r6, r5
+    shl r3, 12
+    clc
+p86l2:
+    add r6, 193
+    jmp p86l3
+    shr.w r5, 8
+    mul.w r0, 32767
+p86l3:
+    div.w r3, 40645
+    mov r6, 126
+    jz p86l0
+    div r0, 53
+    neg r4
+    nop
+    jlt p86l4
+    shr r3, 9
+p86l4:
+    shr r0, 13
+    sub.d r1, 65535
+    cmp r4, 255
+    shl r4, 0
+    str.w 1021, r1
+    shl r6, 2
+    mov r7, 36
+p86l5:
+    div.w r4, 1
+    cmp.d r3, 1
+    str r7, r0
+    shr r3, 1
+    sbc r3, 1
+    shl r3, 6
+    sub.w r2, r6
+    sub r7, 1
+    jnz p86l5
+    jne p86l6
+    nop
+    ptu 108
+    mxor 88, 35, 15
+    sbc r3, r1
+p86l6:
+    jlt p86l7
+    str 31, 112
+    sbc r1, 29
+    ptu 2
+    str r2, 255
+p86l7:
+    nop
+p86l0:
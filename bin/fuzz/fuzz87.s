@@ -0,0 +1,62 @@
+; program 87
+    ptn r5
+    ld r6, 124
+    mcmp.w 926, 103, 65
+    mcpy.w 383, r2, r3
+    str.d 1917016059, 2147483648
+    shr.w r4, 1
+    cmp 128, r0
+    str r0, 255
+    sbc r5, 2
+    mul.d r3, 3655812761
+    cmp.w 941, 17999
+    cmp r7, 255
+    jgt p87l1
+    sub.d r3, 327407020
+    shr r5, 9
+p87l1:
+    sbc r4, r1
+    sbc r3, 79
+    neg r0
+    mov r7, 11
+p87l2:
+    jlt p87l3
+    clc
+    cmp.d 32767, r3
+    cmp 255, 177
+p87l3:
+    sub r7, 1
+    jnz p87l2
+    mov r7, 98
+p87l4:
+    je p87l5
+    mov r4, 255
+    add r6, r6
+    str r6, 84
+p87l5:
+    sub r7, 1
+    jnz p87l4
+    mov r7, 62
+p87l6:
+    jlt p87l7
+    neg r5
+    str r1, r3
+p87l7:
+    jnz p87l8
+    cmp 121, rz
+    div.w r2, 862
+    mov r3, 255
+p87l8:
+    cmp r0, r3
+    cmp 40, r2
+    sbc r2, 81
+    clc
+    adc r4, r3
+    mxor 164, 94, 82
+    sub r7, 1
+    jnz p87l6
+    cmp r5, 139
+    mul r0, r5
+    nop
+    shl r1, 13
+p87l0:
@@ -0,0 +1,31 @@
+; program 88
+    shr.d r2, 15
+    hlt
+    mov r2, r6
+    ld.w r2, 37736
+    madd.w 835, 1005, 1
+    jgt p88l1
+    sub r6, rz
+    shl r4, 3
+p88l1:
+    jgt p88l2
+    sbc r1, r4
+p88l2:
+    neg r4
+    cmp.d 972264376, r4
+    shr r1, 14
+    sub r2, 0
+    mov r7, 66
+p88l3:
+    clv
+    sub r7, 1
+    jnz p88l3
+    ptu r5
+    mul r5, rz
+    cmp 223, r2
+    jmp p88l4
+    mul.w r5, 9682
+    nop
+p88l4:
+    clv
+p88l0:
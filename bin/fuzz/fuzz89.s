@@ -0,0 +1,28 @@
+; program 89
+    mov r7, 48
+p89l1:
+    sbc r5, 202
+    ptc 31
+    nop
+    add r0, 160
+    shr.w r4, 14
+    mul r2, 255
+    sub r7, 1
+    jnz p89l1
+    neg r6
+    mul r1, 230
+    mov.d r3, 65535
+    shl.w r2, 9
+    sub r6, r4
+    cmp 0, r5
+    neg r2
+    jgt p89l2
+    sub r1, 142
+p89l2:
+    jnz p89l3
+    cmp.w 128, 0
+p89l3:
+    mcmp.w 290, 52, 424
+    mul.d r1, r3
+    ptc 208
+p89l0:
@@ -0,0 +1,32 @@
+; program 9
+    jne p9l1
+    str.w r2, 48378
+    div r1, 159
+p9l1:
+    mul.d r0, r2
+    div r4, 164
+    div r6, 13
+    ptc r3
+    neg r0
+    shr r1, 10
+    ld r3, 235
+    add r5, r0
+    mov r7, 90
+p9l2:
+    sbc r6, 28
+    sub r7, 1
+    jnz p9l2
+    add.d r0, r0
+    str 90, r5
+    nop
+    sub r4, 43
+    mul.w r2, 65535
+    sbc r0, 255
+    pts.w 718, 18
+    cmp r6, r7
+    neg r0
+    sbc r4, 1
+    mov r3, r7
+    add.w r5, 255
+    shl.d r1, 10
+p9l0:
@@ -0,0 +1,25 @@
+; program 90
+    cmp.w r4, 127
+    div r6, 191
+    jgt p90l1
+    sub r0, 0
+    str.d 65535, 0
+    mov r6, 179
+p90l1:
+    jnz p90l2
+    clv
+    shr r3, 14
+    shl.d r2, 9
+    sub r5, rz
+p90l2:
+    sub.d r1, 1057084459
+    cmp.d r3, r2
+    cmp 1, r1
+    ptn r7
+    ld r3, r7
+    neg r1
+    cmp.w r1, r6
+    shl r4, 13
+    adc r5, 255
+    adc r6, r4
+p90l0:
@@ -0,0 +1,15 @@
+; program 91
+    add r2, r7
+    clv
+    sub.w r0, 44449
+    mul r2, r0
+    jne p91l1
+    cmp 127, r3
+    cmp.w 32767, 127
+p91l1:
+    ld r2, 130
+    nop
+    je p91l2
+    nop
+p91l2:
+p91l0:
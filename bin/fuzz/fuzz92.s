@@ -0,0 +1,66 @@
+; program 92
+    cmp 128, 255
+    ld r0, 16
+    jz p92l1
+    nop
+    div.w r4, 32768
+    sbc r3, r3
+p92l1:
+    add.w r3, 128
+    shr r6, 2
+    cmp.d r0, r3
+    cmp r6, 255
+    mcmp.w 626, 540, 22
+    clc
+    str r3, r4
+    jne p92l2
+    mov r5, r5
+p92l2:
+    jne p92l3
+    sub r5, 255
+    str.w 10815, 32767
+p92l3:
+    mov r7, 72
+p92l4:
+    cmp 255, r6
+    jnz p92l5
+    sbc r2, r0
+p92l5:
+    mov r2, 103
+    shl.d r2, 1
+    cmp.d 1739137584, 2722254711
+    ld r6, 255
+    add.d r2, r0
+    jmp p92l6
+    str r0, rz
+    neg r4
+    mov r6, rz
+    ptc 242
+p92l6:
+    add.d r2, 3127310476
+    jz p92l7
+    adc r6, 255
+    neg r3
+    mxor 33, 13, 142
+    ld.d r0, 1020
+p92l7:
+    sub r7, 1
+    jnz p92l4
+    str.w 32767, r3
+    ld.w r4, 1023
+    nop
+    div r0, 188
+    sub r2, 128
+    mov r7, 28
+p92l8:
+    jz p92l9
+    clc
+    mul.d r3, r0
+    clc
+p92l9:
+    str 255, r7
+    mul r2, 78
+    sub r7, 1
+    jnz p92l8
+    je p92l0
+p92l0:
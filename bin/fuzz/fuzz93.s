@@ -0,0 +1,51 @@
+; program 93
+    div r4, 208
+    jgt p93l1
+    mul r1, r6
+    mul r1, 255
+    adc r0, 255
+    div.w r5, 1
+p93l1:
+    cmp r3, 128
+    shl.w r3, 6
+    sbc r1, 238
+    nop
+    mov r7, 47
+p93l2:
+    add r0, r5
+    neg r6
+    cmp.d 128, 128
+    sub r7, 1
+    jnz p93l2
+    mov r7, 22
+p93l3:
+    mul.d r1, 255
+    ptn r4
+    div.w r0, 1
+    sub r7, 1
+    jnz p93l3
+    jz p93l0
+    je p93l4
+    nop
+    str.d r0, r4
+    mov.w r4, 65492
+p93l4:
+    jlt p93l5
+    cmp r1, r6
+    str.d 4294967295, 255
+p93l5:
+    jnz p93l6
+    cmp.d 3119819422, 1341301745
+p93l6:
+    add.d r0, 2147483647
+    jlt p93l7
+    mul.d r0, r2
+p93l7:
+    ld r2, r2
+    div r6, 146
+    sbc r6, r5
+    jne p93l8
+    clv
+    add r6, 128
+p93l8:
+p93l0:
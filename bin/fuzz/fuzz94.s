@@ -0,0 +1,40 @@
+; program 94
+    div r4, 133
+    str 18, r1
+    jnz p94l0
+    div r3, 21
+    cmp.d r2, r2
+    ptu rz
+    nop
+    ld.w r2, 1022
+    je p94l1
+    div r5, 196
+p94l1:
+    nop
+    ptn 255
+    jgt p94l2
+    add r3, r5
+    mul r5, 255
+p94l2:
+    sbc r4, r0
+    ptc r4
+    mov r7, 36
+p94l3:
+    neg r6
+    mxor.w 604, 648, 228
+    nop
+    clc
+    nop
+    adc r1, 255
+    sub.d r1, 0
+    sub r7, 1
+    jnz p94l3
+    ptn 195
+    cmp rz, 255
+    jz p94l4
+    nop
+    ptn 54
+    cmp 255, r5
+p94l4:
+    clv
+p94l0:
@@ -0,0 +1,70 @@
+; program 95
+    mov r7, 61
+p95l1:
+    ptu 255
+    mcpy 48, 127, 65
+    ptu r3
+    mul r2, r7
+    sub r7, 1
+    jnz p95l1
+    mov r7, 3
+p95l2:
+    sbc r5, r2
+    neg r0
+    jz p95l3
+    ptu 1
+    cmp.d 0, r3
+p95l3:
+    ptc r3
+    ld.d r0, 1023
+    sbc r1, 54
+    cmp r4, r1
+    sub.d r1, 918981174
+    sub r7, 1
+    jnz p95l2
+    mcmp 175, 144, 72
+    sbc r0, 1
+    jmp p95l4
+    mov r2, 255
+    str 225, 0
+    mov r1, 50
+p95l4:
+    mov r7, 53
+p95l5:
+    shr.w r1, 13
+    mul r5, 45
+    je p95l6
+    sub r2, 112
+p95l6:
+    mov.d r3, r2
+    add r6, 198
+    mov.w r5, r2
+    sub r7, 1
+    jnz p95l5
+    jnz p95l7
+    ptc 242
+    add r3, r0
+p95l7:
+    adc r1, 219
+    add r4, r1
+    jnz p95l8
+    adc r2, r1
+    nop
+    clv
+    ld.w r4, 1023
+p95l8:
+    str r7, r0
+    adc r2, r4
+    nop
+    ld.w r5, 1020
+    shr r4, 12
+    cmp 57, 255
+    clc
+    mov r7, 66
+p95l9:
+    clc
+    clc
+    div r1, 104
+    sub r7, 1
+    jnz p95l9
+p95l0:
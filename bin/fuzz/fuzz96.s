@@ -0,0 +1,57 @@
+; program 96
+    mov r7, 59
+p96l1:
+    clv
+    cmp 0, 0
+    ptc 0
+    je p96l2
+    nop
+    clc
+    clv
+    mov.d r1, r4
+p96l2:
+    neg r0
+    str 2, r5
+    mul r0, 0
+    mul.d r3, r3
+    cmp 194, r3
+    shr.w r4, 8
+    sub r7, 1
+    jnz p96l1
+    sbc r4, r7
+    mul.d r2, 4294967295
+    jz p96l3
+    clv
+    sbc r1, r2
+p96l3:
+    mov r7, 92
+p96l4:
+    div r1, 81
+    ld r4, r3
+    madd.w 195, 740, r0
+    add.w r3, 1
+    sub r7, 1
+    jnz p96l4
+    jgt p96l5
+    mov.d r3, r2
+    cmp.d r0, r1
+    add.d r3, 4235972252
+p96l5:
+    mov.d r1, r2
+    str 189, 185
+    ld r1, r0
+    shl r2, 5
+    sbc r4, r4
+    cmp.d r3, 4087840965
+    je p96l6
+    nop
+p96l6:
+    mset 62, 128, 100
+    pts 201, 15
+    mov r7, 70
+p96l7:
+    str 0, 152
+    cmp r4, r5
+    sub r7, 1
+    jnz p96l7
+p96l0:
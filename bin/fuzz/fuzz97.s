@@ -0,0 +1,22 @@
+; program 97
+    div r0, 58
+    sbc r2, rz
+    adc r4, r2
+    je p97l1
+    shr.w r1, 5
+    nop
+    sbc r0, r1
+p97l1:
+    mov.d r1, 3283312130
+    jz p97l2
+    sbc r1, r7
+    sub r4, r1
+    div r0, 162
+    neg r5
+p97l2:
+    hlt
+    shr r2, 9
+    str 255, 255
+    mov r0, r7
+    neg r0
+p97l0:
@@ -0,0 +1,16 @@
+; program 98
+    mov r7, 95
+p98l1:
+    neg r5
+    mul.w r0, 46479
+    sub.d r3, r4
+    str r5, 255
+    neg r6
+    jnz p98l2
+    mul r3, 24
+p98l2:
+    add r0, 95
+    sub r7, 1
+    jnz p98l1
+    str 93, 197
+p98l0:
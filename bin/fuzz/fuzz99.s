@@ -0,0 +1,51 @@
+; program 99
+    neg r3
+    mov r4, 0
+    clv
+    add r6, 94
+    mov.w r3, 30557
+    jne p99l0
+    jne p99l1
+    shr.d r2, 10
+    shr r6, 0
+    ld r0, r7
+p99l1:
+    nop
+    mcpy 180, 170, 73
+    adc r4, 16
+    jne p99l2
+    nop
+    nop
+    ld.w r2, 60065
+p99l2:
+    neg r5
+    jz p99l3
+    mov r5, r4
+    ld r3, 32
+    sub r0, 0
+p99l3:
+    sub r6, r7
+    jgt p99l4
+    str 90, 255
+    adc r5, 255
+    mov r1, r3
+    nop
+p99l4:
+    str 127, 255
+    nop
+    jgt p99l0
+    jne p99l5
+    mul r2, r5
+    div r5, 227
+p99l5:
+    shl r1, 13
+    neg r0
+    jlt p99l6
+    sub r0, 83
+    ptn 255
+    shr r5, 5
+    str.d 1020, 32767
+p99l6:
+    str.d r1, r4
+    sub r0, 91
+p99l0:
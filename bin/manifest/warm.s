@@ -0,0 +1,9 @@
+    mov r0, 42
+    mov r1, 7
+warm:
+    ptn r0
+    ptc 32
+    ptn r1
+    ptc 32
+    ptn r2
+    ptc 10
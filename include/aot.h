@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "common.h"
+#include "decoder.h"
+
+/* Writes `program` out as a standalone C program,
+which behaves just like `strvm` running it: same
+output, same errors, same exit code. `source_name`
+only goes in a comment at the top. */
+bool aot_write_c(const char* filename, const DecodedProgram* program, const char* source_name);
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+
+/* Many instances (lanes) of one program, stored as
+structure-of-arrays: registers[2][lane] is r2 of that
+lane, and memory[address * num_lanes + lane] is one of
+its bytes, for as much memory as the program can reach.
+Lanes that are at the same instruction run
+it together, one loop over all of them per instruction,
+which the compiler turns into SIMD code.
+
+Each flag is a byte per lane (0 or 1), rather than a
+bitfield, so that it can be computed the same way. */
+typedef struct {
+    int num_lanes;
+    uint8_t* registers[NUM_GP_REGISTERS];
+    uint8_t* carry;
+    uint8_t* overflow;
+    uint8_t* not_zero;
+    uint8_t* not_equal;
+    uint8_t* equal;
+    uint8_t* greater_than;
+    uint8_t* less_than;
+    uint32_t* program_counter;
+    uint32_t* instr_ptr;
+    uint8_t* memory;
+    uint32_t memory_size; // Bytes per lane, from decoder_memory_reach()
+    VM_Error* errors;
+    OutputSink** outputs; // NULL entries print to stdout
+    // Scratch space for vm_batch_run()
+    uint8_t* mask;
+    uint32_t* waiting_at;
+} VM_Batch;
+
+VM_Batch vm_batch_create(int num_lanes, uint32_t memory_size);
+void vm_batch_free(VM_Batch* batch);
+void vm_batch_load(VM_Batch* batch, int lane, const VM* vm);
+void vm_batch_store(const VM_Batch* batch, int lane, VM* vm);
+void vm_batch_run(VM_Batch* batch, const DecodedProgram* program);
\ No newline at end of file
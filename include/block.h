@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "ops.h"
+
+// The most instructions a block can hold, so that entering one partway doesn't copy too much
+#define BLOCK_MAX_LENGTH 64
+#define BLOCK_MIN_LENGTH 2
+/* Times the interpreter has to get to an instruction
+before a block is decoded there, since decoding costs
+more than running code that only runs once */
+#define BLOCK_WARM 2
+// What a BlockCache's `visits` holds once a block has been tried, if there can't be one
+#define BLOCK_REFUSED (BLOCK_WARM + 1)
+
+/* A run of instructions with only one way in, the
+first, and one way out, the last, decoded. A block
+ends at a jump, or just before anything it can't run:
+wide, bulk and channel instructions, hlt, and anything
+the decoder would turn into OP_TRAP. Those are left to
+the interpreter. */
+typedef struct Block {
+    uint32_t start;
+    uint32_t length;      // Instructions, including the jump if it ends with one
+    struct Block* next;   // Where it falls through to, once it's been there
+    struct Block* taken;  // Where its jump goes, if that's forward, once it's been there
+    DecodedInstruction ops[]; // `length`, then OP_END
+} Block;
+
+/* The blocks vm_run() has found so far, by the
+instruction they start at. Lives as long as a run, like
+a TraceCache. */
+typedef struct {
+    int num_instrs;
+    Block** blocks;   // NULL until the first block is decoded
+    uint8_t* visits;  // Up to BLOCK_WARM if there's a block there by then, or else BLOCK_REFUSED
+} BlockCache;
+
+void block_cache_free(BlockCache* cache);
+// For block_at(): counts a visit to `ip`, still warming up, and decodes a block there once it is
+Block* block_visit(BlockCache* cache, const VM* vm, Instruction instrs[], int num_instrs,
+                   uint32_t ip);
+
+// Whether `ip` has been tried, and there can't be a block starting there
+static inline bool block_refused(const BlockCache* cache, uint32_t ip) {
+    return cache->visits != NULL && cache->visits[ip] == BLOCK_REFUSED;
+}
+
+/* NULL if there's no block starting at `ip`, or not
+yet. Inline, since the interpreter asks after every
+instruction a block can't hold, and only needs to call
+out while an instruction is still warming up. */
+static inline Block* block_at(BlockCache* cache, const VM* vm, Instruction instrs[], int num_instrs,
+                              uint32_t ip) {
+    if (ip < (uint32_t)cache->num_instrs) {
+        uint8_t visits = cache->visits[ip];
+        if (visits == BLOCK_WARM)
+            return cache->blocks[ip];
+        if (visits == BLOCK_REFUSED)
+            return NULL;
+    }
+    return block_visit(cache, vm, instrs, num_instrs, ip);
+}
+
+bool block_run(VM* vm, LazyFlags* flags, BlockCache* cache, Instruction instrs[], int num_instrs,
+               Block* block);
\ No newline at end of file
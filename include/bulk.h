@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytewise dst[i] op= src[i] over `len` bytes, for
+madd and mxor. Overlapping ranges work as if all of
+`src` were read before anything was written. */
+void bulk_add(uint8_t* dst, const uint8_t* src, size_t len);
+void bulk_xor(uint8_t* dst, const uint8_t* src, size_t len);
\ No newline at end of file
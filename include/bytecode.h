@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+
+#define BYTECODE_MAGIC     "strvmbc"
+#define BYTECODE_VERSION   7
+#define BYTECODE_ALIGNMENT 16
+
+typedef enum {
+    BYTECODE_OK,
+    BYTECODE_IO_ERROR,
+    BYTECODE_NOT_AN_IMAGE,
+    BYTECODE_BAD_VERSION,
+    BYTECODE_BAD_LAYOUT, // Written by a build with different struct layouts
+    BYTECODE_CORRUPT
+} BytecodeError;
+
+/* Sections are stored in the host's native struct
+layout, so that they can be executed straight out of
+the mapping. The size and endianness fields make sure
+that an image is only ever loaded by a compatible build. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t checksum; // FNV-1a of everything after the header
+    uint32_t size;     // Of the whole image, header included
+    uint16_t endianness;
+    uint8_t instruction_size;
+    uint8_t decoded_size;
+    uint8_t error_size;
+    uint8_t padding[3];
+    uint32_t num_instrs;
+    uint32_t num_labels;
+    uint32_t num_traps;
+    uint32_t num_constants;
+    uint32_t instrs_offset;    // Instruction[num_instrs]
+    uint32_t labels_offset;    // uint32_t[num_labels], the label addresses, or LABEL_UNDEFINED
+    uint32_t decoded_offset;   // DecodedInstruction[num_instrs + 1]
+    uint32_t traps_offset;     // VM_Error[num_traps]
+    uint32_t constants_offset; // uint32_t[num_constants], for wide and bulk instructions
+} BytecodeHeader;
+
+typedef struct {
+    BytecodeError error;
+    const BytecodeHeader* header;
+    Instruction* instrs;
+    const uint32_t* label_addresses;
+    DecodedProgram decoded;
+    void* base;
+    size_t size;
+    bool mapped;
+} BytecodeImage;
+
+BytecodeError bytecode_write(const char* filename, Instruction instrs[], int num_instrs,
+                             Label labels[], int num_labels);
+BytecodeImage bytecode_load(const char* filename);
+BytecodeImage bytecode_load_memory(const void* data, size_t size);
+// The image's labels, in an array of their own for the caller to free
+Label* bytecode_labels(const BytecodeImage* image);
+void bytecode_unload(BytecodeImage* image);
+const char* bytecode_error_string(BytecodeError error);
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NUM_CHANNELS     256
+#define CHANNEL_CAPACITY 64
+
+// Set in ChannelSet.touched
+#define CHANNEL_SENT     1
+#define CHANNEL_RECEIVED 2
+
+typedef struct {
+    uint8_t data[CHANNEL_CAPACITY];
+    uint32_t head; // Where the next byte is received from
+    uint32_t len;
+} Channel;
+
+/* Byte queues that a group of VMs (and their host)
+talk over. Nothing here ever waits: a send to a full
+channel or a receive from an empty one just fails, and
+the VM stops with BLOCKED so that whatever is running
+it can try again once the channel is ready. */
+typedef struct {
+    Channel channels[NUM_CHANNELS];
+    // What's happened to each channel since channel_clear_touched(), so waiters can be woken
+    uint8_t touched[NUM_CHANNELS];
+    uint8_t touched_list[NUM_CHANNELS];
+    int num_touched;
+    // The last channel a VM blocked on, and whether it was sending
+    uint8_t blocked_channel;
+    bool blocked_sending;
+} ChannelSet;
+
+ChannelSet* channel_set_create();
+void channel_set_free(ChannelSet* set);
+bool channel_send(ChannelSet* set, uint8_t channel, uint8_t value);
+bool channel_receive(ChannelSet* set, uint8_t channel, uint8_t* value);
+void channel_clear_touched(ChannelSet* set);
\ No newline at end of file
@@ -1,20 +1,39 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "fiesta/str.h"
 
-#define MAX_INSTRS  1024
-#define MAX_LABELS  1024
-
 #define NUM_GP_REGISTERS      8
 #define NUM_SPECIAL_REGISTERS 5
 #define NUM_OPERANDS          3
-#define MEMORY_SIZE        1024
+
+// Special registers come after the general purpose ones, in this order
+enum {
+    REGISTER_RST = NUM_GP_REGISTERS,
+    REGISTER_RZ,
+    REGISTER_RCMP,
+    REGISTER_PC,
+    REGISTER_IP
+};
+
+/* Bytes of memory each VM has, which lives in the VM
+itself, so it's also what every green thread, fork and
+queued job costs. Set with `make MEMORY_SIZE=...` for
+programs that need more. Addresses wrap around, which
+needs it to be a power of two, and plain ld and str can
+reach the first 256 bytes. */
+#ifndef MEMORY_SIZE
+#define MEMORY_SIZE 1024
+#endif
+_Static_assert(MEMORY_SIZE >= 256 && (MEMORY_SIZE & (MEMORY_SIZE - 1)) == 0,
+               "MEMORY_SIZE has to be a power of two, and at least 256");
 
 typedef struct {
     str name;
-    uint16_t address;
+    uint32_t address; // 0 if it's used but never defined
+    bool defined;
 } Label;
 
 typedef enum {
@@ -45,16 +64,37 @@ typedef enum {
     PTN, // PRINT AS SIGNED NUMBER (R/I)
     PTU, // PRINT AS UNSIGNED NUMBER (R/I)
     HLT, // HALT EXECUTION
+    SND, // SEND ON CHANNEL (R/I) (R/I)
+    RCV, // RECEIVE FROM CHANNEL (R) (R/I)
+    // Bulk memory instructions, whose operands are all addresses, lengths or values
+    MCPY, // COPY MEMORY (R/I) (R/I) (R/I)
+    MSET, // FILL MEMORY (R/I) (R/I) (R/I)
+    MCMP, // COMPARE MEMORY (R/I) (R/I) (R/I)
+    MADD, // ADD MEMORY BYTEWISE (R/I) (R/I) (R/I)
+    MXOR, // XOR MEMORY BYTEWISE (R/I) (R/I) (R/I)
+    PTS,  // PRINT MEMORY AS CHARS (R/I) (R/I)
     NUM_INSTR_TYPES
 } InstructionType;
 
+/* How many bytes an instruction works on, as a
+power of two. Wide instructions treat a register as the
+low byte of a little-endian group (so with WIDTH_WORD,
+r2 is r3:r2), and take immediates of the same width. */
+typedef enum {
+    WIDTH_BYTE,  // No suffix
+    WIDTH_WORD,  // .w
+    WIDTH_DWORD, // .d
+    NUM_WIDTHS
+} Width;
+
 typedef struct {
     bool is_register;
     bool is_label;
-    uint8_t value;
+    uint32_t value; // Register number, immediate or label index
 } Operand;
 
 typedef struct {
     InstructionType type;
+    uint8_t width; // A Width
     Operand operands[NUM_OPERANDS];
 } Instruction;
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "ops.h"
+
+/* Instructions specialized by operand kind: REG is a
+general purpose register, IMM is an immediate, and ABS
+is an absolute instruction index. Operands are checked
+once when decoding, so the engine never has to. */
+typedef enum {
+    OP_NOP,
+    OP_MOV_REG_REG, OP_MOV_REG_IMM,
+    OP_ADD_REG_REG, OP_ADD_REG_IMM,
+    OP_ADC_REG_REG, OP_ADC_REG_IMM,
+    OP_SBC_REG_REG, OP_SBC_REG_IMM,
+    OP_SUB_REG_REG, OP_SUB_REG_IMM,
+    OP_MUL_REG_REG, OP_MUL_REG_IMM,
+    OP_DIV_REG_REG, OP_DIV_REG_IMM,
+    OP_SHL_REG_REG, OP_SHL_REG_IMM,
+    OP_SHR_REG_REG, OP_SHR_REG_IMM,
+    OP_CLC,
+    OP_CLV,
+    OP_NEG_REG,
+    OP_STR_REG_REG, OP_STR_REG_IMM, OP_STR_IMM_REG, OP_STR_IMM_IMM,
+    OP_LD_REG_REG, OP_LD_REG_IMM,
+    OP_CMP_REG_REG, OP_CMP_REG_IMM, OP_CMP_IMM_REG, OP_CMP_IMM_IMM,
+    OP_JMP_ABS,
+    OP_JNE_ABS,
+    OP_JE_ABS,
+    OP_JGT_ABS,
+    OP_JLT_ABS,
+    OP_JNZ_ABS,
+    OP_JZ_ABS,
+    OP_PTC_REG, OP_PTC_IMM,
+    OP_PTN_REG, OP_PTN_IMM,
+    OP_PTU_REG, OP_PTU_IMM,
+    OP_SND_REG_REG, OP_SND_REG_IMM, OP_SND_IMM_REG, OP_SND_IMM_IMM,
+    OP_RCV_REG_REG, OP_RCV_REG_IMM,
+    // Wide instructions, whose immediates are in `constants`
+    OP_WIDE_MOV_REG_REG, OP_WIDE_MOV_REG_IMM,
+    OP_WIDE_ADD_REG_REG, OP_WIDE_ADD_REG_IMM,
+    OP_WIDE_SUB_REG_REG, OP_WIDE_SUB_REG_IMM,
+    OP_WIDE_MUL_REG_REG, OP_WIDE_MUL_REG_IMM,
+    OP_WIDE_DIV_REG_REG, OP_WIDE_DIV_REG_IMM,
+    OP_WIDE_SHL_REG_REG, OP_WIDE_SHL_REG_IMM,
+    OP_WIDE_SHR_REG_REG, OP_WIDE_SHR_REG_IMM,
+    OP_WIDE_LD_REG_REG, OP_WIDE_LD_REG_IMM,
+    OP_WIDE_STR_REG_REG, OP_WIDE_STR_REG_IMM, OP_WIDE_STR_IMM_REG, OP_WIDE_STR_IMM_IMM,
+    OP_WIDE_CMP_REG_REG, OP_WIDE_CMP_REG_IMM, OP_WIDE_CMP_IMM_REG, OP_WIDE_CMP_IMM_IMM,
+    // Bulk instructions, in the same order as their InstructionTypes
+    OP_MCPY, OP_MSET, OP_MCMP, OP_MADD, OP_MXOR, OP_PTS,
+    OP_HLT,
+    OP_TRAP, // Raises the error the instruction would have raised
+    OP_END,  // Sentinel placed after the last instruction
+    NUM_DECODED_TYPES
+} DecodedType;
+
+/* Bulk instructions have too many operands for `a`
+and `b`, so they keep all of them in `constants`, each
+either a register number or an immediate, with bit i of
+`a` set if operand i is a register */
+typedef struct {
+    uint8_t type;
+    uint8_t a;       // Destination register or first value
+    uint8_t b;       // Source register or second value
+    uint8_t width;   // A Width, for wide and bulk instructions
+    /* Jump destination, index into `traps`, or for wide
+    and bulk instructions, where their operands start in
+    `constants` (the first operand's first) */
+    uint32_t target;
+} DecodedInstruction;
+
+/* Decoded instructions keep the same indices as the
+instructions they came from, so `instr_ptr` means the
+same thing to every engine */
+typedef struct {
+    DecodedInstruction* instrs; // `num_instrs` + 1, for OP_END
+    int num_instrs;
+    VM_Error* traps;
+    int num_traps;
+    uint32_t* constants;
+    int num_constants;
+} DecodedProgram;
+
+static inline bool decoded_is_wide(uint8_t type) {
+    return type >= OP_WIDE_MOV_REG_REG && type <= OP_WIDE_CMP_IMM_IMM;
+}
+
+static inline bool decoded_is_bulk(uint8_t type) {
+    return type >= OP_MCPY && type <= OP_PTS;
+}
+
+/* What op_wide_arith() should do for a wide mov or
+arithmetic instruction, which come in pairs, REG_REG
+then REG_IMM, in the same order as here */
+static inline InstructionType decoded_wide_arith(uint8_t type) {
+    static const InstructionType arith[] = {MOV, ADD, SUB, MUL, DIV, SHL, SHR};
+    return arith[(type - OP_WIDE_MOV_REG_REG) / 2];
+}
+
+DecodedProgram decoder_decode(Instruction instrs[], int num_instrs, Label labels[], int num_labels);
+void decoder_free(DecodedProgram* program);
+/* Decodes one instruction on its own, for engines that
+only want some of a program decoded. Wide and bulk
+instructions need a whole DecodedProgram, so they fail
+here along with anything that would be an OP_TRAP. */
+bool decoder_decode_instruction(DecodedInstruction* out, Instruction instr,
+                                Label labels[], int num_labels, int num_instrs);
+uint32_t decoder_memory_reach(const DecodedProgram* program);
+VM_Error vm_run_decoded(VM* vm, DecodedProgram* program);
+VM_Error vm_run_decoded_budget(VM* vm, DecodedProgram* program, VM_Budget* budget);
+// For engines that hand wide and bulk instructions back to C
+void decoder_run_wide(VM* vm, LazyFlags* flags, const DecodedProgram* program,
+                      const DecodedInstruction* instr);
+bool decoder_run_bulk(VM* vm, LazyFlags* flags, const DecodedProgram* program,
+                      const DecodedInstruction* instr);
+VM_Error decoder_bulk_error(const DecodedProgram* program, const DecodedInstruction* instr);
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+
+/* A decoded program translated to x86-64 machine code.
+The decoded program has to outlive it, since errors
+are looked up in its traps. */
+typedef struct {
+    const DecodedProgram* program;
+    uint8_t* code;        // NULL if the program couldn't be compiled
+    size_t size;
+    uint32_t* entries;    // Where to start running each instruction from
+    uint32_t* from_block; // How far each instruction is into its basic block
+} JitProgram;
+
+bool jit_supported();
+JitProgram jit_compile(const DecodedProgram* program);
+void jit_free(JitProgram* program);
+VM_Error vm_run_jit(VM* vm, JitProgram* program);
\ No newline at end of file
@@ -7,23 +7,72 @@
 
 #include "fiesta/str.h"
 
+/* Every array grows as needed, so programs are only
+limited by memory. `instrs` always has room for at
+least `cur_instr` + 1 instructions, any of which that
+are never written to are NOPs.
+
+Label names point into `src`, so it has to outlive
+them, except when lexing a stream, which copies them into
+`names` instead. */
+typedef struct NameBlock NameBlock;
+
 typedef struct {
     str src;
     int cur;
     int line_num;
-    Instruction instrs[MAX_INSTRS];
+    Instruction* instrs;
+    int instrs_capacity;
+    int* lines; // The source line each instruction is on, from 1
+    int lines_capacity;
     int cur_instr;
     uint8_t cur_operand;
-    Label labels[MAX_LABELS];
-    int cur_label_index;
+    Label* labels;
+    int labels_capacity;
     int num_labels;
+    uint32_t* label_slots; // Label index + 1, or 0 if empty, and NULL once lexing is done
+    int num_label_slots;   // A power of two, and at most half full
+    NameBlock* names;
+    bool copy_names;
     bool had_error;
 } LexerState;
 
-static bool names_initialized = false;
-static dynstr instruction_names[NUM_INSTR_TYPES];
-static dynstr gp_register_names[NUM_GP_REGISTERS];
-static dynstr special_register_names[NUM_SPECIAL_REGISTERS];
+// Labels that are used before they're defined, until they are
+#define LABEL_UNDEFINED UINT32_MAX
+
+// How much a stream reads at once, although lines longer than this are still read whole
+#define LEXER_BLOCK_SIZE 65536
+
+/* Source lexed as it's read from a file descriptor,
+such as a pipe, so that it can start being run before
+the rest of it has even been written. Only the current
+block is ever held, besides `lexed` itself.
 
+The first `num_runnable` instructions in `lexed` are
+complete, and refer to no labels still to come, so they
+can be run as they are, while `lexed.labels` is only
+ever added to or patched. Both arrays can be moved by
+every lexer_stream_next(). */
+typedef struct {
+    LexerState lexed;
+    int fd;
+    char* block;
+    int block_len;
+    int block_capacity;
+    int num_runnable;
+    bool at_end;
+    bool read_failed; // As well as lexed.had_error
+} LexerStream;
+
+str read_file_to_str(const char* filename);
 LexerState lexer_lex(str src);
-void lexer_free(LexerState* ls);
\ No newline at end of file
+/* Gives the same result as lexer_lex(), but splits
+`src` between up to `num_threads` threads. Sources under
+128 KiB aren't worth splitting, and are just lexed on
+this one. */
+LexerState lexer_lex_parallel(str src, int num_threads);
+void lexer_free(LexerState* ls);
+
+LexerStream lexer_stream_open(int fd);
+bool lexer_stream_next(LexerStream* stream);
+void lexer_stream_close(LexerStream* stream);
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The API for embedding strvm, and all that
+libstrvm.so exports. None of the VM's own structs show
+through, so they can change without embedders having to
+be rebuilt; STRVM_API_VERSION only goes up when
+something here does.
+
+A program is compiled (or loaded from bytecode) once,
+and never changes after that, so any number of threads
+can share one. Each context is a VM of its own, created
+from a program, and can only be used by one thread at a
+time. There is no global state, so nothing needs setting
+up or tearing down around them. */
+
+#define STRVM_API_VERSION 2
+
+// libstrvm.so is built with everything else hidden
+#if defined(__GNUC__)
+#define STRVM_API __attribute__((visibility("default")))
+#else
+#define STRVM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct StrvmProgram StrvmProgram;
+typedef struct StrvmContext StrvmContext;
+
+// Values are fixed, so they can be stored or sent elsewhere
+typedef enum {
+    STRVM_OK = 0,                  // Ran off the end of the program
+    STRVM_HALTED = 1,
+    STRVM_OUT_OF_FUEL = 2,         // Can be carried on by running again
+    STRVM_BLOCKED = 3,             // On a channel, which contexts never have, so for good
+    STRVM_INVALID_INSTRUCTION = 4,
+    STRVM_INVALID_OPERAND = 5,
+    STRVM_PARSE_ERROR = 6,         // Only from strvm_compile()
+    STRVM_BAD_BYTECODE = 7         // Only from strvm_load_bytecode()
+} StrvmStatus;
+
+typedef enum {
+    STRVM_ENGINE_INTERP = 0,
+    STRVM_ENGINE_DECODED = 1,
+    STRVM_ENGINE_JIT = 2 // Falls back to STRVM_ENGINE_DECODED where there's no JIT
+} StrvmEngine;
+
+#define STRVM_UNLIMITED_FUEL UINT64_MAX
+
+/* Given output as it's printed. Output is buffered, so
+it comes in chunks, and whatever's left over comes at
+the end of every run. Called on the thread doing the
+running. */
+typedef void (*StrvmWriteFn)(void* user_data, const char* data, size_t len);
+
+/* Both fill in `*program` only if they return
+STRVM_OK. `opt_level` is as for -O, from 0 (none) up. */
+STRVM_API StrvmStatus strvm_compile(const char* source, size_t len, int opt_level,
+                                    StrvmProgram** program);
+STRVM_API StrvmStatus strvm_load_bytecode(const void* image, size_t size, StrvmProgram** program);
+// Every context created from it has to have been freed first
+STRVM_API void strvm_program_free(StrvmProgram* program);
+/* Whether the program passed the verifier when it was
+created, in which case the interpreter runs it without
+checking its operands as it goes. Programs that don't
+pass still run, and fail wherever they go wrong. */
+STRVM_API bool strvm_program_verified(const StrvmProgram* program);
+
+/* Starts with everything zeroed, at the start of the
+program, with output discarded */
+STRVM_API StrvmContext* strvm_context_create(const StrvmProgram* program);
+// Back to how strvm_context_create() left it, but keeping the output callback
+STRVM_API void strvm_context_reset(StrvmContext* context);
+STRVM_API void strvm_context_free(StrvmContext* context);
+// `write` can be NULL to discard output
+STRVM_API void strvm_set_output(StrvmContext* context, StrvmWriteFn write, void* user_data);
+
+/* Runs from wherever the context is up to, for at most
+`fuel` instructions (give or take; see the README), or
+STRVM_UNLIMITED_FUEL. Runs with fuel always use the
+interpreter or the decoded engine, since compiled code
+can't stop partway. */
+STRVM_API StrvmStatus strvm_run(StrvmContext* context, StrvmEngine engine, uint64_t fuel);
+
+// Registers are r0-r7; any other index reads as 0 and can't be written
+STRVM_API uint8_t strvm_get_register(const StrvmContext* context, int index);
+STRVM_API void strvm_set_register(StrvmContext* context, int index, uint8_t value);
+/* Both copy as much of `len` bytes as fits before the
+end of memory, and return how much that was */
+STRVM_API size_t strvm_read_memory(const StrvmContext* context, uint32_t address,
+                                   void* data, size_t len);
+STRVM_API size_t strvm_write_memory(StrvmContext* context, uint32_t address,
+                                    const void* data, size_t len);
+STRVM_API size_t strvm_memory_size(void);
+// How many instructions have run since the context was created or reset
+STRVM_API uint64_t strvm_instructions_run(const StrvmContext* context);
+
+STRVM_API const char* strvm_status_string(StrvmStatus status);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "strvm.h"
+#include "output.h"
+#include "channel.h"
+#include "bulk.h"
+
+/* Instruction semantics that more than one execution
+engine needs. Anything that touches flags or produces
+output lives here, so the engines can't drift apart. */
+
+/* adc and sbc, on their own so that engines which
+don't keep flags in a StatusRegister can share them.
+Carry is the carry out of bit 7, which for sbc means a
+borrow, and overflow is set if the result has the wrong
+sign for a signed operation. Both are always written,
+so they're cleared as well as set. */
+
+static inline uint8_t op_add_carry(uint8_t a, uint8_t b, uint8_t carry_in,
+                                   uint8_t* carry, uint8_t* overflow) {
+    unsigned sum = a + b + carry_in;
+    uint8_t result = sum;
+    *carry = sum >> 8;
+    *overflow = ((a ^ result) & (b ^ result)) >> 7;
+    return result;
+}
+
+static inline uint8_t op_sub_borrow(uint8_t a, uint8_t b, uint8_t borrow_in,
+                                    uint8_t* borrow, uint8_t* overflow) {
+    unsigned difference = (unsigned)a - b - borrow_in;
+    uint8_t result = difference;
+    *borrow = difference >> 8 & 1;
+    *overflow = ((a ^ b) & (a ^ result)) >> 7;
+    return result;
+}
+
+static inline void op_cmp(VM* vm, uint32_t a, uint32_t b) {
+    vm->compare_register = (CompareFlags){.not_equal = a != b,
+                                          .equal = a == b,
+                                          .greater_than = a > b,
+                                          .less_than = a < b};
+}
+
+typedef enum {
+    CARRY_SETTLED, // Carry and overflow are up to date in the VM
+    CARRY_FROM_ADC,
+    CARRY_FROM_SBC
+} CarrySource;
+
+/* Flags as a run sees them. Working out flags after
+every instruction is wasted effort when hardly any are
+read, so instead, arithmetic only records its result,
+cmp its operands, and adc and sbc their operands, and
+the flags are only worked out from those when a jump,
+adc or sbc needs them. flags_settle() writes them all
+back to the VM once the run is over. */
+typedef struct {
+    uint8_t result; // not_zero is whether this is nonzero
+    bool cmp_pending;
+    uint32_t cmp_a; // Wide, for wide cmps
+    uint32_t cmp_b;
+    uint8_t carry_source; // A CarrySource
+    uint8_t carry_a;
+    uint8_t carry_b;
+    uint8_t carry_in;
+} LazyFlags;
+
+static inline LazyFlags flags_load(const VM* vm) {
+    return (LazyFlags){.result = vm->status_register.not_zero};
+}
+
+static inline CompareFlags flags_compare(const VM* vm, const LazyFlags* flags) {
+    if (!flags->cmp_pending)
+        return vm->compare_register;
+    uint32_t a = flags->cmp_a, b = flags->cmp_b;
+    return (CompareFlags){.not_equal = a != b, .equal = a == b,
+                          .greater_than = a > b, .less_than = a < b};
+}
+
+static inline void flags_cmp(LazyFlags* flags, uint32_t a, uint32_t b) {
+    flags->cmp_pending = true;
+    flags->cmp_a = a;
+    flags->cmp_b = b;
+}
+
+static inline void flags_settle_carry(VM* vm, LazyFlags* flags) {
+    if (flags->carry_source == CARRY_SETTLED)
+        return;
+    uint8_t carry, overflow;
+    if (flags->carry_source == CARRY_FROM_ADC)
+        op_add_carry(flags->carry_a, flags->carry_b, flags->carry_in, &carry, &overflow);
+    else
+        op_sub_borrow(flags->carry_a, flags->carry_b, flags->carry_in, &carry, &overflow);
+    vm->status_register.carry = carry;
+    vm->status_register.overflow = overflow;
+    flags->carry_source = CARRY_SETTLED;
+}
+
+static inline void flags_settle(VM* vm, LazyFlags* flags) {
+    vm->status_register.not_zero = flags->result != 0;
+    flags_settle_carry(vm, flags);
+    if (flags->cmp_pending) {
+        op_cmp(vm, flags->cmp_a, flags->cmp_b);
+        flags->cmp_pending = false;
+    }
+}
+
+// Only the result is worked out now
+static inline void op_adc(VM* vm, LazyFlags* flags, uint8_t* dst, uint8_t value, bool subtract) {
+    flags_settle_carry(vm, flags);
+    uint8_t carry_in = vm->status_register.carry;
+    flags->carry_source = subtract ? CARRY_FROM_SBC : CARRY_FROM_ADC;
+    flags->carry_a = *dst;
+    flags->carry_b = value;
+    flags->carry_in = carry_in;
+    *dst = subtract ? *dst - value - carry_in : *dst + value + carry_in;
+    flags->result = *dst;
+}
+
+static inline void op_clc(VM* vm, LazyFlags* flags) {
+    flags_settle_carry(vm, flags);
+    vm->status_register.carry = 0;
+}
+
+static inline void op_clv(VM* vm, LazyFlags* flags) {
+    flags_settle_carry(vm, flags);
+    vm->status_register.overflow = 0;
+}
+
+/* Wide instructions. Register groups and values in
+memory are little-endian, and memory wraps around at
+MEMORY_SIZE a byte at a time, so nothing a wide
+instruction does can go out of bounds. Registers are
+only read and written through the group's first one,
+which the decoder has already checked is far enough
+from the end. */
+
+static inline uint32_t width_mask(uint8_t width) {
+    return width == WIDTH_DWORD ? UINT32_MAX : (1u << (8 << width)) - 1;
+}
+
+static inline uint32_t op_wide_get(const Register* group, uint8_t width) {
+    switch (width) {
+        case WIDTH_WORD:
+            return group[0].value | group[1].value << 8;
+        case WIDTH_DWORD:
+            return group[0].value | group[1].value << 8 | group[2].value << 16
+                 | (uint32_t)group[3].value << 24;
+        default:
+            return group[0].value;
+    }
+}
+
+static inline void op_wide_set(Register* group, uint8_t width, uint32_t value) {
+    switch (width) {
+        case WIDTH_DWORD:
+            group[3].value = value >> 24;
+            group[2].value = value >> 16;
+            // Fallthrough
+        case WIDTH_WORD:
+            group[1].value = value >> 8;
+            // Fallthrough
+        default:
+            group[0].value = value;
+    }
+}
+
+// Only a value that straddles the end of memory needs wrapping a byte at a time
+static inline uint32_t op_wide_load(const uint8_t* memory, uint32_t address, uint8_t width) {
+    address &= MEMORY_SIZE - 1;
+    if (address + (1u << width) > MEMORY_SIZE) {
+        uint32_t value = 0;
+        for (int i = 0; i < 1 << width; i++)
+            value |= (uint32_t)memory[(address + i) & (MEMORY_SIZE - 1)] << 8 * i;
+        return value;
+    }
+    const uint8_t* bytes = memory + address;
+    switch (width) {
+        case WIDTH_WORD:
+            return bytes[0] | bytes[1] << 8;
+        case WIDTH_DWORD:
+            return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+        default:
+            return bytes[0];
+    }
+}
+
+static inline void op_wide_store(uint8_t* memory, uint32_t address, uint8_t width, uint32_t value) {
+    address &= MEMORY_SIZE - 1;
+    if (address + (1u << width) > MEMORY_SIZE) {
+        for (int i = 0; i < 1 << width; i++)
+            memory[(address + i) & (MEMORY_SIZE - 1)] = value >> 8 * i;
+        return;
+    }
+    uint8_t* bytes = memory + address;
+    switch (width) {
+        case WIDTH_DWORD:
+            bytes[3] = value >> 24;
+            bytes[2] = value >> 16;
+            // Fallthrough
+        case WIDTH_WORD:
+            bytes[1] = value >> 8;
+            // Fallthrough
+        default:
+            bytes[0] = value;
+    }
+}
+
+/* mov and the arithmetic instructions, by their
+InstructionType, before the result is cut down to the
+width. Shifts of 32 or more wrap around, as they do for
+bytes on x86, and division by zero isn't caught any more
+than it is for bytes. */
+static inline uint32_t op_wide_arith(uint8_t type, uint32_t a, uint32_t b) {
+    switch (type) {
+        case ADD: return a + b;
+        case SUB: return a - b;
+        case MUL: return a * b;
+        case DIV: return a / b;
+        case SHL: return a << (b & 31);
+        case SHR: return a >> (b & 31);
+        default:  return b;
+    }
+}
+
+/* Bulk memory instructions, which work on `len`
+bytes at once. Each range has to lie wholly within
+memory, or the instruction fails having done nothing,
+and ranges that overlap work as if the source were read
+in full before anything was written, like memmove().
+mcmp compares the first bytes that differ, unsigned, so
+two equal ranges (or empty ones) compare equal. */
+
+static inline bool op_bulk_in_bounds(uint32_t address, uint32_t len) {
+    return address <= MEMORY_SIZE && len <= MEMORY_SIZE - address;
+}
+
+static inline void op_pts(OutputSink* output, const uint8_t* data, uint32_t len) {
+    if (output == NULL)
+        fwrite(data, 1, len, stdout);
+    else
+        output_put(output, (const char*)data, len);
+}
+
+/* `type` is the InstructionType. pts only has two
+operands, the address and the length. Returns false if a
+range is out of bounds. */
+static inline bool op_bulk(VM* vm, LazyFlags* flags, uint8_t type,
+                           uint32_t a, uint32_t b, uint32_t len) {
+    uint8_t* memory = vm->memory;
+    if (type == PTS) {
+        if (!op_bulk_in_bounds(a, b))
+            return false;
+        op_pts(vm->output, memory + a, b);
+        return true;
+    }
+    // The second operand of mset is the byte to fill with
+    if (!op_bulk_in_bounds(a, len) || (type != MSET && !op_bulk_in_bounds(b, len)))
+        return false;
+
+    switch (type) {
+        case MCPY: memmove(memory + a, memory + b, len); break;
+        case MSET: memset(memory + a, (uint8_t)b, len); break;
+        case MCMP: {
+            int order = memcmp(memory + a, memory + b, len);
+            flags_cmp(flags, order > 0, order < 0);
+            break;
+        }
+        case MADD: bulk_add(memory + a, memory + b, len); break;
+        default:   bulk_xor(memory + a, memory + b, len); break;
+    }
+    return true;
+}
+
+/* Printing goes to the VM's sink, or straight to
+stdio if it doesn't have one. Neither parses a format. */
+
+static inline void op_ptc(OutputSink* output, uint8_t value) {
+    if (output == NULL)
+        putchar(value);
+    else
+        output_put_char(output, value);
+}
+
+// Values are unsigned, so this prints the same as ptu
+static inline void op_ptn(OutputSink* output, uint8_t value) {
+    char digits[3];
+    size_t len = output_format_u8(digits, value);
+    if (output == NULL)
+        fwrite(digits, 1, len, stdout);
+    else
+        output_put(output, digits, len);
+}
+
+static inline void op_ptu(OutputSink* output, uint8_t value) {
+    char digits[3];
+    size_t len = output_format_u8(digits, value);
+    if (output == NULL)
+        fwrite(digits, 1, len, stdout);
+    else
+        output_put(output, digits, len);
+}
+
+/* Both return false if the instruction has to wait,
+having changed nothing, so that it can simply be run
+again later. VMs without channels wait forever. */
+
+static inline bool op_snd(VM* vm, uint8_t channel, uint8_t value) {
+    return vm->channels != NULL && channel_send(vm->channels, channel, value);
+}
+
+static inline bool op_rcv(VM* vm, uint8_t* dst, uint8_t channel) {
+    return vm->channels != NULL && channel_receive(vm->channels, channel, dst);
+}
+// Whether a jump would be taken, worked out from the VM's flags before running it
+static inline bool op_jump_taken(const VM* vm, uint8_t type) {
+    switch (type) {
+        case JMP: return true;
+        case JNE: return vm->compare_register.not_equal;
+        case JE:  return vm->compare_register.equal;
+        case JGT: return vm->compare_register.greater_than;
+        case JLT: return vm->compare_register.less_than;
+        case JNZ: return vm->status_register.not_zero;
+        case JZ:  return !vm->status_register.not_zero;
+        default:  return false;
+    }
+}
\ No newline at end of file
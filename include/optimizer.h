@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+
+#define OPTIMIZER_MAX_LEVEL 2
+
+typedef struct {
+    int instrs_before;
+    int instrs_after;
+} OptimizerStats;
+
+/* Rewrites `instrs` in place, and moves `labels` to
+match. Programs run from the start print exactly what
+they would have otherwise and fail the same way, but
+will generally end with different register contents,
+and always with a lower program counter.
+
+Level 1 only looks within basic blocks: it propagates
+constants into operands, folds jumps on flags that are
+known, threads jumps through jumps, and removes code
+that can't be reached. Level 2 also removes stores to
+registers and flags that are never read, and folds
+arithmetic on constants into plain moves. */
+OptimizerStats optimizer_run(Instruction instrs[], int* num_instrs,
+                             Label labels[], int num_labels, int level);
\ No newline at end of file
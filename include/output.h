@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define OUTPUT_FD_BUFFER_SIZE 65536
+
+typedef enum {
+    SINK_BUFFER,   // Caller-provided buffer; anything that doesn't fit is dropped
+    SINK_ARENA,    // Buffer that grows as needed
+    SINK_FD,       // Written to a file descriptor whenever the buffer fills up
+    SINK_CALLBACK, // Like SINK_FD, but handed to a function instead
+    SINK_DISCARD
+} OutputSinkType;
+
+typedef void (*OutputCallback)(void* user_data, const char* data, size_t len);
+
+/* Where a VM's output goes. Every kind of sink is a
+buffer at heart, so printing is almost always a store
+and a length bump; output_write() only gets involved
+once the buffer is full. */
+typedef struct {
+    OutputSinkType type;
+    char* data;
+    size_t len;
+    size_t capacity;
+    int fd;
+    OutputCallback callback;
+    void* user_data;
+    bool truncated; // A SINK_BUFFER ran out of space
+    bool failed;    // A SINK_FD couldn't be written to
+} OutputSink;
+
+OutputSink output_sink_buffer(char* data, size_t capacity);
+OutputSink output_sink_arena();
+OutputSink output_sink_fd(int fd);
+OutputSink output_sink_callback(OutputCallback callback, void* user_data);
+OutputSink output_sink_stdout();
+OutputSink output_sink_discard();
+void output_write(OutputSink* sink, const char* data, size_t len);
+void output_flush(OutputSink* sink);
+void output_free(OutputSink* sink);
+
+// Only takes the slow path when the buffer is full
+static inline void output_put(OutputSink* sink, const char* data, size_t len) {
+    if (sink->capacity - sink->len >= len) {
+        memcpy(sink->data + sink->len, data, len);
+        sink->len += len;
+    }
+    else
+        output_write(sink, data, len);
+}
+
+static inline void output_put_char(OutputSink* sink, char c) {
+    if (sink->len < sink->capacity)
+        sink->data[sink->len++] = c;
+    else
+        output_write(sink, &c, 1);
+}
+
+static inline size_t output_format_u8(char digits[3], uint8_t value) {
+    if (value >= 100) {
+        digits[0] = '0' + value / 100;
+        digits[1] = '0' + value / 10 % 10;
+        digits[2] = '0' + value % 10;
+        return 3;
+    }
+    if (value >= 10) {
+        digits[0] = '0' + value / 10;
+        digits[1] = '0' + value % 10;
+        return 2;
+    }
+    digits[0] = '0' + value;
+    return 1;
+}
\ No newline at end of file
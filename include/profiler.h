@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "strvm.h"
+
+#include "fiesta/str.h"
+
+/* What a profiled run spent its time on. Ticks are
+CPU cycles where rdtsc is available, and nanoseconds
+everywhere else. */
+typedef struct {
+    int num_instrs;
+    uint64_t* counts; // Times each instruction was run
+    uint64_t* taken;  // Times each jump was taken
+    uint64_t opcode_counts[NUM_INSTR_TYPES];
+    uint64_t opcode_ticks[NUM_INSTR_TYPES];
+    uint64_t total;
+} Profile;
+
+/* Everything profiler_report() needs to know about
+where a program came from. `lines` and `src` can be
+NULL and empty when there's no source to point at
+(bytecode images, or optimized programs). */
+typedef struct {
+    const Instruction* instrs;
+    int num_instrs;
+    const int* lines;
+    const Label* labels;
+    int num_labels;
+    str src;
+} ProfileSource;
+
+Profile profiler_create(int num_instrs);
+void profiler_free(Profile* profile);
+VM_Error vm_run_profiled(VM* vm, Instruction instrs[], int num_instrs, Profile* profile);
+void profiler_report(FILE* file, const Profile* profile, ProfileSource source);
\ No newline at end of file
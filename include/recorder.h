@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+
+#define RECORDER_MAGIC   "strvmrl"
+#define RECORDER_VERSION 2
+// Bytes of log kept, unless a whole checkpoint needs more room than that
+#define RECORDER_DEFAULT_CAPACITY (1u << 20)
+// Instructions between checkpoints, give or take a loop iteration
+#define RECORDER_DEFAULT_INTERVAL (1u << 16)
+// Checkpoints only compare pages of memory that have been written to since the last one
+#define RECORDER_PAGE_SIZE 256
+#define RECORDER_NUM_PAGES (MEMORY_SIZE / RECORDER_PAGE_SIZE)
+
+typedef enum {
+    RECORDER_OK,
+    RECORDER_IO_ERROR,
+    RECORDER_NOT_A_LOG,
+    RECORDER_BAD_VERSION,
+    RECORDER_WRONG_PROGRAM, // Recorded while running a different program
+    RECORDER_CORRUPT,
+    RECORDER_OUT_OF_RANGE,  // The run never got that far, or it's been dropped from the ring
+    RECORDER_DIVERGED       // Replaying went differently from the recorded run
+} RecorderError;
+
+/* A log of a run, kept in a ring buffer so that it
+takes the same memory however long the run goes on for.
+It holds the outcome of every conditional jump, a bit
+each, every store with what it stored, every byte
+received from a channel, and every so often a
+checkpoint of the registers, flags and counters, along
+with whatever memory has changed since the one before.
+Once the ring is full, the oldest checkpoint's changes
+are folded into `base`, and everything up to it is
+dropped, so that the log always starts from a complete
+state. Offsets into the log count every byte ever
+written, and only wrap around when they index `ring`. */
+typedef struct {
+    uint8_t* ring;
+    uint32_t capacity;      // A power of two
+    uint64_t start;         // The oldest byte still in the ring
+    uint64_t end;           // One past the newest
+    uint64_t segment;       // Just past the newest checkpoint
+    uint64_t limit;         // How far `end` can go before the ring is full, or a checkpoint is due
+    uint32_t interval;
+    uint64_t branches;      // Outcomes not written out yet, after a leading 1 bit, the newest lowest
+    bool due;               // The log has grown by a quarter of the ring since the newest checkpoint
+    uint32_t checkpoint_pc; // The newest checkpoint's program counter
+    uint32_t end_pc;        // Where the run got to, as far as it's been recorded
+    uint64_t num_checkpoints;
+    VM* base;               // Registers, flags, counters and memory where the log starts
+    uint8_t* shadow;        // Memory at the newest checkpoint
+    uint8_t* scratch;       // Where checkpoints are put together
+    uint8_t dirty[(RECORDER_NUM_PAGES + 7) / 8]; // Pages written to since the newest checkpoint
+} Recording;
+
+/* Starts recording from where `vm` is. `capacity` is
+rounded up to a power of two big enough to hold a few
+checkpoints of all of memory. */
+Recording recorder_create(const VM* vm, uint32_t capacity, uint32_t interval);
+// Throws the log away, and starts again from where `vm` is
+void recorder_reset(Recording* recording, const VM* vm);
+void recorder_free(Recording* recording);
+/* Runs a decoded program exactly like
+vm_run_decoded(), logging into `recording` as it goes.
+Running again after a BLOCKED carries on with the same
+log. */
+VM_Error vm_run_recorded(VM* vm, DecodedProgram* program, Recording* recording);
+/* Puts `vm` where the recorded run was once it had
+run `count` instructions, by restoring the checkpoint
+before it and running the rest of the way on the
+interpreter, checking every jump and store against the
+log, and taking anything received from channels from it.
+Nothing is printed or sent along the way. `vm` needs the
+program's labels, and is left wherever it got to if the
+run diverges. */
+RecorderError recorder_replay(const Recording* recording, VM* vm, Instruction instrs[],
+                              int num_instrs, uint32_t count);
+// The first instruction count recorder_replay() can still get to
+uint32_t recorder_first_pc(const Recording* recording);
+RecorderError recorder_write(const char* filename, const Recording* recording, uint32_t program_id);
+// Logs that have been read can be replayed, but not recorded into any further
+RecorderError recorder_read(const char* filename, Recording* recording, uint32_t program_id);
+const char* recorder_error_string(RecorderError error);
\ No newline at end of file
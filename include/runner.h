@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+
+typedef struct {
+    uint32_t address;
+    uint8_t value;
+} MemoryInput;
+
+/* One run of a program. Programs are only read while
+running, so any number of jobs can share one. */
+typedef struct {
+    const DecodedProgram* program;
+    const VM* start; // Copied to start the run from, or NULL to start from scratch
+    uint8_t registers[NUM_GP_REGISTERS];
+    uint8_t set_mask; // Which of registers[] to set, a bit each, so the rest keep start's values
+    MemoryInput* memory;
+    int num_memory;
+    // Filled in by runner_run()
+    OutputSink output;
+    VM_Error error;
+    bool done;
+} Job;
+
+/* Called on the calling thread, once per job, in the
+order the jobs were given, as soon as every job before
+it has been emitted */
+typedef void (*JobCallback)(Job* job, int index, void* user_data);
+
+void runner_run(Job* jobs, int num_jobs, int num_threads, JobCallback emit, void* user_data);
+int runner_default_threads();
+int runner_run_manifest(const char* filename, int num_threads, bool green);
\ No newline at end of file
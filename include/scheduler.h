@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "strvm.h"
+#include "decoder.h"
+#include "channel.h"
+
+// Instructions a task runs before it has to let the next one have a go
+#define SCHEDULER_QUANTUM 10000
+
+typedef enum {
+    TASK_READY,
+    TASK_BLOCKED, // Parked until the channel it blocked on is ready
+    TASK_DONE
+} TaskState;
+
+typedef struct {
+    VM* vm; // Owned, and kept out of line so growing `tasks` never moves a VM
+    const DecodedProgram* program;
+    TaskState state;
+    VM_Error error; // What ended it, once it's done or blocked
+    int next_waiting; // The next task parked on the same channel, or -1
+} Task;
+
+typedef struct {
+    int head;
+    int tail;
+} WaitList;
+
+/* Runs any number of VMs as green threads on the
+calling thread, all sharing one set of channels. Tasks
+take turns a quantum at a time, and give way early when
+they block on a channel, to be woken once something
+happens to it. Nothing is ever preempted in the middle
+of an instruction, so tasks need no locking. */
+typedef struct {
+    Task* tasks;
+    int num_tasks;
+    int capacity;
+    ChannelSet* channels;
+    // Ready tasks, in the order they'll run
+    int* ready;
+    int ready_head;
+    int ready_len;
+    // Tasks parked on each channel, receivers first then senders
+    WaitList waiting[NUM_CHANNELS][2];
+    uint32_t quantum;
+} Scheduler;
+
+/* Called whenever no task is ready, to feed the
+channels from outside. Returns false if it has nothing
+more to give, which ends the run. */
+typedef bool (*IdleCallback)(Scheduler* scheduler, void* user_data);
+
+Scheduler* scheduler_create(uint32_t quantum);
+void scheduler_free(Scheduler* scheduler);
+int scheduler_spawn(Scheduler* scheduler, const DecodedProgram* program, const VM* start);
+int scheduler_run(Scheduler* scheduler, IdleCallback idle, void* user_data);
+bool scheduler_is_waiting(const Scheduler* scheduler, uint8_t channel, bool sending);
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+
+#define SNAPSHOT_MAGIC   "strvmss"
+#define SNAPSHOT_VERSION 3
+
+typedef enum {
+    SNAPSHOT_OK,
+    SNAPSHOT_IO_ERROR,
+    SNAPSHOT_NOT_A_SNAPSHOT,
+    SNAPSHOT_BAD_VERSION,
+    SNAPSHOT_WRONG_PROGRAM, // Taken while running a different program
+    SNAPSHOT_CORRUPT
+} SnapshotError;
+
+/* Everything a VM needs to pick up where it left
+off: registers, flags, counters and memory, but not
+its labels or output sink, which belong to whoever
+restores it. Every field is written out byte by byte
+in little-endian order, so unlike bytecode images,
+snapshots are portable between builds and platforms. */
+typedef struct {
+    uint8_t* data;
+    size_t size;
+} Snapshot;
+
+uint32_t snapshot_program_id(const Instruction instrs[], int num_instrs,
+                             const Label labels[], int num_labels);
+Snapshot snapshot_take(const VM* vm, uint32_t program_id);
+SnapshotError snapshot_restore(VM* vm, const Snapshot* snapshot, uint32_t program_id);
+void snapshot_fork(const VM* vm, VM forks[], int num_forks);
+SnapshotError snapshot_write(const char* filename, const Snapshot* snapshot);
+SnapshotError snapshot_read(const char* filename, Snapshot* snapshot);
+void snapshot_free(Snapshot* snapshot);
+const char* snapshot_error_string(SnapshotError error);
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <stdint.h>
 
 #include "common.h"
+#include "output.h"
+#include "channel.h"
 
 typedef struct {
     uint8_t value;
@@ -13,7 +15,9 @@ typedef enum {
     NONE,
     INVALID_INSTRUCTION,
     INVALID_OPERAND,
-    HALT
+    HALT,
+    YIELD,  // Ran out of budget, and can be resumed by running again
+    BLOCKED // Waiting on a channel, and can be resumed once it's ready
 } VM_ErrorType;
 
 typedef struct {
@@ -43,12 +47,41 @@ typedef struct {
     StatusRegister status_register;       // rst
     Register zero_register;               // rz
     CompareFlags compare_register;        // rcmp
-    uint16_t program_counter;             // pc
-    uint16_t instr_ptr;                   // ip
-    Label labels[MAX_LABELS];
+    uint32_t program_counter;             // pc
+    uint32_t instr_ptr;                   // ip
+    const Label* labels;                  // Not owned, and never written to
     int num_labels;
     uint8_t memory[MEMORY_SIZE];
+    OutputSink* output;                   // NULL for stdout
+    ChannelSet* channels;                 // NULL if it isn't connected to any
 } VM;
 
-VM vm_init(Label labels[MAX_LABELS], int num_labels);
-VM_Error vm_run(VM* vm, Instruction instrs[MAX_LABELS], uint8_t num_instrs);
\ No newline at end of file
+#define VM_UNLIMITED_FUEL UINT64_MAX
+
+/* How long a run may go on for before it yields.
+Budgets are only checked at backward jumps, since
+nothing else can keep a program running, so a run can
+go over by however many instructions it takes to reach
+the next one. A yielded VM is left exactly where it
+stopped, and picks up from there when run again. */
+typedef struct {
+    uint64_t fuel;        // Instructions left to run, or VM_UNLIMITED_FUEL
+    uint64_t deadline_ns; // Against vm_clock_ns(), or 0 for none
+} VM_Budget;
+
+VM vm_init(const Label labels[], int num_labels);
+VM_Error vm_execute(VM* vm, Instruction instr);
+VM_Error vm_run(VM* vm, Instruction instrs[], int num_instrs);
+VM_Error vm_run_budget(VM* vm, Instruction instrs[], int num_instrs, VM_Budget* budget);
+/* vm_run_budget() for a program that verifier_verify()
+has passed, with the same labels, which is run without
+checking its operands. Anything else is undefined
+behaviour. */
+VM_Error vm_run_verified(VM* vm, Instruction instrs[], int num_instrs, VM_Budget* budget);
+VM_Error vm_run_until(VM* vm, Instruction instrs[], int num_instrs, uint32_t stop_at);
+void vm_print_state(VM vm);
+uint64_t vm_clock_ns();
+// For engines: how many instructions to run before checking back in
+uint32_t vm_budget_slice(const VM_Budget* budget);
+// For engines: takes `used` out of the budget, and returns whether it's run out
+bool vm_budget_spend(VM_Budget* budget, uint32_t used);
\ No newline at end of file
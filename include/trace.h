@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+
+// Times a backward jump has to land on an instruction before the loop there is traced
+#define TRACE_HOT_LOOP   32
+#define TRACE_HEAT_SLOTS 64
+// The most instructions one trip round a traced loop can take
+#define TRACE_MAX_LENGTH 256
+
+/* Traces are made of decoded instructions, minus the
+jumps, plus these. A guard checks that a jump goes the
+same way it did when the trace was recorded, and leaves
+the trace (just before the jump) if not. */
+typedef enum {
+    TRACE_GUARD_CMP_REG_REG = NUM_DECODED_TYPES, // A cmp fused with the guard straight after it
+    TRACE_GUARD_CMP_REG_IMM,
+    TRACE_GUARD_CMP_IMM_REG,
+    TRACE_GUARD_CMP_IMM_IMM,
+    TRACE_GUARD_LAST_CMP, // Against the last cmp this trip, which hasn't set any flags yet
+    TRACE_GUARD_FLAGS,    // Against the compare flags, from before this trip
+    TRACE_GUARD_ZERO,
+    TRACE_LOOP, // Back to the start, unless it's time to yield
+    NUM_TRACE_TYPES
+} TraceType;
+
+typedef enum {
+    COND_NOT_EQUAL,
+    COND_EQUAL,
+    COND_GREATER_THAN,
+    COND_LESS_THAN,
+    COND_NOT_ZERO,
+    COND_ZERO
+} Condition;
+
+typedef struct {
+    uint8_t type;
+    uint8_t a;
+    uint8_t b;
+    // The rest are only for guards
+    uint8_t cond;      // A Condition
+    bool taken;        // Which way the jump went while recording
+    uint16_t executed; // Instructions run this trip, before the jump
+    uint32_t exit;     // The jump itself, which the interpreter takes over at
+} TraceOp;
+
+/* One loop, from the instruction a backward jump
+lands on, round to the jump back to it */
+typedef struct {
+    TraceOp* ops;
+    int num_ops;
+    uint32_t anchor;
+    uint32_t length; // Instructions in one trip round
+} Trace;
+
+/* Everything vm_run() learns about a program while
+running it: how hot each loop is, and the traces of
+the ones that got hot enough. Lives as long as a run. */
+typedef struct {
+    /* Backward jumps landing on each instruction, by
+    its index modulo TRACE_HEAT_SLOTS. Loops can share a
+    slot, which just makes them get hot a little sooner,
+    and nothing needs allocating until one does. */
+    uint8_t heat[TRACE_HEAT_SLOTS];
+    int num_instrs;
+    Trace** traces; // By anchor, NULL until the first loop gets hot
+    bool* given_up; // Loops that can't be traced, by anchor
+    DecodedProgram program; // Decoded when the first trace is compiled
+    bool decoded;
+    // The loop being recorded, if any
+    bool recording;
+    uint32_t anchor;
+    uint32_t* recorded;
+    bool* taken;
+    int num_recorded;
+} TraceCache;
+
+void trace_cache_free(TraceCache* cache);
+Trace* trace_backward_jump(TraceCache* cache, const VM* vm, int num_instrs);
+void trace_record(TraceCache* cache, const VM* vm, Instruction instrs[], uint32_t ip);
+VM_Error trace_run(VM* vm, const Trace* trace, uint32_t start_pc, uint32_t slice);
\ No newline at end of file
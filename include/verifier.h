@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "common.h"
+
+/* What verifier_verify() can find. Errors are what the
+interpreter would fail on, or run differently from the
+other engines, if it ever got there. Everything from
+VERIFY_UNREACHABLE on is only a warning, and doesn't
+keep a program from being verified. */
+typedef enum {
+    VERIFY_BAD_INSTRUCTION, // No such instruction, or not at that width
+    VERIFY_BAD_OPERAND,     // The wrong kind of operand, or a register that can't be used there
+    VERIFY_OUT_OF_RANGE,    // An immediate that doesn't fit in the instruction's width
+    VERIFY_UNDEFINED_LABEL, // A jump to a label that's used but never defined
+    VERIFY_DIVIDE_BY_ZERO,  // Division by something that's always 0
+    VERIFY_OUT_OF_BOUNDS,   // A bulk instruction whose range is always out of bounds
+    VERIFY_UNREACHABLE,     // The first of a run of instructions that nothing can get to
+    VERIFY_UNINITIALIZED,   // A read of a register that isn't written first on every path there
+    NUM_VERIFY_ISSUES
+} VerifyIssueType;
+
+typedef struct {
+    uint8_t type;    // A VerifyIssueType
+    int8_t operand;  // The one it's about, or -1 for the whole instruction
+    uint32_t instr;
+    uint32_t detail; // The label, for undefined ones, or the register, for uninitialized ones
+} VerifyIssue;
+
+/* Memory accesses are counted only where they can be
+reached. Plain ld and str can only reach the first 256
+bytes, and wide ones wrap around, so they're always in
+bounds; bulk ones are proven in bounds when their
+operands are known, or too small to go past the end. */
+typedef struct {
+    bool verified;       // No errors, so vm_run_verified() can run it
+    VerifyIssue* issues; // Ordered by instruction
+    int num_issues;
+    int num_errors;
+    int num_blocks;      // Basic blocks in the control-flow graph
+    int num_accesses;
+    int num_proven;      // Accesses that can never go out of bounds
+} VerifyResult;
+
+static inline bool verifier_is_error(uint8_t type) {
+    return type < VERIFY_UNREACHABLE;
+}
+
+/* Checks every instruction's operands, then follows
+every path from the first instruction through a
+control-flow graph of basic blocks to find the rest.
+Registers aren't assumed to start out as anything,
+since embedders and snapshots can set them. */
+VerifyResult verifier_verify(const Instruction instrs[], int num_instrs,
+                             const Label labels[], int num_labels);
+void verifier_free(VerifyResult* result);
+/* One line per issue, then a summary. `lines` maps
+instructions to source lines, or is NULL if there's no
+source to point at. */
+void verifier_report(FILE* file, const VerifyResult* result, const char* filename,
+                     const int* lines, const Label labels[], int num_labels);
\ No newline at end of file
@@ -0,0 +1,393 @@
+/* Ahead-of-time compilation to C. Each instruction
+becomes a statement or two, registers and flags become
+locals, and jumps become gotos, so the C compiler sees
+the whole program and can optimize it as a unit.
+
+Everything comes from the decoded program, so operand
+checking and label resolution work the same as they do
+for the other engines. Only the program counter is
+missing, since nothing outside a VM can see it. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "decoder.h"
+#include "aot.h"
+
+static const char PRELUDE[] =
+    "#include <stdint.h>\n"
+    "#include <stdio.h>\n"
+    "#include <string.h>\n"
+    "\n"
+    "static uint8_t memory[MEMORY_SIZE];\n"
+    "static char output[65536];\n"
+    "static size_t output_len;\n"
+    "\n"
+    "static void flush(void) {\n"
+    "    fwrite(output, 1, output_len, stdout);\n"
+    "    fflush(stdout);\n"
+    "    output_len = 0;\n"
+    "}\n"
+    "\n"
+    "static void put_char(uint8_t c) {\n"
+    "    if (output_len == sizeof(output))\n"
+    "        flush();\n"
+    "    output[output_len++] = c;\n"
+    "}\n"
+    "\n"
+    "static void put_u8(uint8_t value) {\n"
+    "    if (value >= 100)\n"
+    "        put_char('0' + value / 100);\n"
+    "    if (value >= 10)\n"
+    "        put_char('0' + value / 10 % 10);\n"
+    "    put_char('0' + value % 10);\n"
+    "}\n"
+    "\n"
+    "// Wide values are little-endian, and wrap around the end of memory\n"
+    "static uint32_t load_wide(uint32_t address, int bytes) {\n"
+    "    uint32_t value = 0;\n"
+    "    for (int i = 0; i < bytes; i++)\n"
+    "        value |= (uint32_t)memory[(address + i) & (MEMORY_SIZE - 1)] << 8 * i;\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static void store_wide(uint32_t address, int bytes, uint32_t value) {\n"
+    "    for (int i = 0; i < bytes; i++)\n"
+    "        memory[(address + i) & (MEMORY_SIZE - 1)] = value >> 8 * i;\n"
+    "}\n"
+    "\n"
+    "// Bulk ranges have to lie wholly within memory\n"
+    "static int in_bounds(uint32_t address, uint32_t len) {\n"
+    "    return address <= MEMORY_SIZE && len <= MEMORY_SIZE - address;\n"
+    "}\n"
+    "\n"
+    "// madd and mxor, backward if the destination starts partway into the source\n"
+    "static void combine(uint32_t dst, uint32_t src, uint32_t len, int is_xor) {\n"
+    "    if (dst > src) {\n"
+    "        while (len-- > 0)\n"
+    "            memory[dst + len] = is_xor ? memory[dst + len] ^ memory[src + len]\n"
+    "                                       : memory[dst + len] + memory[src + len];\n"
+    "        return;\n"
+    "    }\n"
+    "    for (uint32_t i = 0; i < len; i++)\n"
+    "        memory[dst + i] = is_xor ? memory[dst + i] ^ memory[src + i] : memory[dst + i] + memory[src + i];\n"
+    "}\n"
+    "\n"
+    "int main(void) {\n"
+    "    uint8_t r0 = 0, r1 = 0, r2 = 0, r3 = 0, r4 = 0, r5 = 0, r6 = 0, r7 = 0;\n"
+    "    uint8_t carry = 0, overflow = 0, not_zero = 0;\n"
+    "    uint8_t not_equal = 0, equal = 0, greater_than = 0, less_than = 0;\n"
+    "    // Not every program uses everything\n"
+    "    (void)r0; (void)r1; (void)r2; (void)r3; (void)r4; (void)r5; (void)r6; (void)r7;\n"
+    "    (void)carry; (void)overflow; (void)not_zero;\n"
+    "    (void)not_equal; (void)equal; (void)greater_than; (void)less_than;\n"
+    "    (void)memory; (void)put_u8; (void)load_wide; (void)store_wide;\n"
+    "    (void)in_bounds; (void)combine;\n"
+    "\n";
+
+static const char EPILOGUE[] =
+    "    flush();\n"
+    "    return 0;\n"
+    "}\n";
+
+static void write_value(FILE* file, bool is_reg, uint8_t value) {
+    if (is_reg)
+        fprintf(file, "r%d", value);
+    else
+        fprintf(file, "%d", value);
+}
+
+static void write_alu(FILE* file, const DecodedInstruction* instr, const char* op, bool is_reg) {
+    fprintf(file, "    r%d = r%d %s ", instr->a, instr->a, op);
+    write_value(file, is_reg, instr->b);
+    fprintf(file, "; not_zero = r%d != 0;\n", instr->a);
+}
+
+// Shift counts of 32 or more wrap around, as they do in the other engines on x86
+static void write_shift(FILE* file, const DecodedInstruction* instr, const char* op, bool is_reg) {
+    fprintf(file, "    r%d = r%d %s (", instr->a, instr->a, op);
+    write_value(file, is_reg, instr->b);
+    fprintf(file, " & 31); not_zero = r%d != 0;\n", instr->a);
+}
+
+/* Same as op_add_carry() and op_sub_borrow(). Flags
+that are never read are left for the C compiler to drop. */
+static void write_adc(FILE* file, const DecodedInstruction* instr, bool is_reg, bool subtract) {
+    fprintf(file, "    { uint8_t a = r%d, b = ", instr->a);
+    write_value(file, is_reg, instr->b);
+    if (subtract)
+        fprintf(file, "; unsigned difference = (unsigned)a - b - carry; r%d = difference; "
+                      "carry = difference >> 8 & 1; overflow = ((a ^ b) & (a ^ r%d)) >> 7;",
+                instr->a, instr->a);
+    else
+        fprintf(file, "; unsigned sum = a + b + carry; r%d = sum; "
+                      "carry = sum >> 8; overflow = ((a ^ r%d) & (b ^ r%d)) >> 7;",
+                instr->a, instr->a, instr->a);
+    fprintf(file, " not_zero = r%d != 0; }\n", instr->a);
+}
+
+static void write_store(FILE* file, const DecodedInstruction* instr,
+                        bool address_is_reg, bool value_is_reg) {
+    fprintf(file, "    memory[");
+    write_value(file, address_is_reg, instr->a);
+    fprintf(file, "] = ");
+    write_value(file, value_is_reg, instr->b);
+    fprintf(file, ";\n");
+}
+
+static void write_cmp(FILE* file, const DecodedInstruction* instr, bool a_is_reg, bool b_is_reg) {
+    static const char* flags[] = {"not_equal", "equal", "greater_than", "less_than"};
+    static const char* ops[] = {"!=", "==", ">", "<"};
+    fprintf(file, "   ");
+    for (int i = 0; i < 4; i++) {
+        fprintf(file, " %s = ", flags[i]);
+        write_value(file, a_is_reg, instr->a);
+        fprintf(file, " %s ", ops[i]);
+        write_value(file, b_is_reg, instr->b);
+        fprintf(file, ";");
+    }
+    fprintf(file, "\n");
+}
+
+// Register groups are little-endian, as op_wide_get() reads them
+static void write_group(FILE* file, uint8_t first, uint8_t width) {
+    fprintf(file, "(r%d", first);
+    for (int i = 1; i < 1 << width; i++)
+        fprintf(file, " | (uint32_t)r%d << %d", first + i, 8 * i);
+    fprintf(file, ")");
+}
+
+// A register group, or the `index`th of the instruction's constants
+static void write_wide_value(FILE* file, const DecodedProgram* program, const DecodedInstruction* instr,
+                             bool is_reg, uint8_t reg, int index) {
+    if (is_reg)
+        write_group(file, reg, instr->width);
+    else
+        fprintf(file, "%uu", program->constants[instr->target + index]);
+}
+
+// Same as run_wide() in the decoded engine
+static void write_wide(FILE* file, const DecodedProgram* program, const DecodedInstruction* instr) {
+    static const char* ops[NUM_INSTR_TYPES] = {[ADD] = "+", [SUB] = "-", [MUL] = "*",
+                                               [DIV] = "/", [SHL] = "<<", [SHR] = ">>"};
+    uint8_t type = instr->type;
+    int bytes = 1 << instr->width;
+
+    if (type >= OP_WIDE_STR_REG_REG) {
+        // REG_REG, REG_IMM, IMM_REG, then IMM_IMM, for both str and cmp
+        int variant = (type - OP_WIDE_STR_REG_REG) % 4;
+        fprintf(file, "    { uint32_t a = ");
+        write_wide_value(file, program, instr, variant < 2, instr->a, 0);
+        fprintf(file, ", b = ");
+        write_wide_value(file, program, instr, variant % 2 == 0, instr->b, variant == 3);
+        if (type <= OP_WIDE_STR_IMM_IMM)
+            fprintf(file, "; store_wide(a, %d, b); }\n", bytes);
+        else
+            fprintf(file, "; not_equal = a != b; equal = a == b; "
+                          "greater_than = a > b; less_than = a < b; }\n");
+        return;
+    }
+
+    fprintf(file, "    { uint32_t b = ");
+    write_wide_value(file, program, instr, (type - OP_WIDE_MOV_REG_REG) % 2 == 0, instr->b, 0);
+    fprintf(file, "; uint32_t v = (");
+    InstructionType op = type >= OP_WIDE_LD_REG_REG ? LD : decoded_wide_arith(type);
+    if (op == LD)
+        fprintf(file, "load_wide(b, %d)", bytes);
+    else if (op == MOV)
+        fprintf(file, "b");
+    else {
+        write_group(file, instr->a, instr->width);
+        fprintf(file, " %s %s", ops[op], op == SHL || op == SHR ? "(b & 31)" : "b");
+    }
+    fprintf(file, ")");
+    if (instr->width != WIDTH_DWORD)
+        fprintf(file, " & 0x%X", (1u << (8 << instr->width)) - 1);
+    fprintf(file, ";");
+    for (int i = 0; i < bytes; i++)
+        fprintf(file, " r%d = v >> %d;", instr->a + i, 8 * i);
+    if (op != MOV && op != LD)
+        fprintf(file, " not_zero = v != 0;");
+    fprintf(file, " }\n");
+}
+
+// Same as run_bulk() in the decoded engine
+static void write_bulk(FILE* file, const DecodedProgram* program, const DecodedInstruction* instr) {
+    uint8_t type = MCPY + (instr->type - OP_MCPY);
+    const uint32_t* k = program->constants + instr->target;
+    fprintf(file, "    {\n");
+    fprintf(file, "        uint32_t a = ");
+    write_wide_value(file, program, instr, instr->a & 1, k[0], 0);
+    fprintf(file, ", b = ");
+    write_wide_value(file, program, instr, instr->a >> 1 & 1, k[1], 1);
+    if (type == PTS)
+        fprintf(file, ", len = b;\n");
+    else {
+        fprintf(file, ", len = ");
+        write_wide_value(file, program, instr, instr->a >> 2 & 1, k[2], 2);
+        fprintf(file, ";\n");
+    }
+    fprintf(file, "        if (!in_bounds(a, len)%s) {\n",
+            type == PTS || type == MSET ? "" : " || !in_bounds(b, len)");
+    fprintf(file, "            flush();\n");
+    fprintf(file, "            printf(\"Error: invalid operand\\n\");\n");
+    fprintf(file, "            return 1;\n");
+    fprintf(file, "        }\n");
+    switch (type) {
+        case MCPY: fprintf(file, "        memmove(memory + a, memory + b, len);\n"); break;
+        case MSET: fprintf(file, "        memset(memory + a, (uint8_t)b, len);\n"); break;
+        case MCMP:
+            fprintf(file, "        int order = memcmp(memory + a, memory + b, len);\n");
+            fprintf(file, "        not_equal = order != 0; equal = order == 0; "
+                          "greater_than = order > 0; less_than = order < 0;\n");
+            break;
+        case MADD: fprintf(file, "        combine(a, b, len, 0);\n"); break;
+        case MXOR: fprintf(file, "        combine(a, b, len, 1);\n"); break;
+        default:
+            fprintf(file, "        for (uint32_t i = 0; i < len; i++)\n");
+            fprintf(file, "            put_char(memory[a + i]);\n");
+            break;
+    }
+    fprintf(file, "    }\n");
+}
+
+static void write_jump(FILE* file, const DecodedProgram* program, const char* cond, int target) {
+    if (cond != NULL)
+        fprintf(file, "    if (%s) ", cond);
+    else
+        fprintf(file, "    ");
+    if (target == program->num_instrs)
+        fprintf(file, "goto end;\n");
+    else
+        fprintf(file, "goto i%d;\n", target);
+}
+
+static void write_print(FILE* file, const char* function, bool is_reg, uint8_t value) {
+    fprintf(file, "    %s(", function);
+    write_value(file, is_reg, value);
+    fprintf(file, ");\n");
+}
+
+// Same messages as main() prints
+static void write_trap(FILE* file, VM_Error error) {
+    const char* message = error.type == INVALID_INSTRUCTION ? "invalid instruction"
+                                                            : "invalid operand";
+    fprintf(file, "    flush();\n");
+    fprintf(file, "    printf(\"Error: %s\\n\");\n", message);
+    fprintf(file, "    return 1;\n");
+}
+
+// Compiled programs run alone, so there's nothing on the other end of a channel
+static void write_blocked(FILE* file) {
+    fprintf(file, "    flush();\n");
+    fprintf(file, "    printf(\"Error: blocked on a channel\\n\");\n");
+    fprintf(file, "    return 1;\n");
+}
+
+static void write_instruction(FILE* file, const DecodedProgram* program, int index) {
+    const DecodedInstruction* instr = &program->instrs[index];
+    switch ((DecodedType)instr->type) {
+        case OP_NOP: break;
+
+        case OP_MOV_REG_REG: fprintf(file, "    r%d = r%d;\n", instr->a, instr->b); break;
+        case OP_MOV_REG_IMM: fprintf(file, "    r%d = %d;\n", instr->a, instr->b); break;
+
+        case OP_ADD_REG_REG: write_alu(file, instr, "+", true); break;
+        case OP_ADD_REG_IMM: write_alu(file, instr, "+", false); break;
+        case OP_SUB_REG_REG: write_alu(file, instr, "-", true); break;
+        case OP_SUB_REG_IMM: write_alu(file, instr, "-", false); break;
+        case OP_MUL_REG_REG: write_alu(file, instr, "*", true); break;
+        case OP_MUL_REG_IMM: write_alu(file, instr, "*", false); break;
+        case OP_DIV_REG_REG: write_alu(file, instr, "/", true); break;
+        case OP_DIV_REG_IMM: write_alu(file, instr, "/", false); break;
+        case OP_SHL_REG_REG: write_shift(file, instr, "<<", true); break;
+        case OP_SHL_REG_IMM: write_shift(file, instr, "<<", false); break;
+        case OP_SHR_REG_REG: write_shift(file, instr, ">>", true); break;
+        case OP_SHR_REG_IMM: write_shift(file, instr, ">>", false); break;
+        case OP_ADC_REG_REG: write_adc(file, instr, true, false); break;
+        case OP_ADC_REG_IMM: write_adc(file, instr, false, false); break;
+        case OP_SBC_REG_REG: write_adc(file, instr, true, true); break;
+        case OP_SBC_REG_IMM: write_adc(file, instr, false, true); break;
+
+        case OP_CLC: fprintf(file, "    carry = 0;\n"); break;
+        case OP_CLV: fprintf(file, "    overflow = 0;\n"); break;
+
+        case OP_NEG_REG: fprintf(file, "    r%d = -r%d;\n", instr->a, instr->a); break;
+
+        case OP_STR_REG_REG: write_store(file, instr, true, true); break;
+        case OP_STR_REG_IMM: write_store(file, instr, true, false); break;
+        case OP_STR_IMM_REG: write_store(file, instr, false, true); break;
+        case OP_STR_IMM_IMM: write_store(file, instr, false, false); break;
+
+        case OP_LD_REG_REG: fprintf(file, "    r%d = memory[r%d];\n", instr->a, instr->b); break;
+        case OP_LD_REG_IMM: fprintf(file, "    r%d = memory[%d];\n", instr->a, instr->b); break;
+
+        case OP_CMP_REG_REG: write_cmp(file, instr, true, true); break;
+        case OP_CMP_REG_IMM: write_cmp(file, instr, true, false); break;
+        case OP_CMP_IMM_REG: write_cmp(file, instr, false, true); break;
+        case OP_CMP_IMM_IMM: write_cmp(file, instr, false, false); break;
+
+        case OP_JMP_ABS: write_jump(file, program, NULL, instr->target); break;
+        case OP_JNE_ABS: write_jump(file, program, "not_equal", instr->target); break;
+        case OP_JE_ABS:  write_jump(file, program, "equal", instr->target); break;
+        case OP_JGT_ABS: write_jump(file, program, "greater_than", instr->target); break;
+        case OP_JLT_ABS: write_jump(file, program, "less_than", instr->target); break;
+        case OP_JNZ_ABS: write_jump(file, program, "not_zero", instr->target); break;
+        case OP_JZ_ABS:  write_jump(file, program, "!not_zero", instr->target); break;
+
+        case OP_PTC_REG: write_print(file, "put_char", true, instr->a); break;
+        case OP_PTC_IMM: write_print(file, "put_char", false, instr->a); break;
+        // Values are unsigned, so ptn prints the same as ptu
+        case OP_PTN_REG: case OP_PTU_REG: write_print(file, "put_u8", true, instr->a); break;
+        case OP_PTN_IMM: case OP_PTU_IMM: write_print(file, "put_u8", false, instr->a); break;
+
+        case OP_SND_REG_REG: case OP_SND_REG_IMM: case OP_SND_IMM_REG: case OP_SND_IMM_IMM:
+        case OP_RCV_REG_REG: case OP_RCV_REG_IMM:
+            write_blocked(file);
+            break;
+
+        case OP_HLT: fprintf(file, "    goto end;\n"); break;
+        case OP_TRAP: write_trap(file, program->traps[instr->target]); break;
+        case OP_MCPY: case OP_MSET: case OP_MCMP: case OP_MADD: case OP_MXOR: case OP_PTS:
+            write_bulk(file, program, instr);
+            break;
+        default:
+            if (decoded_is_wide(instr->type))
+                write_wide(file, program, instr);
+            break;
+    }
+}
+
+bool aot_write_c(const char* filename, const DecodedProgram* program, const char* source_name) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+        return false;
+
+    // Only instructions that are jumped to get a label, so there are no unused ones
+    bool* targets = calloc(program->num_instrs + 1, sizeof(bool));
+    for (int i = 0; i < program->num_instrs; i++) {
+        uint8_t type = program->instrs[i].type;
+        if (type >= OP_JMP_ABS && type <= OP_JZ_ABS)
+            targets[program->instrs[i].target] = true;
+        else if (type == OP_HLT)
+            targets[program->num_instrs] = true;
+    }
+
+    fprintf(file, "/* Compiled from %s by strvm */\n\n", source_name);
+    fprintf(file, "#define MEMORY_SIZE %u\n\n", decoder_memory_reach(program));
+    fputs(PRELUDE, file);
+    for (int i = 0; i < program->num_instrs; i++) {
+        if (targets[i])
+            fprintf(file, "i%d:\n", i);
+        write_instruction(file, program, i);
+    }
+    if (targets[program->num_instrs])
+        fprintf(file, "end:\n");
+    fputs(EPILOGUE, file);
+    free(targets);
+
+    bool failed = ferror(file);
+    return !(fclose(file) != 0 || failed);
+}
\ No newline at end of file
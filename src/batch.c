@@ -0,0 +1,719 @@
+/* Runs one decoded program over many lanes at once.
+
+Lanes start out together, but branches split them up.
+The scheduler always picks the lanes that are furthest
+behind and runs them to the end of their basic block,
+which lets lanes that took different sides of a branch
+meet up again at the next common label. Every lane
+that isn't at that block still goes through the same
+loops, but a per-lane mask keeps its state unchanged,
+so that the loops stay branch-free and vectorizable. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "batch.h"
+#include "ops.h"
+#include "bulk.h"
+
+// `mask` is 0xFF for lanes being run, and 0x00 otherwise
+#define BLEND(mask, new, old) (((mask) & (new)) | (~(mask) & (old)))
+
+/* Memory is per lane, so it's worth only keeping as much
+as the program can reach: the first 256 bytes, unless
+it has wide loads or stores */
+VM_Batch vm_batch_create(int num_lanes, uint32_t memory_size) {
+    VM_Batch batch = {.num_lanes = num_lanes, .memory_size = memory_size};
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        batch.registers[i] = calloc(num_lanes, sizeof(uint8_t));
+    batch.carry = calloc(num_lanes, sizeof(uint8_t));
+    batch.overflow = calloc(num_lanes, sizeof(uint8_t));
+    batch.not_zero = calloc(num_lanes, sizeof(uint8_t));
+    batch.not_equal = calloc(num_lanes, sizeof(uint8_t));
+    batch.equal = calloc(num_lanes, sizeof(uint8_t));
+    batch.greater_than = calloc(num_lanes, sizeof(uint8_t));
+    batch.less_than = calloc(num_lanes, sizeof(uint8_t));
+    batch.program_counter = calloc(num_lanes, sizeof(uint32_t));
+    batch.instr_ptr = calloc(num_lanes, sizeof(uint32_t));
+    batch.memory = calloc((size_t)memory_size * num_lanes, sizeof(uint8_t));
+    batch.errors = calloc(num_lanes, sizeof(VM_Error));
+    batch.outputs = calloc(num_lanes, sizeof(OutputSink*));
+    batch.mask = calloc(num_lanes, sizeof(uint8_t));
+    batch.waiting_at = calloc(num_lanes, sizeof(uint32_t));
+    return batch;
+}
+
+void vm_batch_free(VM_Batch* batch) {
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        free(batch->registers[i]);
+    free(batch->carry);
+    free(batch->overflow);
+    free(batch->not_zero);
+    free(batch->not_equal);
+    free(batch->equal);
+    free(batch->greater_than);
+    free(batch->less_than);
+    free(batch->program_counter);
+    free(batch->instr_ptr);
+    free(batch->memory);
+    free(batch->errors);
+    free(batch->outputs);
+    free(batch->mask);
+    free(batch->waiting_at);
+    *batch = (VM_Batch){0};
+}
+
+// Copies the state and sink of `vm` into `lane`, and clears its error
+void vm_batch_load(VM_Batch* batch, int lane, const VM* vm) {
+    int n = batch->num_lanes;
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        batch->registers[i][lane] = vm->registers[i].value;
+    batch->carry[lane] = vm->status_register.carry;
+    batch->overflow[lane] = vm->status_register.overflow;
+    batch->not_zero[lane] = vm->status_register.not_zero;
+    batch->not_equal[lane] = vm->compare_register.not_equal;
+    batch->equal[lane] = vm->compare_register.equal;
+    batch->greater_than[lane] = vm->compare_register.greater_than;
+    batch->less_than[lane] = vm->compare_register.less_than;
+    batch->program_counter[lane] = vm->program_counter;
+    batch->instr_ptr[lane] = vm->instr_ptr;
+    for (uint32_t i = 0; i < batch->memory_size; i++)
+        batch->memory[(size_t)i * n + lane] = vm->memory[i];
+    batch->errors[lane] = (VM_Error){.type = NONE};
+    batch->outputs[lane] = vm->output;
+}
+
+// Copies the state of `lane` into `vm`, leaving its labels and sink alone
+void vm_batch_store(const VM_Batch* batch, int lane, VM* vm) {
+    int n = batch->num_lanes;
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        vm->registers[i].value = batch->registers[i][lane];
+    vm->status_register.carry = batch->carry[lane];
+    vm->status_register.overflow = batch->overflow[lane];
+    vm->status_register.not_zero = batch->not_zero[lane];
+    vm->compare_register.not_equal = batch->not_equal[lane];
+    vm->compare_register.equal = batch->equal[lane];
+    vm->compare_register.greater_than = batch->greater_than[lane];
+    vm->compare_register.less_than = batch->less_than[lane];
+    vm->program_counter = batch->program_counter[lane];
+    vm->instr_ptr = batch->instr_ptr[lane];
+    for (uint32_t i = 0; i < batch->memory_size; i++)
+        vm->memory[i] = batch->memory[(size_t)i * n + lane];
+}
+
+/* Every lane-parallel operation takes its source as
+either an array of lanes or, if that's NULL, a single
+immediate. Pointers are passed in rather than read out
+of the VM_Batch so that the compiler knows the loops
+can't overwrite them. */
+
+#define DEFINE_LANES_ALU(name, op) \
+    static void lanes_##name(int n, const uint8_t* mask, uint8_t* dst, const uint8_t* src, \
+                             uint8_t imm, uint8_t* not_zero) { \
+        if (src == NULL) { \
+            for (int l = 0; l < n; l++) { \
+                uint8_t result = dst[l] op imm; \
+                dst[l] = BLEND(mask[l], result, dst[l]); \
+                not_zero[l] = BLEND(mask[l], result != 0, not_zero[l]); \
+            } \
+        } \
+        else { \
+            for (int l = 0; l < n; l++) { \
+                uint8_t result = dst[l] op src[l]; \
+                dst[l] = BLEND(mask[l], result, dst[l]); \
+                not_zero[l] = BLEND(mask[l], result != 0, not_zero[l]); \
+            } \
+        } \
+    }
+
+DEFINE_LANES_ALU(add, +)
+DEFINE_LANES_ALU(sub, -)
+DEFINE_LANES_ALU(mul, *)
+
+/* Division and shifts can't be done on lanes that
+aren't being run, since their divisor or shift count
+might not be valid, so these only touch masked lanes */
+#define DEFINE_LANES_ALU_SCALAR(name, op) \
+    static void lanes_##name(int n, const uint8_t* mask, uint8_t* dst, const uint8_t* src, \
+                             uint8_t imm, uint8_t* not_zero) { \
+        for (int l = 0; l < n; l++) { \
+            if (mask[l]) { \
+                dst[l] op (src == NULL ? imm : src[l]); \
+                not_zero[l] = dst[l] != 0; \
+            } \
+        } \
+    }
+
+DEFINE_LANES_ALU_SCALAR(div, /=)
+DEFINE_LANES_ALU_SCALAR(shl, <<=)
+DEFINE_LANES_ALU_SCALAR(shr, >>=)
+
+static void lanes_adc(VM_Batch* b, const uint8_t* mask, uint8_t* dst, const uint8_t* src, uint8_t imm) {
+    for (int l = 0; l < b->num_lanes; l++) {
+        if (mask[l]) {
+            dst[l] = op_add_carry(dst[l], src == NULL ? imm : src[l], b->carry[l],
+                                  &b->carry[l], &b->overflow[l]);
+            b->not_zero[l] = dst[l] != 0;
+        }
+    }
+}
+
+static void lanes_sbc(VM_Batch* b, const uint8_t* mask, uint8_t* dst, const uint8_t* src, uint8_t imm) {
+    for (int l = 0; l < b->num_lanes; l++) {
+        if (mask[l]) {
+            dst[l] = op_sub_borrow(dst[l], src == NULL ? imm : src[l], b->carry[l],
+                                   &b->carry[l], &b->overflow[l]);
+            b->not_zero[l] = dst[l] != 0;
+        }
+    }
+}
+
+static void lanes_mov(int n, const uint8_t* mask, uint8_t* dst, const uint8_t* src, uint8_t imm) {
+    if (src == NULL)
+        for (int l = 0; l < n; l++)
+            dst[l] = BLEND(mask[l], imm, dst[l]);
+    else
+        for (int l = 0; l < n; l++)
+            dst[l] = BLEND(mask[l], src[l], dst[l]);
+}
+
+static void lanes_neg(int n, const uint8_t* mask, uint8_t* dst) {
+    for (int l = 0; l < n; l++)
+        dst[l] = BLEND(mask[l], (uint8_t)-dst[l], dst[l]);
+}
+
+static void lanes_set(int n, const uint8_t* mask, uint8_t* flag, uint8_t value) {
+    for (int l = 0; l < n; l++)
+        flag[l] = BLEND(mask[l], value, flag[l]);
+}
+
+static void lanes_cmp(VM_Batch* b, const uint8_t* mask, const uint8_t* a, uint8_t a_imm,
+                      const uint8_t* src, uint8_t b_imm) {
+    uint8_t* not_equal = b->not_equal;
+    uint8_t* equal = b->equal;
+    uint8_t* greater_than = b->greater_than;
+    uint8_t* less_than = b->less_than;
+    for (int l = 0; l < b->num_lanes; l++) {
+        uint8_t x = a == NULL ? a_imm : a[l];
+        uint8_t y = src == NULL ? b_imm : src[l];
+        not_equal[l] = BLEND(mask[l], x != y, not_equal[l]);
+        equal[l] = BLEND(mask[l], x == y, equal[l]);
+        greater_than[l] = BLEND(mask[l], x > y, greater_than[l]);
+        less_than[l] = BLEND(mask[l], x < y, less_than[l]);
+    }
+}
+
+// Memory is address-major, so an immediate address is one contiguous row
+static void lanes_ld(int n, const uint8_t* mask, uint8_t* dst, const uint8_t* memory,
+                     const uint8_t* address, uint8_t imm) {
+    if (address == NULL) {
+        const uint8_t* row = memory + (size_t)imm * n;
+        for (int l = 0; l < n; l++)
+            dst[l] = BLEND(mask[l], row[l], dst[l]);
+    }
+    else {
+        for (int l = 0; l < n; l++)
+            dst[l] = BLEND(mask[l], memory[(size_t)address[l] * n + l], dst[l]);
+    }
+}
+
+static void lanes_str(int n, const uint8_t* mask, uint8_t* memory, const uint8_t* address,
+                      uint8_t address_imm, const uint8_t* src, uint8_t imm) {
+    for (int l = 0; l < n; l++) {
+        if (mask[l]) {
+            size_t index = (size_t)(address == NULL ? address_imm : address[l]) * n + l;
+            memory[index] = src == NULL ? imm : src[l];
+        }
+    }
+}
+
+static void lanes_print(VM_Batch* b, const uint8_t* mask, DecodedType type, const uint8_t* src, uint8_t imm) {
+    for (int l = 0; l < b->num_lanes; l++) {
+        if (!mask[l])
+            continue;
+        uint8_t value = src == NULL ? imm : src[l];
+        switch (type) {
+            case OP_PTC_REG: case OP_PTC_IMM: op_ptc(b->outputs[l], value); break;
+            case OP_PTN_REG: case OP_PTN_IMM: op_ptn(b->outputs[l], value); break;
+            default:                          op_ptu(b->outputs[l], value); break;
+        }
+    }
+}
+
+/* Wide instructions are run a lane at a time, since
+they're rare enough that it isn't worth gathering
+register groups and wide values into vectors. Memory
+can only be out of reach of them if there are no wide
+loads or stores at all. */
+
+static uint32_t lane_group(uint8_t** r, int l, uint8_t first, uint8_t width) {
+    uint32_t value = 0;
+    for (int i = 0; i < 1 << width; i++)
+        value |= (uint32_t)r[first + i][l] << 8 * i;
+    return value;
+}
+
+static void lane_set_group(uint8_t** r, int l, uint8_t first, uint8_t width, uint32_t value) {
+    for (int i = 0; i < 1 << width; i++)
+        r[first + i][l] = value >> 8 * i;
+}
+
+static void lanes_wide(VM_Batch* b, const uint8_t* mask, const uint32_t* constants,
+                       DecodedInstruction instr) {
+    int n = b->num_lanes;
+    uint8_t** r = b->registers;
+    const uint32_t* k = constants + instr.target;
+    uint8_t width = instr.width;
+    for (int l = 0; l < n; l++) {
+        if (!mask[l])
+            continue;
+
+        if (instr.type >= OP_WIDE_STR_REG_REG) {
+            // REG_REG, REG_IMM, IMM_REG, then IMM_IMM, for both str and cmp
+            int variant = (instr.type - OP_WIDE_STR_REG_REG) % 4;
+            uint32_t x = variant < 2 ? lane_group(r, l, instr.a, width) : k[0];
+            uint32_t y = variant % 2 == 0 ? lane_group(r, l, instr.b, width) : k[variant == 3];
+            if (instr.type <= OP_WIDE_STR_IMM_IMM) {
+                for (int i = 0; i < 1 << width; i++)
+                    b->memory[(size_t)((x + i) & (MEMORY_SIZE - 1)) * n + l] = y >> 8 * i;
+            }
+            else {
+                b->not_equal[l] = x != y;
+                b->equal[l] = x == y;
+                b->greater_than[l] = x > y;
+                b->less_than[l] = x < y;
+            }
+            continue;
+        }
+
+        bool is_imm = (instr.type - OP_WIDE_MOV_REG_REG) % 2;
+        uint32_t value = is_imm ? k[0] : lane_group(r, l, instr.b, width);
+        if (instr.type >= OP_WIDE_LD_REG_REG) {
+            uint32_t loaded = 0;
+            for (int i = 0; i < 1 << width; i++)
+                loaded |= (uint32_t)b->memory[(size_t)((value + i) & (MEMORY_SIZE - 1)) * n + l] << 8 * i;
+            lane_set_group(r, l, instr.a, width, loaded);
+            continue;
+        }
+        InstructionType type = decoded_wide_arith(instr.type);
+        uint32_t result = op_wide_arith(type, lane_group(r, l, instr.a, width), value) & width_mask(width);
+        lane_set_group(r, l, instr.a, width, result);
+        if (type != MOV)
+            b->not_zero[l] = result != 0;
+    }
+}
+
+/* While running, lanes are tracked by the instruction
+they're waiting at rather than by `instr_ptr`, with lanes
+that have stopped waiting at STOPPED, so that picking the
+next lanes to run is a plain vectorizable minimum */
+#define STOPPED UINT32_MAX
+
+static void lanes_advance(VM_Batch* b, const uint8_t* mask, uint32_t executed) {
+    uint32_t* program_counter = b->program_counter;
+    for (int l = 0; l < b->num_lanes; l++)
+        program_counter[l] += mask[l] ? executed : 0;
+}
+
+// Moves every lane being run on to `instr_ptr`, having run `executed` instructions
+static void lanes_leave(VM_Batch* b, const uint8_t* mask, uint32_t instr_ptr, uint32_t executed) {
+    uint32_t* waiting_at = b->waiting_at;
+    for (int l = 0; l < b->num_lanes; l++)
+        waiting_at[l] = mask[l] ? instr_ptr : waiting_at[l];
+    lanes_advance(b, mask, executed);
+}
+
+static void lanes_jump(VM_Batch* b, const uint8_t* mask, const uint8_t* cond, uint8_t negate,
+                       uint32_t instr_ptr, uint32_t target, uint32_t executed) {
+    uint32_t* waiting_at = b->waiting_at;
+    if (cond == NULL) {
+        lanes_leave(b, mask, target, executed + 1);
+        return;
+    }
+    for (int l = 0; l < b->num_lanes; l++) {
+        uint32_t next = (cond[l] ^ negate) ? target : instr_ptr + 1;
+        waiting_at[l] = mask[l] ? next : waiting_at[l];
+    }
+    lanes_advance(b, mask, executed + 1);
+}
+
+static void lanes_stop(VM_Batch* b, const uint8_t* mask, VM_Error error,
+                       uint32_t instr_ptr, uint32_t executed) {
+    for (int l = 0; l < b->num_lanes; l++) {
+        if (mask[l]) {
+            b->errors[l] = error;
+            b->instr_ptr[l] = instr_ptr;
+            b->waiting_at[l] = STOPPED;
+        }
+    }
+    lanes_advance(b, mask, executed);
+}
+
+/* Bulk instructions whose operands differ between
+lanes are run a lane at a time, and go through each
+lane's memory a byte at a time, since it's strided.
+mcpy, madd and mxor go backward when the destination is
+after the source, so that overlapping ranges come out as
+they would for the other engines. */
+
+static void lane_combine(VM_Batch* b, int l, uint8_t type, uint32_t dst, uint32_t src, uint32_t len) {
+    int n = b->num_lanes;
+    bool backward = dst > src;
+    for (uint32_t j = 0; j < len; j++) {
+        uint32_t i = backward ? len - 1 - j : j;
+        uint8_t* d = &b->memory[(size_t)(dst + i) * n + l];
+        uint8_t value = b->memory[(size_t)(src + i) * n + l];
+        *d = type == MCPY ? value : type == MADD ? *d + value : *d ^ value;
+    }
+}
+
+static void lane_compare(VM_Batch* b, int l, uint32_t x, uint32_t y, uint32_t len) {
+    int n = b->num_lanes;
+    int order = 0;
+    for (uint32_t i = 0; i < len && order == 0; i++) {
+        uint8_t p = b->memory[(size_t)(x + i) * n + l];
+        uint8_t q = b->memory[(size_t)(y + i) * n + l];
+        order = (p > q) - (p < q);
+    }
+    b->not_equal[l] = order != 0;
+    b->equal[l] = order == 0;
+    b->greater_than[l] = order > 0;
+    b->less_than[l] = order < 0;
+}
+
+/* When every lane being run has the same operands,
+which they always do when they're immediates, a range
+is a run of whole rows (an address's row being that
+byte of every lane), all next to each other. If every
+lane is being run, that goes to the bulk kernels as it
+is. Otherwise it goes a row at a time, with the lanes
+masked, and since two rows are either the same or don't
+overlap at all, only the order of the rows matters. */
+
+static void rows_combine(VM_Batch* b, bool all_lanes, uint8_t type, uint32_t dst, uint32_t src, uint32_t len) {
+    int n = b->num_lanes;
+    const uint8_t* mask = b->mask;
+    uint8_t* d = b->memory + (size_t)dst * n;
+    const uint8_t* s = b->memory + (size_t)src * n;
+    if (all_lanes) {
+        size_t size = (size_t)len * n;
+        switch (type) {
+            case MCPY: memmove(d, s, size); break;
+            case MADD: bulk_add(d, s, size); break;
+            default:   bulk_xor(d, s, size); break;
+        }
+        return;
+    }
+
+    bool backward = dst > src;
+    for (uint32_t j = 0; j < len; j++) {
+        size_t row = (size_t)(backward ? len - 1 - j : j) * n;
+        uint8_t* dr = d + row;
+        const uint8_t* sr = s + row;
+        switch (type) {
+            case MCPY:
+                for (int l = 0; l < n; l++)
+                    dr[l] = BLEND(mask[l], sr[l], dr[l]);
+                break;
+            case MADD:
+                for (int l = 0; l < n; l++)
+                    dr[l] = BLEND(mask[l], (uint8_t)(dr[l] + sr[l]), dr[l]);
+                break;
+            default:
+                for (int l = 0; l < n; l++)
+                    dr[l] = BLEND(mask[l], dr[l] ^ sr[l], dr[l]);
+                break;
+        }
+    }
+}
+
+static void rows_set(VM_Batch* b, bool all_lanes, uint32_t dst, uint8_t value, uint32_t len) {
+    int n = b->num_lanes;
+    const uint8_t* mask = b->mask;
+    uint8_t* d = b->memory + (size_t)dst * n;
+    if (all_lanes) {
+        memset(d, value, (size_t)len * n);
+        return;
+    }
+    for (size_t row = 0; row < (size_t)len * n; row += n) {
+        for (int l = 0; l < n; l++)
+            d[row + l] = BLEND(mask[l], value, d[row + l]);
+    }
+}
+
+// Lanes are equal until a row tells them apart, and rows that match in every lane are skipped whole
+static void rows_compare(VM_Batch* b, uint32_t x, uint32_t y, uint32_t len) {
+    int n = b->num_lanes;
+    const uint8_t* mask = b->mask;
+    lanes_set(n, mask, b->not_equal, 0);
+    lanes_set(n, mask, b->equal, 1);
+    lanes_set(n, mask, b->greater_than, 0);
+    lanes_set(n, mask, b->less_than, 0);
+    int undecided = 0;
+    for (int l = 0; l < n; l++)
+        undecided += mask[l] != 0;
+
+    for (uint32_t i = 0; i < len && undecided > 0; i++) {
+        const uint8_t* p = b->memory + (size_t)(x + i) * n;
+        const uint8_t* q = b->memory + (size_t)(y + i) * n;
+        if (memcmp(p, q, n) == 0)
+            continue;
+        for (int l = 0; l < n; l++) {
+            if (mask[l] && b->equal[l] && p[l] != q[l]) {
+                b->not_equal[l] = 1;
+                b->equal[l] = 0;
+                b->greater_than[l] = p[l] > q[l];
+                b->less_than[l] = p[l] < q[l];
+                undecided--;
+            }
+        }
+    }
+}
+
+/* Whether every lane being run has the same operands,
+which are put in `v`, and whether that's every lane.
+False if no lane is being run. */
+static bool lanes_same_operands(VM_Batch* b, DecodedInstruction instr, const uint32_t* k,
+                                int num_operands, uint32_t v[3], bool* all_lanes) {
+    bool found = false;
+    *all_lanes = true;
+    for (int l = 0; l < b->num_lanes; l++) {
+        if (!b->mask[l]) {
+            *all_lanes = false;
+            continue;
+        }
+        for (int i = 0; i < num_operands; i++) {
+            uint32_t value = instr.a >> i & 1 ? lane_group(b->registers, l, k[i], instr.width) : k[i];
+            if (!found)
+                v[i] = value;
+            else if (value != v[i])
+                return false;
+        }
+        found = true;
+    }
+    return found;
+}
+
+static void lane_bulk_fail(VM_Batch* b, const DecodedProgram* program, const DecodedInstruction* instr,
+                           int l, uint32_t instr_ptr, uint32_t executed) {
+    b->errors[l] = decoder_bulk_error(program, instr);
+    b->instr_ptr[l] = instr_ptr;
+    b->waiting_at[l] = STOPPED;
+    b->program_counter[l] += executed;
+    b->mask[l] = 0;
+}
+
+// Lanes whose ranges are out of bounds stop, and are taken out of the mask
+static void lanes_bulk(VM_Batch* b, const DecodedProgram* program, DecodedInstruction instr,
+                       uint32_t instr_ptr, uint32_t executed) {
+    int n = b->num_lanes;
+    uint8_t** r = b->registers;
+    const uint32_t* k = program->constants + instr.target;
+    uint8_t type = MCPY + (instr.type - OP_MCPY);
+    int num_operands = type == PTS ? 2 : 3;
+
+    // Output is per lane anyway, so pts always goes a lane at a time
+    uint32_t v[3] = {0};
+    bool all_lanes;
+    if (type != PTS && lanes_same_operands(b, instr, k, num_operands, v, &all_lanes)) {
+        if (!op_bulk_in_bounds(v[0], v[2]) || (type != MSET && !op_bulk_in_bounds(v[1], v[2]))) {
+            for (int l = 0; l < n; l++) {
+                if (b->mask[l])
+                    lane_bulk_fail(b, program, &instr, l, instr_ptr, executed);
+            }
+            return;
+        }
+        switch (type) {
+            case MSET: rows_set(b, all_lanes, v[0], v[1], v[2]); break;
+            case MCMP: rows_compare(b, v[0], v[1], v[2]); break;
+            default:   rows_combine(b, all_lanes, type, v[0], v[1], v[2]); break;
+        }
+        return;
+    }
+
+    for (int l = 0; l < n; l++) {
+        if (!b->mask[l])
+            continue;
+
+        for (int i = 0; i < num_operands; i++)
+            v[i] = instr.a >> i & 1 ? lane_group(r, l, k[i], instr.width) : k[i];
+        uint32_t len = type == PTS ? v[1] : v[2];
+        bool in_bounds = op_bulk_in_bounds(v[0], len)
+                      && (type == PTS || type == MSET || op_bulk_in_bounds(v[1], len));
+        if (!in_bounds) {
+            lane_bulk_fail(b, program, &instr, l, instr_ptr, executed);
+            continue;
+        }
+
+        switch (type) {
+            case MSET:
+                for (uint32_t i = 0; i < len; i++)
+                    b->memory[(size_t)(v[0] + i) * n + l] = v[1];
+                break;
+            case MCMP:
+                lane_compare(b, l, v[0], v[1], len);
+                break;
+            case PTS:
+                for (uint32_t i = 0; i < len; i++)
+                    op_ptc(b->outputs[l], b->memory[(size_t)(v[0] + i) * n + l]);
+                break;
+            default:
+                lane_combine(b, l, type, v[0], v[1], len);
+                break;
+        }
+    }
+}
+
+// Instructions that lanes can be waiting at, i.e. the starts of basic blocks
+static bool* find_leaders(const DecodedProgram* program) {
+    bool* leaders = calloc(program->num_instrs + 1, sizeof(bool));
+    leaders[0] = true;
+    leaders[program->num_instrs] = true;
+    for (int i = 0; i < program->num_instrs; i++) {
+        DecodedInstruction instr = program->instrs[i];
+        if (instr.type >= OP_JMP_ABS && instr.type <= OP_JZ_ABS) {
+            leaders[instr.target] = true;
+            leaders[i + 1] = true;
+        }
+    }
+    return leaders;
+}
+
+// Runs the lanes in the mask from `ip` to the end of the basic block
+static void run_block(VM_Batch* b, const DecodedProgram* program, const bool* leaders, int ip) {
+    int n = b->num_lanes;
+    const uint8_t* mask = b->mask;
+    uint8_t** r = b->registers;
+    uint32_t executed = 0;
+
+    for (;;) {
+        DecodedInstruction instr = program->instrs[ip];
+        switch ((DecodedType)instr.type) {
+            case OP_NOP: break;
+
+            case OP_MOV_REG_REG: lanes_mov(n, mask, r[instr.a], r[instr.b], 0); break;
+            case OP_MOV_REG_IMM: lanes_mov(n, mask, r[instr.a], NULL, instr.b); break;
+
+            case OP_ADD_REG_REG: lanes_add(n, mask, r[instr.a], r[instr.b], 0, b->not_zero); break;
+            case OP_ADD_REG_IMM: lanes_add(n, mask, r[instr.a], NULL, instr.b, b->not_zero); break;
+            case OP_ADC_REG_REG: lanes_adc(b, mask, r[instr.a], r[instr.b], 0); break;
+            case OP_ADC_REG_IMM: lanes_adc(b, mask, r[instr.a], NULL, instr.b); break;
+            case OP_SBC_REG_REG: lanes_sbc(b, mask, r[instr.a], r[instr.b], 0); break;
+            case OP_SBC_REG_IMM: lanes_sbc(b, mask, r[instr.a], NULL, instr.b); break;
+            case OP_SUB_REG_REG: lanes_sub(n, mask, r[instr.a], r[instr.b], 0, b->not_zero); break;
+            case OP_SUB_REG_IMM: lanes_sub(n, mask, r[instr.a], NULL, instr.b, b->not_zero); break;
+            case OP_MUL_REG_REG: lanes_mul(n, mask, r[instr.a], r[instr.b], 0, b->not_zero); break;
+            case OP_MUL_REG_IMM: lanes_mul(n, mask, r[instr.a], NULL, instr.b, b->not_zero); break;
+            case OP_DIV_REG_REG: lanes_div(n, mask, r[instr.a], r[instr.b], 0, b->not_zero); break;
+            case OP_DIV_REG_IMM: lanes_div(n, mask, r[instr.a], NULL, instr.b, b->not_zero); break;
+            case OP_SHL_REG_REG: lanes_shl(n, mask, r[instr.a], r[instr.b], 0, b->not_zero); break;
+            case OP_SHL_REG_IMM: lanes_shl(n, mask, r[instr.a], NULL, instr.b, b->not_zero); break;
+            case OP_SHR_REG_REG: lanes_shr(n, mask, r[instr.a], r[instr.b], 0, b->not_zero); break;
+            case OP_SHR_REG_IMM: lanes_shr(n, mask, r[instr.a], NULL, instr.b, b->not_zero); break;
+
+            case OP_CLC: lanes_set(n, mask, b->carry, 0); break;
+            case OP_CLV: lanes_set(n, mask, b->overflow, 0); break;
+
+            case OP_NEG_REG: lanes_neg(n, mask, r[instr.a]); break;
+
+            case OP_STR_REG_REG: lanes_str(n, mask, b->memory, r[instr.a], 0, r[instr.b], 0); break;
+            case OP_STR_REG_IMM: lanes_str(n, mask, b->memory, r[instr.a], 0, NULL, instr.b); break;
+            case OP_STR_IMM_REG: lanes_str(n, mask, b->memory, NULL, instr.a, r[instr.b], 0); break;
+            case OP_STR_IMM_IMM: lanes_str(n, mask, b->memory, NULL, instr.a, NULL, instr.b); break;
+
+            case OP_LD_REG_REG: lanes_ld(n, mask, r[instr.a], b->memory, r[instr.b], 0); break;
+            case OP_LD_REG_IMM: lanes_ld(n, mask, r[instr.a], b->memory, NULL, instr.b); break;
+
+            case OP_CMP_REG_REG: lanes_cmp(b, mask, r[instr.a], 0, r[instr.b], 0); break;
+            case OP_CMP_REG_IMM: lanes_cmp(b, mask, r[instr.a], 0, NULL, instr.b); break;
+            case OP_CMP_IMM_REG: lanes_cmp(b, mask, NULL, instr.a, r[instr.b], 0); break;
+            case OP_CMP_IMM_IMM: lanes_cmp(b, mask, NULL, instr.a, NULL, instr.b); break;
+
+            case OP_PTC_REG: case OP_PTN_REG: case OP_PTU_REG:
+                lanes_print(b, mask, instr.type, r[instr.a], 0);
+                break;
+            case OP_PTC_IMM: case OP_PTN_IMM: case OP_PTU_IMM:
+                lanes_print(b, mask, instr.type, NULL, instr.a);
+                break;
+
+            case OP_JMP_ABS: lanes_jump(b, mask, NULL, 0, ip, instr.target, executed); return;
+            case OP_JNE_ABS: lanes_jump(b, mask, b->not_equal, 0, ip, instr.target, executed); return;
+            case OP_JE_ABS:  lanes_jump(b, mask, b->equal, 0, ip, instr.target, executed); return;
+            case OP_JGT_ABS: lanes_jump(b, mask, b->greater_than, 0, ip, instr.target, executed); return;
+            case OP_JLT_ABS: lanes_jump(b, mask, b->less_than, 0, ip, instr.target, executed); return;
+            case OP_JNZ_ABS: lanes_jump(b, mask, b->not_zero, 0, ip, instr.target, executed); return;
+            case OP_JZ_ABS:  lanes_jump(b, mask, b->not_zero, 1, ip, instr.target, executed); return;
+
+            case OP_HLT:
+                lanes_stop(b, mask, (VM_Error){.type = HALT}, ip, executed);
+                return;
+            // Lanes aren't connected to any channels, so they'd wait forever
+            case OP_SND_REG_REG: case OP_SND_REG_IMM: case OP_SND_IMM_REG: case OP_SND_IMM_IMM:
+            case OP_RCV_REG_REG: case OP_RCV_REG_IMM:
+                lanes_stop(b, mask, (VM_Error){.type = BLOCKED}, ip, executed);
+                return;
+            case OP_TRAP:
+                lanes_stop(b, mask, program->traps[instr.target], ip, executed);
+                return;
+            case OP_END:
+                lanes_leave(b, mask, ip, executed);
+                return;
+            case OP_MCPY: case OP_MSET: case OP_MCMP: case OP_MADD: case OP_MXOR: case OP_PTS:
+                lanes_bulk(b, program, instr, ip, executed);
+                break;
+            default:
+                if (!decoded_is_wide(instr.type)) {
+                    lanes_leave(b, mask, ip, executed);
+                    return;
+                }
+                lanes_wide(b, mask, program->constants, instr);
+                break;
+        }
+
+        executed++;
+        ip++;
+        if (leaders[ip]) {
+            lanes_leave(b, mask, ip, executed);
+            return;
+        }
+    }
+}
+
+/* Runs every lane until it halts, fails, or falls off the
+end, exactly as vm_run_decoded() would have run it alone.
+Lanes that share a sink have their output interleaved. */
+void vm_batch_run(VM_Batch* batch, const DecodedProgram* program) {
+    bool* leaders = find_leaders(program);
+    int n = batch->num_lanes;
+    uint32_t* waiting_at = batch->waiting_at;
+    uint8_t* mask = batch->mask;
+
+    for (int l = 0; l < n; l++)
+        waiting_at[l] = batch->errors[l].type == NONE ? batch->instr_ptr[l] : STOPPED;
+
+    for (;;) {
+        uint32_t ip = STOPPED;
+        for (int l = 0; l < n; l++)
+            ip = waiting_at[l] < ip ? waiting_at[l] : ip;
+        if (ip >= (uint32_t)program->num_instrs)
+            break;
+
+        for (int l = 0; l < n; l++)
+            mask[l] = waiting_at[l] == ip ? 0xFF : 0;
+
+        run_block(batch, program, leaders, ip);
+    }
+
+    for (int l = 0; l < n; l++) {
+        if (waiting_at[l] != STOPPED)
+            batch->instr_ptr[l] = waiting_at[l];
+        if (batch->outputs[l] != NULL)
+            output_flush(batch->outputs[l]);
+    }
+
+    free(leaders);
+}
\ No newline at end of file
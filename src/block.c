@@ -0,0 +1,286 @@
+/* Basic blocks for the interpreter. Stepping through
+an Instruction at a time means checking its operands,
+bounds checking `instr_ptr` and counting
+`program_counter` on every one of them, so vm_run()
+instead decodes the straight-line stretches it runs
+into blocks the second time it gets to them, and runs
+those a block at a time: operands were checked when
+decoding, and `program_counter` only moves once per
+block.
+
+Blocks start wherever the interpreter enters them
+rather than at every label, so that nothing has to look
+over the whole program first, and a jump into the middle
+of one just makes another. Each block remembers the
+blocks it leads to, so going from one to the next is a
+pointer away, with no lookup, until a backward jump
+hands control back to the interpreter, which yields and
+traces loops there. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "block.h"
+#include "ops.h"
+
+void block_cache_free(BlockCache* cache) {
+    if (cache->blocks != NULL) {
+        for (int i = 0; i < cache->num_instrs; i++)
+            free(cache->blocks[i]);
+    }
+    free(cache->blocks);
+    free(cache->visits);
+    *cache = (BlockCache){0};
+}
+
+static bool is_jump(uint8_t type) {
+    return type >= OP_JMP_ABS && type <= OP_JZ_ABS;
+}
+
+// Whatever would stop partway, or can only be run with a whole DecodedProgram
+static bool fits_in_block(uint8_t type) {
+    return type <= OP_PTU_IMM;
+}
+
+// The same as the interpreter's label_address()
+static uint32_t label_address(const VM* vm, Operand op) {
+    return op.value < (uint32_t)vm->num_labels ? vm->labels[op.value].address : 0;
+}
+
+// Returns NULL if too little fits to be worth it
+static Block* decode_block(const VM* vm, Instruction instrs[], int num_instrs, uint32_t start) {
+    DecodedInstruction ops[BLOCK_MAX_LENGTH + 1];
+    uint32_t length = 0;
+    while (length < BLOCK_MAX_LENGTH && start + length < (uint32_t)num_instrs) {
+        Instruction instr = instrs[start + length];
+        DecodedInstruction* op = &ops[length];
+        // The decoder never writes to the labels
+        if (!decoder_decode_instruction(op, instr, (Label*)vm->labels, vm->num_labels, num_instrs)
+            || !fits_in_block(op->type))
+            break;
+        length++;
+        if (is_jump(op->type)) {
+            /* The decoder sends anything past the end to
+            OP_END, but a run that's been given only some of
+            the program, like a streamed one, has to stop
+            where the label really is */
+            op->target = label_address(vm, instr.operands[0]);
+            break;
+        }
+    }
+    // A lone instruction isn't worth leaving the interpreter for
+    if (length < BLOCK_MIN_LENGTH)
+        return NULL;
+    // Never reached after a jump
+    ops[length] = (DecodedInstruction){.type = OP_END};
+
+    Block* block = malloc(sizeof(Block) + sizeof(DecodedInstruction) * (length + 1));
+    *block = (Block){.start = start, .length = length};
+    memcpy(block->ops, ops, sizeof(DecodedInstruction) * (length + 1));
+    return block;
+}
+
+Block* block_visit(BlockCache* cache, const VM* vm, Instruction instrs[], int num_instrs,
+                   uint32_t ip) {
+    if (ip >= (uint32_t)num_instrs)
+        return NULL;
+    if (cache->visits == NULL) {
+        cache->num_instrs = num_instrs;
+        cache->visits = calloc(num_instrs, sizeof(uint8_t));
+    }
+    if (++cache->visits[ip] < BLOCK_WARM)
+        return NULL;
+
+    // Only one try, so that anything left to the interpreter stays that way cheaply
+    Block* block = decode_block(vm, instrs, num_instrs, ip);
+    if (block == NULL) {
+        cache->visits[ip] = BLOCK_REFUSED;
+        return NULL;
+    }
+    // Code that only runs once never needs this
+    if (cache->blocks == NULL)
+        cache->blocks = calloc(num_instrs, sizeof(Block*));
+    cache->blocks[ip] = block;
+    return block;
+}
+
+// See decoder.c
+#if defined(__GNUC__) && !defined(STRVM_NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
+#ifdef USE_COMPUTED_GOTO
+#define TARGET(type) case type: TARGET_##type
+#define DISPATCH()   goto *dispatch_table[op->type]
+#else
+#define TARGET(type) case type
+#define DISPATCH()   goto dispatch
+#endif
+
+#define R(i)   vm->registers[i].value
+#define NEXT() do { op++; DISPATCH(); } while (0)
+
+#define JUMP_IF(cond) do { \
+        if (cond) { \
+            next = op->target; \
+            if (next < block->start + block->length) \
+                goto backward; \
+            link = &block->taken; \
+        } \
+        else { \
+            next = block->start + block->length; \
+            link = &block->next; \
+        } \
+        goto chain; \
+    } while (0)
+
+// See decoder.c
+#define ALU_VARIANTS(OP, expr) \
+    TARGET(OP##_REG_REG): { \
+        uint8_t* dst = &R(op->a); \
+        uint8_t result = *dst; \
+        result expr R(op->b); \
+        *dst = result; \
+        flags->result = result; \
+        NEXT(); \
+    } \
+    TARGET(OP##_REG_IMM): { \
+        uint8_t* dst = &R(op->a); \
+        uint8_t result = *dst; \
+        result expr op->b; \
+        *dst = result; \
+        flags->result = result; \
+        NEXT(); \
+    }
+
+/* Runs `block`, and the blocks after it, until a
+backward jump, which it takes before returning true,
+or until it gets somewhere that isn't a block, where it
+leaves `instr_ptr` and returns false. A backward jump
+always ends a block, so no run goes on forever. */
+bool block_run(VM* vm, LazyFlags* flags, BlockCache* cache, Instruction instrs[], int num_instrs,
+               Block* block) {
+#ifdef USE_COMPUTED_GOTO
+    static const void* dispatch_table[NUM_DECODED_TYPES] = {
+        [OP_NOP] = &&TARGET_OP_NOP,
+        [OP_MOV_REG_REG] = &&TARGET_OP_MOV_REG_REG, [OP_MOV_REG_IMM] = &&TARGET_OP_MOV_REG_IMM,
+        [OP_ADD_REG_REG] = &&TARGET_OP_ADD_REG_REG, [OP_ADD_REG_IMM] = &&TARGET_OP_ADD_REG_IMM,
+        [OP_ADC_REG_REG] = &&TARGET_OP_ADC_REG_REG, [OP_ADC_REG_IMM] = &&TARGET_OP_ADC_REG_IMM,
+        [OP_SBC_REG_REG] = &&TARGET_OP_SBC_REG_REG, [OP_SBC_REG_IMM] = &&TARGET_OP_SBC_REG_IMM,
+        [OP_SUB_REG_REG] = &&TARGET_OP_SUB_REG_REG, [OP_SUB_REG_IMM] = &&TARGET_OP_SUB_REG_IMM,
+        [OP_MUL_REG_REG] = &&TARGET_OP_MUL_REG_REG, [OP_MUL_REG_IMM] = &&TARGET_OP_MUL_REG_IMM,
+        [OP_DIV_REG_REG] = &&TARGET_OP_DIV_REG_REG, [OP_DIV_REG_IMM] = &&TARGET_OP_DIV_REG_IMM,
+        [OP_SHL_REG_REG] = &&TARGET_OP_SHL_REG_REG, [OP_SHL_REG_IMM] = &&TARGET_OP_SHL_REG_IMM,
+        [OP_SHR_REG_REG] = &&TARGET_OP_SHR_REG_REG, [OP_SHR_REG_IMM] = &&TARGET_OP_SHR_REG_IMM,
+        [OP_CLC] = &&TARGET_OP_CLC,
+        [OP_CLV] = &&TARGET_OP_CLV,
+        [OP_NEG_REG] = &&TARGET_OP_NEG_REG,
+        [OP_STR_REG_REG] = &&TARGET_OP_STR_REG_REG, [OP_STR_REG_IMM] = &&TARGET_OP_STR_REG_IMM,
+        [OP_STR_IMM_REG] = &&TARGET_OP_STR_IMM_REG, [OP_STR_IMM_IMM] = &&TARGET_OP_STR_IMM_IMM,
+        [OP_LD_REG_REG] = &&TARGET_OP_LD_REG_REG, [OP_LD_REG_IMM] = &&TARGET_OP_LD_REG_IMM,
+        [OP_CMP_REG_REG] = &&TARGET_OP_CMP_REG_REG, [OP_CMP_REG_IMM] = &&TARGET_OP_CMP_REG_IMM,
+        [OP_CMP_IMM_REG] = &&TARGET_OP_CMP_IMM_REG, [OP_CMP_IMM_IMM] = &&TARGET_OP_CMP_IMM_IMM,
+        [OP_JMP_ABS] = &&TARGET_OP_JMP_ABS,
+        [OP_JNE_ABS] = &&TARGET_OP_JNE_ABS,
+        [OP_JE_ABS] = &&TARGET_OP_JE_ABS,
+        [OP_JGT_ABS] = &&TARGET_OP_JGT_ABS,
+        [OP_JLT_ABS] = &&TARGET_OP_JLT_ABS,
+        [OP_JNZ_ABS] = &&TARGET_OP_JNZ_ABS,
+        [OP_JZ_ABS] = &&TARGET_OP_JZ_ABS,
+        [OP_PTC_REG] = &&TARGET_OP_PTC_REG, [OP_PTC_IMM] = &&TARGET_OP_PTC_IMM,
+        [OP_PTN_REG] = &&TARGET_OP_PTN_REG, [OP_PTN_IMM] = &&TARGET_OP_PTN_IMM,
+        [OP_PTU_REG] = &&TARGET_OP_PTU_REG, [OP_PTU_IMM] = &&TARGET_OP_PTU_IMM,
+        [OP_END] = &&TARGET_OP_END
+    };
+#endif
+
+    const DecodedInstruction* op = block->ops;
+    uint32_t next;
+    Block** link;
+
+#ifdef USE_COMPUTED_GOTO
+    DISPATCH();
+#else
+dispatch:
+#endif
+    switch ((DecodedType)op->type) {
+        TARGET(OP_NOP): NEXT();
+
+        TARGET(OP_MOV_REG_REG): R(op->a) = R(op->b); NEXT();
+        TARGET(OP_MOV_REG_IMM): R(op->a) = op->b; NEXT();
+
+        ALU_VARIANTS(OP_ADD, +=)
+        ALU_VARIANTS(OP_SUB, -=)
+        ALU_VARIANTS(OP_MUL, *=)
+        ALU_VARIANTS(OP_DIV, /=)
+        ALU_VARIANTS(OP_SHL, <<=)
+        ALU_VARIANTS(OP_SHR, >>=)
+
+        TARGET(OP_ADC_REG_REG): op_adc(vm, flags, &R(op->a), R(op->b), false); NEXT();
+        TARGET(OP_ADC_REG_IMM): op_adc(vm, flags, &R(op->a), op->b, false); NEXT();
+        TARGET(OP_SBC_REG_REG): op_adc(vm, flags, &R(op->a), R(op->b), true); NEXT();
+        TARGET(OP_SBC_REG_IMM): op_adc(vm, flags, &R(op->a), op->b, true); NEXT();
+
+        TARGET(OP_CLC): op_clc(vm, flags); NEXT();
+        TARGET(OP_CLV): op_clv(vm, flags); NEXT();
+
+        TARGET(OP_NEG_REG): R(op->a) = -R(op->a); NEXT();
+
+        TARGET(OP_STR_REG_REG): vm->memory[R(op->a)] = R(op->b); NEXT();
+        TARGET(OP_STR_REG_IMM): vm->memory[R(op->a)] = op->b; NEXT();
+        TARGET(OP_STR_IMM_REG): vm->memory[op->a] = R(op->b); NEXT();
+        TARGET(OP_STR_IMM_IMM): vm->memory[op->a] = op->b; NEXT();
+
+        TARGET(OP_LD_REG_REG): R(op->a) = vm->memory[R(op->b)]; NEXT();
+        TARGET(OP_LD_REG_IMM): R(op->a) = vm->memory[op->b]; NEXT();
+
+        TARGET(OP_CMP_REG_REG): flags_cmp(flags, R(op->a), R(op->b)); NEXT();
+        TARGET(OP_CMP_REG_IMM): flags_cmp(flags, R(op->a), op->b); NEXT();
+        TARGET(OP_CMP_IMM_REG): flags_cmp(flags, op->a, R(op->b)); NEXT();
+        TARGET(OP_CMP_IMM_IMM): flags_cmp(flags, op->a, op->b); NEXT();
+
+        TARGET(OP_PTC_REG): op_ptc(vm->output, R(op->a)); NEXT();
+        TARGET(OP_PTC_IMM): op_ptc(vm->output, op->a); NEXT();
+        TARGET(OP_PTN_REG): op_ptn(vm->output, R(op->a)); NEXT();
+        TARGET(OP_PTN_IMM): op_ptn(vm->output, op->a); NEXT();
+        TARGET(OP_PTU_REG): op_ptu(vm->output, R(op->a)); NEXT();
+        TARGET(OP_PTU_IMM): op_ptu(vm->output, op->a); NEXT();
+
+        TARGET(OP_JMP_ABS): JUMP_IF(true);
+        TARGET(OP_JNE_ABS): JUMP_IF(flags_compare(vm, flags).not_equal);
+        TARGET(OP_JE_ABS):  JUMP_IF(flags_compare(vm, flags).equal);
+        TARGET(OP_JGT_ABS): JUMP_IF(flags_compare(vm, flags).greater_than);
+        TARGET(OP_JLT_ABS): JUMP_IF(flags_compare(vm, flags).less_than);
+        TARGET(OP_JNZ_ABS): JUMP_IF(flags->result != 0);
+        TARGET(OP_JZ_ABS):  JUMP_IF(flags->result == 0);
+
+        // Ran off the end of a block that doesn't end with a jump
+        TARGET(OP_END): default: {
+            next = block->start + block->length;
+            link = &block->next;
+            goto chain;
+        }
+    }
+
+chain:
+    vm->program_counter += block->length;
+    if (*link == NULL) {
+        *link = block_at(cache, vm, instrs, num_instrs, next);
+        if (*link == NULL) {
+            vm->instr_ptr = next;
+            return false;
+        }
+    }
+    block = *link;
+    op = block->ops;
+    DISPATCH();
+
+backward:
+    vm->program_counter += block->length;
+    vm->instr_ptr = next;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+/* Kernels for the bulk memory instructions that libc
+has nothing for. mcpy, mset and mcmp go straight to
+memmove(), memset() and memcmp(), which are already
+vectorized as well as anything here could be.
+
+On x86 each kernel has an SSE2 version, which every
+x86-64 host can run, and with GCC or Clang an AVX2 one
+as well, used if the host turns out to support it.
+Anything else gets the plain loop, which the compiler
+is free to vectorize itself. Going forward a vector at
+a time gives the same result as going a byte at a time
+unless the destination starts partway into the source,
+so that case goes backward, a byte at a time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bulk.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define BULK_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(BULK_SSE2) && defined(__GNUC__)
+#define BULK_AVX2
+#include <immintrin.h>
+#endif
+
+// Each returns how many bytes it got through, leaving the rest for the next one down
+
+#ifdef BULK_AVX2
+#define AVX2_KERNEL(name, vector_op) \
+    __attribute__((target("avx2"))) \
+    static size_t name##_avx2(uint8_t* dst, const uint8_t* src, size_t len) { \
+        size_t i = 0; \
+        for (; i + 32 <= len; i += 32) { \
+            __m256i a = _mm256_loadu_si256((const __m256i*)(dst + i)); \
+            __m256i b = _mm256_loadu_si256((const __m256i*)(src + i)); \
+            _mm256_storeu_si256((__m256i*)(dst + i), vector_op(a, b)); \
+        } \
+        return i; \
+    }
+
+AVX2_KERNEL(add, _mm256_add_epi8)
+AVX2_KERNEL(xor, _mm256_xor_si256)
+#endif
+
+#ifdef BULK_SSE2
+#define SSE2_KERNEL(name, vector_op) \
+    static size_t name##_sse2(uint8_t* dst, const uint8_t* src, size_t len) { \
+        size_t i = 0; \
+        for (; i + 16 <= len; i += 16) { \
+            __m128i a = _mm_loadu_si128((const __m128i*)(dst + i)); \
+            __m128i b = _mm_loadu_si128((const __m128i*)(src + i)); \
+            _mm_storeu_si128((__m128i*)(dst + i), vector_op(a, b)); \
+        } \
+        return i; \
+    }
+
+SSE2_KERNEL(add, _mm_add_epi8)
+SSE2_KERNEL(xor, _mm_xor_si128)
+#endif
+
+// Going forward would read bytes that it had already written
+static bool overlaps_behind(const uint8_t* dst, const uint8_t* src, size_t len) {
+    return dst > src && dst < src + len;
+}
+
+void bulk_add(uint8_t* dst, const uint8_t* src, size_t len) {
+    if (overlaps_behind(dst, src, len)) {
+        while (len-- > 0)
+            dst[len] += src[len];
+        return;
+    }
+    size_t i = 0;
+#ifdef BULK_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        i = add_avx2(dst, src, len);
+#endif
+#ifdef BULK_SSE2
+    i += add_sse2(dst + i, src + i, len - i);
+#endif
+    for (; i < len; i++)
+        dst[i] += src[i];
+}
+
+void bulk_xor(uint8_t* dst, const uint8_t* src, size_t len) {
+    if (overlaps_behind(dst, src, len)) {
+        while (len-- > 0)
+            dst[len] ^= src[len];
+        return;
+    }
+    size_t i = 0;
+#ifdef BULK_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        i = xor_avx2(dst, src, len);
+#endif
+#ifdef BULK_SSE2
+    i += xor_sse2(dst + i, src + i, len - i);
+#endif
+    for (; i < len; i++)
+        dst[i] ^= src[i];
+}
\ No newline at end of file
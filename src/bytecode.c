@@ -0,0 +1,269 @@
+/* Binary images of lexed programs. An image holds
+both the lexer's Instruction[] and the decoded form
+of the same program, laid out exactly as they are in
+memory, so loading one is a matter of mapping the file
+and pointing at it. Nothing is parsed or copied.
+
+The checksum guards against truncated or otherwise
+damaged files, not against hostile ones; images should
+be treated like executables. */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "bytecode.h"
+#include "lexer.h"
+
+#define ENDIANNESS_MARKER 0x0102
+
+static uint32_t align_up(uint32_t value) {
+    return (value + BYTECODE_ALIGNMENT - 1) & ~(uint32_t)(BYTECODE_ALIGNMENT - 1);
+}
+
+static uint32_t checksum(const uint8_t* data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+BytecodeError bytecode_write(const char* filename, Instruction instrs[], int num_instrs,
+                             Label labels[], int num_labels) {
+    DecodedProgram decoded = decoder_decode(instrs, num_instrs, labels, num_labels);
+
+    BytecodeHeader header = {.magic = BYTECODE_MAGIC,
+                             .version = BYTECODE_VERSION,
+                             .endianness = ENDIANNESS_MARKER,
+                             .instruction_size = sizeof(Instruction),
+                             .decoded_size = sizeof(DecodedInstruction),
+                             .error_size = sizeof(VM_Error),
+                             .num_instrs = num_instrs,
+                             .num_labels = num_labels,
+                             .num_traps = decoded.num_traps,
+                             .num_constants = decoded.num_constants};
+    header.instrs_offset = align_up(sizeof(BytecodeHeader));
+    header.labels_offset = align_up(header.instrs_offset + sizeof(Instruction) * num_instrs);
+    header.decoded_offset = align_up(header.labels_offset + sizeof(uint32_t) * num_labels);
+    header.traps_offset = align_up(header.decoded_offset
+                                   + sizeof(DecodedInstruction) * (num_instrs + 1));
+    header.constants_offset = align_up(header.traps_offset + sizeof(VM_Error) * decoded.num_traps);
+    header.size = align_up(header.constants_offset + sizeof(uint32_t) * decoded.num_constants);
+
+    // calloc() so that struct padding is always written out as zeroes
+    uint8_t* image = calloc(header.size, 1);
+
+    Instruction* out_instrs = (Instruction*)(image + header.instrs_offset);
+    for (int i = 0; i < num_instrs; i++) {
+        out_instrs[i].type = instrs[i].type;
+        out_instrs[i].width = instrs[i].width;
+        for (int j = 0; j < NUM_OPERANDS; j++) {
+            out_instrs[i].operands[j].is_register = instrs[i].operands[j].is_register;
+            out_instrs[i].operands[j].is_label = instrs[i].operands[j].is_label;
+            out_instrs[i].operands[j].value = instrs[i].operands[j].value;
+        }
+    }
+
+    uint32_t* out_labels = (uint32_t*)(image + header.labels_offset);
+    for (int i = 0; i < num_labels; i++)
+        out_labels[i] = labels[i].defined ? labels[i].address : LABEL_UNDEFINED;
+
+    DecodedInstruction* out_decoded = (DecodedInstruction*)(image + header.decoded_offset);
+    for (int i = 0; i <= num_instrs; i++) {
+        out_decoded[i].type = decoded.instrs[i].type;
+        out_decoded[i].a = decoded.instrs[i].a;
+        out_decoded[i].b = decoded.instrs[i].b;
+        out_decoded[i].width = decoded.instrs[i].width;
+        out_decoded[i].target = decoded.instrs[i].target;
+    }
+
+    VM_Error* out_traps = (VM_Error*)(image + header.traps_offset);
+    for (int i = 0; i < decoded.num_traps; i++) {
+        out_traps[i].type = decoded.traps[i].type;
+        memcpy(out_traps[i].operands, decoded.traps[i].operands, sizeof(out_traps[i].operands));
+    }
+
+    uint32_t* out_constants = (uint32_t*)(image + header.constants_offset);
+    for (int i = 0; i < decoded.num_constants; i++)
+        out_constants[i] = decoded.constants[i];
+    decoder_free(&decoded);
+
+    header.checksum = checksum(image + sizeof(BytecodeHeader),
+                               header.size - sizeof(BytecodeHeader));
+    memcpy(image, &header, sizeof(BytecodeHeader));
+
+    BytecodeError error = BYTECODE_OK;
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL || fwrite(image, 1, header.size, file) != header.size)
+        error = BYTECODE_IO_ERROR;
+    if (file != NULL && fclose(file) != 0)
+        error = BYTECODE_IO_ERROR;
+
+    free(image);
+    return error;
+}
+
+static bool section_fits(const BytecodeHeader* header, uint32_t offset, size_t len) {
+    return offset % BYTECODE_ALIGNMENT == 0 && offset <= header->size
+           && len <= header->size - offset;
+}
+
+static BytecodeError validate(const uint8_t* base, size_t size) {
+    const BytecodeHeader* header = (const BytecodeHeader*)base;
+    if (size < sizeof(BytecodeHeader) || memcmp(header->magic, BYTECODE_MAGIC, sizeof(header->magic)))
+        return BYTECODE_NOT_AN_IMAGE;
+    if (header->version != BYTECODE_VERSION)
+        return BYTECODE_BAD_VERSION;
+    if (header->endianness != ENDIANNESS_MARKER
+        || header->instruction_size != sizeof(Instruction)
+        || header->decoded_size != sizeof(DecodedInstruction)
+        || header->error_size != sizeof(VM_Error))
+        return BYTECODE_BAD_LAYOUT;
+
+    if (header->size != size
+        || !section_fits(header, header->instrs_offset, sizeof(Instruction) * (size_t)header->num_instrs)
+        || !section_fits(header, header->labels_offset, sizeof(uint32_t) * (size_t)header->num_labels)
+        || !section_fits(header, header->decoded_offset,
+                         sizeof(DecodedInstruction) * ((size_t)header->num_instrs + 1))
+        || !section_fits(header, header->traps_offset, sizeof(VM_Error) * (size_t)header->num_traps)
+        || !section_fits(header, header->constants_offset,
+                         sizeof(uint32_t) * (size_t)header->num_constants))
+        return BYTECODE_CORRUPT;
+
+    if (checksum(base + sizeof(BytecodeHeader), size - sizeof(BytecodeHeader)) != header->checksum)
+        return BYTECODE_CORRUPT;
+
+    return BYTECODE_OK;
+}
+
+static void release(BytecodeImage* image) {
+#if !defined(_WIN32)
+    if (image->mapped) {
+        munmap(image->base, image->size);
+        return;
+    }
+#endif
+    free(image->base);
+}
+
+// Takes ownership of image.base, releasing it on failure
+static BytecodeImage open_image(BytecodeImage image) {
+    image.error = validate(image.base, image.size);
+    if (image.error != BYTECODE_OK) {
+        release(&image);
+        return (BytecodeImage){.error = image.error};
+    }
+
+    uint8_t* base = image.base;
+    image.header = (const BytecodeHeader*)base;
+    image.instrs = (Instruction*)(base + image.header->instrs_offset);
+    image.label_addresses = (const uint32_t*)(base + image.header->labels_offset);
+    image.decoded = (DecodedProgram){
+        .instrs = (DecodedInstruction*)(base + image.header->decoded_offset),
+        .num_instrs = image.header->num_instrs,
+        .traps = (VM_Error*)(base + image.header->traps_offset),
+        .num_traps = image.header->num_traps,
+        .constants = (uint32_t*)(base + image.header->constants_offset),
+        .num_constants = image.header->num_constants
+    };
+    return image;
+}
+
+/* Labels as lexer_lex() would have left them, but
+without names, since images don't keep them */
+Label* bytecode_labels(const BytecodeImage* image) {
+    int num_labels = image->header->num_labels;
+    Label* labels = calloc(num_labels ? num_labels : 1, sizeof(Label));
+    for (int i = 0; i < num_labels; i++) {
+        uint32_t address = image->label_addresses[i];
+        labels[i].defined = address != LABEL_UNDEFINED;
+        labels[i].address = labels[i].defined ? address : 0;
+    }
+    return labels;
+}
+
+/* Maps the file where mmap() is available, and
+reads it into memory everywhere else */
+BytecodeImage bytecode_load(const char* filename) {
+    BytecodeImage image = {.error = BYTECODE_IO_ERROR};
+
+#if !defined(_WIN32)
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+        return image;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return image;
+    }
+    // Too small to map anything useful
+    if (st.st_size < (off_t)sizeof(BytecodeHeader)) {
+        close(fd);
+        image.error = BYTECODE_NOT_AN_IMAGE;
+        return image;
+    }
+    image.size = st.st_size;
+    image.base = mmap(NULL, image.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image.base == MAP_FAILED)
+        return (BytecodeImage){.error = BYTECODE_IO_ERROR};
+    image.mapped = true;
+#else
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return image;
+    fseek(file, 0, SEEK_END);
+    image.size = ftell(file);
+    rewind(file);
+    image.base = malloc(image.size ? image.size : 1);
+    size_t bytes_read = fread(image.base, 1, image.size, file);
+    fclose(file);
+    if (bytes_read != image.size) {
+        free(image.base);
+        return image;
+    }
+#endif
+
+    return open_image(image);
+}
+
+/* Copies the image, so `data` can go as soon as this
+returns. malloc() gives at least the alignment that the
+sections need. */
+BytecodeImage bytecode_load_memory(const void* data, size_t size) {
+    BytecodeImage image = {.size = size, .base = malloc(size ? size : 1)};
+    memcpy(image.base, data, size);
+    return open_image(image);
+}
+
+void bytecode_unload(BytecodeImage* image) {
+    if (image->base != NULL)
+        release(image);
+    *image = (BytecodeImage){0};
+}
+
+const char* bytecode_error_string(BytecodeError error) {
+    switch (error) {
+        case BYTECODE_OK:           return "no error";
+        case BYTECODE_IO_ERROR:     return "couldn't be read or written";
+        case BYTECODE_NOT_AN_IMAGE: return "isn't a bytecode image";
+        case BYTECODE_BAD_VERSION:  return "was written by an incompatible version";
+        case BYTECODE_BAD_LAYOUT:   return "was written by an incompatible build";
+        case BYTECODE_CORRUPT:      return "is corrupt";
+    }
+    return "has an unknown problem";
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "channel.h"
+
+ChannelSet* channel_set_create() {
+    return calloc(1, sizeof(ChannelSet));
+}
+
+void channel_set_free(ChannelSet* set) {
+    free(set);
+}
+
+static void touch(ChannelSet* set, uint8_t channel, uint8_t what) {
+    if (set->touched[channel] == 0)
+        set->touched_list[set->num_touched++] = channel;
+    set->touched[channel] |= what;
+}
+
+static bool block(ChannelSet* set, uint8_t channel, bool sending) {
+    set->blocked_channel = channel;
+    set->blocked_sending = sending;
+    return false;
+}
+
+bool channel_send(ChannelSet* set, uint8_t channel, uint8_t value) {
+    Channel* c = &set->channels[channel];
+    if (c->len == CHANNEL_CAPACITY)
+        return block(set, channel, true);
+    c->data[(c->head + c->len++) % CHANNEL_CAPACITY] = value;
+    touch(set, channel, CHANNEL_SENT);
+    return true;
+}
+
+bool channel_receive(ChannelSet* set, uint8_t channel, uint8_t* value) {
+    Channel* c = &set->channels[channel];
+    if (c->len == 0)
+        return block(set, channel, false);
+    *value = c->data[c->head];
+    c->head = (c->head + 1) % CHANNEL_CAPACITY;
+    c->len--;
+    touch(set, channel, CHANNEL_RECEIVED);
+    return true;
+}
+
+void channel_clear_touched(ChannelSet* set) {
+    for (int i = 0; i < set->num_touched; i++)
+        set->touched[set->touched_list[i]] = 0;
+    set->num_touched = 0;
+}
\ No newline at end of file
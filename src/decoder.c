@@ -0,0 +1,592 @@
+/* The decoded engine. decoder_decode() does all
+of the operand checking that execute_instruction()
+repeats on every step, once, at load time, and
+resolves labels to absolute instruction indices.
+What comes out can then be run without any checks.
+
+Instructions that would fail at runtime are decoded
+into OP_TRAP rather than rejected, since the interpreter
+only reports an error if such an instruction is
+actually reached. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "ops.h"
+
+typedef enum {
+    KIND_REG,
+    KIND_IMM,
+    KIND_INVALID
+} OperandKind;
+
+// Mirrors get_operand_register()
+static bool is_gp_register(Operand op) {
+    return op.is_register && !op.is_label && op.value < NUM_GP_REGISTERS;
+}
+
+// Mirrors get_operand_value(), with rz as an immediate 0
+static OperandKind value_kind(Operand* op) {
+    if (op->is_register && op->value == REGISTER_RZ) {
+        *op = (Operand){.value = 0};
+        return KIND_IMM;
+    }
+    if (op->is_register)
+        return op->value < NUM_GP_REGISTERS ? KIND_REG : KIND_INVALID;
+    else if (!op->is_label)
+        return KIND_IMM;
+    return KIND_INVALID;
+}
+
+/* Picks the REG or IMM variant of an instruction,
+which are always declared in that order */
+static bool decode_reg_value(DecodedInstruction* out, DecodedType reg_variant,
+                             Operand dst, Operand src) {
+    OperandKind kind = value_kind(&src);
+    if (!is_gp_register(dst) || kind == KIND_INVALID)
+        return false;
+
+    *out = (DecodedInstruction){.type = reg_variant + (kind == KIND_IMM),
+                                .a = dst.value, .b = src.value};
+    return true;
+}
+
+// Same as above, but for REG_REG, REG_IMM, IMM_REG, IMM_IMM
+static bool decode_value_value(DecodedInstruction* out, DecodedType reg_reg_variant,
+                               Operand a, Operand b) {
+    OperandKind kind_a = value_kind(&a);
+    OperandKind kind_b = value_kind(&b);
+    if (kind_a == KIND_INVALID || kind_b == KIND_INVALID)
+        return false;
+
+    *out = (DecodedInstruction){.type = reg_reg_variant + (kind_a == KIND_IMM) * 2
+                                                        + (kind_b == KIND_IMM),
+                                .a = a.value, .b = b.value};
+    return true;
+}
+
+static bool decode_value(DecodedInstruction* out, DecodedType reg_variant, Operand src) {
+    OperandKind kind = value_kind(&src);
+    if (kind == KIND_INVALID)
+        return false;
+
+    *out = (DecodedInstruction){.type = reg_variant + (kind == KIND_IMM), .a = src.value};
+    return true;
+}
+
+static bool decode_jump(DecodedInstruction* out, DecodedType type, Operand dst,
+                        Label labels[], int num_labels, int num_instrs) {
+    if (!dst.is_label)
+        return false;
+
+    /* Labels that are used but never defined keep
+    their placeholder address of 0. Anything past the
+    end goes to OP_END, same as falling off the end. */
+    uint32_t target = dst.value < (uint32_t)num_labels ? labels[dst.value].address : 0;
+    if (target > (uint32_t)num_instrs)
+        target = num_instrs;
+
+    *out = (DecodedInstruction){.type = type, .target = target};
+    return true;
+}
+
+// The REG (or REG_REG) variant of each instruction that has a wide version
+static const DecodedType WIDE_VARIANTS[NUM_INSTR_TYPES] = {
+    [MOV] = OP_WIDE_MOV_REG_REG, [ADD] = OP_WIDE_ADD_REG_REG, [SUB] = OP_WIDE_SUB_REG_REG,
+    [MUL] = OP_WIDE_MUL_REG_REG, [DIV] = OP_WIDE_DIV_REG_REG, [SHL] = OP_WIDE_SHL_REG_REG,
+    [SHR] = OP_WIDE_SHR_REG_REG, [LD] = OP_WIDE_LD_REG_REG, [STR] = OP_WIDE_STR_REG_REG,
+    [CMP] = OP_WIDE_CMP_REG_REG
+};
+
+static bool is_bulk(Instruction instr) {
+    return instr.type >= MCPY && instr.type <= PTS;
+}
+
+// Mirrors execute_instruction() and execute_wide() turning an instruction down
+static bool has_wide_version(Instruction instr) {
+    return instr.type >= 0 && instr.type < NUM_INSTR_TYPES && instr.width < NUM_WIDTHS
+           && (WIDE_VARIANTS[instr.type] != OP_NOP || is_bulk(instr));
+}
+
+// Mirrors get_wide_register() and get_wide_value()
+static OperandKind wide_kind(Operand op, uint8_t width) {
+    if (op.is_register)
+        return op.value <= NUM_GP_REGISTERS - (1u << width) ? KIND_REG : KIND_INVALID;
+    else if (!op.is_label)
+        return KIND_IMM;
+    return KIND_INVALID;
+}
+
+/* Wide immediates go in `constants`, which has room
+for three per instruction, cut down to the width */
+static bool decode_wide(DecodedProgram* program, DecodedInstruction* out, Instruction instr) {
+    if (!has_wide_version(instr))
+        return false;
+    uint8_t width = instr.width;
+    Operand* ops = instr.operands;
+    DecodedType variant = WIDE_VARIANTS[instr.type];
+    bool two_values = variant == OP_WIDE_STR_REG_REG || variant == OP_WIDE_CMP_REG_REG;
+
+    OperandKind kind_a = wide_kind(ops[0], width);
+    OperandKind kind_b = wide_kind(ops[1], width);
+    // Everything else has a register group as its destination
+    bool dst_ok = two_values || (kind_a == KIND_REG && !ops[0].is_label);
+    if (kind_a == KIND_INVALID || kind_b == KIND_INVALID || !dst_ok)
+        return false;
+
+    *out = (DecodedInstruction){.type = variant + (kind_a == KIND_IMM) * 2 + (kind_b == KIND_IMM),
+                                .width = width, .target = program->num_constants};
+    if (kind_a == KIND_REG)
+        out->a = ops[0].value;
+    else
+        program->constants[program->num_constants++] = ops[0].value & width_mask(width);
+    if (kind_b == KIND_REG)
+        out->b = ops[1].value;
+    else
+        program->constants[program->num_constants++] = ops[1].value & width_mask(width);
+    return true;
+}
+
+// Mirrors execute_bulk()
+static bool decode_bulk(DecodedProgram* program, DecodedInstruction* out, Instruction instr) {
+    if (instr.width >= NUM_WIDTHS)
+        return false;
+    int num_operands = instr.type == PTS ? 2 : 3;
+    *out = (DecodedInstruction){.type = OP_MCPY + (instr.type - MCPY), .width = instr.width,
+                                .target = program->num_constants};
+    for (int i = 0; i < num_operands; i++) {
+        OperandKind kind = wide_kind(instr.operands[i], instr.width);
+        if (kind == KIND_INVALID)
+            return false;
+        out->a |= (kind == KIND_REG) << i;
+        program->constants[out->target + i] = instr.operands[i].value & width_mask(instr.width);
+    }
+    program->num_constants += num_operands;
+    return true;
+}
+
+static bool decode_instruction(DecodedInstruction* out, Instruction instr,
+                               Label labels[], int num_labels, int num_instrs) {
+    Operand* ops = instr.operands;
+    switch (instr.type) {
+        case NOP: *out = (DecodedInstruction){.type = OP_NOP}; return true;
+        case MOV: return decode_reg_value(out, OP_MOV_REG_REG, ops[0], ops[1]);
+        case ADD: return decode_reg_value(out, OP_ADD_REG_REG, ops[0], ops[1]);
+        case ADC: return decode_reg_value(out, OP_ADC_REG_REG, ops[0], ops[1]);
+        case SUB: return decode_reg_value(out, OP_SUB_REG_REG, ops[0], ops[1]);
+        case MUL: return decode_reg_value(out, OP_MUL_REG_REG, ops[0], ops[1]);
+        case DIV: return decode_reg_value(out, OP_DIV_REG_REG, ops[0], ops[1]);
+        case SHL: return decode_reg_value(out, OP_SHL_REG_REG, ops[0], ops[1]);
+        case SHR: return decode_reg_value(out, OP_SHR_REG_REG, ops[0], ops[1]);
+        case SBC: return decode_reg_value(out, OP_SBC_REG_REG, ops[0], ops[1]);
+        case CLC: *out = (DecodedInstruction){.type = OP_CLC}; return true;
+        case CLV: *out = (DecodedInstruction){.type = OP_CLV}; return true;
+        case NEG: {
+            if (!is_gp_register(ops[0]))
+                return false;
+            *out = (DecodedInstruction){.type = OP_NEG_REG, .a = ops[0].value};
+            return true;
+        }
+        case STR: return decode_value_value(out, OP_STR_REG_REG, ops[0], ops[1]);
+        case LD:  return decode_reg_value(out, OP_LD_REG_REG, ops[0], ops[1]);
+        case CMP: return decode_value_value(out, OP_CMP_REG_REG, ops[0], ops[1]);
+        case JMP: return decode_jump(out, OP_JMP_ABS, ops[0], labels, num_labels, num_instrs);
+        case JNE: return decode_jump(out, OP_JNE_ABS, ops[0], labels, num_labels, num_instrs);
+        case JE:  return decode_jump(out, OP_JE_ABS, ops[0], labels, num_labels, num_instrs);
+        case JGT: return decode_jump(out, OP_JGT_ABS, ops[0], labels, num_labels, num_instrs);
+        case JLT: return decode_jump(out, OP_JLT_ABS, ops[0], labels, num_labels, num_instrs);
+        case JNZ: return decode_jump(out, OP_JNZ_ABS, ops[0], labels, num_labels, num_instrs);
+        case JZ:  return decode_jump(out, OP_JZ_ABS, ops[0], labels, num_labels, num_instrs);
+        case PTC: return decode_value(out, OP_PTC_REG, ops[0]);
+        case PTN: return decode_value(out, OP_PTN_REG, ops[0]);
+        case PTU: return decode_value(out, OP_PTU_REG, ops[0]);
+        case HLT: *out = (DecodedInstruction){.type = OP_HLT}; return true;
+        case SND: return decode_value_value(out, OP_SND_REG_REG, ops[0], ops[1]);
+        case RCV: return decode_reg_value(out, OP_RCV_REG_REG, ops[0], ops[1]);
+        default:  return false;
+    }
+}
+
+bool decoder_decode_instruction(DecodedInstruction* out, Instruction instr,
+                                Label labels[], int num_labels, int num_instrs) {
+    return instr.width == WIDTH_BYTE && !is_bulk(instr)
+        && decode_instruction(out, instr, labels, num_labels, num_instrs);
+}
+
+DecodedProgram decoder_decode(Instruction instrs[], int num_instrs, Label labels[], int num_labels) {
+    DecodedProgram program = {.num_instrs = num_instrs};
+    program.instrs = malloc(sizeof(DecodedInstruction) * (num_instrs + 1));
+    program.traps = malloc(sizeof(VM_Error) * (num_instrs + 1));
+    program.constants = malloc(sizeof(uint32_t) * (3 * num_instrs + 1));
+
+    for (int i = 0; i < num_instrs; i++) {
+        bool wide = instrs[i].width != WIDTH_BYTE;
+        bool decoded = is_bulk(instrs[i]) ? decode_bulk(&program, &program.instrs[i], instrs[i])
+                     : wide ? decode_wide(&program, &program.instrs[i], instrs[i])
+                     : decode_instruction(&program.instrs[i], instrs[i], labels, num_labels, num_instrs);
+        if (decoded)
+            continue;
+
+        VM_Error* trap = &program.traps[program.num_traps];
+        if (instrs[i].type >= NUM_INSTR_TYPES || instrs[i].type < 0
+            || (wide && !has_wide_version(instrs[i])))
+            *trap = (VM_Error){.type = INVALID_INSTRUCTION};
+        else {
+            *trap = (VM_Error){.type = INVALID_OPERAND};
+            memcpy(trap->operands, instrs[i].operands, sizeof(trap->operands));
+        }
+        program.instrs[i] = (DecodedInstruction){.type = OP_TRAP,
+                                                 .target = program.num_traps++};
+    }
+    program.instrs[num_instrs] = (DecodedInstruction){.type = OP_END};
+
+    return program;
+}
+
+void decoder_free(DecodedProgram* program) {
+    free(program->instrs);
+    free(program->traps);
+    free(program->constants);
+    *program = (DecodedProgram){0};
+}
+
+/* How many bytes at the start of memory a program can
+ever touch. Plain ld and str can only reach the first
+256, so engines that have to copy memory around can
+skip the rest for programs without wide ones. Bulk
+instructions are counted even without a suffix, since
+a range starting below 256 can go past it. */
+uint32_t decoder_memory_reach(const DecodedProgram* program) {
+    for (int i = 0; i < program->num_instrs; i++) {
+        uint8_t type = program->instrs[i].type;
+        if ((type >= OP_WIDE_LD_REG_REG && type <= OP_WIDE_STR_IMM_IMM) || decoded_is_bulk(type))
+            return MEMORY_SIZE;
+    }
+    return UINT8_MAX + 1;
+}
+
+/* With GCC and Clang every handler jumps straight
+to the next one through a table of label addresses
+(computed goto), which gives the branch predictor one
+indirect branch per handler instead of one shared by
+all of them. Everything else gets a plain switch. */
+#if defined(__GNUC__) && !defined(STRVM_NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
+#ifdef USE_COMPUTED_GOTO
+#define TARGET(type) case type: TARGET_##type
+#define DISPATCH()   goto *dispatch_table[ip->type]
+#else
+#define TARGET(type) case type
+#define DISPATCH()   goto dispatch
+#endif
+
+#define R(i)   vm->registers[i].value
+#define NEXT() do { ip++; pc++; DISPATCH(); } while (0)
+// Backward jumps are the only place a run can yield
+#define JUMP_IF(cond) do { \
+        pc++; \
+        if (cond) { \
+            bool backward = ip->target <= (uint32_t)(ip - code); \
+            ip = code + ip->target; \
+            if (backward && pc - start_pc >= slice) { \
+                error = (VM_Error){.type = YIELD}; \
+                goto done; \
+            } \
+        } \
+        else \
+            ip++; \
+        DISPATCH(); \
+    } while (0)
+
+// Stays on the instruction if it has to wait, so it's run again on resuming
+#define CHANNEL_OP(ok) do { \
+        if (!(ok)) { \
+            error = (VM_Error){.type = BLOCKED}; \
+            goto done; \
+        } \
+        NEXT(); \
+    } while (0)
+
+/* The result is worked out in a local before storing
+it, because registers are bytes and so may alias the
+instruction stream as far as the compiler knows */
+#define ALU_VARIANTS(OP, expr) \
+    TARGET(OP##_REG_REG): { \
+        uint8_t* dst = &R(ip->a); \
+        uint8_t result = *dst; \
+        result expr R(ip->b); \
+        *dst = result; \
+        flags.result = result; \
+        NEXT(); \
+    } \
+    TARGET(OP##_REG_IMM): { \
+        uint8_t* dst = &R(ip->a); \
+        uint8_t result = *dst; \
+        result expr ip->b; \
+        *dst = result; \
+        flags.result = result; \
+        NEXT(); \
+    }
+
+static inline void wide_alu(VM* vm, LazyFlags* flags, const DecodedInstruction* ip,
+                            InstructionType type, uint32_t value) {
+    Register* dst = &vm->registers[ip->a];
+    uint32_t result = op_wide_arith(type, op_wide_get(dst, ip->width), value) & width_mask(ip->width);
+    op_wide_set(dst, ip->width, result);
+    if (type != MOV)
+        flags->result = result != 0;
+}
+
+#define WIDE(reg) op_wide_get(&vm->registers[reg], ip->width)
+#define WIDE_ALU_VARIANTS(OP, type) \
+    case OP##_REG_REG: wide_alu(vm, flags, ip, type, WIDE(ip->b)); break; \
+    case OP##_REG_IMM: wide_alu(vm, flags, ip, type, k[0]); break;
+
+/* Wide instructions all share one handler, since
+they're there to save instructions rather than time
+spent on each one */
+static inline void run_wide(VM* vm, LazyFlags* flags, const uint32_t* constants,
+                            const DecodedInstruction* ip) {
+    const uint32_t* k = constants + ip->target;
+    switch ((DecodedType)ip->type) {
+        WIDE_ALU_VARIANTS(OP_WIDE_MOV, MOV)
+        WIDE_ALU_VARIANTS(OP_WIDE_ADD, ADD)
+        WIDE_ALU_VARIANTS(OP_WIDE_SUB, SUB)
+        WIDE_ALU_VARIANTS(OP_WIDE_MUL, MUL)
+        WIDE_ALU_VARIANTS(OP_WIDE_DIV, DIV)
+        WIDE_ALU_VARIANTS(OP_WIDE_SHL, SHL)
+        WIDE_ALU_VARIANTS(OP_WIDE_SHR, SHR)
+
+        case OP_WIDE_LD_REG_REG: case OP_WIDE_LD_REG_IMM: {
+            uint32_t address = ip->type == OP_WIDE_LD_REG_REG ? WIDE(ip->b) : k[0];
+            op_wide_set(&vm->registers[ip->a], ip->width, op_wide_load(vm->memory, address, ip->width));
+            break;
+        }
+        case OP_WIDE_STR_REG_REG: case OP_WIDE_STR_REG_IMM:
+        case OP_WIDE_STR_IMM_REG: case OP_WIDE_STR_IMM_IMM:
+        case OP_WIDE_CMP_REG_REG: case OP_WIDE_CMP_REG_IMM:
+        case OP_WIDE_CMP_IMM_REG: case OP_WIDE_CMP_IMM_IMM: {
+            // REG_REG, REG_IMM, IMM_REG, then IMM_IMM, for both
+            int variant = (ip->type - OP_WIDE_STR_REG_REG) % 4;
+            uint32_t a = variant < 2 ? WIDE(ip->a) : k[0];
+            uint32_t b = variant % 2 == 0 ? WIDE(ip->b) : k[variant == 3];
+            if (ip->type <= OP_WIDE_STR_IMM_IMM)
+                op_wide_store(vm->memory, a, ip->width, b);
+            else
+                flags_cmp(flags, a, b);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// A bulk instruction's `index`th operand, which is a register group or an immediate
+static inline uint32_t bulk_operand(const VM* vm, const uint32_t* constants,
+                                    const DecodedInstruction* ip, int index) {
+    uint32_t k = constants[ip->target + index];
+    return ip->a >> index & 1 ? op_wide_get(&vm->registers[k], ip->width) : k;
+}
+
+static inline bool run_bulk(VM* vm, LazyFlags* flags, const uint32_t* constants,
+                            const DecodedInstruction* ip) {
+    uint32_t len = ip->type == OP_PTS ? 0 : bulk_operand(vm, constants, ip, 2);
+    return op_bulk(vm, flags, MCPY + (ip->type - OP_MCPY), bulk_operand(vm, constants, ip, 0),
+                   bulk_operand(vm, constants, ip, 1), len);
+}
+
+/* Runs until `slice` instructions have gone by, then
+yields at the next backward jump, having taken it */
+static VM_Error run_slice(VM* vm, DecodedProgram* program, uint32_t slice) {
+#ifdef USE_COMPUTED_GOTO
+    static const void* dispatch_table[NUM_DECODED_TYPES] = {
+        [OP_NOP] = &&TARGET_OP_NOP,
+        [OP_MOV_REG_REG] = &&TARGET_OP_MOV_REG_REG, [OP_MOV_REG_IMM] = &&TARGET_OP_MOV_REG_IMM,
+        [OP_ADD_REG_REG] = &&TARGET_OP_ADD_REG_REG, [OP_ADD_REG_IMM] = &&TARGET_OP_ADD_REG_IMM,
+        [OP_ADC_REG_REG] = &&TARGET_OP_ADC_REG_REG, [OP_ADC_REG_IMM] = &&TARGET_OP_ADC_REG_IMM,
+        [OP_SBC_REG_REG] = &&TARGET_OP_SBC_REG_REG, [OP_SBC_REG_IMM] = &&TARGET_OP_SBC_REG_IMM,
+        [OP_SUB_REG_REG] = &&TARGET_OP_SUB_REG_REG, [OP_SUB_REG_IMM] = &&TARGET_OP_SUB_REG_IMM,
+        [OP_MUL_REG_REG] = &&TARGET_OP_MUL_REG_REG, [OP_MUL_REG_IMM] = &&TARGET_OP_MUL_REG_IMM,
+        [OP_DIV_REG_REG] = &&TARGET_OP_DIV_REG_REG, [OP_DIV_REG_IMM] = &&TARGET_OP_DIV_REG_IMM,
+        [OP_SHL_REG_REG] = &&TARGET_OP_SHL_REG_REG, [OP_SHL_REG_IMM] = &&TARGET_OP_SHL_REG_IMM,
+        [OP_SHR_REG_REG] = &&TARGET_OP_SHR_REG_REG, [OP_SHR_REG_IMM] = &&TARGET_OP_SHR_REG_IMM,
+        [OP_CLC] = &&TARGET_OP_CLC,
+        [OP_CLV] = &&TARGET_OP_CLV,
+        [OP_NEG_REG] = &&TARGET_OP_NEG_REG,
+        [OP_STR_REG_REG] = &&TARGET_OP_STR_REG_REG, [OP_STR_REG_IMM] = &&TARGET_OP_STR_REG_IMM,
+        [OP_STR_IMM_REG] = &&TARGET_OP_STR_IMM_REG, [OP_STR_IMM_IMM] = &&TARGET_OP_STR_IMM_IMM,
+        [OP_LD_REG_REG] = &&TARGET_OP_LD_REG_REG, [OP_LD_REG_IMM] = &&TARGET_OP_LD_REG_IMM,
+        [OP_CMP_REG_REG] = &&TARGET_OP_CMP_REG_REG, [OP_CMP_REG_IMM] = &&TARGET_OP_CMP_REG_IMM,
+        [OP_CMP_IMM_REG] = &&TARGET_OP_CMP_IMM_REG, [OP_CMP_IMM_IMM] = &&TARGET_OP_CMP_IMM_IMM,
+        [OP_JMP_ABS] = &&TARGET_OP_JMP_ABS,
+        [OP_JNE_ABS] = &&TARGET_OP_JNE_ABS,
+        [OP_JE_ABS] = &&TARGET_OP_JE_ABS,
+        [OP_JGT_ABS] = &&TARGET_OP_JGT_ABS,
+        [OP_JLT_ABS] = &&TARGET_OP_JLT_ABS,
+        [OP_JNZ_ABS] = &&TARGET_OP_JNZ_ABS,
+        [OP_JZ_ABS] = &&TARGET_OP_JZ_ABS,
+        [OP_PTC_REG] = &&TARGET_OP_PTC_REG, [OP_PTC_IMM] = &&TARGET_OP_PTC_IMM,
+        [OP_PTN_REG] = &&TARGET_OP_PTN_REG, [OP_PTN_IMM] = &&TARGET_OP_PTN_IMM,
+        [OP_PTU_REG] = &&TARGET_OP_PTU_REG, [OP_PTU_IMM] = &&TARGET_OP_PTU_IMM,
+        [OP_SND_REG_REG] = &&TARGET_OP_SND_REG_REG, [OP_SND_REG_IMM] = &&TARGET_OP_SND_REG_IMM,
+        [OP_SND_IMM_REG] = &&TARGET_OP_SND_IMM_REG, [OP_SND_IMM_IMM] = &&TARGET_OP_SND_IMM_IMM,
+        [OP_RCV_REG_REG] = &&TARGET_OP_RCV_REG_REG, [OP_RCV_REG_IMM] = &&TARGET_OP_RCV_REG_IMM,
+        [OP_WIDE_MOV_REG_REG ... OP_WIDE_CMP_IMM_IMM] = &&TARGET_OP_WIDE,
+        [OP_MCPY ... OP_PTS] = &&TARGET_OP_MCPY,
+        [OP_HLT] = &&TARGET_OP_HLT,
+        [OP_TRAP] = &&TARGET_OP_TRAP,
+        [OP_END] = &&TARGET_OP_END
+    };
+#endif
+
+    DecodedInstruction* code = program->instrs;
+    DecodedInstruction* ip = code + (vm->instr_ptr < (uint32_t)program->num_instrs
+                                     ? (int)vm->instr_ptr : program->num_instrs);
+    uint32_t pc = vm->program_counter;
+    uint32_t start_pc = pc;
+    LazyFlags flags = flags_load(vm);
+    VM_Error error = {.type = NONE};
+
+#ifdef USE_COMPUTED_GOTO
+    DISPATCH();
+#else
+dispatch:
+#endif
+    switch ((DecodedType)ip->type) {
+        TARGET(OP_NOP): NEXT();
+
+        TARGET(OP_MOV_REG_REG): R(ip->a) = R(ip->b); NEXT();
+        TARGET(OP_MOV_REG_IMM): R(ip->a) = ip->b; NEXT();
+
+        ALU_VARIANTS(OP_ADD, +=)
+        ALU_VARIANTS(OP_SUB, -=)
+        ALU_VARIANTS(OP_MUL, *=)
+        ALU_VARIANTS(OP_DIV, /=)
+        ALU_VARIANTS(OP_SHL, <<=)
+        ALU_VARIANTS(OP_SHR, >>=)
+
+        TARGET(OP_ADC_REG_REG): op_adc(vm, &flags, &R(ip->a), R(ip->b), false); NEXT();
+        TARGET(OP_ADC_REG_IMM): op_adc(vm, &flags, &R(ip->a), ip->b, false); NEXT();
+        TARGET(OP_SBC_REG_REG): op_adc(vm, &flags, &R(ip->a), R(ip->b), true); NEXT();
+        TARGET(OP_SBC_REG_IMM): op_adc(vm, &flags, &R(ip->a), ip->b, true); NEXT();
+
+        TARGET(OP_CLC): op_clc(vm, &flags); NEXT();
+        TARGET(OP_CLV): op_clv(vm, &flags); NEXT();
+
+        TARGET(OP_NEG_REG): R(ip->a) = -R(ip->a); NEXT();
+
+        TARGET(OP_STR_REG_REG): vm->memory[R(ip->a)] = R(ip->b); NEXT();
+        TARGET(OP_STR_REG_IMM): vm->memory[R(ip->a)] = ip->b; NEXT();
+        TARGET(OP_STR_IMM_REG): vm->memory[ip->a] = R(ip->b); NEXT();
+        TARGET(OP_STR_IMM_IMM): vm->memory[ip->a] = ip->b; NEXT();
+
+        TARGET(OP_LD_REG_REG): R(ip->a) = vm->memory[R(ip->b)]; NEXT();
+        TARGET(OP_LD_REG_IMM): R(ip->a) = vm->memory[ip->b]; NEXT();
+
+        TARGET(OP_CMP_REG_REG): flags_cmp(&flags, R(ip->a), R(ip->b)); NEXT();
+        TARGET(OP_CMP_REG_IMM): flags_cmp(&flags, R(ip->a), ip->b); NEXT();
+        TARGET(OP_CMP_IMM_REG): flags_cmp(&flags, ip->a, R(ip->b)); NEXT();
+        TARGET(OP_CMP_IMM_IMM): flags_cmp(&flags, ip->a, ip->b); NEXT();
+
+        TARGET(OP_JMP_ABS): JUMP_IF(true);
+        TARGET(OP_JNE_ABS): JUMP_IF(flags_compare(vm, &flags).not_equal);
+        TARGET(OP_JE_ABS):  JUMP_IF(flags_compare(vm, &flags).equal);
+        TARGET(OP_JGT_ABS): JUMP_IF(flags_compare(vm, &flags).greater_than);
+        TARGET(OP_JLT_ABS): JUMP_IF(flags_compare(vm, &flags).less_than);
+        TARGET(OP_JNZ_ABS): JUMP_IF(flags.result != 0);
+        TARGET(OP_JZ_ABS):  JUMP_IF(flags.result == 0);
+
+        TARGET(OP_PTC_REG): op_ptc(vm->output, R(ip->a)); NEXT();
+        TARGET(OP_PTC_IMM): op_ptc(vm->output, ip->a); NEXT();
+        TARGET(OP_PTN_REG): op_ptn(vm->output, R(ip->a)); NEXT();
+        TARGET(OP_PTN_IMM): op_ptn(vm->output, ip->a); NEXT();
+        TARGET(OP_PTU_REG): op_ptu(vm->output, R(ip->a)); NEXT();
+        TARGET(OP_PTU_IMM): op_ptu(vm->output, ip->a); NEXT();
+
+        TARGET(OP_SND_REG_REG): CHANNEL_OP(op_snd(vm, R(ip->a), R(ip->b)));
+        TARGET(OP_SND_REG_IMM): CHANNEL_OP(op_snd(vm, R(ip->a), ip->b));
+        TARGET(OP_SND_IMM_REG): CHANNEL_OP(op_snd(vm, ip->a, R(ip->b)));
+        TARGET(OP_SND_IMM_IMM): CHANNEL_OP(op_snd(vm, ip->a, ip->b));
+        TARGET(OP_RCV_REG_REG): CHANNEL_OP(op_rcv(vm, &R(ip->a), R(ip->b)));
+        TARGET(OP_RCV_REG_IMM): CHANNEL_OP(op_rcv(vm, &R(ip->a), ip->b));
+
+        TARGET(OP_MCPY): case OP_MSET: case OP_MCMP: case OP_MADD: case OP_MXOR: case OP_PTS:
+            if (!run_bulk(vm, &flags, program->constants, ip)) {
+                error = decoder_bulk_error(program, ip);
+                break;
+            }
+            NEXT();
+
+        TARGET(OP_HLT): {
+            error = (VM_Error){.type = HALT};
+            break;
+        }
+        TARGET(OP_TRAP): {
+            error = program->traps[ip->target];
+            break;
+        }
+        TARGET(OP_END): break;
+
+        // Every wide instruction shares one handler
+        default:
+#ifdef USE_COMPUTED_GOTO
+        TARGET_OP_WIDE:
+#endif
+            if (!decoded_is_wide(ip->type))
+                break;
+            run_wide(vm, &flags, program->constants, ip);
+            NEXT();
+    }
+
+done:
+    flags_settle(vm, &flags);
+    vm->instr_ptr = ip - code;
+    vm->program_counter = pc;
+    return error;
+}
+
+VM_Error vm_run_decoded(VM* vm, DecodedProgram* program) {
+    VM_Budget budget = {.fuel = VM_UNLIMITED_FUEL};
+    return vm_run_decoded_budget(vm, program, &budget);
+}
+
+// The same as vm_run_budget(), but for decoded programs
+VM_Error vm_run_decoded_budget(VM* vm, DecodedProgram* program, VM_Budget* budget) {
+    VM_Error error;
+    for (;;) {
+        uint32_t start = vm->program_counter;
+        error = run_slice(vm, program, vm_budget_slice(budget));
+        if (vm_budget_spend(budget, vm->program_counter - start) || error.type != YIELD)
+            break;
+    }
+    if (vm->output != NULL)
+        output_flush(vm->output);
+    return error;
+}
+
+void decoder_run_wide(VM* vm, LazyFlags* flags, const DecodedProgram* program,
+                      const DecodedInstruction* instr) {
+    run_wide(vm, flags, program->constants, instr);
+}
+
+bool decoder_run_bulk(VM* vm, LazyFlags* flags, const DecodedProgram* program,
+                      const DecodedInstruction* instr) {
+    return run_bulk(vm, flags, program->constants, instr);
+}
+
+// What the interpreter fails with when a bulk instruction's range is out of bounds
+VM_Error decoder_bulk_error(const DecodedProgram* program, const DecodedInstruction* instr) {
+    VM_Error error = {.type = INVALID_OPERAND};
+    int num_operands = instr->type == OP_PTS ? 2 : 3;
+    for (int i = 0; i < num_operands; i++) {
+        error.operands[i] = (Operand){.is_register = instr->a >> i & 1,
+                                      .value = program->constants[instr->target + i]};
+    }
+    return error;
+}
\ No newline at end of file
@@ -0,0 +1,904 @@
+/* The JIT engine. jit_compile() turns a decoded program
+into x86-64 machine code, one straight run of native
+instructions per VM instruction, so there's nothing
+left to dispatch and jumps are native jumps.
+
+While running, r0-r7 live in the low bytes of r8-r15,
+rbx points at the VM, and ebp is the program counter.
+Each flag is a byte in the stack frame, which setcc can
+write without any masking. A jump straight after a cmp,
+or a jnz/jz straight after arithmetic, branches on the
+host's own flags instead of reading those bytes back.
+
+The program counter is only brought up to date at the
+end of each basic block, using lea so that the host's
+flags survive until the jump that ends it. Printing,
+bulk instructions, and wide values that straddle the end
+of memory are the only things that call back into C. A
+bulk instruction that fails stops the code where it is,
+and channel instructions leave the generated code
+altogether, and are run by vm_run_jit() before it goes
+back in. */
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#define _DEFAULT_SOURCE
+#include <sys/mman.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "jit.h"
+#include "ops.h"
+
+// Generous upper bounds on how much code each part can take
+#define MAX_FIXED_SIZE 256
+#define MAX_INSTR_SIZE 256
+#define MAX_STUB_SIZE  32
+
+/* The flags, as the generated code keeps them. Copied in
+and out of the VM's bitfields around every run. */
+typedef struct {
+    uint8_t not_equal;
+    uint8_t equal;
+    uint8_t greater_than;
+    uint8_t less_than;
+    uint8_t carry;
+    uint8_t overflow;
+    uint8_t not_zero;
+    uint8_t unused;
+} JitFlags;
+
+typedef uint32_t (*JitEntry)(VM* vm, JitFlags* flags, const uint8_t* start);
+
+enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+#if defined(_WIN32)
+static const int ARGS[] = {RCX, RDX, R8, R9};
+#else
+static const int ARGS[] = {RDI, RSI, RDX, RCX};
+#endif
+
+// Callee-saved in either ABI, and used by the generated code
+static const int SAVED[] = {RBX, RBP, RSI, RDI, R12, R13, R14, R15};
+#define NUM_SAVED 8
+
+// Host register holding VM register `i`
+#define VREG(i) (R8 + (i))
+
+/* The stack frame, above the 32 bytes of shadow space
+that Windows wants for calls: a copy of the flags, then
+the pointer they're copied back to. 8 pushes plus the
+frame keep rsp 16-byte aligned for calls. */
+#define FRAME_SIZE      56
+#define FRAME_FLAGS     32
+#define FRAME_FLAGS_PTR 40
+
+#define FLAG(name)   mem(RSP, -1, FRAME_FLAGS + offsetof(JitFlags, name))
+#define VM_REG(i)    mem(RBX, -1, offsetof(VM, registers) + (i))
+#define VM_MEM(index, address) mem(RBX, index, offsetof(VM, memory) + (address))
+#define VM_PC        mem(RBX, -1, offsetof(VM, program_counter))
+
+typedef enum {
+    CC_O  = 0x0,
+    CC_B  = 0x2,
+    CC_E  = 0x4,
+    CC_NE = 0x5,
+    CC_A  = 0x7
+} ConditionCode;
+
+// Flags that emit_op() adds prefixes for
+#define OP_W    1 // 64-bit operands
+#define OP_BYTE 4 // 8-bit operands, which always get a REX prefix
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+} Emitter;
+
+// The r/m operand of an instruction: a register, or [base + index + disp]
+typedef struct {
+    bool is_mem;
+    int reg;
+    int index; // -1 for none
+    int32_t disp;
+} RM;
+
+static RM reg(int r) {
+    return (RM){.reg = r, .index = -1};
+}
+
+static RM mem(int base, int index, int32_t disp) {
+    return (RM){.is_mem = true, .reg = base, .index = index, .disp = disp};
+}
+
+static void emit8(Emitter* e, uint8_t byte) {
+    e->data[e->len++] = byte;
+}
+
+static void emit32(Emitter* e, uint32_t value) {
+    memcpy(e->data + e->len, &value, sizeof(value));
+    e->len += sizeof(value);
+}
+
+static void emit64(Emitter* e, uint64_t value) {
+    memcpy(e->data + e->len, &value, sizeof(value));
+    e->len += sizeof(value);
+}
+
+static void patch32(Emitter* e, size_t at, uint32_t value) {
+    memcpy(e->data + at, &value, sizeof(value));
+}
+
+/* Emits an instruction with a ModRM byte. `r` is the
+reg field, which is either a register or an opcode
+extension, and two byte opcodes are given as 0x0Fxx.
+Byte operations always get a REX prefix, so that
+registers 4-7 are spl-dil rather than ah-bh. Memory
+operands always use a 32-bit displacement. */
+static void emit_op(Emitter* e, int flags, uint32_t opcode, int r, RM rm) {
+    int index = rm.is_mem && rm.index >= 0 ? rm.index : 0;
+    uint8_t rex = 0x40 | (flags & OP_W ? 8 : 0) | (r & 8 ? 4 : 0)
+                       | (index & 8 ? 2 : 0) | (rm.reg & 8 ? 1 : 0);
+    if (rex != 0x40 || (flags & OP_BYTE))
+        emit8(e, rex);
+    if (opcode > 0xFF)
+        emit8(e, opcode >> 8);
+    emit8(e, opcode);
+
+    if (!rm.is_mem) {
+        emit8(e, 0xC0 | (r & 7) << 3 | (rm.reg & 7));
+        return;
+    }
+    if (rm.index >= 0 || (rm.reg & 7) == RSP) {
+        emit8(e, 0x80 | (r & 7) << 3 | 4);
+        emit8(e, (rm.index >= 0 ? rm.index & 7 : 4) << 3 | (rm.reg & 7));
+    }
+    else
+        emit8(e, 0x80 | (r & 7) << 3 | (rm.reg & 7));
+    emit32(e, rm.disp);
+}
+
+static void emit_mov_imm32(Emitter* e, int r, uint32_t value) {
+    if (r & 8)
+        emit8(e, 0x41);
+    emit8(e, 0xB8 + (r & 7));
+    emit32(e, value);
+}
+
+static void emit_push(Emitter* e, int r) {
+    if (r & 8)
+        emit8(e, 0x41);
+    emit8(e, 0x50 + (r & 7));
+}
+
+static void emit_pop(Emitter* e, int r) {
+    if (r & 8)
+        emit8(e, 0x41);
+    emit8(e, 0x58 + (r & 7));
+}
+
+static void emit_setcc(Emitter* e, ConditionCode cc, RM rm) {
+    emit_op(e, OP_BYTE, 0x0F90 | cc, 0, rm);
+}
+
+// Returns where the displacement goes, to be patched later
+static size_t emit_jcc(Emitter* e, ConditionCode cc) {
+    emit8(e, 0x0F);
+    emit8(e, 0x80 | cc);
+    emit32(e, 0);
+    return e->len - 4;
+}
+
+static size_t emit_jmp(Emitter* e) {
+    emit8(e, 0xE9);
+    emit32(e, 0);
+    return e->len - 4;
+}
+
+// Adds to the program counter without touching the host's flags
+static void emit_count(Emitter* e, int count) {
+    if (count > 0)
+        emit_op(e, 0, 0x8D, RBP, mem(RBP, -1, count));
+}
+
+// movzx for a value that's either a VM register or an immediate
+static void emit_load_value(Emitter* e, int r, bool is_reg, uint8_t value) {
+    if (is_reg)
+        emit_op(e, OP_BYTE, 0x0FB6, r, reg(VREG(value)));
+    else
+        emit_mov_imm32(e, r, value);
+}
+
+static void emit_prologue(Emitter* e) {
+    for (int i = 0; i < NUM_SAVED; i++)
+        emit_push(e, SAVED[i]);
+    emit_op(e, OP_W, 0x81, 5, reg(RSP));
+    emit32(e, FRAME_SIZE);
+
+    emit_op(e, OP_W, 0x89, ARGS[0], reg(RBX));
+    emit_op(e, OP_W, 0x89, ARGS[1], mem(RSP, -1, FRAME_FLAGS_PTR));
+    // On Windows the start address is in r8, which is about to be r0
+    emit_op(e, OP_W, 0x89, ARGS[2], reg(RAX));
+    emit_op(e, OP_W, 0x8B, RCX, mem(ARGS[1], -1, 0));
+    emit_op(e, OP_W, 0x89, RCX, mem(RSP, -1, FRAME_FLAGS));
+
+    emit_op(e, 0, 0x8B, RBP, VM_PC);
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        emit_op(e, OP_BYTE, 0x8A, VREG(i), VM_REG(i));
+    emit_op(e, 0, 0xFF, 4, reg(RAX));
+}
+
+// Expects the index of the instruction it stopped at in eax
+static void emit_exit(Emitter* e) {
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        emit_op(e, OP_BYTE, 0x88, VREG(i), VM_REG(i));
+    emit_op(e, 0, 0x89, RBP, VM_PC);
+    emit_op(e, OP_W, 0x8B, RCX, mem(RSP, -1, FRAME_FLAGS_PTR));
+    emit_op(e, OP_W, 0x8B, RDX, mem(RSP, -1, FRAME_FLAGS));
+    emit_op(e, OP_W, 0x89, RDX, mem(RCX, -1, 0));
+
+    emit_op(e, OP_W, 0x81, 0, reg(RSP));
+    emit32(e, FRAME_SIZE);
+    for (int i = NUM_SAVED - 1; i >= 0; i--)
+        emit_pop(e, SAVED[i]);
+    emit8(e, 0xC3);
+}
+
+static void jit_ptc(VM* vm, uint32_t value) {
+    op_ptc(vm->output, value);
+}
+
+static void jit_ptn(VM* vm, uint32_t value) {
+    op_ptn(vm->output, value);
+}
+
+static void jit_ptu(VM* vm, uint32_t value) {
+    op_ptu(vm->output, value);
+}
+
+// r8-r11 (r0-r3) are the only caller-saved ones in use
+static void emit_call_print(Emitter* e, void (*print)(VM*, uint32_t), bool is_reg, uint8_t value) {
+    for (int i = 0; i < 4; i++)
+        emit_op(e, OP_BYTE, 0x88, VREG(i), VM_REG(i));
+    emit_op(e, OP_W, 0x89, RBX, reg(ARGS[0]));
+    emit_load_value(e, ARGS[1], is_reg, value);
+    emit8(e, 0x48); // mov rax, imm64
+    emit8(e, 0xB8);
+    emit64(e, (uint64_t)(uintptr_t)print);
+    emit_op(e, 0, 0xFF, 2, reg(RAX));
+    for (int i = 0; i < 4; i++)
+        emit_op(e, OP_BYTE, 0x8A, VREG(i), VM_REG(i));
+}
+
+/* Wide instructions are called out to as well, but
+can read and write any register, so all of them go back
+to the VM around the call. The only flags they can set
+are not_zero and the compare flags. */
+static void store_lazy_flags(JitFlags* flags, const LazyFlags* lazy) {
+    flags->not_zero = lazy->result != 0;
+    if (lazy->cmp_pending) {
+        flags->not_equal = lazy->cmp_a != lazy->cmp_b;
+        flags->equal = lazy->cmp_a == lazy->cmp_b;
+        flags->greater_than = lazy->cmp_a > lazy->cmp_b;
+        flags->less_than = lazy->cmp_a < lazy->cmp_b;
+    }
+}
+
+static void jit_wide(VM* vm, JitFlags* flags, const DecodedProgram* program,
+                     const DecodedInstruction* instr) {
+    LazyFlags lazy = {.result = flags->not_zero};
+    decoder_run_wide(vm, &lazy, program, instr);
+    store_lazy_flags(flags, &lazy);
+}
+
+/* Bulk instructions spend long enough in their kernels
+that calling out costs next to nothing. Returns false if
+a range was out of bounds, for the code to stop at. */
+static bool jit_bulk(VM* vm, JitFlags* flags, const DecodedProgram* program,
+                     const DecodedInstruction* instr) {
+    LazyFlags lazy = {.result = flags->not_zero};
+    if (!decoder_run_bulk(vm, &lazy, program, instr))
+        return false;
+    store_lazy_flags(flags, &lazy);
+    return true;
+}
+
+static void emit_mov_imm64(Emitter* e, int r, uint64_t value) {
+    emit8(e, 0x48 | (r >= 8));
+    emit8(e, 0xB8 + (r & 7));
+    emit64(e, value);
+}
+
+// Calls jit_wide() or jit_bulk(), whose result is left in al
+static void emit_call_decoded(Emitter* e, uintptr_t function, const DecodedProgram* program,
+                              const DecodedInstruction* instr) {
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        emit_op(e, OP_BYTE, 0x88, VREG(i), VM_REG(i));
+    emit_op(e, OP_W, 0x89, RBX, reg(ARGS[0]));
+    emit_op(e, OP_W, 0x8D, ARGS[1], mem(RSP, -1, FRAME_FLAGS));
+    emit_mov_imm64(e, ARGS[2], (uint64_t)(uintptr_t)program);
+    emit_mov_imm64(e, ARGS[3], (uint64_t)(uintptr_t)instr);
+    emit_mov_imm64(e, RAX, function);
+    emit_op(e, 0, 0xFF, 2, reg(RAX));
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        emit_op(e, OP_BYTE, 0x8A, VREG(i), VM_REG(i));
+}
+
+/* Register groups are gathered into a host register
+a byte at a time, high byte first, and scattered back
+low byte first. Scattering shifts the value away. */
+static void emit_load_group(Emitter* e, int r, uint8_t first, uint8_t width) {
+    int last = first + (1 << width) - 1;
+    emit_op(e, OP_BYTE, 0x0FB6, r, reg(VREG(last)));
+    for (int i = last - 1; i >= first; i--) {
+        emit_op(e, 0, 0xC1, 4, reg(r));
+        emit8(e, 8);
+        emit_op(e, OP_BYTE, 0x8A, r, reg(VREG(i)));
+    }
+}
+
+static void emit_store_group(Emitter* e, int r, uint8_t first, uint8_t width) {
+    for (int i = 0; i < 1 << width; i++) {
+        if (i > 0) {
+            emit_op(e, 0, 0xC1, 5, reg(r));
+            emit8(e, 8);
+        }
+        emit_op(e, OP_BYTE, 0x88, r, reg(VREG(first + i)));
+    }
+}
+
+// A wide operand: a group if `is_reg`, otherwise a constant
+static void emit_load_wide(Emitter* e, int r, bool is_reg, uint8_t first, uint8_t width,
+                           const uint32_t* constant) {
+    if (is_reg)
+        emit_load_group(e, r, first, width);
+    else
+        emit_mov_imm32(e, r, *constant);
+}
+
+// mov and the arithmetic instructions, with the result cut down to the width
+static void emit_wide_alu(Emitter* e, const DecodedInstruction* instr, const uint32_t* k) {
+    bool is_reg = (instr->type - OP_WIDE_MOV_REG_REG) % 2 == 0;
+    InstructionType type = decoded_wide_arith(instr->type);
+    if (type == MOV) {
+        emit_load_wide(e, RAX, is_reg, instr->b, instr->width, k);
+        emit_store_group(e, RAX, instr->a, instr->width);
+        return;
+    }
+
+    emit_load_group(e, RAX, instr->a, instr->width);
+    emit_load_wide(e, RCX, is_reg, instr->b, instr->width, k);
+    switch (type) {
+        case ADD: emit_op(e, 0, 0x01, RCX, reg(RAX)); break;
+        case SUB: emit_op(e, 0, 0x29, RCX, reg(RAX)); break;
+        case MUL: emit_op(e, 0, 0x0FAF, RAX, reg(RCX)); break;
+        case DIV:
+            emit_op(e, 0, 0x31, RDX, reg(RDX));
+            emit_op(e, 0, 0xF7, 6, reg(RCX));
+            break;
+        case SHL: emit_op(e, 0, 0xD3, 4, reg(RAX)); break;
+        default:  emit_op(e, 0, 0xD3, 5, reg(RAX)); break;
+    }
+    if (instr->width == WIDTH_WORD)
+        emit_op(e, 0, 0x0FB7, RAX, reg(RAX));
+    emit_op(e, 0, 0x85, RAX, reg(RAX));
+    emit_setcc(e, CC_NE, FLAG(not_zero));
+    emit_store_group(e, RAX, instr->a, instr->width);
+}
+
+/* ld and str go straight to memory, unless the value
+straddles the end of it, which is left to jit_wide() */
+static void emit_wide_memory(Emitter* e, const DecodedProgram* program,
+                             const DecodedInstruction* instr, const uint32_t* k) {
+    bool load = instr->type <= OP_WIDE_LD_REG_IMM;
+    int variant = load ? (instr->type == OP_WIDE_LD_REG_IMM) * 2 : instr->type - OP_WIDE_STR_REG_REG;
+    uint8_t address_reg = load ? instr->b : instr->a;
+    emit_load_wide(e, RAX, variant < 2, address_reg, instr->width, k);
+    emit_op(e, 0, 0x81, 4, reg(RAX));
+    emit32(e, MEMORY_SIZE - 1);
+    emit_op(e, 0, 0x81, 7, reg(RAX));
+    emit32(e, MEMORY_SIZE - (1u << instr->width));
+    size_t straddles = emit_jcc(e, CC_A);
+
+    if (load) {
+        if (instr->width == WIDTH_WORD)
+            emit_op(e, 0, 0x0FB7, RCX, VM_MEM(RAX, 0));
+        else
+            emit_op(e, 0, 0x8B, RCX, VM_MEM(RAX, 0));
+        emit_store_group(e, RCX, instr->a, instr->width);
+    }
+    else {
+        emit_load_wide(e, RCX, variant % 2 == 0, instr->b, instr->width, &k[variant == 3]);
+        if (instr->width == WIDTH_WORD)
+            emit8(e, 0x66);
+        emit_op(e, 0, 0x89, RCX, VM_MEM(RAX, 0));
+    }
+    size_t done = emit_jmp(e);
+
+    patch32(e, straddles, e->len - (straddles + 4));
+    emit_call_decoded(e, (uintptr_t)jit_wide, program, instr);
+    patch32(e, done, e->len - (done + 4));
+}
+
+// The result ends up in al, with ZF set from it
+static void emit_alu_via_eax(Emitter* e, const DecodedInstruction* instr, bool is_reg) {
+    emit_op(e, OP_BYTE, 0x0FB6, RAX, reg(VREG(instr->a)));
+    emit_load_value(e, RCX, is_reg, instr->b);
+    switch (instr->type) {
+        case OP_MUL_REG_REG: case OP_MUL_REG_IMM:
+            emit_op(e, 0, 0x0FAF, RAX, reg(RCX));
+            break;
+        case OP_DIV_REG_REG: case OP_DIV_REG_IMM:
+            emit_op(e, 0, 0x31, RDX, reg(RDX));
+            emit_op(e, 0, 0xF7, 6, reg(RCX));
+            break;
+        // Shifts of 32 or more wrap around, like they do in the other engines on x86
+        case OP_SHL_REG_REG: case OP_SHL_REG_IMM:
+            emit_op(e, 0, 0xD3, 4, reg(RAX));
+            break;
+        default:
+            emit_op(e, 0, 0xD3, 5, reg(RAX));
+            break;
+    }
+    emit_op(e, OP_BYTE, 0x88, RAX, reg(VREG(instr->a)));
+    emit_op(e, OP_BYTE, 0x84, RAX, reg(RAX));
+}
+
+/* Native adc and sbb, which work out carry and
+overflow exactly like op_add_carry() and op_sub_borrow().
+Adding 0xFF to the VM's carry moves it into CF. */
+static void emit_adc(Emitter* e, const DecodedInstruction* instr, bool is_reg, bool subtract) {
+    emit_load_value(e, RCX, is_reg, instr->b);
+    emit_op(e, OP_BYTE, 0x0FB6, RAX, FLAG(carry));
+    emit_op(e, OP_BYTE, 0x80, 0, reg(RAX));
+    emit8(e, UINT8_MAX);
+    emit_op(e, OP_BYTE, subtract ? 0x18 : 0x10, RCX, reg(VREG(instr->a)));
+    // Neither touches ZF, which is still set from the result
+    emit_setcc(e, CC_B, FLAG(carry));
+    emit_setcc(e, CC_O, FLAG(overflow));
+}
+
+typedef enum {
+    HOST_NONE, // The host's flags mean nothing
+    HOST_CMP,  // Set by comparing the operands of a cmp
+    HOST_NZ    // ZF is set if the last result was zero
+} HostFlags;
+
+typedef struct {
+    size_t at;
+    int target;
+} Patch;
+
+// A jump that reads the host's flags, which need a way in that doesn't
+typedef struct {
+    int index;
+    int32_t flag;
+    ConditionCode cc;
+    int count;
+} Stub;
+
+bool jit_supported() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static bool is_jump(uint8_t type) {
+    return type >= OP_JMP_ABS && type <= OP_JZ_ABS;
+}
+
+static bool is_channel_op(uint8_t type) {
+    return type >= OP_SND_REG_REG && type <= OP_RCV_REG_IMM;
+}
+
+// Returns false if the instruction has to wait
+static bool run_channel_op(VM* vm, const DecodedInstruction* instr) {
+    Register* r = vm->registers;
+    switch (instr->type) {
+        case OP_SND_REG_REG: return op_snd(vm, r[instr->a].value, r[instr->b].value);
+        case OP_SND_REG_IMM: return op_snd(vm, r[instr->a].value, instr->b);
+        case OP_SND_IMM_REG: return op_snd(vm, instr->a, r[instr->b].value);
+        case OP_SND_IMM_IMM: return op_snd(vm, instr->a, instr->b);
+        case OP_RCV_REG_REG: return op_rcv(vm, &r[instr->a].value, r[instr->b].value);
+        default:             return op_rcv(vm, &r[instr->a].value, instr->b);
+    }
+}
+
+static uint8_t* map_code(const uint8_t* code, size_t size) {
+#if defined(_WIN32)
+    uint8_t* mapped = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (mapped == NULL)
+        return NULL;
+    memcpy(mapped, code, size);
+    DWORD old;
+    if (!VirtualProtect(mapped, size, PAGE_EXECUTE_READ, &old)) {
+        VirtualFree(mapped, 0, MEM_RELEASE);
+        return NULL;
+    }
+    return mapped;
+#else
+    uint8_t* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        return NULL;
+    memcpy(mapped, code, size);
+    // Never writable and executable at the same time
+    if (mprotect(mapped, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mapped, size);
+        return NULL;
+    }
+    return mapped;
+#endif
+}
+
+static void unmap_code(uint8_t* code, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(code, 0, MEM_RELEASE);
+#else
+    munmap(code, size);
+#endif
+}
+
+JitProgram jit_compile(const DecodedProgram* program) {
+    JitProgram jit = {.program = program};
+    if (!jit_supported())
+        return jit;
+
+    int n = program->num_instrs;
+    const DecodedInstruction* instrs = program->instrs;
+    Emitter e = {.data = malloc(MAX_FIXED_SIZE + (size_t)(n + 1) * MAX_INSTR_SIZE
+                                + (size_t)n * MAX_STUB_SIZE)};
+    uint32_t* offsets = malloc(sizeof(uint32_t) * (n + 1));
+    bool* leaders = calloc(n + 1, sizeof(bool));
+    Patch* patches = malloc(sizeof(Patch) * (2 * n + 1));
+    Stub* stubs = malloc(sizeof(Stub) * (n + 1));
+    int num_patches = 0;
+    int num_stubs = 0;
+    jit.entries = malloc(sizeof(uint32_t) * (n + 1));
+    jit.from_block = malloc(sizeof(uint32_t) * (n + 1));
+
+    leaders[0] = leaders[n] = true;
+    for (int i = 0; i < n; i++) {
+        if (is_jump(instrs[i].type)) {
+            leaders[instrs[i].target] = true;
+            leaders[i + 1] = true;
+        }
+        else if (instrs[i].type == OP_HLT || instrs[i].type == OP_TRAP)
+            leaders[i + 1] = true;
+    }
+
+    emit_prologue(&e);
+    size_t exit_offset = e.len;
+    emit_exit(&e);
+
+    // Instructions run since the program counter was last updated
+    int count = 0;
+    HostFlags host = HOST_NONE;
+    for (int i = 0; i <= n; i++) {
+        const DecodedInstruction* instr = &instrs[i];
+        if (leaders[i]) {
+            emit_count(&e, count);
+            count = 0;
+            host = HOST_NONE;
+        }
+        HostFlags live = host;
+        host = HOST_NONE;
+        offsets[i] = jit.entries[i] = e.len;
+        jit.from_block[i] = count;
+
+        if (is_jump(instr->type)) {
+            count++;
+            if (instr->type == OP_JMP_ABS) {
+                emit_count(&e, count);
+                patches[num_patches++] = (Patch){emit_jmp(&e), instr->target};
+                count = 0;
+                continue;
+            }
+
+            // Which flag byte the jump reads, and what it would be on the host
+            int32_t flag;
+            ConditionCode cc = CC_NE;
+            ConditionCode host_cc;
+            HostFlags needs = HOST_CMP;
+            switch (instr->type) {
+                case OP_JNE_ABS: flag = FLAG(not_equal).disp;    host_cc = CC_NE; break;
+                case OP_JE_ABS:  flag = FLAG(equal).disp;        host_cc = CC_E;  break;
+                case OP_JGT_ABS: flag = FLAG(greater_than).disp; host_cc = CC_A;  break;
+                case OP_JLT_ABS: flag = FLAG(less_than).disp;    host_cc = CC_B;  break;
+                case OP_JNZ_ABS:
+                    flag = FLAG(not_zero).disp;
+                    host_cc = CC_NE;
+                    needs = HOST_NZ;
+                    break;
+                default:
+                    flag = FLAG(not_zero).disp;
+                    cc = CC_E;
+                    host_cc = CC_E;
+                    needs = HOST_NZ;
+                    break;
+            }
+
+            if (live == needs) {
+                stubs[num_stubs++] = (Stub){.index = i, .flag = flag, .cc = cc, .count = count};
+                cc = host_cc;
+            }
+            else {
+                emit_op(&e, OP_BYTE, 0x80, 7, mem(RSP, -1, flag));
+                emit8(&e, 0);
+            }
+            emit_count(&e, count);
+            patches[num_patches++] = (Patch){emit_jcc(&e, cc), instr->target};
+            count = 0;
+            continue;
+        }
+
+        switch ((DecodedType)instr->type) {
+            case OP_NOP: break;
+
+            case OP_MOV_REG_REG:
+                emit_op(&e, OP_BYTE, 0x88, VREG(instr->b), reg(VREG(instr->a)));
+                break;
+            case OP_MOV_REG_IMM:
+                emit_op(&e, OP_BYTE, 0xC6, 0, reg(VREG(instr->a)));
+                emit8(&e, instr->b);
+                break;
+
+            case OP_ADD_REG_REG: case OP_SUB_REG_REG:
+                emit_op(&e, OP_BYTE, instr->type == OP_ADD_REG_REG ? 0x00 : 0x28,
+                        VREG(instr->b), reg(VREG(instr->a)));
+                emit_setcc(&e, CC_NE, FLAG(not_zero));
+                host = HOST_NZ;
+                break;
+            case OP_ADD_REG_IMM: case OP_SUB_REG_IMM:
+                emit_op(&e, OP_BYTE, 0x80, instr->type == OP_ADD_REG_IMM ? 0 : 5,
+                        reg(VREG(instr->a)));
+                emit8(&e, instr->b);
+                emit_setcc(&e, CC_NE, FLAG(not_zero));
+                host = HOST_NZ;
+                break;
+
+            case OP_MUL_REG_REG: case OP_DIV_REG_REG: case OP_SHL_REG_REG: case OP_SHR_REG_REG:
+                emit_alu_via_eax(&e, instr, true);
+                emit_setcc(&e, CC_NE, FLAG(not_zero));
+                host = HOST_NZ;
+                break;
+            case OP_MUL_REG_IMM: case OP_DIV_REG_IMM: case OP_SHL_REG_IMM: case OP_SHR_REG_IMM:
+                emit_alu_via_eax(&e, instr, false);
+                emit_setcc(&e, CC_NE, FLAG(not_zero));
+                host = HOST_NZ;
+                break;
+
+            case OP_ADC_REG_REG: case OP_ADC_REG_IMM:
+                emit_adc(&e, instr, instr->type == OP_ADC_REG_REG, false);
+                emit_setcc(&e, CC_NE, FLAG(not_zero));
+                host = HOST_NZ;
+                break;
+            case OP_SBC_REG_REG: case OP_SBC_REG_IMM:
+                emit_adc(&e, instr, instr->type == OP_SBC_REG_REG, true);
+                emit_setcc(&e, CC_NE, FLAG(not_zero));
+                host = HOST_NZ;
+                break;
+
+            case OP_CLC:
+                emit_op(&e, OP_BYTE, 0xC6, 0, FLAG(carry));
+                emit8(&e, 0);
+                break;
+            case OP_CLV:
+                emit_op(&e, OP_BYTE, 0xC6, 0, FLAG(overflow));
+                emit8(&e, 0);
+                break;
+
+            case OP_NEG_REG:
+                emit_op(&e, OP_BYTE, 0xF6, 3, reg(VREG(instr->a)));
+                break;
+
+            case OP_STR_REG_REG:
+                emit_op(&e, OP_BYTE, 0x0FB6, RAX, reg(VREG(instr->a)));
+                emit_op(&e, OP_BYTE, 0x88, VREG(instr->b), VM_MEM(RAX, 0));
+                break;
+            case OP_STR_REG_IMM:
+                emit_op(&e, OP_BYTE, 0x0FB6, RAX, reg(VREG(instr->a)));
+                emit_op(&e, OP_BYTE, 0xC6, 0, VM_MEM(RAX, 0));
+                emit8(&e, instr->b);
+                break;
+            case OP_STR_IMM_REG:
+                emit_op(&e, OP_BYTE, 0x88, VREG(instr->b), VM_MEM(-1, instr->a));
+                break;
+            case OP_STR_IMM_IMM:
+                emit_op(&e, OP_BYTE, 0xC6, 0, VM_MEM(-1, instr->a));
+                emit8(&e, instr->b);
+                break;
+
+            case OP_LD_REG_REG:
+                emit_op(&e, OP_BYTE, 0x0FB6, RAX, reg(VREG(instr->b)));
+                emit_op(&e, OP_BYTE, 0x8A, VREG(instr->a), VM_MEM(RAX, 0));
+                break;
+            case OP_LD_REG_IMM:
+                emit_op(&e, OP_BYTE, 0x8A, VREG(instr->a), VM_MEM(-1, instr->b));
+                break;
+
+            case OP_CMP_REG_REG:
+                emit_op(&e, OP_BYTE, 0x38, VREG(instr->b), reg(VREG(instr->a)));
+                goto set_compare;
+            case OP_CMP_REG_IMM:
+                emit_op(&e, OP_BYTE, 0x80, 7, reg(VREG(instr->a)));
+                emit8(&e, instr->b);
+                goto set_compare;
+            case OP_CMP_IMM_REG:
+                emit_op(&e, OP_BYTE, 0xC6, 0, reg(RAX));
+                emit8(&e, instr->a);
+                emit_op(&e, OP_BYTE, 0x38, VREG(instr->b), reg(RAX));
+                goto set_compare;
+            case OP_CMP_IMM_IMM:
+                emit_op(&e, OP_BYTE, 0xC6, 0, reg(RAX));
+                emit8(&e, instr->a);
+                emit_op(&e, OP_BYTE, 0x80, 7, reg(RAX));
+                emit8(&e, instr->b);
+            set_compare:
+                emit_setcc(&e, CC_NE, FLAG(not_equal));
+                emit_setcc(&e, CC_E, FLAG(equal));
+                emit_setcc(&e, CC_A, FLAG(greater_than));
+                emit_setcc(&e, CC_B, FLAG(less_than));
+                host = HOST_CMP;
+                break;
+
+            case OP_PTC_REG: emit_call_print(&e, jit_ptc, true, instr->a); break;
+            case OP_PTC_IMM: emit_call_print(&e, jit_ptc, false, instr->a); break;
+            case OP_PTN_REG: emit_call_print(&e, jit_ptn, true, instr->a); break;
+            case OP_PTN_IMM: emit_call_print(&e, jit_ptn, false, instr->a); break;
+            case OP_PTU_REG: emit_call_print(&e, jit_ptu, true, instr->a); break;
+            case OP_PTU_IMM: emit_call_print(&e, jit_ptu, false, instr->a); break;
+
+            default: {
+                if (decoded_is_wide(instr->type)) {
+                    const uint32_t* k = program->constants + instr->target;
+                    if (instr->type <= OP_WIDE_SHR_REG_IMM)
+                        emit_wide_alu(&e, instr, k);
+                    else if (instr->type <= OP_WIDE_STR_IMM_IMM)
+                        emit_wide_memory(&e, program, instr, k);
+                    else {
+                        int variant = instr->type - OP_WIDE_CMP_REG_REG;
+                        emit_load_wide(&e, RAX, variant < 2, instr->a, instr->width, k);
+                        emit_load_wide(&e, RCX, variant % 2 == 0, instr->b, instr->width,
+                                       &k[variant == 3]);
+                        emit_op(&e, 0, 0x39, RCX, reg(RAX));
+                        goto set_compare;
+                    }
+                    break;
+                }
+                if (decoded_is_bulk(instr->type)) {
+                    // On failure, stops here for vm_run_jit() to report it
+                    emit_call_decoded(&e, (uintptr_t)jit_bulk, program, instr);
+                    emit_op(&e, OP_BYTE, 0x84, RAX, reg(RAX));
+                    size_t ok = emit_jcc(&e, CC_NE);
+                    emit_count(&e, count);
+                    emit_mov_imm32(&e, RAX, i);
+                    size_t at = emit_jmp(&e);
+                    patch32(&e, at, exit_offset - (at + 4));
+                    patch32(&e, ok, e.len - (ok + 4));
+                    break;
+                }
+                // Stopping doesn't count as running an instruction
+                emit_count(&e, count);
+                count = 0;
+                emit_mov_imm32(&e, RAX, i);
+                size_t at = emit_jmp(&e);
+                patch32(&e, at, exit_offset - (at + 4));
+                continue;
+            }
+        }
+        count++;
+    }
+
+    /* Starting at a jump that reads the host's flags
+    goes through a copy of it that reads the flag byte */
+    for (int i = 0; i < num_stubs; i++) {
+        Stub* stub = &stubs[i];
+        jit.entries[stub->index] = e.len;
+        emit_op(&e, OP_BYTE, 0x80, 7, mem(RSP, -1, stub->flag));
+        emit8(&e, 0);
+        emit_count(&e, stub->count);
+        patches[num_patches++] = (Patch){emit_jcc(&e, stub->cc), instrs[stub->index].target};
+        size_t at = emit_jmp(&e);
+        patch32(&e, at, offsets[stub->index + 1] - (at + 4));
+    }
+
+    for (int i = 0; i < num_patches; i++)
+        patch32(&e, patches[i].at, offsets[patches[i].target] - (patches[i].at + 4));
+
+    jit.code = map_code(e.data, e.len);
+    jit.size = e.len;
+
+    free(e.data);
+    free(offsets);
+    free(leaders);
+    free(patches);
+    free(stubs);
+    if (jit.code == NULL)
+        jit_free(&jit);
+    return jit;
+}
+
+void jit_free(JitProgram* program) {
+    if (program->code != NULL)
+        unmap_code(program->code, program->size);
+    free(program->entries);
+    free(program->from_block);
+    *program = (JitProgram){.program = program->program};
+}
+
+/* Runs the compiled code from wherever the VM is up
+to. Without compiled code (on hosts other than x86-64,
+or if it couldn't be mapped) it falls back to the
+decoded engine. */
+VM_Error vm_run_jit(VM* vm, JitProgram* program) {
+    const DecodedProgram* decoded = program->program;
+    if (program->code == NULL)
+        return vm_run_decoded(vm, (DecodedProgram*)decoded);
+
+    int start = vm->instr_ptr < (uint32_t)decoded->num_instrs ? (int)vm->instr_ptr : decoded->num_instrs;
+    JitFlags flags = {
+        .not_equal = vm->compare_register.not_equal,
+        .equal = vm->compare_register.equal,
+        .greater_than = vm->compare_register.greater_than,
+        .less_than = vm->compare_register.less_than,
+        .carry = vm->status_register.carry,
+        .overflow = vm->status_register.overflow,
+        .not_zero = vm->status_register.not_zero
+    };
+
+    JitEntry entry = (JitEntry)(void*)program->code;
+    uint32_t stop;
+    bool blocked = false;
+    for (;;) {
+        // Blocks count their instructions from the top, even when started partway through
+        vm->program_counter -= program->from_block[start];
+        stop = entry(vm, &flags, program->code + program->entries[start]);
+
+        // Channel instructions exit to here, and are run in C before carrying on after them
+        const DecodedInstruction* instr = &decoded->instrs[stop];
+        if (!is_channel_op(instr->type))
+            break;
+        blocked = !run_channel_op(vm, instr);
+        if (blocked)
+            break;
+        vm->program_counter++;
+        start = stop + 1;
+    }
+
+    vm->compare_register = (CompareFlags){.not_equal = flags.not_equal,
+                                          .equal = flags.equal,
+                                          .greater_than = flags.greater_than,
+                                          .less_than = flags.less_than};
+    vm->status_register = (StatusRegister){.carry = flags.carry,
+                                           .overflow = flags.overflow,
+                                           .not_zero = flags.not_zero};
+    vm->instr_ptr = stop;
+
+    VM_Error error = {.type = NONE};
+    if (blocked)
+        error = (VM_Error){.type = BLOCKED};
+    else if (decoded->instrs[stop].type == OP_HLT)
+        error = (VM_Error){.type = HALT};
+    else if (decoded->instrs[stop].type == OP_TRAP)
+        error = decoded->traps[decoded->instrs[stop].target];
+    else if (decoded_is_bulk(decoded->instrs[stop].type))
+        error = decoder_bulk_error(decoded, &decoded->instrs[stop]);
+
+    if (vm->output != NULL)
+        output_flush(vm->output);
+    return error;
+}
\ No newline at end of file
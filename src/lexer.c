@@ -3,20 +3,96 @@ for such a simple syntax. Therefore this
 lexer, while a bit messy, produces AST nodes
 (Instructions, to be specific) itself. :)
 
+Tokens are never copied out of the source: numbers
+are converted as they're scanned, and everything
+else is a str pointing into the source buffer, with
+its case folded in place as it's scanned. Mnemonics are
+matched with a switch over their characters, and labels
+are kept in an open addressing hash table alongside the
+label array. All of the arrays double in size when they
+fill up.
+
+A stream lexes its source a block at a time, cutting
+each block off after its last newline and carrying the
+rest over to the next, so that no token is ever split
+between two. Nothing refers back to an earlier block
+but label names, which streams copy out. Labels are
+found by index, so a jump to one that's still to come
+is patched as soon as its definition turns up.
+
+Large sources can also be split into runs of whole
+lines that are lexed on threads of their own, each as if
+it were a program by itself. Their labels are then
+matched up by name, split between the threads by hash,
+and numbered in the order they first appear, before each
+thread copies its instructions into place, moving them
+along and renumbering their labels. Only a few counts
+per thread are ever added up on one thread.
+
 TODO:
 - unicode support lol */
 
+#if defined(_WIN32)
+#include <io.h>
+#define read _read
+#else
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
+#endif
+
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <ctype.h>
-#include <math.h>
 
 #include "lexer.h"
 #include "strvm.h"
 
 #include "fiesta/str.h"
 
+// Packs a mnemonic's characters into a single switchable key
+#define KEY2(a, b)    ((uint32_t)(a) | (uint32_t)(b) << 8)
+#define KEY3(a, b, c) (KEY2(a, b) | (uint32_t)(c) << 16)
+#define KEY4(a, b, c, d) (KEY3(a, b, c) | (uint32_t)(d) << 24)
+
+// Numbered from REGISTER_RST, in this order
+static const char* special_register_names[NUM_SPECIAL_REGISTERS] = {
+    "rst", "rz", "rcmp", "pc", "ip"
+};
+
+#define INITIAL_LABEL_SLOTS 64
+#define NAME_BLOCK_SIZE 4096
+// Any less isn't worth starting a thread for
+#define MIN_CHUNK_SIZE (64 * 1024)
+// So that a uint8_t can pick a shard
+#define MAX_CHUNKS 256
+
+// Label names copied out of a stream's blocks, which are never moved once written
+struct NameBlock {
+    NameBlock* next;
+    int len;
+    int capacity;
+    char data[];
+};
+
+/* Makes sure `data` has room for element `index`,
+doubling its capacity as many times as needed. Any
+new elements are zeroed. */
+static void* grow(void* data, int* capacity, int index, size_t size) {
+    if (index < *capacity)
+        return data;
+
+    int new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity <= index)
+        new_capacity *= 2;
+    data = realloc(data, size * new_capacity);
+    memset((char*)data + size * *capacity, 0, size * (new_capacity - *capacity));
+    *capacity = new_capacity;
+    return data;
+}
+
 static char next(LexerState* ls) {
     return ls->src.data[++ls->cur];
 }
@@ -25,251 +101,668 @@ static char cur(LexerState* ls) {
     return ls->src.data[ls->cur];
 }
 
-static char peek(LexerState* ls) {
-    return ls->src.data[ls->cur+1];
+// Folds the case of the current character in place, since the lexer is case-sensitive
+static char fold(LexerState* ls) {
+    char* c = &ls->src.data[ls->cur];
+    *c = tolower((unsigned char)*c);
+    return *c;
 }
 
-static char peek_n(LexerState* ls, int offset) {
-    return ls->src.data[ls->cur+offset];
+static char peek(LexerState* ls) {
+    return ls->src.data[ls->cur+1];
 }
 
 static bool is_at_end(LexerState* ls) {
     return ls->cur >= ls->src.len - 1;
 }
 
+static Operand* cur_operand(LexerState* ls) {
+    return &ls->instrs[ls->cur_instr].operands[ls->cur_operand];
+}
+
 static void handle_number(LexerState* ls) {
-    dynstr number = dynstr_create();
-    dynstr_append_char(&number, cur(ls));
-    while (!is_at_end(ls) && isdigit(peek(ls)))
-        dynstr_append_char(&number, next(ls));
+    // Wraps around to the instruction's width, the same way atoi() followed by truncation did
+    uint32_t value = cur(ls) - '0';
+    while (!is_at_end(ls) && isdigit((unsigned char)peek(ls)))
+        value = value * 10 + (next(ls) - '0');
+    uint8_t width = ls->instrs[ls->cur_instr].width;
+    if (width < WIDTH_DWORD)
+        value &= (1u << (8 << width)) - 1;
 
-    Operand* op = &ls->instrs[ls->cur_instr].operands[ls->cur_operand];
+    Operand* op = cur_operand(ls);
     op->is_register = false;
     op->is_label = false;
-    op->value = atoi(number.data);
-}
-
-/* This function's return value indicates whether
-an instruction was actually parsed or not */
-static bool try_handle_instruction(LexerState* ls, dynstr* buffer) {
-    for (int i = 0; i < NUM_INSTR_TYPES; i++) {
-        int res = !dynstr_compare_n(buffer, &instruction_names[i],
-                                    fmin(buffer->len, instruction_names[i].len))
-                  && buffer->len == instruction_names[i].len;
-        if (res) {
-            ls->instrs[ls->cur_instr] = (Instruction){.type = i};
-            return true;
-        }
-    }
-    return false;
+    op->value = value;
 }
 
-/* This function's return value indicates whether
-a register was actually parsed or not */
-static bool try_handle_register(LexerState* ls, dynstr* buffer) {
-    for (int i = 0; i < NUM_GP_REGISTERS; i++) {
-        if ((i < 10 ? !dynstr_compare_n(buffer, &gp_register_names[i], 2)
-                    : !dynstr_compare_n(buffer, &gp_register_names[i], 3))) {
-            Operand* op = &ls->instrs[ls->cur_instr].operands[ls->cur_operand];
-            op->is_register = true;
-            op->is_label = false;
-            op->value = i;
-            return true;
-        }
+// Returns -1 if `token` isn't a mnemonic
+static int instruction_type(str token) {
+    if (token.len < 2 || token.len > 4)
+        return -1;
+    uint32_t key = 0;
+    for (int i = 0; i < (int)token.len; i++)
+        key |= (uint32_t)(uint8_t)token.data[i] << 8 * i;
+
+    switch (key) {
+        case KEY3('n', 'o', 'p'): return NOP;
+        case KEY3('m', 'o', 'v'): return MOV;
+        case KEY3('a', 'd', 'd'): return ADD;
+        case KEY3('a', 'd', 'c'): return ADC;
+        case KEY3('s', 'u', 'b'): return SUB;
+        case KEY3('s', 'b', 'c'): return SBC;
+        case KEY3('c', 'l', 'c'): return CLC;
+        case KEY3('c', 'l', 'v'): return CLV;
+        case KEY3('m', 'u', 'l'): return MUL;
+        case KEY3('d', 'i', 'v'): return DIV;
+        case KEY3('n', 'e', 'g'): return NEG;
+        case KEY3('s', 'h', 'l'): return SHL;
+        case KEY3('s', 'h', 'r'): return SHR;
+        case KEY3('s', 't', 'r'): return STR;
+        case KEY2('l', 'd'):      return LD;
+        case KEY3('c', 'm', 'p'): return CMP;
+        case KEY3('j', 'm', 'p'): return JMP;
+        case KEY3('j', 'n', 'e'): return JNE;
+        case KEY2('j', 'e'):      return JE;
+        case KEY3('j', 'g', 't'): return JGT;
+        case KEY3('j', 'l', 't'): return JLT;
+        case KEY3('j', 'n', 'z'): return JNZ;
+        case KEY2('j', 'z'):      return JZ;
+        case KEY3('p', 't', 'c'): return PTC;
+        case KEY3('p', 't', 'n'): return PTN;
+        case KEY3('p', 't', 'u'): return PTU;
+        case KEY3('h', 'l', 't'): return HLT;
+        case KEY3('s', 'n', 'd'): return SND;
+        case KEY3('r', 'c', 'v'): return RCV;
+        case KEY4('m', 'c', 'p', 'y'): return MCPY;
+        case KEY4('m', 's', 'e', 't'): return MSET;
+        case KEY4('m', 'c', 'm', 'p'): return MCMP;
+        case KEY4('m', 'a', 'd', 'd'): return MADD;
+        case KEY4('m', 'x', 'o', 'r'): return MXOR;
+        case KEY3('p', 't', 's'): return PTS;
     }
+    return -1;
+}
+
+/* Returns -1 if `token` isn't a register. Registers
+are matched loosely: only the first two characters of
+general purpose ones are looked at (so r1x is r1), and
+special ones only have to be a prefix of the name or
+have the name as a prefix (so both r and rstx are rst). */
+static int register_number(str token) {
+    if (token.len >= 2 && token.data[0] == 'r'
+        && token.data[1] >= '0' && token.data[1] < '0' + NUM_GP_REGISTERS)
+        return token.data[1] - '0';
+
     for (int i = 0; i < NUM_SPECIAL_REGISTERS; i++) {
-        if (!dynstr_compare_n(buffer, &special_register_names[i],
-            fmin(buffer->len, special_register_names[i].len))) {
-            Operand* op = &ls->instrs[ls->cur_instr].operands[ls->cur_operand];
-            op->is_register = true;
-            op->is_label = false;
-            op->value = i;
-            return true;
-        }
+        int name_len = strlen(special_register_names[i]);
+        int len = (int)token.len < name_len ? (int)token.len : name_len;
+        if (!memcmp(token.data, special_register_names[i], len))
+            return NUM_GP_REGISTERS + i;
     }
-    return false;
+    return -1;
+}
+
+static uint32_t hash_name(str name) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < (int)name.len; i++) {
+        hash ^= (uint8_t)name.data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void insert_label_slot(LexerState* ls, int index) {
+    uint32_t mask = ls->num_label_slots - 1;
+    uint32_t slot = hash_name(ls->labels[index].name) & mask;
+    while (ls->label_slots[slot] != 0)
+        slot = (slot + 1) & mask;
+    ls->label_slots[slot] = index + 1;
+}
+
+static void resize_label_slots(LexerState* ls, int num_slots) {
+    free(ls->label_slots);
+    ls->label_slots = calloc(num_slots, sizeof(uint32_t));
+    ls->num_label_slots = num_slots;
+    for (int i = 0; i < ls->num_labels; i++)
+        insert_label_slot(ls, i);
+}
+
+static str copy_name(LexerState* ls, str name) {
+    NameBlock* block = ls->names;
+    if (block == NULL || block->capacity - block->len < (int)name.len) {
+        int capacity = name.len > NAME_BLOCK_SIZE ? name.len : NAME_BLOCK_SIZE;
+        block = malloc(sizeof(NameBlock) + capacity);
+        *block = (NameBlock){.next = ls->names, .capacity = capacity};
+        ls->names = block;
+    }
+    char* data = block->data + block->len;
+    memcpy(data, name.data, name.len);
+    block->len += name.len;
+    return (str){.data = data, .len = name.len};
+}
+
+/* Returns the index of the label called `name`, adding
+it as LABEL_UNDEFINED if it hasn't been seen yet */
+static int find_label(LexerState* ls, str name) {
+    uint32_t mask = ls->num_label_slots - 1;
+    uint32_t slot = hash_name(name) & mask;
+    while (ls->label_slots[slot] != 0) {
+        int index = ls->label_slots[slot] - 1;
+        str* other = &ls->labels[index].name;
+        if (other->len == name.len && !memcmp(other->data, name.data, name.len))
+            return index;
+        slot = (slot + 1) & mask;
+    }
+
+    int index = ls->num_labels++;
+    ls->labels = grow(ls->labels, &ls->labels_capacity, index, sizeof(Label));
+    if (ls->copy_names)
+        name = copy_name(ls, name);
+    ls->labels[index] = (Label){.name = name, .address = LABEL_UNDEFINED};
+    if (ls->num_labels * 2 > ls->num_label_slots)
+        resize_label_slots(ls, ls->num_label_slots * 2);
+    else
+        insert_label_slot(ls, index);
+    return index;
 }
 
 /* This function's return value is acts as an
 error code indicating if an unexpected character
 was encountered */
-static bool try_handle_label(LexerState* ls, dynstr* buffer) {
+static bool handle_label(LexerState* ls, str name) {
     // Labels as operands
-    if (is_at_end(ls) || isspace(peek(ls)) || peek(ls) == ',') {
-        Operand* op = &ls->instrs[ls->cur_instr].operands[ls->cur_operand];
+    if (is_at_end(ls) || isspace((unsigned char)peek(ls)) || peek(ls) == ',') {
+        int index = find_label(ls, name);
+        Operand* op = cur_operand(ls);
         op->is_register = false;
         op->is_label = true;
-
-        str name = dynstr_to_str(buffer);
-        *buffer = dynstr_create();
-
-        bool found_label = false;
-        for (int i = 0; i < ls->num_labels; i++) {
-            if (!str_compare(&name, &ls->labels[i].name)) {
-                // `value` is set to the index of the label
-                op->value = i;
-                found_label = true;
-                break;
-            }
-        }
-        /* If we come across a label that we haven't seen yet,
-        then create the struct for it with a placeholder address
-        to be filled in later when we actually find the label */
-        if (!found_label) {
-            ls->labels[ls->num_labels] = (Label){.name = name,
-                                                 .address = 0};
-            op->value = ls->num_labels++;
-        }
-
+        // `value` is set to the index of the label
+        op->value = index;
         return true;
     }
     // Labels as, well, labels
     else if (peek(ls) == ':') {
-        str name = dynstr_to_str(buffer);
-        *buffer = dynstr_create();
-
-        bool found_label = false;
-        for (int i = 0; i < ls->num_labels; i++) {
-            /* If we find the label already has an existing
-            struct, then just fill in the address */
-            if (!str_compare(&name, &ls->labels[i].name)) {
-                ls->labels[i].address = ls->cur_instr;
-                ls->cur_label_index = i;
-                found_label = true;
-                break;
-            }
-        }
-        // Otherwise, create the struct here
-        if (!found_label) {
-            ls->labels[ls->cur_label_index++] = (Label){.name = name,
-                                                        .address = ls->cur_instr};
-            ls->num_labels++;
-        }
-
+        int index = find_label(ls, name);
+        ls->labels[index].address = ls->cur_instr;
+        ls->labels[index].defined = true;
         return true;
     }
     return false;
 }
 
-/* This function basically just ensures that
-the buffer being used for string comparisons
-reaches the minimum length to ensure that
-said comparisons are correct. It then hands
-off the actual parsing to helper functions.
-It propagates errors from those functions, too. */
+/* Reads a width suffix (.w or .d) after a mnemonic.
+Only instructions that move or work out a value, and
+bulk memory ones, have wide versions, so anything else
+is an error. */
+static bool handle_width(LexerState* ls, int type) {
+    next(ls);
+    if (is_at_end(ls) || !isalnum((unsigned char)peek(ls)))
+        return false;
+    next(ls);
+    char suffix = fold(ls);
+    if (!is_at_end(ls) && isalnum((unsigned char)peek(ls)))
+        return false;
+
+    switch (type) {
+        case MOV: case ADD: case SUB: case MUL: case DIV: case SHL: case SHR:
+        case CMP: case LD: case STR:
+        case MCPY: case MSET: case MCMP: case MADD: case MXOR: case PTS:
+            break;
+        default:
+            return false;
+    }
+    switch (suffix) {
+        case 'w': ls->instrs[ls->cur_instr].width = WIDTH_WORD; return true;
+        case 'd': ls->instrs[ls->cur_instr].width = WIDTH_DWORD; return true;
+        default:  return false;
+    }
+}
+
+/* Scans a whole word, then works out whether it's
+a mnemonic, a register or a label, in that order.
+It propagates errors from handle_width() and
+handle_label(). */
 static bool handle_text(LexerState* ls) {
-    dynstr buffer = dynstr_create();
-    dynstr_append_char(&buffer, cur(ls));
-    while (!is_at_end(ls) && isalnum(peek(ls)))
-        dynstr_append_char(&buffer, next(ls));
+    fold(ls);
+    str token = {.data = ls->src.data + ls->cur, .len = 1};
+    while (!is_at_end(ls) && isalnum((unsigned char)peek(ls))) {
+        next(ls);
+        fold(ls);
+        token.len++;
+    }
 
-    if (try_handle_instruction(ls, &buffer))
-        return true;
+    int type = instruction_type(token);
+    if (type != -1) {
+        ls->instrs[ls->cur_instr] = (Instruction){.type = type};
+        return is_at_end(ls) || peek(ls) != '.' || handle_width(ls, type);
+    }
 
-    if (try_handle_register(ls, &buffer))
+    int reg = register_number(token);
+    if (reg != -1) {
+        Operand* op = cur_operand(ls);
+        op->is_register = true;
+        op->is_label = false;
+        op->value = reg;
         return true;
+    }
 
-    return try_handle_label(ls, &buffer);
-}
-
-static void initialize_names() {
-    int cur = 0;
-    instruction_names[cur++] = dynstr_create_from("nop");
-    instruction_names[cur++] = dynstr_create_from("mov");
-    instruction_names[cur++] = dynstr_create_from("add");
-    instruction_names[cur++] = dynstr_create_from("adc");
-    instruction_names[cur++] = dynstr_create_from("sub");
-    instruction_names[cur++] = dynstr_create_from("sbc");
-    instruction_names[cur++] = dynstr_create_from("clc");
-    instruction_names[cur++] = dynstr_create_from("clv");
-    instruction_names[cur++] = dynstr_create_from("mul");
-    instruction_names[cur++] = dynstr_create_from("div");
-    instruction_names[cur++] = dynstr_create_from("neg");
-    instruction_names[cur++] = dynstr_create_from("shl");
-    instruction_names[cur++] = dynstr_create_from("shr");
-    instruction_names[cur++] = dynstr_create_from("str");
-    instruction_names[cur++] = dynstr_create_from("ld");
-    instruction_names[cur++] = dynstr_create_from("cmp");
-    instruction_names[cur++] = dynstr_create_from("jmp");
-    instruction_names[cur++] = dynstr_create_from("jne");
-    instruction_names[cur++] = dynstr_create_from("je");
-    instruction_names[cur++] = dynstr_create_from("jgt");
-    instruction_names[cur++] = dynstr_create_from("jlt");
-    instruction_names[cur++] = dynstr_create_from("jnz");
-    instruction_names[cur++] = dynstr_create_from("jz");
-    instruction_names[cur++] = dynstr_create_from("ptc");
-    instruction_names[cur++] = dynstr_create_from("ptn");
-    instruction_names[cur++] = dynstr_create_from("ptu");
-    instruction_names[cur++] = dynstr_create_from("hlt");
-    instruction_names[cur++] = dynstr_create_from("none");
-    cur = 0;
-    gp_register_names[cur++] = dynstr_create_from("r0");
-    gp_register_names[cur++] = dynstr_create_from("r1");
-    gp_register_names[cur++] = dynstr_create_from("r2");
-    gp_register_names[cur++] = dynstr_create_from("r3");
-    gp_register_names[cur++] = dynstr_create_from("r4");
-    gp_register_names[cur++] = dynstr_create_from("r5");
-    gp_register_names[cur++] = dynstr_create_from("r6");
-    gp_register_names[cur++] = dynstr_create_from("r7");
-    cur = 0;
-    special_register_names[cur++] = dynstr_create_from("rst");
-    special_register_names[cur++] = dynstr_create_from("rz");
-    special_register_names[cur++] = dynstr_create_from("rcmp");
-    special_register_names[cur++] = dynstr_create_from("pc");
-    special_register_names[cur++] = dynstr_create_from("ip");
+    return handle_label(ls, token);
 }
 
-LexerState lexer_lex(str src) {
-    if (!names_initialized)
-        initialize_names();
-
-    LexerState ls = {.src = src, .cur = -1, .line_num = 1, .instrs = {0}, .cur_instr = 0, 
-                     .cur_operand = 0, .labels = {0}, .cur_label_index = 0,
-                     .num_labels = 0, .had_error = false};
-    while (!is_at_end(&ls)) {
-        char c = next(&ls);
+// Reads a whole source file, for anything that needs all of it at once
+str read_file_to_str(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return (str){.data = NULL, .len = 0};
+
+    fseek(file, 0, SEEK_END);
+    int file_len = ftell(file);
+    rewind(file);
+
+    str string = str_create(file_len);
+
+    fread(string.data, sizeof(uint8_t), file_len, file);
+    fclose(file);
+
+    return string;
+}
+
+static LexerState create(str src) {
+    LexerState ls = {.src = src, .cur = -1, .line_num = 1};
+    ls.instrs = grow(NULL, &ls.instrs_capacity, 0, sizeof(Instruction));
+    ls.lines = grow(NULL, &ls.lines_capacity, 0, sizeof(int));
+    ls.lines[0] = 1;
+    resize_label_slots(&ls, INITIAL_LABEL_SLOTS);
+    return ls;
+}
+
+/* Labels that were used but never defined go to the
+start, as they always have, and are left with `defined`
+false for the verifier to find. Nothing looks labels up
+by name any more, so their hash table goes too. */
+static void finish(LexerState* ls) {
+    for (int i = 0; i < ls->num_labels; i++) {
+        if (ls->labels[i].address == LABEL_UNDEFINED)
+            ls->labels[i].address = 0;
+    }
+    free(ls->label_slots);
+    ls->label_slots = NULL;
+    ls->num_label_slots = 0;
+}
+
+// Lexes the rest of `src`, stopping at the first error
+static void lex(LexerState* ls) {
+    str src = ls->src;
+    while (!is_at_end(ls)) {
+        char c = next(ls);
         switch (c) {
-            // Ignore comments
+            // Ignore comments, but not the newline ending them
             case ';': {
-                ls.cur--;
-                while ((c = next(&ls) != '\n'));
-                ls.cur--;
+                while (!is_at_end(ls) && peek(ls) != '\n')
+                    ls->cur++;
 
                 break;
             }
             case ',': {
-                if (ls.cur_operand == 2)
-                    ls.cur_operand = 0;
+                if (ls->cur_operand == 2)
+                    ls->cur_operand = 0;
                 else
-                    ls.cur_operand++;
+                    ls->cur_operand++;
 
                 break;
             }
             case '\n': {
                 // Don't count labels as instructions
-                int offset = -1;
-                if (peek_n(&ls, offset) == '\r')
-                    offset--;
+                int before = ls->cur - 1;
+                if (before >= 0 && src.data[before] == '\r')
+                    before--;
 
-                if (peek_n(&ls, offset) != ':') {
-                    ls.cur_operand = 0;
-                    ls.cur_instr++;
+                if (before < 0 || src.data[before] != ':') {
+                    ls->cur_operand = 0;
+                    ls->cur_instr++;
+                    ls->instrs = grow(ls->instrs, &ls->instrs_capacity, ls->cur_instr,
+                                     sizeof(Instruction));
+                    ls->lines = grow(ls->lines, &ls->lines_capacity, ls->cur_instr, sizeof(int));
                 }
-                ls.line_num++;
+                // Instructions after a label line are on the line after it
+                ls->line_num++;
+                ls->lines[ls->cur_instr] = ls->line_num;
 
                 break;
             }
             default: {
-                if (isdigit(c))
-                    handle_number(&ls);
-                else if (isalnum(c)) {
-                    if (!handle_text(&ls)) {
-                        ls.had_error = true;
-                        break;
-                    }
+                if (!isalnum((unsigned char)c))
+                    break;
+
+                if (isdigit((unsigned char)c))
+                    handle_number(ls);
+                else if (!handle_text(ls)) {
+                    ls->had_error = true;
+                    return;
                 }
             }
         }
     }
+}
+
+/* Folds the case of `src` in place, since the lexer is
+case-sensitive, and label names point into it */
+LexerState lexer_lex(str src) {
+    LexerState ls = create(src);
+    lex(&ls);
+    finish(&ls);
     return ls;
+}
+
+typedef struct Assembly Assembly;
+
+/* A run of whole lines, lexed by itself. Each of its
+labels also has a place in one of the shards, which is
+where labels are matched up between chunks. */
+typedef struct {
+    Assembly* assembly;
+    int id;
+    LexerState lexed;
+    int num_instrs;        // Not counting the empty one after its last newline
+    int first_instr;       // Where its instructions go in the whole program
+    int first_line;        // How many lines come before it
+    uint8_t* label_shards; // By its own label index, as are the rest
+    int* label_entries;    // In the label's shard
+    bool* label_firsts;    // Whether no earlier chunk has the label
+    int first_label;       // Where the labels first seen here start in the whole program
+    int* label_indices;    // In the whole program
+} Chunk;
+
+// Labels whose hash picks it, from every chunk
+typedef struct {
+    LexerState table;   // Only its labels are used
+    int* first_counts;  // How many of them each chunk has first
+    int* label_indices; // In the whole program, by index in `table`
+} Shard;
+
+// There are as many shards as chunks, each merged on the chunk's thread
+struct Assembly {
+    Chunk* chunks;
+    Shard* shards;
+    int num_chunks;
+    LexerState merged;
+};
+
+static void* lex_chunk(void* arg) {
+    Chunk* chunk = arg;
+    LexerState* lexed = &chunk->lexed;
+    lex(lexed);
+    int num_labels = lexed->num_labels ? lexed->num_labels : 1;
+    chunk->label_shards = malloc(sizeof(uint8_t) * num_labels);
+    chunk->label_entries = malloc(sizeof(int) * num_labels);
+    chunk->label_firsts = malloc(sizeof(bool) * num_labels);
+    chunk->label_indices = malloc(sizeof(int) * num_labels);
+    // The high bits, since the low ones pick slots
+    for (int i = 0; i < lexed->num_labels; i++) {
+        uint32_t hash = hash_name(lexed->labels[i].name);
+        chunk->label_shards[i] = (uint64_t)hash * chunk->assembly->num_chunks >> 32;
+    }
+    return NULL;
+}
+
+/* Goes through the chunks in order, so that later
+definitions win, and each label is first in the chunk
+that has it first */
+static void* merge_shard(void* arg) {
+    Chunk* chunk = arg;
+    Assembly* assembly = chunk->assembly;
+    Shard* shard = &assembly->shards[chunk->id];
+    shard->table = create((str){0});
+    shard->first_counts = calloc(assembly->num_chunks, sizeof(int));
+    for (int i = 0; i < assembly->num_chunks; i++) {
+        Chunk* other = &assembly->chunks[i];
+        for (int j = 0; j < other->lexed.num_labels; j++) {
+            if (other->label_shards[j] != chunk->id)
+                continue;
+            int num_labels = shard->table.num_labels;
+            int entry = find_label(&shard->table, other->lexed.labels[j].name);
+            other->label_entries[j] = entry;
+            other->label_firsts[j] = shard->table.num_labels > num_labels;
+            shard->first_counts[i] += other->label_firsts[j];
+            uint32_t address = other->lexed.labels[j].address;
+            if (address != LABEL_UNDEFINED)
+                shard->table.labels[entry].address = address + other->first_instr;
+        }
+    }
+    int num_labels = shard->table.num_labels ? shard->table.num_labels : 1;
+    shard->label_indices = malloc(sizeof(int) * num_labels);
+    return NULL;
+}
+
+// Numbers the labels first seen in this chunk in the order it first has them
+static void* number_labels(void* arg) {
+    Chunk* chunk = arg;
+    Assembly* assembly = chunk->assembly;
+    int index = chunk->first_label;
+    for (int i = 0; i < chunk->lexed.num_labels; i++) {
+        if (!chunk->label_firsts[i])
+            continue;
+        Shard* shard = &assembly->shards[chunk->label_shards[i]];
+        int entry = chunk->label_entries[i];
+        uint32_t address = shard->table.labels[entry].address;
+        shard->label_indices[entry] = index;
+        // As finish() would
+        assembly->merged.labels[index++] = (Label){
+            .name = chunk->lexed.labels[i].name,
+            .address = address == LABEL_UNDEFINED ? 0 : address,
+            .defined = address != LABEL_UNDEFINED
+        };
+    }
+    return NULL;
+}
+
+static void* place_chunk(void* arg) {
+    Chunk* chunk = arg;
+    Assembly* assembly = chunk->assembly;
+    for (int i = 0; i < chunk->lexed.num_labels; i++) {
+        Shard* shard = &assembly->shards[chunk->label_shards[i]];
+        chunk->label_indices[i] = shard->label_indices[chunk->label_entries[i]];
+    }
+
+    Instruction* instrs = assembly->merged.instrs + chunk->first_instr;
+    int* lines = assembly->merged.lines + chunk->first_instr;
+    memcpy(instrs, chunk->lexed.instrs, sizeof(Instruction) * chunk->num_instrs);
+    for (int i = 0; i < chunk->num_instrs; i++) {
+        lines[i] = chunk->lexed.lines[i] + chunk->first_line;
+        for (int j = 0; j < NUM_OPERANDS; j++) {
+            if (instrs[i].operands[j].is_label)
+                instrs[i].operands[j].value = chunk->label_indices[instrs[i].operands[j].value];
+        }
+    }
+    return NULL;
+}
+
+// Runs `function` on every chunk at once, with the first on this thread
+static void run_on_chunks(Assembly* assembly, void* (*function)(void*)) {
+    pthread_t* threads = malloc(sizeof(pthread_t) * assembly->num_chunks);
+    for (int i = 1; i < assembly->num_chunks; i++)
+        pthread_create(&threads[i], NULL, function, &assembly->chunks[i]);
+    function(&assembly->chunks[0]);
+    for (int i = 1; i < assembly->num_chunks; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+/* Splits `src` into at most `num_chunks` runs of whole
+lines, of about the same size. Returns how many there
+are. */
+static int split(Assembly* assembly, str src, int num_chunks) {
+    int len = (int)src.len;
+    int chunk_size = len / num_chunks;
+    int start = 0, count = 0;
+    while (start < len) {
+        int end = count == num_chunks - 1 ? len : start + chunk_size;
+        while (end < len && src.data[end - 1] != '\n')
+            end++;
+        str chunk_src = {.data = src.data + start, .len = end - start};
+        assembly->chunks[count] = (Chunk){.assembly = assembly, .id = count,
+                                          .lexed = create(chunk_src)};
+        count++;
+        start = end;
+    }
+    return count;
+}
+
+static void free_assembly(Assembly* assembly) {
+    for (int i = 0; i < assembly->num_chunks; i++) {
+        Chunk* chunk = &assembly->chunks[i];
+        lexer_free(&chunk->lexed);
+        free(chunk->label_shards);
+        free(chunk->label_entries);
+        free(chunk->label_firsts);
+        free(chunk->label_indices);
+        Shard* shard = &assembly->shards[i];
+        lexer_free(&shard->table);
+        free(shard->first_counts);
+        free(shard->label_indices);
+    }
+    free(assembly->chunks);
+    free(assembly->shards);
+}
+
+LexerState lexer_lex_parallel(str src, int num_threads) {
+    int num_chunks = src.len / MIN_CHUNK_SIZE;
+    if (num_chunks > num_threads)
+        num_chunks = num_threads;
+    if (num_chunks > MAX_CHUNKS)
+        num_chunks = MAX_CHUNKS;
+    if (num_chunks < 2)
+        return lexer_lex(src);
+
+    Assembly assembly = {.chunks = calloc(num_chunks, sizeof(Chunk))};
+    assembly.num_chunks = split(&assembly, src, num_chunks);
+    assembly.shards = calloc(assembly.num_chunks, sizeof(Shard));
+    run_on_chunks(&assembly, lex_chunk);
+
+    LexerState* merged = &assembly.merged;
+    *merged = (LexerState){.src = src, .cur = src.len - 1};
+    int num_instrs = 0, num_lines = 0;
+    for (int i = 0; i < assembly.num_chunks; i++) {
+        Chunk* chunk = &assembly.chunks[i];
+        if (chunk->lexed.had_error) {
+            merged->had_error = true;
+            free_assembly(&assembly);
+            return *merged;
+        }
+        bool last = i == assembly.num_chunks - 1;
+        chunk->num_instrs = last ? chunk->lexed.cur_instr + 1 : chunk->lexed.cur_instr;
+        chunk->first_instr = num_instrs;
+        chunk->first_line = num_lines;
+        num_instrs += chunk->num_instrs;
+        num_lines += chunk->lexed.line_num - 1;
+    }
+
+    run_on_chunks(&assembly, merge_shard);
+    int num_labels = 0;
+    for (int i = 0; i < assembly.num_chunks; i++) {
+        assembly.chunks[i].first_label = num_labels;
+        for (int j = 0; j < assembly.num_chunks; j++)
+            num_labels += assembly.shards[j].first_counts[i];
+    }
+
+    // Every element is about to be written, so there's no need to zero them
+    merged->instrs = malloc(sizeof(Instruction) * num_instrs);
+    merged->lines = malloc(sizeof(int) * num_instrs);
+    merged->labels = malloc(sizeof(Label) * (num_labels ? num_labels : 1));
+    merged->instrs_capacity = merged->lines_capacity = num_instrs;
+    merged->labels_capacity = merged->num_labels = num_labels;
+    merged->cur_instr = num_instrs - 1;
+    merged->line_num = num_lines + 1;
+    run_on_chunks(&assembly, number_labels);
+    run_on_chunks(&assembly, place_chunk);
+
+    free_assembly(&assembly);
+    return *merged;
+}
+
+void lexer_free(LexerState* ls) {
+    free(ls->instrs);
+    free(ls->lines);
+    free(ls->labels);
+    free(ls->label_slots);
+    while (ls->names != NULL) {
+        NameBlock* next = ls->names->next;
+        free(ls->names);
+        ls->names = next;
+    }
+    *ls = (LexerState){0};
+}
+
+LexerStream lexer_stream_open(int fd) {
+    LexerStream stream = {.lexed = create((str){0}), .fd = fd,
+                          .block = malloc(LEXER_BLOCK_SIZE),
+                          .block_capacity = LEXER_BLOCK_SIZE};
+    stream.lexed.copy_names = true;
+    return stream;
+}
+
+static bool refers_to_undefined_label(const LexerState* ls, const Instruction* instr) {
+    for (int i = 0; i < NUM_OPERANDS; i++) {
+        const Operand* op = &instr->operands[i];
+        if (op->is_label && ls->labels[op->value].address == LABEL_UNDEFINED)
+            return true;
+    }
+    return false;
+}
+
+/* Reads whatever's ready, up to a block, and lexes all
+the whole lines there are so far. Returns false once
+the whole source has been lexed, or it fails. */
+bool lexer_stream_next(LexerStream* stream) {
+    LexerState* ls = &stream->lexed;
+    if (stream->at_end || ls->had_error)
+        return false;
+
+    // Room for a whole block after what's left of the last one
+    if (stream->block_capacity - stream->block_len < LEXER_BLOCK_SIZE) {
+        stream->block_capacity *= 2;
+        stream->block = realloc(stream->block, stream->block_capacity);
+    }
+    long bytes_read = read(stream->fd, stream->block + stream->block_len, LEXER_BLOCK_SIZE);
+    if (bytes_read < 0) {
+        stream->read_failed = ls->had_error = true;
+        return false;
+    }
+    stream->block_len += bytes_read;
+    stream->at_end = bytes_read == 0;
+
+    int end = stream->block_len;
+    if (!stream->at_end) {
+        while (end > 0 && stream->block[end - 1] != '\n')
+            end--;
+        // Still in the middle of the first line
+        if (end == 0)
+            return true;
+    }
+
+    ls->src = (str){.data = stream->block, .len = end};
+    ls->cur = -1;
+    lex(ls);
+    ls->src = (str){0};
+    if (ls->had_error)
+        return false;
+    memmove(stream->block, stream->block + end, stream->block_len - end);
+    stream->block_len -= end;
+
+    // The instruction being lexed when the stream ends is the last one
+    int num_lexed = ls->cur_instr;
+    if (stream->at_end) {
+        finish(ls);
+        num_lexed++;
+    }
+    while (stream->num_runnable < num_lexed
+           && !refers_to_undefined_label(ls, &ls->instrs[stream->num_runnable]))
+        stream->num_runnable++;
+    return !stream->at_end;
+}
+
+// Leaves `lexed` alone, for lexer_free()
+void lexer_stream_close(LexerStream* stream) {
+    free(stream->block);
+    stream->block = NULL;
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+/* The embedding API in libstrvm.h, on top of the same
+modules that main() uses. Programs are decoded, and
+compiled to machine code where the JIT is supported, as
+soon as they're created, so that nothing about them
+changes afterwards and threads can share them without
+any locking. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "lexer.h"
+#include "decoder.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "optimizer.h"
+#include "output.h"
+#include "verifier.h"
+#include "libstrvm.h"
+
+#include "fiesta/str.h"
+
+struct StrvmProgram {
+    char* source;        // A copy, since label names point into it
+    LexerState lexed;    // For programs compiled from source
+    BytecodeImage image; // For programs loaded from bytecode
+    Instruction* instrs;
+    int num_instrs;
+    Label* labels;
+    int num_labels;
+    DecodedProgram decoded;
+    JitProgram jit;
+    bool verified; // So the interpreter can skip checking it
+};
+
+struct StrvmContext {
+    const StrvmProgram* program;
+    OutputSink output;
+    VM vm;
+};
+
+// Once `instrs` and `labels` are in place
+static void finish_program(StrvmProgram* program) {
+    VerifyResult result = verifier_verify(program->instrs, program->num_instrs,
+                                          program->labels, program->num_labels);
+    program->verified = result.verified;
+    verifier_free(&result);
+
+    if (program->decoded.instrs == NULL) {
+        program->decoded = decoder_decode(program->instrs, program->num_instrs,
+                                          program->labels, program->num_labels);
+    }
+    program->jit = jit_compile(&program->decoded);
+}
+
+StrvmStatus strvm_compile(const char* source, size_t len, int opt_level, StrvmProgram** program) {
+    StrvmProgram* p = calloc(1, sizeof(StrvmProgram));
+    p->source = malloc(len ? len : 1);
+    memcpy(p->source, source, len);
+    p->lexed = lexer_lex((str){.data = p->source, .len = len});
+    if (p->lexed.had_error) {
+        strvm_program_free(p);
+        return STRVM_PARSE_ERROR;
+    }
+
+    p->instrs = p->lexed.instrs;
+    p->num_instrs = p->lexed.cur_instr + 1;
+    p->labels = p->lexed.labels;
+    p->num_labels = p->lexed.num_labels;
+    optimizer_run(p->instrs, &p->num_instrs, p->labels, p->num_labels, opt_level);
+    finish_program(p);
+    *program = p;
+    return STRVM_OK;
+}
+
+// Images hold the decoded program already, and only the addresses of labels
+StrvmStatus strvm_load_bytecode(const void* image, size_t size, StrvmProgram** program) {
+    BytecodeImage loaded = bytecode_load_memory(image, size);
+    if (loaded.error != BYTECODE_OK)
+        return STRVM_BAD_BYTECODE;
+
+    StrvmProgram* p = calloc(1, sizeof(StrvmProgram));
+    p->image = loaded;
+    p->instrs = loaded.instrs;
+    p->num_instrs = loaded.header->num_instrs;
+    p->num_labels = loaded.header->num_labels;
+    p->labels = bytecode_labels(&loaded);
+    p->decoded = loaded.decoded;
+    finish_program(p);
+    *program = p;
+    return STRVM_OK;
+}
+
+void strvm_program_free(StrvmProgram* program) {
+    if (program == NULL)
+        return;
+    jit_free(&program->jit);
+    if (program->image.base != NULL) {
+        free(program->labels);
+        bytecode_unload(&program->image);
+    }
+    else {
+        if (program->decoded.instrs != NULL)
+            decoder_free(&program->decoded);
+        lexer_free(&program->lexed);
+    }
+    free(program->source);
+    free(program);
+}
+
+bool strvm_program_verified(const StrvmProgram* program) {
+    return program->verified;
+}
+
+StrvmContext* strvm_context_create(const StrvmProgram* program) {
+    StrvmContext* context = malloc(sizeof(StrvmContext));
+    context->program = program;
+    context->output = output_sink_discard();
+    strvm_context_reset(context);
+    return context;
+}
+
+void strvm_context_reset(StrvmContext* context) {
+    context->vm = vm_init(context->program->labels, context->program->num_labels);
+    context->vm.output = &context->output;
+}
+
+void strvm_context_free(StrvmContext* context) {
+    if (context == NULL)
+        return;
+    output_free(&context->output);
+    free(context);
+}
+
+void strvm_set_output(StrvmContext* context, StrvmWriteFn write, void* user_data) {
+    output_free(&context->output);
+    context->output = write != NULL ? output_sink_callback(write, user_data) : output_sink_discard();
+}
+
+static StrvmStatus status_of(VM_Error error) {
+    switch (error.type) {
+        case NONE:                return STRVM_OK;
+        case HALT:                return STRVM_HALTED;
+        case YIELD:               return STRVM_OUT_OF_FUEL;
+        case BLOCKED:             return STRVM_BLOCKED;
+        case INVALID_INSTRUCTION: return STRVM_INVALID_INSTRUCTION;
+        default:                  return STRVM_INVALID_OPERAND;
+    }
+}
+
+// Nothing run here writes to the program, whatever the engines' signatures say
+StrvmStatus strvm_run(StrvmContext* context, StrvmEngine engine, uint64_t fuel) {
+    StrvmProgram* program = (StrvmProgram*)context->program;
+    VM* vm = &context->vm;
+    VM_Budget budget = {.fuel = fuel};
+    VM_Error error;
+    if (engine == STRVM_ENGINE_JIT && fuel == STRVM_UNLIMITED_FUEL)
+        error = vm_run_jit(vm, &program->jit);
+    else if (engine != STRVM_ENGINE_INTERP)
+        error = vm_run_decoded_budget(vm, &program->decoded, &budget);
+    else if (program->verified)
+        error = vm_run_verified(vm, program->instrs, program->num_instrs, &budget);
+    else
+        error = vm_run_budget(vm, program->instrs, program->num_instrs, &budget);
+    output_flush(&context->output);
+    return status_of(error);
+}
+
+uint8_t strvm_get_register(const StrvmContext* context, int index) {
+    return index >= 0 && index < NUM_GP_REGISTERS ? context->vm.registers[index].value : 0;
+}
+
+void strvm_set_register(StrvmContext* context, int index, uint8_t value) {
+    if (index >= 0 && index < NUM_GP_REGISTERS)
+        context->vm.registers[index].value = value;
+}
+
+static size_t clamp_to_memory(uint32_t address, size_t len) {
+    if (address >= MEMORY_SIZE)
+        return 0;
+    return len < MEMORY_SIZE - address ? len : MEMORY_SIZE - address;
+}
+
+size_t strvm_read_memory(const StrvmContext* context, uint32_t address, void* data, size_t len) {
+    len = clamp_to_memory(address, len);
+    memcpy(data, context->vm.memory + address, len);
+    return len;
+}
+
+size_t strvm_write_memory(StrvmContext* context, uint32_t address, const void* data, size_t len) {
+    len = clamp_to_memory(address, len);
+    memcpy(context->vm.memory + address, data, len);
+    return len;
+}
+
+size_t strvm_memory_size(void) {
+    return MEMORY_SIZE;
+}
+
+uint64_t strvm_instructions_run(const StrvmContext* context) {
+    return context->vm.program_counter;
+}
+
+const char* strvm_status_string(StrvmStatus status) {
+    switch (status) {
+        case STRVM_OK:                  return "no error";
+        case STRVM_HALTED:              return "halted";
+        case STRVM_OUT_OF_FUEL:         return "ran out of fuel";
+        case STRVM_BLOCKED:             return "blocked on a channel";
+        case STRVM_INVALID_INSTRUCTION: return "invalid instruction";
+        case STRVM_INVALID_OPERAND:     return "invalid operand";
+        case STRVM_PARSE_ERROR:         return "couldn't be parsed";
+        case STRVM_BAD_BYTECODE:        return "isn't a usable bytecode image";
+    }
+    return "unknown status";
+}
\ No newline at end of file
@@ -1,57 +1,424 @@
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#define open _open
+#else
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#endif
+
 #include <stdbool.h>
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <ctype.h>
 
 #include "strvm.h"
 #include "lexer.h"
+#include "decoder.h"
+#include "bytecode.h"
+#include "runner.h"
+#include "jit.h"
+#include "aot.h"
+#include "optimizer.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "recorder.h"
+#include "verifier.h"
 
 #include "fiesta/str.h"
 
-str read_file_to_str(const char* filename) {
-    FILE* file = fopen(filename, "rb");
-    if (file == NULL)
-        return (str){.data = NULL, .len = 0};
-    
-    fseek(file, 0, SEEK_END);
-    int file_len = ftell(file);
-    rewind(file);
+typedef enum {
+    ENGINE_INTERP,
+    ENGINE_DECODED,
+    ENGINE_JIT
+} Engine;
 
-    str string = str_create(file_len);
+static void print_vm_error(VM_Error error) {
+    switch (error.type) {
+        case INVALID_INSTRUCTION:
+            printf("Error: invalid instruction\n");
+            break;
+        case INVALID_OPERAND:
+            printf("Error: invalid operand\n");
+            break;
+        case YIELD:
+            printf("Error: ran out of fuel\n");
+            break;
+        case BLOCKED:
+            printf("Error: blocked on a channel\n");
+            break;
+        default:
+            printf("Error: an unknown error occurred\n");
+    }
+}
 
-    int bytes_read = 0;
-    bytes_read = fread(string.data, sizeof(uint8_t), file_len, file);
-    fclose(file);
+// Returns -1 if there's no label called `name`, ignoring case like the lexer does
+static int find_label(const Label labels[], int num_labels, const char* name) {
+    int len = strlen(name);
+    for (int i = 0; i < num_labels; i++) {
+        if (labels[i].name.data == NULL || (int)labels[i].name.len != len)
+            continue;
+        int j = 0;
+        while (j < len && labels[i].name.data[j] == tolower((unsigned char)name[j]))
+            j++;
+        if (j == len)
+            return i;
+    }
+    return -1;
+}
 
-    str_to_lower(&string);
+/* Runs the program as it's lexed, a block at a time,
+for as far as it can be before more of it has to be
+read. Returns the result of the last run. */
+static VM_Error run_streaming(LexerStream* stream, uint64_t fuel) {
+    OutputSink out = output_sink_stdout();
+    VM vm = vm_init(NULL, 0);
+    vm.output = &out;
+    VM_Budget budget = {.fuel = fuel};
+    VM_Error result = {.type = NONE};
+    bool more = true;
+    while (more && result.type == NONE) {
+        more = lexer_stream_next(stream);
+        // Both can move whenever the stream grows
+        vm.labels = stream->lexed.labels;
+        vm.num_labels = stream->lexed.num_labels;
+        result = vm_run_budget(&vm, stream->lexed.instrs, stream->num_runnable, &budget);
+    }
+    output_free(&out);
+    return result;
+}
 
-    return string;
+static void print_usage() {
+    printf("Usage: strvm [-e interp|decoded|jit] [-O[level]] [-v] [-V] [-p] [-f <fuel>] [-c <output>] [-C <output.c>]\n");
+    printf("             [-s <snapshot> [-a <label>]] [-r <snapshot>] [-l <log> [-x <count>]] <file | ->\n");
+    printf("       strvm -m <manifest> [-t <threads> | -g]\n");
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    Engine engine = ENGINE_INTERP;
+    const char* filename = NULL;
+    const char* output_filename = NULL;
+    const char* c_filename = NULL;
+    const char* manifest_filename = NULL;
+    const char* snapshot_filename = NULL;
+    const char* restore_filename = NULL;
+    const char* stop_label = NULL;
+    const char* log_filename = NULL;
+    const char* replay_count = NULL;
+    int num_threads = 0;
+    int opt_level = 0;
+    bool verbose = false;
+    bool verify = false;
+    bool profile = false;
+    bool green = false;
+    uint64_t fuel = VM_UNLIMITED_FUEL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+            i++;
+            if (!strcmp(argv[i], "interp"))
+                engine = ENGINE_INTERP;
+            else if (!strcmp(argv[i], "decoded"))
+                engine = ENGINE_DECODED;
+            else if (!strcmp(argv[i], "jit"))
+                engine = ENGINE_JIT;
+            else {
+                printf("Error: unknown engine \"%s\"\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+            output_filename = argv[++i];
+        else if (!strcmp(argv[i], "-C") && i + 1 < argc)
+            c_filename = argv[++i];
+        else if (!strncmp(argv[i], "-O", 2)) {
+            opt_level = argv[i][2] ? atoi(argv[i] + 2) : OPTIMIZER_MAX_LEVEL;
+            if (opt_level > OPTIMIZER_MAX_LEVEL)
+                opt_level = OPTIMIZER_MAX_LEVEL;
+        }
+        else if (!strcmp(argv[i], "-v"))
+            verbose = true;
+        else if (!strcmp(argv[i], "-V"))
+            verify = true;
+        else if (!strcmp(argv[i], "-p"))
+            profile = true;
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+            fuel = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            snapshot_filename = argv[++i];
+        else if (!strcmp(argv[i], "-a") && i + 1 < argc)
+            stop_label = argv[++i];
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            restore_filename = argv[++i];
+        else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+            log_filename = argv[++i];
+        else if (!strcmp(argv[i], "-x") && i + 1 < argc)
+            replay_count = argv[++i];
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+            manifest_filename = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            num_threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-g"))
+            green = true;
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            print_usage();
+            return 1;
+        }
+        else
+            filename = argv[i];
+    }
+
+    if (manifest_filename != NULL)
+        return runner_run_manifest(manifest_filename,
+                                   num_threads > 0 ? num_threads : runner_default_threads(), green);
+
+    if (filename == NULL) {
         printf("Error: no source files provided\n");
         return 1;
     }
 
-    str src = read_file_to_str(argv[1]);
-    LexerState lexed = lexer_lex(src);
-    if (lexed.had_error) {
-        printf("Error: file \"%s\" couldn't be parsed\n", argv[1]);
+    // Bytecode images are run straight out of the mapping, and "-" is source on stdin
+    bool from_stdin = !strcmp(filename, "-");
+    BytecodeImage image = {.error = BYTECODE_NOT_AN_IMAGE};
+    if (!from_stdin)
+        image = bytecode_load(filename);
+    if (image.error != BYTECODE_OK && image.error != BYTECODE_NOT_AN_IMAGE) {
+        printf("Error: file \"%s\" %s\n", filename, bytecode_error_string(image.error));
         return 1;
     }
 
-    VM vm = vm_init(lexed.labels, lexed.num_labels);
-    VM_Error vm_result = vm_run(&vm, lexed.instrs, lexed.cur_instr + 1);
-    if (vm_result.type != NONE && vm_result.type != HALT) {
-        switch (vm_result.type) {
-            case INVALID_INSTRUCTION:
-                printf("Error: invalid instruction\n");
-                break;
-            case INVALID_OPERAND:
-                printf("Error: invalid operand\n");
-                break;
-            default:
-                printf("Error: an unknown error occurred\n");
+    Instruction* instrs = NULL;
+    int num_instrs = 0;
+    Label* labels = NULL;
+    int num_labels = 0;
+    DecodedProgram program = {0};
+    LexerState lexed = {0};
+    str src = {0};
+
+    if (image.error == BYTECODE_OK) {
+        if (output_filename != NULL) {
+            printf("Error: file \"%s\" is already assembled\n", filename);
+            return 1;
+        }
+        instrs = image.instrs;
+        num_instrs = image.header->num_instrs;
+        num_labels = image.header->num_labels;
+        labels = bytecode_labels(&image);
+        program = image.decoded;
+    }
+    // Plain runs on the interpreter start before the rest of the program has even been read
+    else if (engine == ENGINE_INTERP && opt_level == 0 && !profile && !verify && output_filename == NULL
+             && c_filename == NULL && snapshot_filename == NULL && restore_filename == NULL
+             && log_filename == NULL) {
+        int fd = from_stdin ? 0 : open(filename, O_RDONLY);
+        if (fd < 0) {
+            printf("Error: file \"%s\" couldn't be read\n", filename);
+            return 1;
+        }
+        LexerStream stream = lexer_stream_open(fd);
+        VM_Error vm_result = run_streaming(&stream, fuel);
+        lexer_stream_close(&stream);
+        if (stream.lexed.had_error) {
+            printf("Error: file \"%s\" couldn't be %s\n", filename,
+                   stream.read_failed ? "read" : "parsed");
+            return 1;
+        }
+        lexer_free(&stream.lexed);
+        if (vm_result.type != NONE && vm_result.type != HALT) {
+            print_vm_error(vm_result);
+            return 1;
+        }
+        return 0;
+    }
+    // Anything else needs the whole program first, which stdin can only be read a block at a time for
+    else if (from_stdin) {
+        LexerStream stream = lexer_stream_open(0);
+        while (lexer_stream_next(&stream)) {}
+        lexer_stream_close(&stream);
+        lexed = stream.lexed;
+        if (stream.read_failed) {
+            printf("Error: file \"%s\" couldn't be read\n", filename);
+            return 1;
+        }
+    }
+    else {
+        src = read_file_to_str(filename);
+        lexed = lexer_lex_parallel(src, runner_default_threads());
+    }
+
+    if (image.error != BYTECODE_OK) {
+        if (lexed.had_error) {
+            printf("Error: file \"%s\" couldn't be parsed\n", filename);
+            return 1;
+        }
+        instrs = lexed.instrs;
+        num_instrs = lexed.cur_instr + 1;
+        labels = lexed.labels;
+        num_labels = lexed.num_labels;
+
+        OptimizerStats stats = optimizer_run(instrs, &num_instrs, labels, num_labels, opt_level);
+        if (verbose && opt_level > 0) {
+            fprintf(stderr, "%s: %d instructions, %d after optimizing\n",
+                    filename, stats.instrs_before, stats.instrs_after);
+        }
+    }
+
+    // Programs that fail aren't run, or assembled, at all
+    bool verified = false;
+    if (verify) {
+        VerifyResult result = verifier_verify(instrs, num_instrs, labels, num_labels);
+        // Optimized programs no longer line up with their source
+        const int* lines = image.error != BYTECODE_OK && opt_level == 0 ? lexed.lines : NULL;
+        verifier_report(stderr, &result, filename, lines, labels, num_labels);
+        verified = result.verified;
+        verifier_free(&result);
+        if (!verified) {
+            printf("Error: file \"%s\" failed verification\n", filename);
+            return 1;
+        }
+    }
+
+    if (image.error != BYTECODE_OK) {
+        if (output_filename != NULL) {
+            BytecodeError error = bytecode_write(output_filename, instrs, num_instrs,
+                                                 labels, num_labels);
+            if (error != BYTECODE_OK) {
+                printf("Error: file \"%s\" %s\n", output_filename, bytecode_error_string(error));
+                return 1;
+            }
+            return 0;
+        }
+
+        if (engine != ENGINE_INTERP || c_filename != NULL || log_filename != NULL)
+            program = decoder_decode(instrs, num_instrs, labels, num_labels);
+    }
+
+    if (c_filename != NULL) {
+        if (!aot_write_c(c_filename, &program, filename)) {
+            printf("Error: couldn't write \"%s\"\n", c_filename);
+            return 1;
+        }
+        return 0;
+    }
+
+    OutputSink out = output_sink_stdout();
+    VM vm = vm_init(labels, num_labels);
+    vm.output = &out;
+    VM_Error vm_result;
+
+    uint32_t program_id = 0;
+    if (snapshot_filename != NULL || restore_filename != NULL || log_filename != NULL)
+        program_id = snapshot_program_id(instrs, num_instrs, labels, num_labels);
+    if (restore_filename != NULL) {
+        Snapshot snapshot;
+        SnapshotError error = snapshot_read(restore_filename, &snapshot);
+        if (error == SNAPSHOT_OK)
+            error = snapshot_restore(&vm, &snapshot, program_id);
+        snapshot_free(&snapshot);
+        if (error != SNAPSHOT_OK) {
+            printf("Error: snapshot \"%s\" %s\n", restore_filename, snapshot_error_string(error));
+            return 1;
+        }
+    }
+
+    // Replaying starts from the log, which already has whatever a snapshot restored
+    if (log_filename != NULL && replay_count != NULL) {
+        Recording recording;
+        RecorderError error = recorder_read(log_filename, &recording, program_id);
+        if (error == RECORDER_OK) {
+            error = recorder_replay(&recording, &vm, instrs, num_instrs,
+                                    strtoul(replay_count, NULL, 10));
+            recorder_free(&recording);
+        }
+        output_free(&out);
+        if (error != RECORDER_OK) {
+            printf("Error: log \"%s\" %s\n", log_filename, recorder_error_string(error));
+            return 1;
         }
+        vm_print_state(vm);
+        return 0;
+    }
+
+    if (snapshot_filename != NULL) {
+        // Prologues only run once, so the interpreter is as good as anything
+        uint32_t stop_at = UINT32_MAX;
+        if (stop_label != NULL) {
+            int label = find_label(labels, num_labels, stop_label);
+            if (label == -1) {
+                printf("Error: no label called \"%s\"\n", stop_label);
+                return 1;
+            }
+            stop_at = labels[label].address;
+        }
+        vm_result = vm_run_until(&vm, instrs, num_instrs, stop_at);
+        output_free(&out);
+        if (vm_result.type != NONE && vm_result.type != HALT) {
+            print_vm_error(vm_result);
+            return 1;
+        }
+        if (stop_label != NULL && vm_result.type == HALT) {
+            printf("Error: the program stopped before reaching \"%s\"\n", stop_label);
+            return 1;
+        }
+
+        Snapshot snapshot = snapshot_take(&vm, program_id);
+        SnapshotError error = snapshot_write(snapshot_filename, &snapshot);
+        snapshot_free(&snapshot);
+        if (error != SNAPSHOT_OK) {
+            printf("Error: snapshot \"%s\" %s\n", snapshot_filename, snapshot_error_string(error));
+            return 1;
+        }
+        return 0;
+    }
+
+    if (profile) {
+        // Optimized programs no longer line up with their source
+        ProfileSource source = {.instrs = instrs, .num_instrs = num_instrs,
+                                .labels = labels, .num_labels = num_labels};
+        if (src.data != NULL && opt_level == 0) {
+            source.lines = lexed.lines;
+            source.src = src;
+        }
+        Profile result = profiler_create(num_instrs);
+        vm_result = vm_run_profiled(&vm, instrs, num_instrs, &result);
+        profiler_report(stderr, &result, source);
+        profiler_free(&result);
+    }
+    // The log is written however the run ends, since failed runs are what it's for
+    else if (log_filename != NULL) {
+        Recording recording = recorder_create(&vm, RECORDER_DEFAULT_CAPACITY,
+                                              RECORDER_DEFAULT_INTERVAL);
+        vm_result = vm_run_recorded(&vm, &program, &recording);
+        RecorderError error = recorder_write(log_filename, &recording, program_id);
+        if (verbose) {
+            fprintf(stderr, "%s: instructions %u to %u recorded, %llu bytes of log kept, %llu checkpoints\n",
+                    filename, recorder_first_pc(&recording), recording.end_pc,
+                    (unsigned long long)(recording.end - recording.start),
+                    (unsigned long long)recording.num_checkpoints);
+        }
+        recorder_free(&recording);
+        if (error != RECORDER_OK) {
+            output_free(&out);
+            printf("Error: log \"%s\" %s\n", log_filename, recorder_error_string(error));
+            return 1;
+        }
+    }
+    // Compiled code can't stop partway, so limited runs fall back to the decoded engine
+    else if (engine == ENGINE_JIT && fuel == VM_UNLIMITED_FUEL) {
+        JitProgram jit = jit_compile(&program);
+        vm_result = vm_run_jit(&vm, &jit);
+        jit_free(&jit);
+    }
+    else if (engine != ENGINE_INTERP)
+        vm_result = vm_run_decoded_budget(&vm, &program, &(VM_Budget){.fuel = fuel});
+    else if (verified)
+        vm_result = vm_run_verified(&vm, instrs, num_instrs, &(VM_Budget){.fuel = fuel});
+    else
+        vm_result = vm_run_budget(&vm, instrs, num_instrs, &(VM_Budget){.fuel = fuel});
+    output_free(&out);
+
+    if (vm_result.type != NONE && vm_result.type != HALT) {
+        print_vm_error(vm_result);
         return 1;
     }
 
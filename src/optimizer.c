@@ -0,0 +1,616 @@
+/* The optimizer. Instructions are decoded first, so
+that every pass deals with specialized instructions
+whose operands have already been checked, and whatever
+is left at the end is encoded back into Instructions.
+Instructions that would trap are left exactly as they
+were.
+
+Nothing moves until the very end: removed instructions
+are only marked as such, so indices and label addresses
+stay valid throughout, and jumps to a removed instruction
+go to the next one that's still there. The passes run
+over and over until none of them can find anything else
+to do, since each one tends to open things up for the
+others. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "decoder.h"
+#include "optimizer.h"
+
+#define MAX_ROUNDS 16
+
+typedef struct {
+    DecodedInstruction op;
+    Instruction original; // What traps get encoded back as
+    int label;            // The label that a jump goes to
+    bool removed;
+    bool has_result;      // Arithmetic whose result is always `result`
+    uint8_t result;
+} Node;
+
+typedef struct {
+    Node* nodes;
+    int num_nodes;
+    Label* labels;
+    int num_labels;
+    bool changed;
+} Optimizer;
+
+// Bits 0-7 are the general purpose registers
+typedef uint16_t LiveSet;
+#define LIVE_NOT_ZERO (1 << 8)
+#define LIVE_CARRY    (1 << 9)
+#define LIVE_OVERFLOW (1 << 10)
+#define LIVE_COMPARE  (1 << 11)
+
+typedef struct {
+    uint8_t known; // Bit i is set if r<i> is known
+    uint8_t values[NUM_GP_REGISTERS];
+    int not_zero;  // -1 if unknown
+    bool compare_known;
+    uint8_t compare_a;
+    uint8_t compare_b;
+} Constants;
+
+static bool is_jump(uint8_t type) {
+    return type >= OP_JMP_ABS && type <= OP_JZ_ABS;
+}
+
+static bool falls_through(uint8_t type) {
+    return type != OP_JMP_ABS && type != OP_HLT && type != OP_TRAP;
+}
+
+static bool ends_block(uint8_t type) {
+    return is_jump(type) || type == OP_HLT || type == OP_TRAP;
+}
+
+static void remove_node(Optimizer* o, Node* node) {
+    node->removed = true;
+    o->changed = true;
+}
+
+static int next_live(const Optimizer* o, int i) {
+    while (i < o->num_nodes && o->nodes[i].removed)
+        i++;
+    return i;
+}
+
+// Where a jump ends up, skipping anything that's been removed
+static int jump_target(const Optimizer* o, const Node* node) {
+    int address = node->label < o->num_labels ? o->labels[node->label].address : 0;
+    return next_live(o, address < o->num_nodes ? address : o->num_nodes);
+}
+
+static bool* find_leaders(const Optimizer* o) {
+    bool* leaders = calloc(o->num_nodes + 1, sizeof(bool));
+    leaders[next_live(o, 0)] = true;
+    for (int i = 0; i < o->num_nodes; i++) {
+        const Node* node = &o->nodes[i];
+        if (node->removed || !ends_block(node->op.type))
+            continue;
+        leaders[next_live(o, i + 1)] = true;
+        if (is_jump(node->op.type))
+            leaders[jump_target(o, node)] = true;
+    }
+    return leaders;
+}
+
+static void remove_unreachable(Optimizer* o) {
+    int n = o->num_nodes;
+    bool* reached = calloc(n + 1, sizeof(bool));
+    // Every instruction goes on the stack at most twice
+    int* stack = malloc(sizeof(int) * (2 * n + 1));
+    int top = 0;
+
+    stack[top++] = next_live(o, 0);
+    while (top > 0) {
+        int i = stack[--top];
+        if (i == n || reached[i])
+            continue;
+        reached[i] = true;
+        const Node* node = &o->nodes[i];
+        if (falls_through(node->op.type))
+            stack[top++] = next_live(o, i + 1);
+        if (is_jump(node->op.type))
+            stack[top++] = jump_target(o, node);
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!o->nodes[i].removed && !reached[i])
+            remove_node(o, &o->nodes[i]);
+    }
+    free(reached);
+    free(stack);
+}
+
+/* Points jumps to jmps at wherever the jmp goes, and
+removes jumps that go where execution would anyway */
+static void thread_jumps(Optimizer* o) {
+    for (int i = 0; i < o->num_nodes; i++) {
+        Node* node = &o->nodes[i];
+        if (node->removed || !is_jump(node->op.type))
+            continue;
+
+        // Bounded, since jmps can go round in circles
+        for (int hops = 0; hops < o->num_nodes; hops++) {
+            int target = jump_target(o, node);
+            if (target == o->num_nodes || target == i)
+                break;
+            const Node* next = &o->nodes[target];
+            if (next->op.type != OP_JMP_ABS || next->label == node->label)
+                break;
+            node->label = next->label;
+            o->changed = true;
+        }
+
+        if (jump_target(o, node) == next_live(o, i + 1))
+            remove_node(o, node);
+    }
+}
+
+static bool is_known(const Constants* c, uint8_t reg) {
+    return c->known & (1 << reg);
+}
+
+static void set_known(Constants* c, uint8_t reg, uint8_t value) {
+    c->known |= 1 << reg;
+    c->values[reg] = value;
+}
+
+static void forget(Constants* c, uint8_t reg) {
+    c->known &= ~(1 << reg);
+}
+
+// Wide instructions aren't tracked, so whatever they might change is no longer known
+static void forget_wide(Constants* c, const DecodedInstruction* op) {
+    if (op->type >= OP_WIDE_CMP_REG_REG)
+        c->compare_known = false;
+    else if (op->type < OP_WIDE_STR_REG_REG) {
+        for (int i = 0; i < 1 << op->width; i++)
+            forget(c, op->a + i);
+        if (op->type < OP_WIDE_LD_REG_REG && decoded_wide_arith(op->type) != MOV)
+            c->not_zero = -1;
+    }
+}
+
+/* Turns register operands whose value is known into
+immediates, relying on REG variants always coming
+right before IMM ones, and REG_x before IMM_x */
+static void substitute(Optimizer* o, DecodedInstruction* op, const Constants* c) {
+    switch ((DecodedType)op->type) {
+        case OP_MOV_REG_REG: case OP_ADD_REG_REG: case OP_ADC_REG_REG: case OP_SBC_REG_REG:
+        case OP_SUB_REG_REG: case OP_MUL_REG_REG: case OP_DIV_REG_REG: case OP_SHL_REG_REG:
+        case OP_SHR_REG_REG:
+        case OP_LD_REG_REG: case OP_STR_REG_REG: case OP_STR_IMM_REG:
+        case OP_CMP_REG_REG: case OP_CMP_IMM_REG:
+            if (is_known(c, op->b)) {
+                op->type++;
+                op->b = c->values[op->b];
+                o->changed = true;
+            }
+            break;
+        default:
+            break;
+    }
+    switch ((DecodedType)op->type) {
+        case OP_STR_REG_REG: case OP_STR_REG_IMM: case OP_CMP_REG_REG: case OP_CMP_REG_IMM:
+            if (is_known(c, op->a)) {
+                op->type += 2;
+                op->a = c->values[op->a];
+                o->changed = true;
+            }
+            break;
+        case OP_PTC_REG: case OP_PTN_REG: case OP_PTU_REG:
+            if (is_known(c, op->a)) {
+                op->type++;
+                op->a = c->values[op->a];
+                o->changed = true;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Works out the result of arithmetic on two constants,
+where it's well defined. Division by zero is left to
+happen at runtime, and so are shifts big enough to be
+undefined in C. */
+static bool fold(uint8_t type, uint8_t a, uint8_t b, uint8_t* result) {
+    switch (type) {
+        case OP_ADD_REG_IMM: *result = a + b; return true;
+        case OP_SUB_REG_IMM: *result = a - b; return true;
+        case OP_MUL_REG_IMM: *result = a * b; return true;
+        case OP_DIV_REG_IMM: *result = b ? a / b : 0; return b != 0;
+        case OP_SHL_REG_IMM: *result = b < 32 ? a << b : 0; return b < 32;
+        case OP_SHR_REG_IMM: *result = b < 32 ? a >> b : 0; return b < 32;
+        default: return false;
+    }
+}
+
+// Whether a conditional jump is taken, or -1 if that isn't known
+static int jump_taken(uint8_t type, const Constants* c) {
+    if (type == OP_JNZ_ABS || type == OP_JZ_ABS) {
+        if (c->not_zero == -1)
+            return -1;
+        return type == OP_JNZ_ABS ? c->not_zero : !c->not_zero;
+    }
+    if (!c->compare_known)
+        return -1;
+    uint8_t a = c->compare_a;
+    uint8_t b = c->compare_b;
+    switch (type) {
+        case OP_JNE_ABS: return a != b;
+        case OP_JE_ABS:  return a == b;
+        case OP_JGT_ABS: return a > b;
+        default:         return a < b;
+    }
+}
+
+/* Tracks which registers and flags hold constants
+through each basic block, starting from nothing known
+at the top of every block */
+static void propagate_constants(Optimizer* o) {
+    bool* leaders = find_leaders(o);
+    Constants c = {.not_zero = -1};
+
+    for (int i = 0; i < o->num_nodes; i++) {
+        Node* node = &o->nodes[i];
+        if (node->removed)
+            continue;
+        if (leaders[i])
+            c = (Constants){.not_zero = -1};
+        node->has_result = false;
+
+        DecodedInstruction* op = &node->op;
+        substitute(o, op, &c);
+        switch ((DecodedType)op->type) {
+            case OP_NOP:
+                remove_node(o, node);
+                break;
+
+            case OP_MOV_REG_IMM:
+                if (is_known(&c, op->a) && c.values[op->a] == op->b)
+                    remove_node(o, node);
+                else
+                    set_known(&c, op->a, op->b);
+                break;
+
+            case OP_ADD_REG_IMM: case OP_SUB_REG_IMM: case OP_MUL_REG_IMM:
+            case OP_DIV_REG_IMM: case OP_SHL_REG_IMM: case OP_SHR_REG_IMM: {
+                uint8_t result;
+                if (is_known(&c, op->a) && fold(op->type, c.values[op->a], op->b, &result)) {
+                    node->has_result = true;
+                    node->result = result;
+                    set_known(&c, op->a, result);
+                    c.not_zero = result != 0;
+                }
+                else {
+                    forget(&c, op->a);
+                    c.not_zero = -1;
+                }
+                break;
+            }
+
+            case OP_MOV_REG_REG: case OP_LD_REG_REG: case OP_LD_REG_IMM:
+            case OP_RCV_REG_REG: case OP_RCV_REG_IMM:
+                forget(&c, op->a);
+                break;
+
+            case OP_ADD_REG_REG: case OP_SUB_REG_REG: case OP_MUL_REG_REG: case OP_DIV_REG_REG:
+            case OP_SHL_REG_REG: case OP_SHR_REG_REG: case OP_ADC_REG_REG: case OP_ADC_REG_IMM:
+            case OP_SBC_REG_REG: case OP_SBC_REG_IMM:
+                forget(&c, op->a);
+                c.not_zero = -1;
+                break;
+
+            case OP_NEG_REG:
+                if (is_known(&c, op->a))
+                    c.values[op->a] = -c.values[op->a];
+                break;
+
+            case OP_CMP_IMM_IMM:
+                c.compare_known = true;
+                c.compare_a = op->a;
+                c.compare_b = op->b;
+                break;
+            case OP_CMP_REG_REG: case OP_CMP_REG_IMM: case OP_CMP_IMM_REG:
+                c.compare_known = false;
+                break;
+
+            case OP_JNE_ABS: case OP_JE_ABS: case OP_JGT_ABS: case OP_JLT_ABS:
+            case OP_JNZ_ABS: case OP_JZ_ABS: {
+                int taken = jump_taken(op->type, &c);
+                if (taken == 1) {
+                    op->type = OP_JMP_ABS;
+                    o->changed = true;
+                }
+                else if (taken == 0)
+                    remove_node(o, node);
+                break;
+            }
+
+            // The other bulk instructions only touch memory, which isn't tracked
+            case OP_MCMP:
+                c.compare_known = false;
+                break;
+
+            default:
+                if (decoded_is_wide(op->type))
+                    forget_wide(&c, op);
+                break;
+        }
+    }
+    free(leaders);
+}
+
+static LiveSet reg_bit(uint8_t reg) {
+    return 1 << reg;
+}
+
+/* What an instruction reads, what it always overwrites,
+and everything it might write. Anything else it does
+that can be seen (output, jumps, stopping, dividing by
+zero) counts as a side effect, and keeps it around. */
+static void effects(const DecodedInstruction* op, LiveSet* uses, LiveSet* kills,
+                    LiveSet* writes, bool* side_effects) {
+    *uses = *kills = 0;
+    *side_effects = false;
+    switch ((DecodedType)op->type) {
+        case OP_MOV_REG_REG: case OP_LD_REG_REG:
+            *uses = reg_bit(op->b);
+            *kills = reg_bit(op->a);
+            break;
+        case OP_MOV_REG_IMM: case OP_LD_REG_IMM:
+            *kills = reg_bit(op->a);
+            break;
+
+        case OP_DIV_REG_REG:
+            *side_effects = true;
+            // Fallthrough
+        case OP_ADD_REG_REG: case OP_SUB_REG_REG: case OP_MUL_REG_REG:
+        case OP_SHL_REG_REG: case OP_SHR_REG_REG:
+            *uses = reg_bit(op->a) | reg_bit(op->b);
+            *kills = reg_bit(op->a) | LIVE_NOT_ZERO;
+            break;
+        case OP_DIV_REG_IMM:
+            *side_effects = op->b == 0;
+            // Fallthrough
+        case OP_ADD_REG_IMM: case OP_SUB_REG_IMM: case OP_MUL_REG_IMM:
+        case OP_SHL_REG_IMM: case OP_SHR_REG_IMM:
+            *uses = reg_bit(op->a);
+            *kills = reg_bit(op->a) | LIVE_NOT_ZERO;
+            break;
+
+        // Reads carry in, then always overwrites both carry and overflow
+        case OP_ADC_REG_REG: case OP_ADC_REG_IMM: case OP_SBC_REG_REG: case OP_SBC_REG_IMM:
+            *uses = reg_bit(op->a) | LIVE_CARRY;
+            if (op->type == OP_ADC_REG_REG || op->type == OP_SBC_REG_REG)
+                *uses |= reg_bit(op->b);
+            *kills = reg_bit(op->a) | LIVE_NOT_ZERO | LIVE_CARRY | LIVE_OVERFLOW;
+            break;
+
+        case OP_CLC: *kills = LIVE_CARRY; break;
+        case OP_CLV: *kills = LIVE_OVERFLOW; break;
+
+        case OP_NEG_REG:
+            *uses = *kills = reg_bit(op->a);
+            break;
+
+        case OP_STR_REG_REG: *uses = reg_bit(op->a) | reg_bit(op->b); *side_effects = true; break;
+        case OP_STR_REG_IMM: *uses = reg_bit(op->a); *side_effects = true; break;
+        case OP_STR_IMM_REG: *uses = reg_bit(op->b); *side_effects = true; break;
+        case OP_STR_IMM_IMM: *side_effects = true; break;
+
+        case OP_CMP_REG_REG: *uses = reg_bit(op->a) | reg_bit(op->b); *kills = LIVE_COMPARE; break;
+        case OP_CMP_REG_IMM: *uses = reg_bit(op->a); *kills = LIVE_COMPARE; break;
+        case OP_CMP_IMM_REG: *uses = reg_bit(op->b); *kills = LIVE_COMPARE; break;
+        case OP_CMP_IMM_IMM: *kills = LIVE_COMPARE; break;
+
+        case OP_JNE_ABS: case OP_JE_ABS: case OP_JGT_ABS: case OP_JLT_ABS:
+            *uses = LIVE_COMPARE;
+            *side_effects = true;
+            break;
+        case OP_JNZ_ABS: case OP_JZ_ABS:
+            *uses = LIVE_NOT_ZERO;
+            *side_effects = true;
+            break;
+
+        case OP_PTC_REG: case OP_PTN_REG: case OP_PTU_REG:
+            *uses = reg_bit(op->a);
+            *side_effects = true;
+            break;
+
+        // Other VMs can see what's sent, and receiving can block
+        case OP_SND_REG_REG: *uses = reg_bit(op->a) | reg_bit(op->b); *side_effects = true; break;
+        case OP_SND_REG_IMM: *uses = reg_bit(op->a); *side_effects = true; break;
+        case OP_SND_IMM_REG: *uses = reg_bit(op->b); *side_effects = true; break;
+        case OP_SND_IMM_IMM: *side_effects = true; break;
+        case OP_RCV_REG_REG: case OP_RCV_REG_IMM:
+            if (op->type == OP_RCV_REG_REG)
+                *uses = reg_bit(op->b);
+            *kills = reg_bit(op->a);
+            *side_effects = true;
+            break;
+
+        case OP_NOP:
+            break;
+        // Wide and bulk instructions are always kept, and might read any register
+        default:
+            if (decoded_is_wide(op->type) || decoded_is_bulk(op->type))
+                *uses = 0xFF;
+            *side_effects = true;
+            break;
+    }
+    *writes = *kills;
+}
+
+/* Works out what's live after every instruction, then
+removes the ones whose every write is dead, and turns
+arithmetic on constants into moves where its flag is */
+static void remove_dead(Optimizer* o) {
+    int n = o->num_nodes;
+    // Nothing is live after the program stops, since only its output can be seen
+    LiveSet* live_in = calloc(n + 1, sizeof(LiveSet));
+    LiveSet* live_out = calloc(n + 1, sizeof(LiveSet));
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = n - 1; i >= 0; i--) {
+            const Node* node = &o->nodes[i];
+            if (node->removed)
+                continue;
+            LiveSet out = 0;
+            if (falls_through(node->op.type))
+                out |= live_in[next_live(o, i + 1)];
+            if (is_jump(node->op.type))
+                out |= live_in[jump_target(o, node)];
+
+            LiveSet uses, kills, writes;
+            bool side_effects;
+            effects(&node->op, &uses, &kills, &writes, &side_effects);
+            LiveSet in = uses | (out & ~kills);
+            if (in != live_in[i] || out != live_out[i]) {
+                live_in[i] = in;
+                live_out[i] = out;
+                changed = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        Node* node = &o->nodes[i];
+        if (node->removed)
+            continue;
+        LiveSet uses, kills, writes;
+        bool side_effects;
+        effects(&node->op, &uses, &kills, &writes, &side_effects);
+        if (!side_effects && !(live_out[i] & writes))
+            remove_node(o, node);
+        else if (node->has_result && !(live_out[i] & LIVE_NOT_ZERO)) {
+            node->op = (DecodedInstruction){.type = OP_MOV_REG_IMM, .a = node->op.a,
+                                            .b = node->result};
+            node->has_result = false;
+            o->changed = true;
+        }
+    }
+    free(live_in);
+    free(live_out);
+}
+
+static Operand reg_operand(uint8_t value) {
+    return (Operand){.is_register = true, .value = value};
+}
+
+static Operand imm_operand(uint8_t value) {
+    return (Operand){.value = value};
+}
+
+static Operand value_operand(bool is_reg, uint8_t value) {
+    return is_reg ? reg_operand(value) : imm_operand(value);
+}
+
+// The REG (or REG_REG) variant of each family of decoded instructions
+static const struct {
+    DecodedType first;
+    InstructionType type;
+} FAMILIES[] = {
+    {OP_MOV_REG_REG, MOV}, {OP_ADD_REG_REG, ADD}, {OP_ADC_REG_REG, ADC},
+    {OP_SBC_REG_REG, SBC}, {OP_SUB_REG_REG, SUB}, {OP_MUL_REG_REG, MUL}, {OP_DIV_REG_REG, DIV},
+    {OP_SHL_REG_REG, SHL}, {OP_SHR_REG_REG, SHR}, {OP_LD_REG_REG, LD},
+};
+
+static Instruction encode(const Node* node) {
+    const DecodedInstruction* op = &node->op;
+    uint8_t type = op->type;
+
+    for (size_t i = 0; i < sizeof(FAMILIES) / sizeof(FAMILIES[0]); i++) {
+        if (type == FAMILIES[i].first || type == FAMILIES[i].first + 1) {
+            return (Instruction){.type = FAMILIES[i].type,
+                                 .operands = {reg_operand(op->a),
+                                              value_operand(type == FAMILIES[i].first, op->b)}};
+        }
+    }
+    if (is_jump(type)) {
+        return (Instruction){.type = JMP + (type - OP_JMP_ABS),
+                             .operands = {{.is_label = true, .value = node->label}}};
+    }
+
+    switch ((DecodedType)type) {
+        case OP_NOP: return (Instruction){.type = NOP};
+        case OP_CLC: return (Instruction){.type = CLC};
+        case OP_CLV: return (Instruction){.type = CLV};
+        case OP_HLT: return (Instruction){.type = HLT};
+        case OP_NEG_REG:
+            return (Instruction){.type = NEG, .operands = {reg_operand(op->a)}};
+        case OP_STR_REG_REG: case OP_STR_REG_IMM: case OP_STR_IMM_REG: case OP_STR_IMM_IMM: {
+            int variant = type - OP_STR_REG_REG;
+            return (Instruction){.type = STR, .operands = {value_operand(variant < 2, op->a),
+                                                           value_operand(variant % 2 == 0, op->b)}};
+        }
+        case OP_CMP_REG_REG: case OP_CMP_REG_IMM: case OP_CMP_IMM_REG: case OP_CMP_IMM_IMM: {
+            int variant = type - OP_CMP_REG_REG;
+            return (Instruction){.type = CMP, .operands = {value_operand(variant < 2, op->a),
+                                                           value_operand(variant % 2 == 0, op->b)}};
+        }
+        case OP_PTC_REG: case OP_PTC_IMM:
+            return (Instruction){.type = PTC, .operands = {value_operand(type == OP_PTC_REG, op->a)}};
+        case OP_PTN_REG: case OP_PTN_IMM:
+            return (Instruction){.type = PTN, .operands = {value_operand(type == OP_PTN_REG, op->a)}};
+        case OP_PTU_REG: case OP_PTU_IMM:
+            return (Instruction){.type = PTU, .operands = {value_operand(type == OP_PTU_REG, op->a)}};
+        default:
+            return node->original;
+    }
+}
+
+OptimizerStats optimizer_run(Instruction instrs[], int* num_instrs,
+                             Label labels[], int num_labels, int level) {
+    int n = *num_instrs;
+    OptimizerStats stats = {.instrs_before = n, .instrs_after = n};
+    if (level <= 0 || n == 0)
+        return stats;
+
+    DecodedProgram decoded = decoder_decode(instrs, n, labels, num_labels);
+    Optimizer o = {.nodes = calloc(n, sizeof(Node)), .num_nodes = n,
+                   .labels = labels, .num_labels = num_labels};
+    for (int i = 0; i < n; i++) {
+        o.nodes[i].op = decoded.instrs[i];
+        o.nodes[i].original = instrs[i];
+        o.nodes[i].label = instrs[i].operands[0].value;
+    }
+    decoder_free(&decoded);
+
+    o.changed = true;
+    for (int round = 0; round < MAX_ROUNDS && o.changed; round++) {
+        o.changed = false;
+        remove_unreachable(&o);
+        thread_jumps(&o);
+        propagate_constants(&o);
+        if (level >= 2)
+            remove_dead(&o);
+    }
+
+    // Removed instructions' indices go to whatever comes after them
+    int* new_index = malloc(sizeof(int) * (n + 1));
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        new_index[i] = count;
+        if (!o.nodes[i].removed)
+            instrs[count++] = encode(&o.nodes[i]);
+    }
+    new_index[n] = count;
+    for (int i = 0; i < num_labels; i++)
+        labels[i].address = new_index[labels[i].address < (uint32_t)n ? (int)labels[i].address : n];
+
+    free(new_index);
+    free(o.nodes);
+    *num_instrs = count;
+    stats.instrs_after = count;
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#if defined(_WIN32)
+#include <io.h>
+#define write _write
+#else
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "output.h"
+
+OutputSink output_sink_buffer(char* data, size_t capacity) {
+    return (OutputSink){.type = SINK_BUFFER, .data = data, .capacity = capacity};
+}
+
+OutputSink output_sink_arena() {
+    return (OutputSink){.type = SINK_ARENA};
+}
+
+OutputSink output_sink_fd(int fd) {
+    return (OutputSink){.type = SINK_FD, .fd = fd,
+                        .data = malloc(OUTPUT_FD_BUFFER_SIZE),
+                        .capacity = OUTPUT_FD_BUFFER_SIZE};
+}
+
+OutputSink output_sink_callback(OutputCallback callback, void* user_data) {
+    return (OutputSink){.type = SINK_CALLBACK, .callback = callback, .user_data = user_data,
+                        .data = malloc(OUTPUT_FD_BUFFER_SIZE),
+                        .capacity = OUTPUT_FD_BUFFER_SIZE};
+}
+
+/* Flushes stdio's stdout first, so whatever was
+printf()ed before the sink was created comes out
+before anything written to it */
+OutputSink output_sink_stdout() {
+    fflush(stdout);
+    return output_sink_fd(1);
+}
+
+// Has no buffer, so every write goes straight to output_write()
+OutputSink output_sink_discard() {
+    return (OutputSink){.type = SINK_DISCARD};
+}
+
+static void write_all(OutputSink* sink, const char* data, size_t len) {
+    if (sink->type == SINK_CALLBACK) {
+        sink->callback(sink->user_data, data, len);
+        return;
+    }
+    while (len > 0 && !sink->failed) {
+        long written = write(sink->fd, data, len);
+        if (written <= 0)
+            sink->failed = true;
+        else {
+            data += written;
+            len -= written;
+        }
+    }
+}
+
+void output_write(OutputSink* sink, const char* data, size_t len) {
+    switch (sink->type) {
+        case SINK_BUFFER: {
+            size_t space = sink->capacity - sink->len;
+            if (len > space) {
+                len = space;
+                sink->truncated = true;
+            }
+            memcpy(sink->data + sink->len, data, len);
+            sink->len += len;
+            break;
+        }
+        case SINK_ARENA: {
+            if (sink->len + len > sink->capacity) {
+                size_t capacity = sink->capacity ? sink->capacity * 2 : 256;
+                while (capacity < sink->len + len)
+                    capacity *= 2;
+                sink->data = realloc(sink->data, capacity);
+                sink->capacity = capacity;
+            }
+            memcpy(sink->data + sink->len, data, len);
+            sink->len += len;
+            break;
+        }
+        case SINK_FD: case SINK_CALLBACK: {
+            output_flush(sink);
+            // Anything too big to be worth buffering goes straight out
+            if (len >= sink->capacity)
+                write_all(sink, data, len);
+            else {
+                memcpy(sink->data, data, len);
+                sink->len = len;
+            }
+            break;
+        }
+        case SINK_DISCARD:
+            break;
+    }
+}
+
+/* Only does anything for SINK_FD and SINK_CALLBACK,
+since every other kind of sink is read by whoever owns
+it */
+void output_flush(OutputSink* sink) {
+    if ((sink->type == SINK_FD || sink->type == SINK_CALLBACK) && sink->len > 0) {
+        write_all(sink, sink->data, sink->len);
+        sink->len = 0;
+    }
+}
+
+void output_free(OutputSink* sink) {
+    output_flush(sink);
+    if (sink->type == SINK_ARENA || sink->type == SINK_FD || sink->type == SINK_CALLBACK)
+        free(sink->data);
+    *sink = (OutputSink){.type = sink->type};
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+/* A separate engine for finding out where programs
+spend their time. It runs instructions one at a time
+through vm_execute(), the same as vm_run(), counting
+and timing each one, so none of the other engines
+pay anything for it. Timing every instruction makes
+it a lot slower than vm_run(), but the overhead is
+the same for every opcode, so the ratios hold up. */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "ops.h"
+#include "profiler.h"
+
+#include "fiesta/str.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define TICK_UNIT "cycles"
+static uint64_t ticks() {
+    return __rdtsc();
+}
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TICK_UNIT "cycles"
+static uint64_t ticks() {
+    return __rdtsc();
+}
+#else
+#include <time.h>
+#define TICK_UNIT "ns"
+static uint64_t ticks() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+#define NUM_HOT_LOOPS 5
+// Lines with at least this share of everything run are marked
+#define HOT_LINE_PERCENT 5.0
+// Runs of lines that were never run longer than this are left out
+#define MAX_COLD_LINES 3
+
+static const char* instruction_names[NUM_INSTR_TYPES] = {
+    "nop", "mov", "add", "adc", "sub", "sbc", "clc", "clv", "mul",
+    "div", "neg", "shl", "shr", "str", "ld", "cmp", "jmp", "jne",
+    "je", "jgt", "jlt", "jnz", "jz", "ptc", "ptn", "ptu", "hlt",
+    "snd", "rcv", "mcpy", "mset", "mcmp", "madd", "mxor", "pts"
+};
+
+Profile profiler_create(int num_instrs) {
+    return (Profile){.num_instrs = num_instrs,
+                     .counts = calloc(num_instrs + 1, sizeof(uint64_t)),
+                     .taken = calloc(num_instrs + 1, sizeof(uint64_t))};
+}
+
+void profiler_free(Profile* profile) {
+    free(profile->counts);
+    free(profile->taken);
+    *profile = (Profile){0};
+}
+
+static bool is_jump(InstructionType type) {
+    return type >= JMP && type <= JZ;
+}
+
+// Runs exactly like vm_run(), recording into `profile` as it goes
+VM_Error vm_run_profiled(VM* vm, Instruction instrs[], int num_instrs, Profile* profile) {
+    VM_Error error = {.type = NONE};
+    for (; vm->instr_ptr < (uint32_t)num_instrs; vm->instr_ptr++, vm->program_counter++) {
+        uint32_t ip = vm->instr_ptr;
+        Instruction instr = instrs[ip];
+        bool taken = is_jump(instr.type) && op_jump_taken(vm, instr.type);
+
+        uint64_t start = ticks();
+        error = vm_execute(vm, instr);
+        uint64_t elapsed = ticks() - start;
+
+        profile->counts[ip]++;
+        profile->total++;
+        if (instr.type >= 0 && instr.type < NUM_INSTR_TYPES) {
+            profile->opcode_counts[instr.type]++;
+            profile->opcode_ticks[instr.type] += elapsed;
+        }
+        if (error.type != NONE)
+            break;
+        if (taken)
+            profile->taken[ip]++;
+    }
+    if (vm->output != NULL)
+        output_flush(vm->output);
+    return error;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+static void report_opcodes(FILE* file, const Profile* profile) {
+    uint64_t total_ticks = 0;
+    for (int i = 0; i < NUM_INSTR_TYPES; i++)
+        total_ticks += profile->opcode_ticks[i];
+
+    fprintf(file, "\nopcode %14s %7s %14s %7s %10s\n",
+            "runs", "", TICK_UNIT, "", "per run");
+    for (int i = 0; i < NUM_INSTR_TYPES; i++) {
+        uint64_t count = profile->opcode_counts[i];
+        if (count == 0)
+            continue;
+        uint64_t spent = profile->opcode_ticks[i];
+        fprintf(file, "%-6s %14llu %6.2f%% %14llu %6.2f%% %10.1f\n", instruction_names[i],
+                (unsigned long long)count, percent(count, profile->total),
+                (unsigned long long)spent, percent(spent, total_ticks), (double)spent / count);
+    }
+}
+
+typedef struct {
+    int start; // The jump target
+    int end;   // The jump back
+    uint64_t run;
+} Loop;
+
+static int compare_loops(const void* a, const void* b) {
+    uint64_t run_a = ((const Loop*)a)->run;
+    uint64_t run_b = ((const Loop*)b)->run;
+    return (run_a < run_b) - (run_a > run_b);
+}
+
+/* Loops are found from their jumps back: a jump to
+a label at or before it runs everything in between
+once per time it's taken */
+static void report_loops(FILE* file, const Profile* profile, ProfileSource source) {
+    int n = source.num_instrs;
+    uint64_t* before = malloc(sizeof(uint64_t) * (n + 1)); // Instructions run before each one
+    before[0] = 0;
+    for (int i = 0; i < n; i++)
+        before[i + 1] = before[i] + profile->counts[i];
+
+    Loop* loops = malloc(sizeof(Loop) * (n + 1));
+    int num_loops = 0;
+    for (int i = 0; i < n; i++) {
+        Operand dst = source.instrs[i].operands[0];
+        if (!is_jump(source.instrs[i].type) || !dst.is_label || profile->taken[i] == 0)
+            continue;
+        int target = dst.value < (uint32_t)source.num_labels ? source.labels[dst.value].address : 0;
+        if (target <= i)
+            loops[num_loops++] = (Loop){.start = target, .end = i,
+                                        .run = before[i + 1] - before[target]};
+    }
+    qsort(loops, num_loops, sizeof(Loop), compare_loops);
+
+    fprintf(file, "\nhottest loops\n");
+    if (num_loops == 0)
+        fprintf(file, "  none\n");
+    for (int i = 0; i < num_loops && i < NUM_HOT_LOOPS; i++) {
+        Loop* loop = &loops[i];
+        Operand dst = source.instrs[loop->end].operands[0];
+        const Label* label = dst.value < (uint32_t)source.num_labels ? &source.labels[dst.value] : NULL;
+        if (label != NULL && label->name.data != NULL)
+            fprintf(file, "  %.*s", (int)label->name.len, label->name.data);
+        else
+            fprintf(file, "  label %u", dst.value);
+        if (source.lines != NULL)
+            fprintf(file, " (lines %d-%d)", source.lines[loop->start], source.lines[loop->end]);
+        else
+            fprintf(file, " (instructions %d-%d)", loop->start, loop->end);
+        fprintf(file, ": %llu iterations, %llu instructions, %.2f%%\n",
+                (unsigned long long)profile->taken[loop->end], (unsigned long long)loop->run,
+                percent(loop->run, profile->total));
+    }
+
+    free(before);
+    free(loops);
+}
+
+static void report_listing(FILE* file, const Profile* profile, ProfileSource source) {
+    int num_lines = 1;
+    for (int i = 0; i < (int)source.src.len; i++)
+        num_lines += source.src.data[i] == '\n';
+
+    uint64_t* line_counts = calloc(num_lines + 2, sizeof(uint64_t));
+    for (int i = 0; i < source.num_instrs; i++) {
+        if (source.lines[i] <= num_lines)
+            line_counts[source.lines[i]] += profile->counts[i];
+    }
+
+    fprintf(file, "\n%14s %7s  line\n", "runs", "");
+    const char* text = source.src.data;
+    const char* end = text + source.src.len;
+    int cold_end = 0; // The last line of the current run that never ran
+    bool hide_cold = false;
+    for (int line = 1; line <= num_lines; line++) {
+        const char* newline = memchr(text, '\n', end - text);
+        int len = (newline != NULL ? newline : end) - text;
+        if (len > 0 && text[len - 1] == '\r')
+            len--;
+
+        // Leave out long stretches of lines that never ran, but not short ones
+        if (line_counts[line] == 0 && line > cold_end) {
+            cold_end = line;
+            while (cold_end < num_lines && line_counts[cold_end + 1] == 0)
+                cold_end++;
+            hide_cold = cold_end - line + 1 > MAX_COLD_LINES;
+            if (hide_cold)
+                fprintf(file, "%14s %7s  ... %d lines\n", "", "", cold_end - line + 1);
+        }
+
+        if (line_counts[line] > 0) {
+            double share = percent(line_counts[line], profile->total);
+            fprintf(file, "%14llu %6.2f%% %c%5d  %.*s\n", (unsigned long long)line_counts[line],
+                    share, share >= HOT_LINE_PERCENT ? '*' : ' ', line, len, text);
+        }
+        else if (!hide_cold)
+            fprintf(file, "%14s %7s  %5d  %.*s\n", "", "", line, len, text);
+
+        text = newline != NULL ? newline + 1 : end;
+    }
+
+    free(line_counts);
+}
+
+/* Prints how much each opcode ran and how long it
+took, the loops that ran the most instructions, and
+the source with the number of instructions run on
+each line, marking the hot ones */
+void profiler_report(FILE* file, const Profile* profile, ProfileSource source) {
+    fprintf(file, "profile: %llu instructions run\n", (unsigned long long)profile->total);
+    report_opcodes(file, profile);
+    report_loops(file, profile, source);
+    if (source.lines != NULL && source.src.data != NULL)
+        report_listing(file, profile, source);
+}
\ No newline at end of file
@@ -0,0 +1,961 @@
+/* Recording runs, so that what a program did can be
+looked at afterwards rather than only where it ended up.
+vm_run_recorded() is an engine of its own, the decoded
+engine's loop with a line or two added to jumps, stores
+and rcv, so none of the other engines pay anything for
+it, and it's cheap enough to leave on: a conditional
+jump costs a bit in a word, and a store a few bytes
+copied into the ring.
+
+Everything the log holds could be worked out again by
+running the program from the last checkpoint, since runs
+are deterministic apart from what comes in over channels.
+Replaying does exactly that, and uses the jumps and
+stores it logged to check that it really is going the
+same way, which it won't be if the program has changed,
+or was restored from a different snapshot. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "recorder.h"
+#include "snapshot.h"
+#include "ops.h"
+
+/* Every record starts with its tag. In the order of
+their fields:
+    REC_BRANCHES:   count (up to 63), then a bit per jump, little-endian, the newest lowest
+    REC_STORE:      address, value
+    REC_WIDE_STORE: width, address (varint), value (little-endian, the width's bytes)
+    REC_BULK:       InstructionType, destination address (varint), length (varint)
+    REC_INPUT:      the byte an rcv received
+    REC_CHECKPOINT: see take_checkpoint()
+Jumps are only logged for the ones that are conditional,
+and bulk instructions don't log their data, which would
+take more room than anything else put together. */
+enum {
+    REC_BRANCHES = 1,
+    REC_STORE,
+    REC_WIDE_STORE,
+    REC_BULK,
+    REC_INPUT,
+    REC_CHECKPOINT
+};
+
+// Changes this close together in a page go in one run, since starting another costs two bytes
+#define RUN_GAP 3
+// With RUN_GAP, a page can't take more than this
+#define PAGE_MAX_SIZE (5 + 1 + 2 * RECORDER_PAGE_SIZE)
+#define CHECKPOINT_HEADER_SIZE (1 + 4 + 5 + 5 + NUM_GP_REGISTERS + 2 + 4)
+#define CHECKPOINT_MAX_SIZE (CHECKPOINT_HEADER_SIZE + RECORDER_NUM_PAGES * PAGE_MAX_SIZE)
+
+#define HEADER_SIZE 36
+
+// Byte offsets into a log file
+enum {
+    OFFSET_MAGIC     = 0,
+    OFFSET_VERSION   = 8,
+    OFFSET_CHECKSUM  = 12, // FNV-1a of everything after the header
+    OFFSET_PROGRAM_ID = 16,
+    OFFSET_SIZE      = 20, // Of the whole file, header included
+    OFFSET_INTERVAL  = 24,
+    OFFSET_END_PC    = 28,
+    OFFSET_BASE_SIZE = 32  // The snapshot of `base` that comes after the header, followed by the log
+};
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void put_u32(uint8_t* at, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        at[i] = value >> 8 * i;
+}
+
+static uint32_t get_u32(const uint8_t* at) {
+    return at[0] | at[1] << 8 | at[2] << 16 | (uint32_t)at[3] << 24;
+}
+
+static uint8_t* put_varint(uint8_t* at, uint32_t value) {
+    while (value >= 0x80) {
+        *at++ = value | 0x80;
+        value >>= 7;
+    }
+    *at++ = value;
+    return at;
+}
+
+static uint8_t pack_status(const VM* vm) {
+    return vm->status_register.carry | vm->status_register.overflow << 1
+         | vm->status_register.not_zero << 2;
+}
+
+static uint8_t pack_compare(const VM* vm) {
+    return vm->compare_register.not_equal | vm->compare_register.equal << 1
+         | vm->compare_register.greater_than << 2 | vm->compare_register.less_than << 3;
+}
+
+// Everything but the labels, output and channels, which belong to whoever runs it
+static void copy_state(VM* to, const VM* from) {
+    memcpy(to->registers, from->registers, sizeof(to->registers));
+    to->status_register = from->status_register;
+    to->zero_register = from->zero_register;
+    to->compare_register = from->compare_register;
+    to->program_counter = from->program_counter;
+    to->instr_ptr = from->instr_ptr;
+    memcpy(to->memory, from->memory, MEMORY_SIZE);
+}
+
+/* Reading the ring. Offsets are into the whole log,
+and only wrap around here. */
+
+static inline uint8_t ring_get(const Recording* recording, uint64_t at) {
+    return recording->ring[at & (recording->capacity - 1)];
+}
+
+static uint32_t ring_u32(const Recording* recording, uint64_t at) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t)ring_get(recording, at + i) << 8 * i;
+    return value;
+}
+
+static uint32_t ring_varint(const Recording* recording, uint64_t* at) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t byte = ring_get(recording, (*at)++);
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    return value;
+}
+
+// Where the record at `at` ends, which is `end` if it's not a record at all
+static uint64_t skip_record(const Recording* recording, uint64_t at, uint64_t end) {
+    uint64_t next = end;
+    switch (ring_get(recording, at)) {
+        case REC_BRANCHES: {
+            uint8_t count = ring_get(recording, at + 1);
+            if (count >= 1 && count <= 63)
+                next = at + 2 + (count + 7) / 8;
+            break;
+        }
+        case REC_STORE:
+            next = at + 3;
+            break;
+        case REC_WIDE_STORE: {
+            uint8_t width = ring_get(recording, at + 1);
+            next = at + 2;
+            ring_varint(recording, &next);
+            next = width < NUM_WIDTHS ? next + (1u << width) : end;
+            break;
+        }
+        case REC_BULK:
+            next = at + 2;
+            ring_varint(recording, &next);
+            ring_varint(recording, &next);
+            break;
+        case REC_INPUT:
+            next = at + 2;
+            break;
+        case REC_CHECKPOINT:
+            next = at + ring_u32(recording, at + 1);
+            break;
+    }
+    return next <= end && next > at ? next : end;
+}
+
+static uint32_t checkpoint_pc(const Recording* recording, uint64_t at, uint32_t previous_pc) {
+    at += 5;
+    return previous_pc + ring_varint(recording, &at);
+}
+
+/* Applies the checkpoint at `at` to `state`, which has
+to be where the one before left things. With no `state`,
+just checks that it's well formed. */
+static bool apply_checkpoint(const Recording* recording, uint64_t at, VM* state) {
+    uint64_t end = at + ring_u32(recording, at + 1);
+    uint64_t read = at + 5;
+    uint32_t pc = ring_varint(recording, &read);
+    uint32_t ip = ring_varint(recording, &read);
+    if (read + NUM_GP_REGISTERS + 2 + 4 > end)
+        return false;
+    if (state != NULL) {
+        state->program_counter += pc;
+        state->instr_ptr = ip;
+        for (int i = 0; i < NUM_GP_REGISTERS; i++)
+            state->registers[i].value = ring_get(recording, read + i);
+        uint8_t status = ring_get(recording, read + NUM_GP_REGISTERS);
+        state->status_register.carry = status & 1;
+        state->status_register.overflow = status >> 1 & 1;
+        state->status_register.not_zero = status >> 2 & 1;
+        uint8_t compare = ring_get(recording, read + NUM_GP_REGISTERS + 1);
+        state->compare_register.not_equal = compare & 1;
+        state->compare_register.equal = compare >> 1 & 1;
+        state->compare_register.greater_than = compare >> 2 & 1;
+        state->compare_register.less_than = compare >> 3 & 1;
+    }
+    read += NUM_GP_REGISTERS + 2;
+    uint32_t num_pages = ring_u32(recording, read);
+    read += 4;
+
+    for (uint32_t i = 0; i < num_pages; i++) {
+        uint32_t page = ring_varint(recording, &read);
+        uint8_t num_runs = ring_get(recording, read++);
+        if (page >= RECORDER_NUM_PAGES || read > end)
+            return false;
+        uint8_t* memory = state != NULL ? state->memory + page * RECORDER_PAGE_SIZE : NULL;
+        for (int run = 0; run < num_runs; run++) {
+            uint32_t offset = ring_get(recording, read);
+            uint32_t len = ring_get(recording, read + 1) + 1;
+            read += 2;
+            if (offset + len > RECORDER_PAGE_SIZE || read + len > end)
+                return false;
+            for (uint32_t j = 0; memory != NULL && j < len; j++)
+                memory[offset + j] = ring_get(recording, read + j);
+            read += len;
+        }
+    }
+    return read == end;
+}
+
+/* Writing the ring */
+
+static void update_limit(Recording* recording) {
+    uint64_t full = recording->start + recording->capacity;
+    uint64_t due = recording->segment + recording->capacity / 4;
+    recording->limit = full < due ? full : due;
+}
+
+/* Drops the oldest checkpoint, and everything before
+it, until there's room for `len` more bytes. Nothing
+between two checkpoints is much more than a quarter of
+the ring, and neither is a checkpoint, so there's always
+one to drop. */
+static void make_room(Recording* recording, uint32_t len) {
+    if (recording->end + len - recording->segment > recording->capacity / 4)
+        recording->due = true;
+    while (recording->end + len - recording->start > recording->capacity) {
+        uint64_t at = recording->start;
+        while (at < recording->end && ring_get(recording, at) != REC_CHECKPOINT)
+            at = skip_record(recording, at, recording->end);
+        if (at < recording->end) {
+            apply_checkpoint(recording, at, recording->base);
+            at = skip_record(recording, at, recording->end);
+        }
+        recording->start = at;
+    }
+    update_limit(recording);
+}
+
+// One comparison, against `limit`, unless the ring is full or a checkpoint is due
+static inline void put_record(Recording* recording, const uint8_t* bytes, uint32_t len) {
+    if (recording->end + len > recording->limit)
+        make_room(recording, len);
+    uint32_t at = recording->end & (recording->capacity - 1);
+    uint32_t first = recording->capacity - at;
+    if (len <= first)
+        memcpy(recording->ring + at, bytes, len);
+    else {
+        memcpy(recording->ring + at, bytes, first);
+        memcpy(recording->ring, bytes + first, len - first);
+    }
+    recording->end += len;
+}
+
+static void flush_branches(Recording* recording) {
+    uint64_t branches = recording->branches;
+    uint32_t count = 0;
+    while (branches >> count > 1)
+        count++;
+    if (count == 0)
+        return;
+    uint8_t bytes[2 + 8] = {REC_BRANCHES, count};
+    for (uint32_t i = 0; i < (count + 7) / 8; i++)
+        bytes[2 + i] = branches >> 8 * i;
+    put_record(recording, bytes, 2 + (count + 7) / 8);
+    recording->branches = 1;
+}
+
+static inline void mark_dirty(Recording* recording, uint32_t page) {
+    recording->dirty[page / 8] |= 1 << page % 8;
+}
+
+// Plain stores can only reach the first page
+static inline void log_store(Recording* recording, uint8_t address, uint8_t value) {
+    uint8_t bytes[3] = {REC_STORE, address, value};
+    put_record(recording, bytes, sizeof(bytes));
+    mark_dirty(recording, 0);
+}
+
+// After the store, which may have wrapped around the end of memory
+static void log_wide_store(Recording* recording, const VM* vm, uint32_t address, uint8_t width) {
+    address &= MEMORY_SIZE - 1;
+    uint8_t bytes[2 + 5 + 4] = {REC_WIDE_STORE, width};
+    uint8_t* at = put_varint(bytes + 2, address);
+    for (int i = 0; i < 1 << width; i++)
+        *at++ = vm->memory[(address + i) & (MEMORY_SIZE - 1)];
+    put_record(recording, bytes, at - bytes);
+    mark_dirty(recording, address / RECORDER_PAGE_SIZE);
+    mark_dirty(recording, ((address + (1u << width) - 1) & (MEMORY_SIZE - 1)) / RECORDER_PAGE_SIZE);
+}
+
+// Bulk ranges are always in bounds, or the instruction wouldn't have run
+static void log_bulk(Recording* recording, uint8_t type, uint32_t address, uint32_t len) {
+    uint8_t bytes[2 + 5 + 5] = {REC_BULK, type};
+    uint8_t* at = put_varint(bytes + 2, address);
+    at = put_varint(at, len);
+    put_record(recording, bytes, at - bytes);
+    for (uint32_t page = address / RECORDER_PAGE_SIZE;
+         len > 0 && page <= (address + len - 1) / RECORDER_PAGE_SIZE; page++)
+        mark_dirty(recording, page);
+}
+
+static inline void log_input(Recording* recording, uint8_t value) {
+    uint8_t bytes[2] = {REC_INPUT, value};
+    put_record(recording, bytes, sizeof(bytes));
+}
+
+/* A checkpoint is its tag, its size (4 bytes), the
+program counter's distance from the last checkpoint's
+(a varint), the instruction pointer (a varint), the
+registers, the status and comparison flags packed the
+way snapshots pack them, and then the number of pages
+that have changed (4 bytes). Each of those is its
+number (a varint), the number of runs of bytes that
+have changed in it, and each run's offset, length less
+one, and bytes. */
+static void take_checkpoint(Recording* recording, const VM* vm) {
+    flush_branches(recording);
+    uint8_t* out = recording->scratch;
+    uint8_t* at = put_varint(out + 5, vm->program_counter - recording->checkpoint_pc);
+    at = put_varint(at, vm->instr_ptr);
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        *at++ = vm->registers[i].value;
+    *at++ = pack_status(vm);
+    *at++ = pack_compare(vm);
+    uint8_t* num_pages_at = at;
+    at += 4;
+
+    uint32_t num_pages = 0;
+    for (uint32_t page = 0; page < RECORDER_NUM_PAGES; page++) {
+        if (!(recording->dirty[page / 8] >> page % 8 & 1))
+            continue;
+        const uint8_t* now = vm->memory + page * RECORDER_PAGE_SIZE;
+        uint8_t* then = recording->shadow + page * RECORDER_PAGE_SIZE;
+        if (!memcmp(now, then, RECORDER_PAGE_SIZE))
+            continue;
+        at = put_varint(at, page);
+        uint8_t* num_runs = at++;
+        *num_runs = 0;
+        for (int i = 0; i < RECORDER_PAGE_SIZE;) {
+            if (now[i] == then[i]) {
+                i++;
+                continue;
+            }
+            int last = i;
+            for (int j = i + 1; j < RECORDER_PAGE_SIZE && j - last <= RUN_GAP; j++) {
+                if (now[j] != then[j])
+                    last = j;
+            }
+            int len = last - i + 1;
+            *at++ = i;
+            *at++ = len - 1;
+            memcpy(at, now + i, len);
+            memcpy(then + i, now + i, len);
+            at += len;
+            (*num_runs)++;
+            i = last + 1;
+        }
+        num_pages++;
+    }
+    put_u32(num_pages_at, num_pages);
+    out[0] = REC_CHECKPOINT;
+    put_u32(out + 1, at - out);
+    put_record(recording, out, at - out);
+
+    recording->segment = recording->end;
+    update_limit(recording);
+    recording->checkpoint_pc = vm->program_counter;
+    recording->due = false;
+    recording->num_checkpoints++;
+    memset(recording->dirty, 0, sizeof(recording->dirty));
+}
+
+static uint32_t round_capacity(uint32_t capacity) {
+    uint32_t rounded = 1;
+    while (rounded < capacity || rounded < 4 * CHECKPOINT_MAX_SIZE)
+        rounded <<= 1;
+    return rounded;
+}
+
+Recording recorder_create(const VM* vm, uint32_t capacity, uint32_t interval) {
+    Recording recording = {.capacity = round_capacity(capacity), .interval = interval};
+    // Jumps are only logged a word at a time, so only a checkpoint every so often keeps them in a quarter of the ring
+    if (recording.interval > recording.capacity)
+        recording.interval = recording.capacity;
+    recording.ring = malloc(recording.capacity);
+    recording.base = malloc(sizeof(VM));
+    *recording.base = vm_init(NULL, 0);
+    recording.shadow = malloc(MEMORY_SIZE);
+    recording.scratch = malloc(CHECKPOINT_MAX_SIZE);
+    recorder_reset(&recording, vm);
+    return recording;
+}
+
+void recorder_reset(Recording* recording, const VM* vm) {
+    recording->start = recording->end = recording->segment = 0;
+    update_limit(recording);
+    recording->branches = 1;
+    recording->due = false;
+    recording->checkpoint_pc = recording->end_pc = vm->program_counter;
+    recording->num_checkpoints = 0;
+    copy_state(recording->base, vm);
+    memcpy(recording->shadow, vm->memory, MEMORY_SIZE);
+    memset(recording->dirty, 0, sizeof(recording->dirty));
+}
+
+void recorder_free(Recording* recording) {
+    free(recording->ring);
+    free(recording->base);
+    free(recording->shadow);
+    free(recording->scratch);
+    *recording = (Recording){0};
+}
+
+#if defined(__GNUC__) && !defined(STRVM_NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
+#ifdef USE_COMPUTED_GOTO
+#define TARGET(type) case type: TARGET_##type
+#define DISPATCH()   goto *dispatch_table[ip->type]
+#else
+#define TARGET(type) case type
+#define DISPATCH()   goto dispatch
+#endif
+
+#define R(i)   vm->registers[i].value
+#define NEXT() do { ip++; pc++; DISPATCH(); } while (0)
+// For anything that's written to the log, which may have grown enough to need a checkpoint
+#define LOGGED_NEXT() do { \
+        ip++; \
+        pc++; \
+        if (recording->due) \
+            goto checkpoint; \
+        DISPATCH(); \
+    } while (0)
+// Checkpoints are otherwise taken at backward jumps, like yields
+#define JUMP_IF(cond) do { \
+        pc++; \
+        if (cond) { \
+            bool backward = ip->target <= (uint32_t)(ip - code); \
+            ip = code + ip->target; \
+            if (backward && pc - checkpoint_pc >= interval) \
+                goto checkpoint; \
+        } \
+        else \
+            ip++; \
+        DISPATCH(); \
+    } while (0)
+// Outcomes are kept in a local until there's a word of them
+#define BRANCH_IF(cond) do { \
+        bool taken = cond; \
+        branches = branches << 1 | taken; \
+        if (branches >> 63) { \
+            recording->branches = branches; \
+            flush_branches(recording); \
+            branches = 1; \
+        } \
+        JUMP_IF(taken); \
+    } while (0)
+
+#define CHANNEL_OP(ok) do { \
+        if (!(ok)) { \
+            error = (VM_Error){.type = BLOCKED}; \
+            goto done; \
+        } \
+        NEXT(); \
+    } while (0)
+
+#define ALU_VARIANTS(OP, expr) \
+    TARGET(OP##_REG_REG): { \
+        uint8_t* dst = &R(ip->a); \
+        uint8_t result = *dst; \
+        result expr R(ip->b); \
+        *dst = result; \
+        flags.result = result; \
+        NEXT(); \
+    } \
+    TARGET(OP##_REG_IMM): { \
+        uint8_t* dst = &R(ip->a); \
+        uint8_t result = *dst; \
+        result expr ip->b; \
+        *dst = result; \
+        flags.result = result; \
+        NEXT(); \
+    }
+
+#define STORE(address, value) do { \
+        uint8_t a = address, v = value; \
+        vm->memory[a] = v; \
+        log_store(recording, a, v); \
+        LOGGED_NEXT(); \
+    } while (0)
+
+// A bulk instruction's `index`th operand, as decoder.c has it
+static inline uint32_t bulk_operand(const VM* vm, const DecodedProgram* program,
+                                    const DecodedInstruction* ip, int index) {
+    uint32_t k = program->constants[ip->target + index];
+    return ip->a >> index & 1 ? op_wide_get(&vm->registers[k], ip->width) : k;
+}
+
+VM_Error vm_run_recorded(VM* vm, DecodedProgram* program, Recording* recording) {
+#ifdef USE_COMPUTED_GOTO
+    static const void* dispatch_table[NUM_DECODED_TYPES] = {
+        [OP_NOP] = &&TARGET_OP_NOP,
+        [OP_MOV_REG_REG] = &&TARGET_OP_MOV_REG_REG, [OP_MOV_REG_IMM] = &&TARGET_OP_MOV_REG_IMM,
+        [OP_ADD_REG_REG] = &&TARGET_OP_ADD_REG_REG, [OP_ADD_REG_IMM] = &&TARGET_OP_ADD_REG_IMM,
+        [OP_ADC_REG_REG] = &&TARGET_OP_ADC_REG_REG, [OP_ADC_REG_IMM] = &&TARGET_OP_ADC_REG_IMM,
+        [OP_SBC_REG_REG] = &&TARGET_OP_SBC_REG_REG, [OP_SBC_REG_IMM] = &&TARGET_OP_SBC_REG_IMM,
+        [OP_SUB_REG_REG] = &&TARGET_OP_SUB_REG_REG, [OP_SUB_REG_IMM] = &&TARGET_OP_SUB_REG_IMM,
+        [OP_MUL_REG_REG] = &&TARGET_OP_MUL_REG_REG, [OP_MUL_REG_IMM] = &&TARGET_OP_MUL_REG_IMM,
+        [OP_DIV_REG_REG] = &&TARGET_OP_DIV_REG_REG, [OP_DIV_REG_IMM] = &&TARGET_OP_DIV_REG_IMM,
+        [OP_SHL_REG_REG] = &&TARGET_OP_SHL_REG_REG, [OP_SHL_REG_IMM] = &&TARGET_OP_SHL_REG_IMM,
+        [OP_SHR_REG_REG] = &&TARGET_OP_SHR_REG_REG, [OP_SHR_REG_IMM] = &&TARGET_OP_SHR_REG_IMM,
+        [OP_CLC] = &&TARGET_OP_CLC,
+        [OP_CLV] = &&TARGET_OP_CLV,
+        [OP_NEG_REG] = &&TARGET_OP_NEG_REG,
+        [OP_STR_REG_REG] = &&TARGET_OP_STR_REG_REG, [OP_STR_REG_IMM] = &&TARGET_OP_STR_REG_IMM,
+        [OP_STR_IMM_REG] = &&TARGET_OP_STR_IMM_REG, [OP_STR_IMM_IMM] = &&TARGET_OP_STR_IMM_IMM,
+        [OP_LD_REG_REG] = &&TARGET_OP_LD_REG_REG, [OP_LD_REG_IMM] = &&TARGET_OP_LD_REG_IMM,
+        [OP_CMP_REG_REG] = &&TARGET_OP_CMP_REG_REG, [OP_CMP_REG_IMM] = &&TARGET_OP_CMP_REG_IMM,
+        [OP_CMP_IMM_REG] = &&TARGET_OP_CMP_IMM_REG, [OP_CMP_IMM_IMM] = &&TARGET_OP_CMP_IMM_IMM,
+        [OP_JMP_ABS] = &&TARGET_OP_JMP_ABS,
+        [OP_JNE_ABS] = &&TARGET_OP_JNE_ABS,
+        [OP_JE_ABS] = &&TARGET_OP_JE_ABS,
+        [OP_JGT_ABS] = &&TARGET_OP_JGT_ABS,
+        [OP_JLT_ABS] = &&TARGET_OP_JLT_ABS,
+        [OP_JNZ_ABS] = &&TARGET_OP_JNZ_ABS,
+        [OP_JZ_ABS] = &&TARGET_OP_JZ_ABS,
+        [OP_PTC_REG] = &&TARGET_OP_PTC_REG, [OP_PTC_IMM] = &&TARGET_OP_PTC_IMM,
+        [OP_PTN_REG] = &&TARGET_OP_PTN_REG, [OP_PTN_IMM] = &&TARGET_OP_PTN_IMM,
+        [OP_PTU_REG] = &&TARGET_OP_PTU_REG, [OP_PTU_IMM] = &&TARGET_OP_PTU_IMM,
+        [OP_SND_REG_REG] = &&TARGET_OP_SND_REG_REG, [OP_SND_REG_IMM] = &&TARGET_OP_SND_REG_IMM,
+        [OP_SND_IMM_REG] = &&TARGET_OP_SND_IMM_REG, [OP_SND_IMM_IMM] = &&TARGET_OP_SND_IMM_IMM,
+        [OP_RCV_REG_REG ... OP_RCV_REG_IMM] = &&TARGET_OP_RCV_REG_REG,
+        [OP_WIDE_MOV_REG_REG ... OP_WIDE_CMP_IMM_IMM] = &&TARGET_OP_WIDE,
+        [OP_MCPY ... OP_PTS] = &&TARGET_OP_MCPY,
+        [OP_HLT] = &&TARGET_OP_HLT,
+        [OP_TRAP] = &&TARGET_OP_TRAP,
+        [OP_END] = &&TARGET_OP_END
+    };
+#endif
+
+    DecodedInstruction* code = program->instrs;
+    DecodedInstruction* ip = code + (vm->instr_ptr < (uint32_t)program->num_instrs
+                                     ? (int)vm->instr_ptr : program->num_instrs);
+    uint32_t pc = vm->program_counter;
+    LazyFlags flags = flags_load(vm);
+    VM_Error error = {.type = NONE};
+    uint64_t branches = recording->branches;
+    uint32_t checkpoint_pc = recording->checkpoint_pc;
+    uint32_t interval = recording->interval;
+
+#ifdef USE_COMPUTED_GOTO
+    DISPATCH();
+#else
+dispatch:
+#endif
+    switch ((DecodedType)ip->type) {
+        TARGET(OP_NOP): NEXT();
+
+        TARGET(OP_MOV_REG_REG): R(ip->a) = R(ip->b); NEXT();
+        TARGET(OP_MOV_REG_IMM): R(ip->a) = ip->b; NEXT();
+
+        ALU_VARIANTS(OP_ADD, +=)
+        ALU_VARIANTS(OP_SUB, -=)
+        ALU_VARIANTS(OP_MUL, *=)
+        ALU_VARIANTS(OP_DIV, /=)
+        ALU_VARIANTS(OP_SHL, <<=)
+        ALU_VARIANTS(OP_SHR, >>=)
+
+        TARGET(OP_ADC_REG_REG): op_adc(vm, &flags, &R(ip->a), R(ip->b), false); NEXT();
+        TARGET(OP_ADC_REG_IMM): op_adc(vm, &flags, &R(ip->a), ip->b, false); NEXT();
+        TARGET(OP_SBC_REG_REG): op_adc(vm, &flags, &R(ip->a), R(ip->b), true); NEXT();
+        TARGET(OP_SBC_REG_IMM): op_adc(vm, &flags, &R(ip->a), ip->b, true); NEXT();
+
+        TARGET(OP_CLC): op_clc(vm, &flags); NEXT();
+        TARGET(OP_CLV): op_clv(vm, &flags); NEXT();
+
+        TARGET(OP_NEG_REG): R(ip->a) = -R(ip->a); NEXT();
+
+        TARGET(OP_STR_REG_REG): STORE(R(ip->a), R(ip->b));
+        TARGET(OP_STR_REG_IMM): STORE(R(ip->a), ip->b);
+        TARGET(OP_STR_IMM_REG): STORE(ip->a, R(ip->b));
+        TARGET(OP_STR_IMM_IMM): STORE(ip->a, ip->b);
+
+        TARGET(OP_LD_REG_REG): R(ip->a) = vm->memory[R(ip->b)]; NEXT();
+        TARGET(OP_LD_REG_IMM): R(ip->a) = vm->memory[ip->b]; NEXT();
+
+        TARGET(OP_CMP_REG_REG): flags_cmp(&flags, R(ip->a), R(ip->b)); NEXT();
+        TARGET(OP_CMP_REG_IMM): flags_cmp(&flags, R(ip->a), ip->b); NEXT();
+        TARGET(OP_CMP_IMM_REG): flags_cmp(&flags, ip->a, R(ip->b)); NEXT();
+        TARGET(OP_CMP_IMM_IMM): flags_cmp(&flags, ip->a, ip->b); NEXT();
+
+        TARGET(OP_JMP_ABS): JUMP_IF(true);
+        TARGET(OP_JNE_ABS): BRANCH_IF(flags_compare(vm, &flags).not_equal);
+        TARGET(OP_JE_ABS):  BRANCH_IF(flags_compare(vm, &flags).equal);
+        TARGET(OP_JGT_ABS): BRANCH_IF(flags_compare(vm, &flags).greater_than);
+        TARGET(OP_JLT_ABS): BRANCH_IF(flags_compare(vm, &flags).less_than);
+        TARGET(OP_JNZ_ABS): BRANCH_IF(flags.result != 0);
+        TARGET(OP_JZ_ABS):  BRANCH_IF(flags.result == 0);
+
+        TARGET(OP_PTC_REG): op_ptc(vm->output, R(ip->a)); NEXT();
+        TARGET(OP_PTC_IMM): op_ptc(vm->output, ip->a); NEXT();
+        TARGET(OP_PTN_REG): op_ptn(vm->output, R(ip->a)); NEXT();
+        TARGET(OP_PTN_IMM): op_ptn(vm->output, ip->a); NEXT();
+        TARGET(OP_PTU_REG): op_ptu(vm->output, R(ip->a)); NEXT();
+        TARGET(OP_PTU_IMM): op_ptu(vm->output, ip->a); NEXT();
+
+        TARGET(OP_SND_REG_REG): CHANNEL_OP(op_snd(vm, R(ip->a), R(ip->b)));
+        TARGET(OP_SND_REG_IMM): CHANNEL_OP(op_snd(vm, R(ip->a), ip->b));
+        TARGET(OP_SND_IMM_REG): CHANNEL_OP(op_snd(vm, ip->a, R(ip->b)));
+        TARGET(OP_SND_IMM_IMM): CHANNEL_OP(op_snd(vm, ip->a, ip->b));
+        // What comes in over a channel is the only thing a replay couldn't work out for itself
+        TARGET(OP_RCV_REG_REG): case OP_RCV_REG_IMM: {
+            uint8_t channel = ip->type == OP_RCV_REG_REG ? R(ip->b) : ip->b;
+            if (!op_rcv(vm, &R(ip->a), channel)) {
+                error = (VM_Error){.type = BLOCKED};
+                break;
+            }
+            log_input(recording, R(ip->a));
+            LOGGED_NEXT();
+        }
+
+        TARGET(OP_MCPY): case OP_MSET: case OP_MCMP: case OP_MADD: case OP_MXOR: case OP_PTS: {
+            uint8_t type = MCPY + (ip->type - OP_MCPY);
+            uint32_t address = bulk_operand(vm, program, ip, 0);
+            uint32_t len = type == PTS ? 0 : bulk_operand(vm, program, ip, 2);
+            if (!decoder_run_bulk(vm, &flags, program, ip)) {
+                error = decoder_bulk_error(program, ip);
+                break;
+            }
+            if (type == MCMP || type == PTS)
+                NEXT();
+            log_bulk(recording, type, address, len);
+            LOGGED_NEXT();
+        }
+
+        TARGET(OP_HLT): {
+            error = (VM_Error){.type = HALT};
+            break;
+        }
+        TARGET(OP_TRAP): {
+            error = program->traps[ip->target];
+            break;
+        }
+        TARGET(OP_END): break;
+
+        // Every wide instruction shares one handler
+        default:
+#ifdef USE_COMPUTED_GOTO
+        TARGET_OP_WIDE:
+#endif
+            if (!decoded_is_wide(ip->type))
+                break;
+            decoder_run_wide(vm, &flags, program, ip);
+            if (ip->type < OP_WIDE_STR_REG_REG || ip->type > OP_WIDE_STR_IMM_IMM)
+                NEXT();
+            log_wide_store(recording, vm, ip->type < OP_WIDE_STR_IMM_REG
+                                          ? op_wide_get(&vm->registers[ip->a], ip->width)
+                                          : program->constants[ip->target], ip->width);
+            LOGGED_NEXT();
+    }
+    goto done;
+
+checkpoint:
+    flags_settle(vm, &flags);
+    vm->instr_ptr = ip - code;
+    vm->program_counter = pc;
+    recording->branches = branches;
+    take_checkpoint(recording, vm);
+    branches = 1;
+    checkpoint_pc = pc;
+    flags = flags_load(vm);
+    DISPATCH();
+
+done:
+    flags_settle(vm, &flags);
+    vm->instr_ptr = ip - code;
+    vm->program_counter = pc;
+    recording->branches = branches;
+    flush_branches(recording);
+    recording->end_pc = pc;
+    if (vm->output != NULL)
+        output_flush(vm->output);
+    return error;
+}
+
+/* Replaying. Each kind of record is read with a cursor
+of its own, so that branch outcomes can be packed a word
+at a time rather than written out in order with
+everything else. */
+
+typedef struct {
+    uint64_t at;  // The next record to look at
+    uint64_t end; // Where the next checkpoint is, or the log ends
+    uint64_t bits;
+    uint32_t num_bits;
+} Cursor;
+
+// Moves to the next record whose tag is in `tags`, a bit each, and returns where it starts
+static bool cursor_next(const Recording* recording, Cursor* cursor, uint32_t tags, uint64_t* record) {
+    while (cursor->at < cursor->end) {
+        uint64_t at = cursor->at;
+        cursor->at = skip_record(recording, at, cursor->end);
+        if (tags >> ring_get(recording, at) & 1) {
+            *record = at;
+            return true;
+        }
+    }
+    return false;
+}
+
+// -1 once there are none left
+static int next_branch(const Recording* recording, Cursor* cursor) {
+    if (cursor->num_bits == 0) {
+        uint64_t at;
+        if (!cursor_next(recording, cursor, 1u << REC_BRANCHES, &at))
+            return -1;
+        cursor->num_bits = ring_get(recording, at + 1);
+        cursor->bits = 0;
+        for (uint32_t i = 0; i < (cursor->num_bits + 7) / 8; i++)
+            cursor->bits |= (uint64_t)ring_get(recording, at + 2 + i) << 8 * i;
+    }
+    cursor->num_bits--;
+    return cursor->bits >> cursor->num_bits & 1;
+}
+
+static bool writes_memory(InstructionType type) {
+    return type == STR || type == MCPY || type == MSET || type == MADD || type == MXOR;
+}
+
+// Whether the store `instr` has just done is the next one in the log
+static bool check_write(const Recording* recording, Cursor* cursor, const VM* vm, Instruction instr) {
+    uint64_t at;
+    uint32_t tags = 1u << REC_STORE | 1u << REC_WIDE_STORE | 1u << REC_BULK;
+    if (!cursor_next(recording, cursor, tags, &at))
+        return false;
+    uint8_t tag = ring_get(recording, at);
+    if (instr.type != STR)
+        return tag == REC_BULK && ring_get(recording, at + 1) == instr.type;
+    if (instr.width == WIDTH_BYTE)
+        return tag == REC_STORE && vm->memory[ring_get(recording, at + 1)] == ring_get(recording, at + 2);
+    if (tag != REC_WIDE_STORE || ring_get(recording, at + 1) != instr.width)
+        return false;
+    uint64_t read = at + 2;
+    uint32_t address = ring_varint(recording, &read);
+    uint32_t value = 0;
+    for (int i = 0; i < 1 << instr.width; i++)
+        value |= (uint32_t)ring_get(recording, read + i) << 8 * i;
+    return op_wide_load(vm->memory, address, instr.width) == value;
+}
+
+static RecorderError replay_forward(const Recording* recording, VM* vm, Instruction instrs[],
+                                    int num_instrs, uint32_t count, uint64_t segment, uint64_t end) {
+    Cursor branches = {.at = segment, .end = end};
+    Cursor writes = branches;
+    Cursor inputs = branches;
+    while (vm->program_counter != count) {
+        uint32_t ip = vm->instr_ptr;
+        if (ip >= (uint32_t)num_instrs)
+            return RECORDER_DIVERGED;
+        Instruction instr = instrs[ip];
+        if (instr.type >= JNE && instr.type <= JZ
+            && next_branch(recording, &branches) != op_jump_taken(vm, instr.type))
+            return RECORDER_DIVERGED;
+
+        // Nothing is sent, and what was received comes from the log
+        if (instr.type == RCV) {
+            uint64_t at;
+            Operand dst = instr.operands[0];
+            if (!cursor_next(recording, &inputs, 1u << REC_INPUT, &at)
+                || !dst.is_register || dst.value >= NUM_GP_REGISTERS)
+                return RECORDER_DIVERGED;
+            vm->registers[dst.value].value = ring_get(recording, at + 1);
+        }
+        else if (instr.type != SND) {
+            if (vm_execute(vm, instr).type != NONE)
+                return RECORDER_DIVERGED;
+            if (writes_memory(instr.type) && !check_write(recording, &writes, vm, instr))
+                return RECORDER_DIVERGED;
+        }
+        vm->instr_ptr++;
+        vm->program_counter++;
+    }
+    return RECORDER_OK;
+}
+
+uint32_t recorder_first_pc(const Recording* recording) {
+    return recording->base->program_counter;
+}
+
+RecorderError recorder_replay(const Recording* recording, VM* vm, Instruction instrs[],
+                              int num_instrs, uint32_t count) {
+    // Counts wrap around, so they're measured from where the log starts
+    uint32_t first = recorder_first_pc(recording);
+    if (count - first > recording->end_pc - first)
+        return RECORDER_OUT_OF_RANGE;
+
+    // Each checkpoint only holds what changed since the one before, so every one up to `count` is applied
+    copy_state(vm, recording->base);
+    uint64_t at = recording->start;
+    uint64_t segment = at;
+    while (at < recording->end) {
+        if (ring_get(recording, at) == REC_CHECKPOINT) {
+            if (checkpoint_pc(recording, at, vm->program_counter) - first > count - first)
+                break;
+            apply_checkpoint(recording, at, vm);
+            at = skip_record(recording, at, recording->end);
+            segment = at;
+        }
+        else
+            at = skip_record(recording, at, recording->end);
+    }
+
+    OutputSink* output = vm->output;
+    ChannelSet* channels = vm->channels;
+    OutputSink discard = output_sink_discard();
+    vm->output = &discard;
+    vm->channels = NULL;
+    RecorderError error = replay_forward(recording, vm, instrs, num_instrs, count, segment, at);
+    output_free(&discard);
+    vm->output = output;
+    vm->channels = channels;
+    return error;
+}
+
+RecorderError recorder_write(const char* filename, const Recording* recording, uint32_t program_id) {
+    Snapshot base = snapshot_take(recording->base, program_id);
+    uint32_t log_size = recording->end - recording->start;
+    size_t size = HEADER_SIZE + base.size + log_size;
+    uint8_t* data = calloc(size, 1);
+
+    memcpy(data + OFFSET_MAGIC, RECORDER_MAGIC, sizeof(RECORDER_MAGIC));
+    put_u32(data + OFFSET_VERSION, RECORDER_VERSION);
+    put_u32(data + OFFSET_PROGRAM_ID, program_id);
+    put_u32(data + OFFSET_SIZE, size);
+    put_u32(data + OFFSET_INTERVAL, recording->interval);
+    put_u32(data + OFFSET_END_PC, recording->end_pc);
+    put_u32(data + OFFSET_BASE_SIZE, base.size);
+    memcpy(data + HEADER_SIZE, base.data, base.size);
+    uint8_t* log = data + HEADER_SIZE + base.size;
+    for (uint32_t i = 0; i < log_size; i++)
+        log[i] = ring_get(recording, recording->start + i);
+    put_u32(data + OFFSET_CHECKSUM, fnv1a(2166136261u, data + HEADER_SIZE, size - HEADER_SIZE));
+    snapshot_free(&base);
+
+    RecorderError error = RECORDER_OK;
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL || fwrite(data, 1, size, file) != size)
+        error = RECORDER_IO_ERROR;
+    if (file != NULL && fclose(file) != 0)
+        error = RECORDER_IO_ERROR;
+    free(data);
+    return error;
+}
+
+static RecorderError validate(const uint8_t* data, size_t size, uint32_t program_id) {
+    if (size < HEADER_SIZE || memcmp(data, RECORDER_MAGIC, sizeof(RECORDER_MAGIC)))
+        return RECORDER_NOT_A_LOG;
+    if (get_u32(data + OFFSET_VERSION) != RECORDER_VERSION)
+        return RECORDER_BAD_VERSION;
+    if (get_u32(data + OFFSET_SIZE) != size || get_u32(data + OFFSET_BASE_SIZE) > size - HEADER_SIZE)
+        return RECORDER_CORRUPT;
+    if (fnv1a(2166136261u, data + HEADER_SIZE, size - HEADER_SIZE) != get_u32(data + OFFSET_CHECKSUM))
+        return RECORDER_CORRUPT;
+    if (get_u32(data + OFFSET_PROGRAM_ID) != program_id)
+        return RECORDER_WRONG_PROGRAM;
+    return RECORDER_OK;
+}
+
+// Whether every record is whole, and every checkpoint is well formed
+static bool check_log(const Recording* recording) {
+    for (uint64_t at = recording->start; at < recording->end;) {
+        uint64_t next = skip_record(recording, at, recording->end + 1);
+        if (next > recording->end)
+            return false;
+        if (ring_get(recording, at) == REC_CHECKPOINT && !apply_checkpoint(recording, at, NULL))
+            return false;
+        at = next;
+    }
+    return true;
+}
+
+RecorderError recorder_read(const char* filename, Recording* recording, uint32_t program_id) {
+    *recording = (Recording){0};
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return RECORDER_IO_ERROR;
+    uint8_t* data = NULL;
+    size_t size = 0;
+    for (size_t capacity = 1 << 16;; capacity *= 2) {
+        data = realloc(data, capacity);
+        size += fread(data + size, 1, capacity - size, file);
+        if (size < capacity)
+            break;
+    }
+    bool failed = ferror(file);
+    fclose(file);
+
+    RecorderError error = failed ? RECORDER_IO_ERROR : validate(data, size, program_id);
+    VM base = vm_init(NULL, 0);
+    if (error == RECORDER_OK) {
+        Snapshot snapshot = {.data = data + HEADER_SIZE, .size = get_u32(data + OFFSET_BASE_SIZE)};
+        if (snapshot_restore(&base, &snapshot, program_id) != SNAPSHOT_OK)
+            error = RECORDER_CORRUPT;
+    }
+    if (error != RECORDER_OK) {
+        free(data);
+        return error;
+    }
+
+    uint32_t base_size = get_u32(data + OFFSET_BASE_SIZE);
+    uint32_t log_size = size - HEADER_SIZE - base_size;
+    *recording = recorder_create(&base, log_size, get_u32(data + OFFSET_INTERVAL));
+    memcpy(recording->ring, data + HEADER_SIZE + base_size, log_size);
+    recording->end = recording->segment = log_size;
+    recording->end_pc = get_u32(data + OFFSET_END_PC);
+    free(data);
+    if (!check_log(recording)) {
+        recorder_free(recording);
+        return RECORDER_CORRUPT;
+    }
+    return RECORDER_OK;
+}
+
+const char* recorder_error_string(RecorderError error) {
+    switch (error) {
+        case RECORDER_OK:            return "no error";
+        case RECORDER_IO_ERROR:      return "couldn't be read or written";
+        case RECORDER_NOT_A_LOG:     return "isn't a log";
+        case RECORDER_BAD_VERSION:   return "was written by an incompatible version";
+        case RECORDER_WRONG_PROGRAM: return "was recorded from a different program";
+        case RECORDER_CORRUPT:       return "is corrupt";
+        case RECORDER_OUT_OF_RANGE:  return "doesn't cover that instruction";
+        case RECORDER_DIVERGED:      return "doesn't match the program's replay";
+    }
+    return "has an unknown problem";
+}
\ No newline at end of file
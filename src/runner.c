@@ -0,0 +1,471 @@
+/* Runs large numbers of jobs on a pool of threads.
+
+Every worker owns a deque, which starts out holding a
+contiguous run of the jobs. Owners take jobs from the
+front of their own deque, so each thread works through
+its share in submission order, and idle workers steal
+from the back of someone else's, which is the work the
+owner would have gotten to last. Since no jobs are added
+once running, each deque is just a window into a fixed
+array, and a plain mutex is plenty for how rarely two
+threads touch the same one. */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
+#endif
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "lexer.h"
+#include "decoder.h"
+#include "bytecode.h"
+#include "runner.h"
+#include "snapshot.h"
+#include "scheduler.h"
+
+#include "fiesta/str.h"
+
+typedef struct {
+    pthread_mutex_t lock;
+    int front;
+    int back; // One past the last job
+} JobDeque;
+
+typedef struct {
+    Job* jobs;
+    JobDeque* deques;
+    int num_threads;
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_cond;
+    int waiting_for; // The job the calling thread is blocked on
+} Runner;
+
+typedef struct {
+    Runner* runner;
+    int id;
+} Worker;
+
+static int take_front(JobDeque* deque) {
+    pthread_mutex_lock(&deque->lock);
+    int job = deque->front < deque->back ? deque->front++ : -1;
+    pthread_mutex_unlock(&deque->lock);
+    return job;
+}
+
+static int take_back(JobDeque* deque) {
+    pthread_mutex_lock(&deque->lock);
+    int job = deque->front < deque->back ? --deque->back : -1;
+    pthread_mutex_unlock(&deque->lock);
+    return job;
+}
+
+static int next_job(Worker* worker) {
+    Runner* runner = worker->runner;
+    int job = take_front(&runner->deques[worker->id]);
+    // Go round the other workers, starting with the next one along
+    for (int i = 1; job == -1 && i < runner->num_threads; i++)
+        job = take_back(&runner->deques[(worker->id + i) % runner->num_threads]);
+    return job;
+}
+
+// Sets up the VM a job starts with, which prints to the job's own output
+static VM job_vm(Job* job) {
+    VM vm = job->start != NULL ? *job->start : (VM){0};
+    for (int i = 0; i < NUM_GP_REGISTERS; i++) {
+        if (job->set_mask & 1 << i)
+            vm.registers[i].value = job->registers[i];
+    }
+    for (int i = 0; i < job->num_memory; i++)
+        vm.memory[job->memory[i].address] = job->memory[i].value;
+    job->output = output_sink_arena();
+    vm.output = &job->output;
+    return vm;
+}
+
+static void run_job(Job* job) {
+    VM vm = job_vm(job);
+    job->error = vm_run_decoded(&vm, (DecodedProgram*)job->program);
+}
+
+static void* worker_main(void* arg) {
+    Worker* worker = arg;
+    Runner* runner = worker->runner;
+
+    int index;
+    while ((index = next_job(worker)) != -1) {
+        run_job(&runner->jobs[index]);
+
+        pthread_mutex_lock(&runner->done_lock);
+        runner->jobs[index].done = true;
+        if (index == runner->waiting_for)
+            pthread_cond_signal(&runner->done_cond);
+        pthread_mutex_unlock(&runner->done_lock);
+    }
+    return NULL;
+}
+
+void runner_run(Job* jobs, int num_jobs, int num_threads, JobCallback emit, void* user_data) {
+    if (num_threads < 1)
+        num_threads = 1;
+
+    Runner runner = {.jobs = jobs, .num_threads = num_threads, .waiting_for = -1};
+    runner.deques = malloc(sizeof(JobDeque) * num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        pthread_mutex_init(&runner.deques[i].lock, NULL);
+        runner.deques[i].front = (long long)num_jobs * i / num_threads;
+        runner.deques[i].back = (long long)num_jobs * (i + 1) / num_threads;
+    }
+    pthread_mutex_init(&runner.done_lock, NULL);
+    pthread_cond_init(&runner.done_cond, NULL);
+    for (int i = 0; i < num_jobs; i++)
+        jobs[i].done = false;
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * num_threads);
+    Worker* workers = malloc(sizeof(Worker) * num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        workers[i] = (Worker){.runner = &runner, .id = i};
+        pthread_create(&threads[i], NULL, worker_main, &workers[i]);
+    }
+
+    // Emit jobs in order as they finish, instead of waiting for all of them
+    for (int i = 0; i < num_jobs; i++) {
+        pthread_mutex_lock(&runner.done_lock);
+        runner.waiting_for = i;
+        while (!jobs[i].done)
+            pthread_cond_wait(&runner.done_cond, &runner.done_lock);
+        pthread_mutex_unlock(&runner.done_lock);
+
+        if (emit != NULL)
+            emit(&jobs[i], i, user_data);
+    }
+
+    for (int i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+    for (int i = 0; i < num_threads; i++)
+        pthread_mutex_destroy(&runner.deques[i].lock);
+    pthread_mutex_destroy(&runner.done_lock);
+    pthread_cond_destroy(&runner.done_cond);
+    free(threads);
+    free(workers);
+    free(runner.deques);
+}
+
+int runner_default_threads() {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0)
+        return count;
+#endif
+    return 1;
+}
+
+/* Manifests list one job per line: the path of a
+program (source or bytecode), then its inputs, each
+of which sets a register (r3=10) or a memory byte
+(@16=10), or starts the job from a snapshot taken
+from the same program (from=warm.snap), with any
+other inputs applied on top. Blank lines, and
+comments starting with a semicolon, are skipped. */
+
+typedef struct {
+    char* path;
+    DecodedProgram program;
+    BytecodeImage image;
+    uint32_t id; // For matching snapshots up with it
+} LoadedProgram;
+
+// A snapshot restored once, for every job from it to start from a copy of
+typedef struct {
+    char* path;
+    const LoadedProgram* program;
+    VM vm;
+} LoadedSnapshot;
+
+typedef struct {
+    LoadedSnapshot** snapshots; // Never moved, since jobs point into them
+    int num_snapshots;
+    int capacity;
+} SnapshotCache;
+
+typedef struct {
+    LoadedProgram** programs; // Never moved, since jobs point into them
+    int num_programs;
+    int capacity;
+} ProgramCache;
+
+static LoadedProgram* load_program(ProgramCache* cache, const char* path) {
+    for (int i = 0; i < cache->num_programs; i++) {
+        if (!strcmp(cache->programs[i]->path, path))
+            return cache->programs[i];
+    }
+
+    LoadedProgram loaded = {0};
+    loaded.image = bytecode_load(path);
+    if (loaded.image.error == BYTECODE_OK) {
+        loaded.program = loaded.image.decoded;
+        Label* labels = bytecode_labels(&loaded.image);
+        loaded.id = snapshot_program_id(loaded.image.instrs, loaded.image.header->num_instrs,
+                                        labels, loaded.image.header->num_labels);
+        free(labels);
+    }
+    else if (loaded.image.error == BYTECODE_NOT_AN_IMAGE) {
+        str src = read_file_to_str(path);
+        if (src.data == NULL)
+            return NULL;
+        LexerState lexed = lexer_lex(src);
+        if (!lexed.had_error) {
+            loaded.program = decoder_decode(lexed.instrs, lexed.cur_instr + 1,
+                                            lexed.labels, lexed.num_labels);
+            loaded.id = snapshot_program_id(lexed.instrs, lexed.cur_instr + 1,
+                                            lexed.labels, lexed.num_labels);
+        }
+        bool had_error = lexed.had_error;
+        lexer_free(&lexed);
+        str_free(&src);
+        if (had_error)
+            return NULL;
+    }
+    else
+        return NULL;
+
+    loaded.path = strdup(path);
+    if (cache->num_programs == cache->capacity) {
+        cache->capacity = cache->capacity ? cache->capacity * 2 : 8;
+        cache->programs = realloc(cache->programs, sizeof(LoadedProgram*) * cache->capacity);
+    }
+    LoadedProgram* stored = malloc(sizeof(LoadedProgram));
+    *stored = loaded;
+    cache->programs[cache->num_programs++] = stored;
+    return stored;
+}
+
+static void free_programs(ProgramCache* cache) {
+    for (int i = 0; i < cache->num_programs; i++) {
+        LoadedProgram* loaded = cache->programs[i];
+        if (loaded->image.error == BYTECODE_OK)
+            bytecode_unload(&loaded->image);
+        else
+            decoder_free(&loaded->program);
+        free(loaded->path);
+        free(loaded);
+    }
+    free(cache->programs);
+}
+
+static const VM* load_snapshot(SnapshotCache* cache, const char* path,
+                               const LoadedProgram* program, SnapshotError* error) {
+    for (int i = 0; i < cache->num_snapshots; i++) {
+        LoadedSnapshot* loaded = cache->snapshots[i];
+        if (loaded->program == program && !strcmp(loaded->path, path))
+            return &loaded->vm;
+    }
+
+    Snapshot snapshot;
+    VM vm = {0};
+    *error = snapshot_read(path, &snapshot);
+    if (*error == SNAPSHOT_OK)
+        *error = snapshot_restore(&vm, &snapshot, program->id);
+    snapshot_free(&snapshot);
+    if (*error != SNAPSHOT_OK)
+        return NULL;
+
+    if (cache->num_snapshots == cache->capacity) {
+        cache->capacity = cache->capacity ? cache->capacity * 2 : 8;
+        cache->snapshots = realloc(cache->snapshots, sizeof(LoadedSnapshot*) * cache->capacity);
+    }
+    LoadedSnapshot* stored = malloc(sizeof(LoadedSnapshot));
+    *stored = (LoadedSnapshot){.path = strdup(path), .program = program, .vm = vm};
+    cache->snapshots[cache->num_snapshots++] = stored;
+    return &stored->vm;
+}
+
+static void free_snapshots(SnapshotCache* cache) {
+    for (int i = 0; i < cache->num_snapshots; i++) {
+        free(cache->snapshots[i]->path);
+        free(cache->snapshots[i]);
+    }
+    free(cache->snapshots);
+}
+
+static bool parse_input(Job* job, char* token) {
+    char* end;
+    if (token[0] == 'r' && isdigit(token[1]) && token[2] == '=') {
+        int reg = token[1] - '0';
+        long value = strtol(token + 3, &end, 0);
+        if (reg >= NUM_GP_REGISTERS || *end != '\0' || value < 0 || value > UINT8_MAX)
+            return false;
+        job->registers[reg] = value;
+        job->set_mask |= 1 << reg;
+        return true;
+    }
+    if (token[0] == '@') {
+        long address = strtol(token + 1, &end, 0);
+        if (*end != '=' || address < 0 || address >= MEMORY_SIZE)
+            return false;
+        long value = strtol(end + 1, &end, 0);
+        if (*end != '\0' || value < 0 || value > UINT8_MAX)
+            return false;
+        job->memory = realloc(job->memory, sizeof(MemoryInput) * (job->num_memory + 1));
+        job->memory[job->num_memory++] = (MemoryInput){.address = address, .value = value};
+        return true;
+    }
+    return false;
+}
+
+typedef struct {
+    OutputSink stdout_sink;
+    int result;
+} EmitState;
+
+static void emit_job(Job* job, int index, void* user_data) {
+    EmitState* state = user_data;
+
+    output_put(&state->stdout_sink, job->output.data, job->output.len);
+    output_free(&job->output);
+
+    const char* message = NULL;
+    switch (job->error.type) {
+        case NONE: case HALT:
+            break;
+        case INVALID_INSTRUCTION:
+            message = "invalid instruction";
+            break;
+        case INVALID_OPERAND:
+            message = "invalid operand";
+            break;
+        case YIELD:
+            message = "ran out of fuel";
+            break;
+        case BLOCKED:
+            message = "blocked on a channel";
+            break;
+    }
+    if (message != NULL) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "Error: job %d: %s\n", index + 1, message);
+        output_put(&state->stdout_sink, line, len);
+        state->result = 1;
+    }
+}
+
+/* Gives channel 0 whatever is on stdin, but only
+once a task is waiting for it, so that reading never
+holds up tasks that could be running */
+static bool feed_stdin(Scheduler* scheduler, void* user_data) {
+    (void)user_data;
+    if (!scheduler_is_waiting(scheduler, 0, false))
+        return false;
+    int c = getchar();
+    if (c == EOF)
+        return false;
+    channel_send(scheduler->channels, 0, c);
+    return true;
+}
+
+/* Runs every job as a green thread on the calling
+thread, so that they can talk over channels. Jobs
+still blocked at the end are deadlocked, and fail. */
+static void run_green(Job* jobs, int num_jobs, JobCallback emit, void* user_data) {
+    Scheduler* scheduler = scheduler_create(SCHEDULER_QUANTUM);
+    for (int i = 0; i < num_jobs; i++) {
+        VM vm = job_vm(&jobs[i]);
+        scheduler_spawn(scheduler, jobs[i].program, &vm);
+    }
+    scheduler_run(scheduler, feed_stdin, NULL);
+
+    for (int i = 0; i < num_jobs; i++) {
+        jobs[i].error = scheduler->tasks[i].error;
+        jobs[i].done = true;
+        emit(&jobs[i], i, user_data);
+    }
+    scheduler_free(scheduler);
+}
+
+int runner_run_manifest(const char* filename, int num_threads, bool green) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error: couldn't read manifest \"%s\"\n", filename);
+        return 1;
+    }
+
+    ProgramCache cache = {0};
+    SnapshotCache snapshots = {0};
+    Job* jobs = NULL;
+    int num_jobs = 0;
+    int capacity = 0;
+    int result = 0;
+
+    char line[4096];
+    for (int line_num = 1; fgets(line, sizeof(line), file) != NULL; line_num++) {
+        char* comment = strchr(line, ';');
+        if (comment != NULL)
+            *comment = '\0';
+
+        char* token = strtok(line, " \t\r\n");
+        if (token == NULL)
+            continue;
+
+        LoadedProgram* program = load_program(&cache, token);
+        if (program == NULL) {
+            printf("Error: manifest line %d: program \"%s\" couldn't be loaded\n", line_num, token);
+            result = 1;
+            break;
+        }
+        Job job = {.program = &program->program};
+        while ((token = strtok(NULL, " \t\r\n")) != NULL) {
+            if (!strncmp(token, "from=", 5)) {
+                SnapshotError error;
+                job.start = load_snapshot(&snapshots, token + 5, program, &error);
+                if (job.start == NULL) {
+                    printf("Error: manifest line %d: snapshot \"%s\" %s\n", line_num, token + 5,
+                           snapshot_error_string(error));
+                    result = 1;
+                    break;
+                }
+            }
+            else if (!parse_input(&job, token)) {
+                printf("Error: manifest line %d: invalid input \"%s\"\n", line_num, token);
+                result = 1;
+                break;
+            }
+        }
+        if (result != 0) {
+            free(job.memory);
+            break;
+        }
+
+        if (num_jobs == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            jobs = realloc(jobs, sizeof(Job) * capacity);
+        }
+        jobs[num_jobs++] = job;
+    }
+    fclose(file);
+
+    if (result == 0) {
+        EmitState state = {.stdout_sink = output_sink_stdout()};
+        if (green)
+            run_green(jobs, num_jobs, emit_job, &state);
+        else
+            runner_run(jobs, num_jobs, num_threads, emit_job, &state);
+        output_free(&state.stdout_sink);
+        result = state.result;
+    }
+
+    for (int i = 0; i < num_jobs; i++) {
+        free(jobs[i].memory);
+        output_free(&jobs[i].output);
+    }
+    free(jobs);
+    free_programs(&cache);
+    free_snapshots(&snapshots);
+    return result;
+}
\ No newline at end of file
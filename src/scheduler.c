@@ -0,0 +1,138 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strvm.h"
+#include "decoder.h"
+#include "channel.h"
+#include "scheduler.h"
+
+Scheduler* scheduler_create(uint32_t quantum) {
+    Scheduler* scheduler = calloc(1, sizeof(Scheduler));
+    scheduler->channels = channel_set_create();
+    scheduler->quantum = quantum > 0 ? quantum : SCHEDULER_QUANTUM;
+    for (int i = 0; i < NUM_CHANNELS; i++) {
+        for (int sending = 0; sending < 2; sending++)
+            scheduler->waiting[i][sending] = (WaitList){.head = -1, .tail = -1};
+    }
+    return scheduler;
+}
+
+void scheduler_free(Scheduler* scheduler) {
+    channel_set_free(scheduler->channels);
+    for (int i = 0; i < scheduler->num_tasks; i++)
+        free(scheduler->tasks[i].vm);
+    free(scheduler->tasks);
+    free(scheduler->ready);
+    free(scheduler);
+}
+
+// Every task is queued at most once, so the queue never needs more room than there are tasks
+static void make_ready(Scheduler* scheduler, int task) {
+    scheduler->tasks[task].state = TASK_READY;
+    int tail = (scheduler->ready_head + scheduler->ready_len++) % scheduler->capacity;
+    scheduler->ready[tail] = task;
+}
+
+static int next_ready(Scheduler* scheduler) {
+    int task = scheduler->ready[scheduler->ready_head];
+    scheduler->ready_head = (scheduler->ready_head + 1) % scheduler->capacity;
+    scheduler->ready_len--;
+    return task;
+}
+
+/* Starts a task off from a copy of `start`, which
+should already have its output set. Returns its index
+into `tasks`. */
+int scheduler_spawn(Scheduler* scheduler, const DecodedProgram* program, const VM* start) {
+    if (scheduler->num_tasks == scheduler->capacity) {
+        int capacity = scheduler->capacity ? scheduler->capacity * 2 : 16;
+        scheduler->tasks = realloc(scheduler->tasks, sizeof(Task) * capacity);
+        // Unwrap the ready queue into the bigger ring
+        int* ready = malloc(sizeof(int) * capacity);
+        for (int i = 0; i < scheduler->ready_len; i++)
+            ready[i] = scheduler->ready[(scheduler->ready_head + i) % scheduler->capacity];
+        free(scheduler->ready);
+        scheduler->ready = ready;
+        scheduler->ready_head = 0;
+        scheduler->capacity = capacity;
+    }
+
+    int task = scheduler->num_tasks++;
+    VM* vm = malloc(sizeof(VM));
+    *vm = *start;
+    vm->channels = scheduler->channels;
+    scheduler->tasks[task] = (Task){.vm = vm, .program = program, .next_waiting = -1};
+    make_ready(scheduler, task);
+    return task;
+}
+
+static void park(Scheduler* scheduler, int task) {
+    ChannelSet* channels = scheduler->channels;
+    WaitList* list = &scheduler->waiting[channels->blocked_channel][channels->blocked_sending];
+    scheduler->tasks[task].state = TASK_BLOCKED;
+    scheduler->tasks[task].next_waiting = -1;
+    if (list->tail == -1)
+        list->head = task;
+    else
+        scheduler->tasks[list->tail].next_waiting = task;
+    list->tail = task;
+}
+
+static void wake_all(Scheduler* scheduler, WaitList* list) {
+    for (int task = list->head; task != -1; task = scheduler->tasks[task].next_waiting)
+        make_ready(scheduler, task);
+    *list = (WaitList){.head = -1, .tail = -1};
+}
+
+/* Anything sent might let a receiver through, and
+anything received might make room for a sender. Those
+woken just try again, and park again if they lost out
+to another task. */
+static void wake_touched(Scheduler* scheduler) {
+    ChannelSet* channels = scheduler->channels;
+    for (int i = 0; i < channels->num_touched; i++) {
+        uint8_t channel = channels->touched_list[i];
+        if (channels->touched[channel] & CHANNEL_SENT)
+            wake_all(scheduler, &scheduler->waiting[channel][false]);
+        if (channels->touched[channel] & CHANNEL_RECEIVED)
+            wake_all(scheduler, &scheduler->waiting[channel][true]);
+    }
+    channel_clear_touched(channels);
+}
+
+/* Runs until every task is done or blocked with
+nothing left to wake it. Returns how many are still
+blocked, which is more than zero on deadlock. */
+int scheduler_run(Scheduler* scheduler, IdleCallback idle, void* user_data) {
+    for (;;) {
+        while (scheduler->ready_len > 0) {
+            int index = next_ready(scheduler);
+            Task* task = &scheduler->tasks[index];
+            VM_Budget budget = {.fuel = scheduler->quantum};
+            task->error = vm_run_decoded_budget(task->vm, (DecodedProgram*)task->program, &budget);
+
+            // A task can't unblock itself, so it's woken by anything it did before parking
+            wake_touched(scheduler);
+            if (task->error.type == YIELD)
+                make_ready(scheduler, index);
+            else if (task->error.type == BLOCKED)
+                park(scheduler, index);
+            else
+                task->state = TASK_DONE;
+        }
+
+        if (idle == NULL || !idle(scheduler, user_data))
+            break;
+        wake_touched(scheduler);
+    }
+
+    int blocked = 0;
+    for (int i = 0; i < scheduler->num_tasks; i++)
+        blocked += scheduler->tasks[i].state == TASK_BLOCKED;
+    return blocked;
+}
+
+bool scheduler_is_waiting(const Scheduler* scheduler, uint8_t channel, bool sending) {
+    return scheduler->waiting[channel][sending].head != -1;
+}
\ No newline at end of file
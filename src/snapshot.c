@@ -0,0 +1,248 @@
+/* Snapshots of running VMs, so that programs which
+always start the same way can skip straight past that
+part. A snapshot is taken once, after the common
+prologue, and then restored into as many fresh VMs as
+needed.
+
+Memory is stored up to its last non-zero byte, since
+VMs start out zeroed and prologues rarely fill all of
+it. A snapshot also records which program it was taken
+from, and won't be restored into any other, since the
+instruction pointer would be meaningless there. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "snapshot.h"
+
+#define HEADER_SIZE 24
+// Registers, flags, counters, and the length of the memory that follows
+#define STATE_SIZE  23
+
+// Byte offsets into a snapshot
+enum {
+    OFFSET_MAGIC        = 0,
+    OFFSET_VERSION      = 8,
+    OFFSET_CHECKSUM     = 12, // FNV-1a of everything after the header
+    OFFSET_PROGRAM_ID   = 16,
+    OFFSET_SIZE         = 20, // Of the whole snapshot, header included
+    OFFSET_REGISTERS    = HEADER_SIZE,
+    OFFSET_ZERO         = OFFSET_REGISTERS + NUM_GP_REGISTERS,
+    OFFSET_STATUS       = OFFSET_ZERO + 1,
+    OFFSET_COMPARE      = OFFSET_STATUS + 1,
+    OFFSET_PC           = OFFSET_COMPARE + 1,
+    OFFSET_IP           = OFFSET_PC + 4,
+    OFFSET_MEMORY_LEN   = OFFSET_IP + 4,
+    OFFSET_MEMORY       = OFFSET_MEMORY_LEN + 4
+};
+
+_Static_assert(OFFSET_MEMORY == HEADER_SIZE + STATE_SIZE, "snapshot layout is out of date");
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void put_u16(uint8_t* at, uint16_t value) {
+    at[0] = value;
+    at[1] = value >> 8;
+}
+
+static void put_u32(uint8_t* at, uint32_t value) {
+    put_u16(at, value);
+    put_u16(at + 2, value >> 16);
+}
+
+static uint16_t get_u16(const uint8_t* at) {
+    return at[0] | at[1] << 8;
+}
+
+static uint32_t get_u32(const uint8_t* at) {
+    return get_u16(at) | (uint32_t)get_u16(at + 2) << 16;
+}
+
+/* Identifies a program by its instructions, widths
+included, and where its labels point, field by field so
+that struct padding doesn't get involved. Label names
+are left out, since bytecode images don't keep them. */
+uint32_t snapshot_program_id(const Instruction instrs[], int num_instrs,
+                             const Label labels[], int num_labels) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < num_instrs; i++) {
+        uint8_t bytes[2 + NUM_OPERANDS * 5];
+        bytes[0] = instrs[i].type;
+        bytes[1] = instrs[i].width;
+        for (int j = 0; j < NUM_OPERANDS; j++) {
+            const Operand* op = &instrs[i].operands[j];
+            bytes[2 + j * 5] = op->is_register | op->is_label << 1;
+            put_u32(&bytes[3 + j * 5], op->value);
+        }
+        hash = fnv1a(hash, bytes, sizeof(bytes));
+    }
+    for (int i = 0; i < num_labels; i++) {
+        uint8_t bytes[5];
+        put_u32(bytes, labels[i].address);
+        bytes[4] = labels[i].defined;
+        hash = fnv1a(hash, bytes, sizeof(bytes));
+    }
+    return hash;
+}
+
+Snapshot snapshot_take(const VM* vm, uint32_t program_id) {
+    int memory_len = MEMORY_SIZE;
+    while (memory_len > 0 && vm->memory[memory_len - 1] == 0)
+        memory_len--;
+
+    Snapshot snapshot = {.size = OFFSET_MEMORY + memory_len};
+    uint8_t* data = snapshot.data = calloc(snapshot.size, 1);
+
+    memcpy(data + OFFSET_MAGIC, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    put_u32(data + OFFSET_VERSION, SNAPSHOT_VERSION);
+    put_u32(data + OFFSET_PROGRAM_ID, program_id);
+    put_u32(data + OFFSET_SIZE, snapshot.size);
+
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        data[OFFSET_REGISTERS + i] = vm->registers[i].value;
+    data[OFFSET_ZERO] = vm->zero_register.value;
+    data[OFFSET_STATUS] = vm->status_register.carry
+                        | vm->status_register.overflow << 1
+                        | vm->status_register.not_zero << 2;
+    data[OFFSET_COMPARE] = vm->compare_register.not_equal
+                         | vm->compare_register.equal << 1
+                         | vm->compare_register.greater_than << 2
+                         | vm->compare_register.less_than << 3;
+    put_u32(data + OFFSET_PC, vm->program_counter);
+    put_u32(data + OFFSET_IP, vm->instr_ptr);
+    put_u32(data + OFFSET_MEMORY_LEN, memory_len);
+    memcpy(data + OFFSET_MEMORY, vm->memory, memory_len);
+
+    put_u32(data + OFFSET_CHECKSUM, fnv1a(2166136261u, data + HEADER_SIZE,
+                                          snapshot.size - HEADER_SIZE));
+    return snapshot;
+}
+
+static SnapshotError validate(const Snapshot* snapshot) {
+    const uint8_t* data = snapshot->data;
+    if (snapshot->size < HEADER_SIZE || memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)))
+        return SNAPSHOT_NOT_A_SNAPSHOT;
+    if (get_u32(data + OFFSET_VERSION) != SNAPSHOT_VERSION)
+        return SNAPSHOT_BAD_VERSION;
+    if (get_u32(data + OFFSET_SIZE) != snapshot->size || snapshot->size < OFFSET_MEMORY
+        || get_u32(data + OFFSET_MEMORY_LEN) > MEMORY_SIZE
+        || OFFSET_MEMORY + get_u32(data + OFFSET_MEMORY_LEN) != snapshot->size)
+        return SNAPSHOT_CORRUPT;
+    if (fnv1a(2166136261u, data + HEADER_SIZE, snapshot->size - HEADER_SIZE)
+        != get_u32(data + OFFSET_CHECKSUM))
+        return SNAPSHOT_CORRUPT;
+    return SNAPSHOT_OK;
+}
+
+/* Overwrites everything in `vm` that a snapshot
+holds, leaving its labels and output alone. `vm` is
+left untouched if the snapshot can't be used. */
+SnapshotError snapshot_restore(VM* vm, const Snapshot* snapshot, uint32_t program_id) {
+    SnapshotError error = validate(snapshot);
+    if (error != SNAPSHOT_OK)
+        return error;
+    const uint8_t* data = snapshot->data;
+    if (get_u32(data + OFFSET_PROGRAM_ID) != program_id)
+        return SNAPSHOT_WRONG_PROGRAM;
+
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        vm->registers[i].value = data[OFFSET_REGISTERS + i];
+    vm->zero_register.value = data[OFFSET_ZERO];
+    uint8_t status = data[OFFSET_STATUS];
+    vm->status_register.carry = status & 1;
+    vm->status_register.overflow = status >> 1 & 1;
+    vm->status_register.not_zero = status >> 2 & 1;
+    uint8_t compare = data[OFFSET_COMPARE];
+    vm->compare_register.not_equal = compare & 1;
+    vm->compare_register.equal = compare >> 1 & 1;
+    vm->compare_register.greater_than = compare >> 2 & 1;
+    vm->compare_register.less_than = compare >> 3 & 1;
+    vm->program_counter = get_u32(data + OFFSET_PC);
+    vm->instr_ptr = get_u32(data + OFFSET_IP);
+
+    int memory_len = get_u32(data + OFFSET_MEMORY_LEN);
+    memcpy(vm->memory, data + OFFSET_MEMORY, memory_len);
+    memset(vm->memory + memory_len, 0, MEMORY_SIZE - memory_len);
+    return SNAPSHOT_OK;
+}
+
+/* Starts `num_forks` VMs off exactly where `vm` is.
+A whole VM is one flat struct, so copying it outright
+is a single memcpy, cheaper than checking and unpacking
+a snapshot: restore a snapshot once, then fork from
+that instead of restoring it over and over. */
+void snapshot_fork(const VM* vm, VM forks[], int num_forks) {
+    for (int i = 0; i < num_forks; i++)
+        forks[i] = *vm;
+}
+
+SnapshotError snapshot_write(const char* filename, const Snapshot* snapshot) {
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+        return SNAPSHOT_IO_ERROR;
+    SnapshotError error = SNAPSHOT_OK;
+    if (fwrite(snapshot->data, 1, snapshot->size, file) != snapshot->size)
+        error = SNAPSHOT_IO_ERROR;
+    if (fclose(file) != 0)
+        error = SNAPSHOT_IO_ERROR;
+    return error;
+}
+
+/* Reads and checks a snapshot, but doesn't check which
+program it belongs to, since that's only known once
+it's restored */
+SnapshotError snapshot_read(const char* filename, Snapshot* snapshot) {
+    *snapshot = (Snapshot){0};
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return SNAPSHOT_IO_ERROR;
+
+    // Anything bigger than this can't be a snapshot
+    size_t capacity = OFFSET_MEMORY + MEMORY_SIZE + 1;
+    uint8_t* buffer = malloc(capacity);
+    size_t size = fread(buffer, 1, capacity, file);
+    bool failed = ferror(file);
+    fclose(file);
+    if (failed) {
+        free(buffer);
+        return SNAPSHOT_IO_ERROR;
+    }
+
+    Snapshot read = {.data = buffer, .size = size};
+    SnapshotError error = validate(&read);
+    if (error != SNAPSHOT_OK) {
+        free(buffer);
+        return error;
+    }
+
+    snapshot->data = realloc(buffer, size);
+    snapshot->size = size;
+    return SNAPSHOT_OK;
+}
+
+void snapshot_free(Snapshot* snapshot) {
+    free(snapshot->data);
+    *snapshot = (Snapshot){0};
+}
+
+const char* snapshot_error_string(SnapshotError error) {
+    switch (error) {
+        case SNAPSHOT_OK:             return "no error";
+        case SNAPSHOT_IO_ERROR:       return "couldn't be read or written";
+        case SNAPSHOT_NOT_A_SNAPSHOT: return "isn't a snapshot";
+        case SNAPSHOT_BAD_VERSION:    return "was written by an incompatible version";
+        case SNAPSHOT_WRONG_PROGRAM:  return "was taken from a different program";
+        case SNAPSHOT_CORRUPT:        return "is corrupt";
+    }
+    return "has an unknown problem";
+}
\ No newline at end of file
@@ -1,25 +1,23 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "common.h"
 #include "strvm.h"
+#include "ops.h"
+#include "trace.h"
+#include "block.h"
 
+// Only general purpose registers can be written to
 static Register* get_operand_register(VM* vm, Operand op) {
-    if (op.value < NUM_GP_REGISTERS) {
-        if (op.is_register && !op.is_label)
-            return &vm->registers[op.value];
-    }
-    else if (op.value >= NUM_GP_REGISTERS + NUM_SPECIAL_REGISTERS) {
-        switch (op.value) {
-            case NUM_GP_REGISTERS:
-                return (Register*)&vm->status_register;
-            case NUM_GP_REGISTERS+1:
-                return (Register*)&vm->compare_register;
-            case NUM_GP_REGISTERS+2:
-                return &vm->zero_register;
-        }
-    }
+    if (op.is_register && !op.is_label && op.value < NUM_GP_REGISTERS)
+        return &vm->registers[op.value];
     return NULL;
 }
 
@@ -30,8 +28,14 @@ error code (-1), while also preserving the full
 range of an unsigned 8-bit integer for values. */
 static int16_t get_operand_value(VM* vm, Operand op) {
     // Operand is a register
-    if (op.is_register)
-        return vm->registers[op.value].value;
+    if (op.is_register) {
+        if (op.value < NUM_GP_REGISTERS)
+            return vm->registers[op.value].value;
+        /* rz always reads as 0. The other special
+        registers are flags or wider than a byte, so they
+        can't be used as values. */
+        return op.value == REGISTER_RZ ? 0 : -1;
+    }
     // Operand is an immediate
     else if (!op.is_label)
         return op.value;
@@ -39,7 +43,98 @@ static int16_t get_operand_value(VM* vm, Operand op) {
     return -1;
 }
 
-static VM_Error execute_instruction(VM* vm, Instruction instr) {
+// Labels that were never given an address go to the start
+static uint32_t label_address(VM* vm, Operand op) {
+    return op.value < (uint32_t)vm->num_labels ? vm->labels[op.value].address : 0;
+}
+
+/* Wide operands are checked like the others, except
+that a register also has to leave room for the rest of
+its group. Returns NULL or false if it's invalid. */
+static Register* get_wide_register(VM* vm, Operand op, uint8_t width) {
+    if (op.is_register && !op.is_label && op.value <= NUM_GP_REGISTERS - (1u << width))
+        return &vm->registers[op.value];
+    return NULL;
+}
+
+static bool get_wide_value(VM* vm, Operand op, uint8_t width, uint32_t* value) {
+    if (op.is_register) {
+        if (op.value > NUM_GP_REGISTERS - (1u << width))
+            return false;
+        *value = op_wide_get(&vm->registers[op.value], width);
+    }
+    else if (!op.is_label)
+        *value = op.value & width_mask(width);
+    else
+        return false;
+    return true;
+}
+
+static VM_Error execute_wide(VM* vm, LazyFlags* flags, Instruction instr) {
+    uint8_t width = instr.width;
+    Operand* ops = instr.operands;
+    uint32_t a, b;
+    switch (instr.type) {
+        case MOV: case ADD: case SUB: case MUL: case DIV: case SHL: case SHR: case LD: {
+            Register* dst = get_wide_register(vm, ops[0], width);
+            if (dst == NULL || !get_wide_value(vm, ops[1], width, &b))
+                return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+
+            if (instr.type == LD)
+                op_wide_set(dst, width, op_wide_load(vm->memory, b, width));
+            else {
+                uint32_t result = op_wide_arith(instr.type, op_wide_get(dst, width), b)
+                                & width_mask(width);
+                op_wide_set(dst, width, result);
+                if (instr.type != MOV)
+                    flags->result = result != 0;
+            }
+
+            break;
+        }
+        case STR: case CMP: {
+            if (!get_wide_value(vm, ops[0], width, &a) || !get_wide_value(vm, ops[1], width, &b))
+                return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+
+            if (instr.type == STR)
+                op_wide_store(vm->memory, a, width, b);
+            else
+                flags_cmp(flags, a, b);
+
+            break;
+        }
+        default: {
+            return (VM_Error){.type = INVALID_INSTRUCTION};
+        }
+    }
+    return (VM_Error){.type = NONE};
+}
+
+/* Every operand of a bulk instruction is a value at
+the instruction's width, so that the 8-bit versions
+work on the first 256 bytes, and .w and .d ones can
+reach the rest */
+static VM_Error execute_bulk(VM* vm, LazyFlags* flags, Instruction instr) {
+    uint32_t values[NUM_OPERANDS] = {0};
+    int num_operands = instr.type == PTS ? 2 : 3;
+    for (int i = 0; i < num_operands; i++) {
+        if (!get_wide_value(vm, instr.operands[i], instr.width, &values[i]))
+            return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+    }
+
+    if (!op_bulk(vm, flags, instr.type, values[0], values[1], values[2]))
+        return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+    return (VM_Error){.type = NONE};
+}
+
+static VM_Error execute_instruction(VM* vm, LazyFlags* flags, Instruction instr) {
+    if (instr.width >= NUM_WIDTHS)
+        return (VM_Error){.type = INVALID_INSTRUCTION};
+    if (instr.type >= MCPY && instr.type <= PTS)
+        return execute_bulk(vm, flags, instr);
+    if (instr.width != WIDTH_BYTE)
+        return execute_wide(vm, flags, instr);
+
     switch (instr.type) {
         case NOP: {
             break;
@@ -56,67 +151,49 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
 
             break;
         }
-        case ADD: case ADC: case SUB: case MUL: case DIV: case SHL: case SHR: {
+        case ADD: case ADC: case SUB: case SBC: case MUL: case DIV: case SHL: case SHR: {
             Register* dst = get_operand_register(vm, instr.operands[0]);
             if (dst == NULL)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
             int16_t value = get_operand_value(vm, instr.operands[1]);
             if (value == -1)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
-            int test = 0;
             switch (instr.type) {
                 case ADD: dst->value += value; break;
-                case ADC: {
-                    dst->value |= vm->status_register.carry;
-                    // Kind of cheating to detect carry/overflow
-                    if (dst->value + value > UINT8_MAX)
-                        vm->status_register.carry = 1;
-                    if (dst->value + value > INT8_MAX)
-                        vm->status_register.overflow = 1;
-                    dst->value += value;
-                    break;
-                }
+                case ADC: op_adc(vm, flags, &dst->value, value, false); break;
                 case SUB: dst->value -= value; break;
-                case SBC: {
-                    dst->value |= -vm->status_register.carry;
-                    if (dst->value - value > UINT8_MAX)
-                        vm->status_register.carry = 1;
-                    if (dst->value - value < INT8_MIN || dst->value - value > INT8_MAX)
-                        vm->status_register.overflow = 1;
-                    dst->value -= value;
-
-                    break;
-                }
+                case SBC: op_adc(vm, flags, &dst->value, value, true); break;
                 case MUL: dst->value *= value; break;
                 case DIV: dst->value /= value; break;
                 case SHL: dst->value <<= value; break;
                 case SHR: dst->value >>= value; break;
             }
 
-            vm->status_register.not_zero = dst->value != 0;
+            flags->result = dst->value;
 
             break;
         }
         case CLC: {
-            vm->status_register.carry = 0;
+            op_clc(vm, flags);
 
             break;
         }
         case CLV: {
-            vm->status_register.overflow = 0;
+            op_clv(vm, flags);
 
             break;
         }
         case NEG: {
-            if (instr.operands[1].is_register)
-                vm->registers[instr.operands[1].value].value = -vm->registers[instr.operands[1].value].value;
-            else
+            Register* dst = get_operand_register(vm, instr.operands[0]);
+            if (dst == NULL)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
+            dst->value = -dst->value;
+
             break;
         }
         case STR: {
-            uint8_t address = get_operand_value(vm, instr.operands[0]);
+            int16_t address = get_operand_value(vm, instr.operands[0]);
             if (address == -1)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
             int16_t value = get_operand_value(vm, instr.operands[1]);
@@ -147,15 +224,7 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (value_2 == -1)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            memset((uint8_t*)&vm->compare_register, 0, 1);
-            if (value_1 != value_2)
-                vm->compare_register.not_equal = true;
-            if (value_1 == value_2)
-                vm->compare_register.equal = true;
-            if (value_1 > value_2)
-                vm->compare_register.greater_than = true;
-            if (value_1 < value_2)
-                vm->compare_register.less_than = true;
+            flags_cmp(flags, value_1, value_2);
 
             break;
         }
@@ -163,7 +232,7 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (!instr.operands[0].is_label)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            vm->instr_ptr = vm->labels[instr.operands[0].value].address - 1;
+            vm->instr_ptr = label_address(vm, instr.operands[0]) - 1;
 
             break;
         }
@@ -171,8 +240,8 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (!instr.operands[0].is_label)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            if (vm->compare_register.not_equal)
-                vm->instr_ptr = vm->labels[instr.operands[0].value].address - 1;
+            if (flags_compare(vm, flags).not_equal)
+                vm->instr_ptr = label_address(vm, instr.operands[0]) - 1;
 
             break;
         }
@@ -180,8 +249,8 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (!instr.operands[0].is_label)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            if (vm->compare_register.equal)
-                vm->instr_ptr = vm->labels[instr.operands[0].value].address - 1;
+            if (flags_compare(vm, flags).equal)
+                vm->instr_ptr = label_address(vm, instr.operands[0]) - 1;
 
             break;
         }
@@ -189,8 +258,8 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (!instr.operands[0].is_label)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            if (vm->compare_register.greater_than)
-                vm->instr_ptr = vm->labels[instr.operands[0].value].address - 1;
+            if (flags_compare(vm, flags).greater_than)
+                vm->instr_ptr = label_address(vm, instr.operands[0]) - 1;
 
             break;
         }
@@ -198,8 +267,8 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (!instr.operands[0].is_label)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            if (vm->compare_register.less_than)
-                vm->instr_ptr = vm->labels[instr.operands[0].value].address - 1;
+            if (flags_compare(vm, flags).less_than)
+                vm->instr_ptr = label_address(vm, instr.operands[0]) - 1;
 
             break;
         }
@@ -207,10 +276,10 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (!instr.operands[0].is_label)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            if ((vm->status_register.not_zero && instr.type == JNZ)
-                || (!vm->status_register.not_zero && instr.type == JZ))
+            if ((flags->result != 0 && instr.type == JNZ)
+                || (flags->result == 0 && instr.type == JZ))
             {
-                vm->instr_ptr = vm->labels[instr.operands[0].value].address - 1;
+                vm->instr_ptr = label_address(vm, instr.operands[0]) - 1;
             }
 
             break;
@@ -220,7 +289,7 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (value == -1)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            printf("%c", (uint8_t)value);
+            op_ptc(vm->output, value);
             
             break;
         }
@@ -229,13 +298,43 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
             if (value == -1)
                 return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
 
-            printf(instr.type == PTN ? "%d" : "%u", value);
+            if (instr.type == PTN)
+                op_ptn(vm->output, value);
+            else
+                op_ptu(vm->output, value);
             
             break;
         }
         case HLT: {
             return (VM_Error){.type = HALT};
         }
+        case SND: {
+            int16_t channel = get_operand_value(vm, instr.operands[0]);
+            if (channel == -1)
+                return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+            int16_t value = get_operand_value(vm, instr.operands[1]);
+            if (value == -1)
+                return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+
+            // Left where it is, to be run again once the channel has room
+            if (!op_snd(vm, channel, value))
+                return (VM_Error){.type = BLOCKED};
+
+            break;
+        }
+        case RCV: {
+            Register* dst = get_operand_register(vm, instr.operands[0]);
+            if (dst == NULL)
+                return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+            int16_t channel = get_operand_value(vm, instr.operands[1]);
+            if (channel == -1)
+                return (VM_Error){.type = INVALID_OPERAND, .operands = instr.operands};
+
+            if (!op_rcv(vm, &dst->value, channel))
+                return (VM_Error){.type = BLOCKED};
+
+            break;
+        }
         default: {
             // TODO: VM_Errors need to hold more descriptive data
             if (instr.type >= NUM_INSTR_TYPES || instr.type < 0)
@@ -245,20 +344,279 @@ static VM_Error execute_instruction(VM* vm, Instruction instr) {
     return (VM_Error){.type = NONE};
 }
 
-VM vm_init(Label labels[MAX_LABELS], int num_labels) {
-    VM vm = {0};
-    memcpy(&vm.labels, labels, sizeof(Label[MAX_LABELS]));
-    vm.num_labels = num_labels;
-    return vm;
+/* What an operand of a verified program holds, which
+verifier_verify() has made sure is a general purpose
+register, rz, or an immediate that fits in the width */
+static inline uint8_t verified_value(const VM* vm, Operand op) {
+    if (!op.is_register)
+        return op.value;
+    return op.value == REGISTER_RZ ? 0 : vm->registers[op.value].value;
+}
+
+static inline uint32_t verified_wide_value(VM* vm, Operand op, uint8_t width) {
+    return op.is_register ? op_wide_get(&vm->registers[op.value], width) : op.value;
+}
+
+static void execute_wide_verified(VM* vm, LazyFlags* flags, Instruction instr) {
+    uint8_t width = instr.width;
+    Operand* ops = instr.operands;
+    uint32_t b = verified_wide_value(vm, ops[1], width);
+    if (instr.type == STR)
+        op_wide_store(vm->memory, verified_wide_value(vm, ops[0], width), width, b);
+    else if (instr.type == CMP)
+        flags_cmp(flags, verified_wide_value(vm, ops[0], width), b);
+    else if (instr.type == LD)
+        op_wide_set(&vm->registers[ops[0].value], width, op_wide_load(vm->memory, b, width));
+    else {
+        Register* dst = &vm->registers[ops[0].value];
+        uint32_t result = op_wide_arith(instr.type, op_wide_get(dst, width), b) & width_mask(width);
+        op_wide_set(dst, width, result);
+        if (instr.type != MOV)
+            flags->result = result != 0;
+    }
+}
+
+#define VERIFIED_JUMP_IF(cond) do { \
+        if (cond) \
+            vm->instr_ptr = vm->labels[ops[0].value].address - 1; \
+    } while (0)
+
+/* execute_instruction() for programs that passed
+verifier_verify(), which have none of what it checks
+for: every operand is of the right kind and in range,
+and every label is defined. Bulk ranges and channels
+depend on what happens at runtime, so those are still
+checked. */
+static VM_Error execute_verified(VM* vm, LazyFlags* flags, Instruction instr) {
+    Operand* ops = instr.operands;
+    if (instr.type >= MCPY)
+        return execute_bulk(vm, flags, instr);
+    if (instr.width != WIDTH_BYTE) {
+        execute_wide_verified(vm, flags, instr);
+        return (VM_Error){.type = NONE};
+    }
+
+    switch (instr.type) {
+        case MOV: vm->registers[ops[0].value].value = verified_value(vm, ops[1]); break;
+        case ADD: case ADC: case SUB: case SBC: case MUL: case DIV: case SHL: case SHR: {
+            uint8_t* dst = &vm->registers[ops[0].value].value;
+            uint8_t value = verified_value(vm, ops[1]);
+            switch (instr.type) {
+                case ADD: *dst += value; break;
+                case ADC: op_adc(vm, flags, dst, value, false); break;
+                case SUB: *dst -= value; break;
+                case SBC: op_adc(vm, flags, dst, value, true); break;
+                case MUL: *dst *= value; break;
+                case DIV: *dst /= value; break;
+                case SHL: *dst <<= value; break;
+                default:  *dst >>= value; break;
+            }
+            flags->result = *dst;
+            break;
+        }
+        case CLC: op_clc(vm, flags); break;
+        case CLV: op_clv(vm, flags); break;
+        case NEG: vm->registers[ops[0].value].value = -vm->registers[ops[0].value].value; break;
+        case STR: vm->memory[verified_value(vm, ops[0])] = verified_value(vm, ops[1]); break;
+        case LD:  vm->registers[ops[0].value].value = vm->memory[verified_value(vm, ops[1])]; break;
+        case CMP: flags_cmp(flags, verified_value(vm, ops[0]), verified_value(vm, ops[1])); break;
+        case JMP: VERIFIED_JUMP_IF(true); break;
+        case JNE: VERIFIED_JUMP_IF(flags_compare(vm, flags).not_equal); break;
+        case JE:  VERIFIED_JUMP_IF(flags_compare(vm, flags).equal); break;
+        case JGT: VERIFIED_JUMP_IF(flags_compare(vm, flags).greater_than); break;
+        case JLT: VERIFIED_JUMP_IF(flags_compare(vm, flags).less_than); break;
+        case JNZ: VERIFIED_JUMP_IF(flags->result != 0); break;
+        case JZ:  VERIFIED_JUMP_IF(flags->result == 0); break;
+        case PTC: op_ptc(vm->output, verified_value(vm, ops[0])); break;
+        case PTN: op_ptn(vm->output, verified_value(vm, ops[0])); break;
+        case PTU: op_ptu(vm->output, verified_value(vm, ops[0])); break;
+        case HLT: return (VM_Error){.type = HALT};
+        case SND: {
+            if (!op_snd(vm, verified_value(vm, ops[0]), verified_value(vm, ops[1])))
+                return (VM_Error){.type = BLOCKED};
+            break;
+        }
+        case RCV: {
+            if (!op_rcv(vm, &vm->registers[ops[0].value].value, verified_value(vm, ops[1])))
+                return (VM_Error){.type = BLOCKED};
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    return (VM_Error){.type = NONE};
+}
+
+/* Runs a single instruction, without moving on to
+the next one. Jumps set `instr_ptr` to one before
+their target. */
+VM_Error vm_execute(VM* vm, Instruction instr) {
+    LazyFlags flags = flags_load(vm);
+    VM_Error error = execute_instruction(vm, &flags, instr);
+    flags_settle(vm, &flags);
+    return error;
+}
+
+/* The VM only points at `labels`, so they have to
+outlive it */
+VM vm_init(const Label labels[], int num_labels) {
+    return (VM){.labels = labels, .num_labels = num_labels};
+}
+
+// Instructions run between checks of a deadline
+#define DEADLINE_SLICE (1u << 16)
+
+uint64_t vm_clock_ns() {
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Deadlines are checked between slices rather than
+at every backward jump, since reading the clock costs
+more than a whole run of instructions */
+uint32_t vm_budget_slice(const VM_Budget* budget) {
+    uint64_t slice = budget->deadline_ns ? DEADLINE_SLICE : UINT32_MAX;
+    return budget->fuel < slice ? budget->fuel : slice;
+}
+
+bool vm_budget_spend(VM_Budget* budget, uint32_t used) {
+    if (budget->fuel != VM_UNLIMITED_FUEL) {
+        budget->fuel = used < budget->fuel ? budget->fuel - used : 0;
+        if (budget->fuel == 0)
+            return true;
+    }
+    return budget->deadline_ns && vm_clock_ns() >= budget->deadline_ns;
+}
+
+/* Runs until `slice` instructions have gone by, then
+yields at the next backward jump, having taken it.
+Straight-line code is run a block at a time, and loops
+that get hot are handed over to traces. While a loop is
+being recorded, everything goes an instruction at a
+time, so that the recording sees each one. */
+static VM_Error run_slice(VM* vm, Instruction instrs[], int num_instrs, uint32_t slice,
+                          bool verified, TraceCache* traces, BlockCache* blocks) {
+    VM_Error error = {.type = NONE};
+    LazyFlags flags = flags_load(vm);
+    uint32_t start = vm->program_counter;
+    // Whether there could be a block here that hasn't been looked for already
+    bool look = true;
+    while (vm->instr_ptr < (uint32_t)num_instrs) {
+        uint32_t ip = vm->instr_ptr;
+        Block* block = NULL;
+#ifndef STRVM_NO_BLOCKS
+        if (look && !traces->recording)
+            block = block_at(blocks, vm, instrs, num_instrs, ip);
+#endif
+        if (block != NULL) {
+            // Stopped short of a backward jump, having looked for a block where it stopped
+            if (!block_run(vm, &flags, blocks, instrs, num_instrs, block)) {
+                look = false;
+                continue;
+            }
+        }
+        else {
+            error = verified ? execute_verified(vm, &flags, instrs[ip])
+                             : execute_instruction(vm, &flags, instrs[ip]);
+            if (error.type != NONE)
+                break;
+            if (traces->recording)
+                trace_record(traces, vm, instrs, ip);
+            // Jumps leave `instr_ptr` one before their target, which wraps around for 0
+            vm->instr_ptr++;
+            vm->program_counter++;
+            /* Code that isn't warm yet is gone through the
+            same way next time, so only where a jump lands, or
+            past something a block can't hold, is there anywhere
+            new for a block to start */
+            look = vm->instr_ptr != ip + 1 || block_refused(blocks, ip);
+            if (vm->instr_ptr > ip)
+                continue;
+        }
+
+        // Just taken a backward jump
+        if (vm->program_counter - start >= slice) {
+            error.type = YIELD;
+            break;
+        }
+        Trace* trace = trace_backward_jump(traces, vm, num_instrs);
+        if (trace != NULL) {
+            // Traces keep flags their own way, starting from the VM's
+            flags_settle(vm, &flags);
+            error = trace_run(vm, trace, start, slice);
+            flags = flags_load(vm);
+            // Otherwise it's left on a jump, for us to take
+            if (error.type == YIELD)
+                break;
+        }
+    }
+    flags_settle(vm, &flags);
+    return error;
+}
+
+VM_Error vm_run(VM* vm, Instruction instrs[], int num_instrs) {
+    VM_Budget budget = {.fuel = VM_UNLIMITED_FUEL};
+    return vm_run_budget(vm, instrs, num_instrs, &budget);
 }
 
-VM_Error vm_run(VM* vm, Instruction instrs[MAX_INSTRS], uint8_t num_instrs) {
+static VM_Error run_budget(VM* vm, Instruction instrs[], int num_instrs, VM_Budget* budget,
+                           bool verified) {
+    VM_Error error;
+    TraceCache traces = {0};
+    BlockCache blocks = {0};
+    for (;;) {
+        uint32_t start = vm->program_counter;
+        error = run_slice(vm, instrs, num_instrs, vm_budget_slice(budget), verified,
+                          &traces, &blocks);
+        if (vm_budget_spend(budget, vm->program_counter - start) || error.type != YIELD)
+            break;
+    }
+    trace_cache_free(&traces);
+    block_cache_free(&blocks);
+    if (vm->output != NULL)
+        output_flush(vm->output);
+    return error;
+}
+
+/* Runs until the program stops or `budget` runs out,
+in which case it returns YIELD. What's left of the
+budget is written back. */
+VM_Error vm_run_budget(VM* vm, Instruction instrs[], int num_instrs, VM_Budget* budget) {
+    return run_budget(vm, instrs, num_instrs, budget, false);
+}
+
+VM_Error vm_run_verified(VM* vm, Instruction instrs[], int num_instrs, VM_Budget* budget) {
+    return run_budget(vm, instrs, num_instrs, budget, true);
+}
+
+/* Like vm_run(), but stops just before running the
+instruction at `stop_at`, the first time it gets there.
+Returns NONE if it stopped there, and whatever ended
+the run otherwise. */
+VM_Error vm_run_until(VM* vm, Instruction instrs[], int num_instrs, uint32_t stop_at) {
     VM_Error error = {.type = NONE};
-    for (; vm->instr_ptr < num_instrs; vm->instr_ptr++, vm->program_counter++) {
-        error = execute_instruction(vm, instrs[vm->instr_ptr]);
-        if (error.type != NONE || error.type == HALT)
+    LazyFlags flags = flags_load(vm);
+    bool stopped = false;
+    for (; vm->instr_ptr < (uint32_t)num_instrs; vm->instr_ptr++, vm->program_counter++) {
+        stopped = vm->instr_ptr == stop_at;
+        if (stopped)
+            break;
+        error = execute_instruction(vm, &flags, instrs[vm->instr_ptr]);
+        if (error.type != NONE)
             break;
     }
+    flags_settle(vm, &flags);
+    // Running off the end counts as halting
+    if (!stopped && error.type == NONE)
+        error.type = HALT;
+    if (vm->output != NULL)
+        output_flush(vm->output);
     return error;
 }
 
@@ -275,6 +633,6 @@ void vm_print_state(VM vm) {
     printf("  gt: %s\n", vm.compare_register.greater_than ? "true" : "false");
     printf("  lt: %s\n", vm.compare_register.less_than ? "true" : "false");
     printf("rz  : %d\n", vm.zero_register.value);
-    printf("pc  : %d\n", vm.program_counter);
-    printf("ip  : %d\n", vm.instr_ptr);
+    printf("pc  : %u\n", vm.program_counter);
+    printf("ip  : %u\n", vm.instr_ptr);
 }
\ No newline at end of file
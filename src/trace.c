@@ -0,0 +1,356 @@
+/* Trace compilation for the interpreter. vm_run()
+counts the backward jumps landing on each instruction,
+and once a loop is hot, records the instructions that
+the next trip round it runs. The recording becomes a
+trace: the decoded form of those instructions, in the
+order they ran, with every jump either dropped (if it
+can only go one way) or turned into a guard.
+
+Running a trace needs far less than the interpreter:
+operands were checked when decoding, there's nowhere to
+jump but the start, a cmp and the jump after it are one
+step, and registers are copied into locals for as long
+as the trace runs. Flags are kept lazily, like in the
+other engines, and since a trace knows which cmp each
+guard depends on, most guards compare its operands
+directly instead of checking whether flags are owed. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "strvm.h"
+#include "decoder.h"
+#include "trace.h"
+#include "ops.h"
+
+void trace_cache_free(TraceCache* cache) {
+    // Everything is allocated along with `traces`
+    if (cache->traces == NULL)
+        return;
+    for (int i = 0; i < cache->num_instrs; i++) {
+        if (cache->traces[i] != NULL) {
+            free(cache->traces[i]->ops);
+            free(cache->traces[i]);
+        }
+    }
+    if (cache->decoded)
+        decoder_free(&cache->program);
+    free(cache->traces);
+    free(cache->given_up);
+    free(cache->recorded);
+    free(cache->taken);
+    *cache = (TraceCache){0};
+}
+
+static Condition jump_condition(DecodedType type) {
+    switch (type) {
+        case OP_JNE_ABS: return COND_NOT_EQUAL;
+        case OP_JE_ABS:  return COND_EQUAL;
+        case OP_JGT_ABS: return COND_GREATER_THAN;
+        case OP_JLT_ABS: return COND_LESS_THAN;
+        case OP_JNZ_ABS: return COND_NOT_ZERO;
+        default:         return COND_ZERO;
+    }
+}
+
+static bool is_cmp(uint8_t type) {
+    return type >= OP_CMP_REG_REG && type <= OP_CMP_IMM_IMM;
+}
+
+// Returns NULL if the recording has anything a trace can't run
+static Trace* compile(const TraceCache* cache) {
+    TraceOp* ops = malloc(sizeof(TraceOp) * (cache->num_recorded + 1));
+    int num_ops = 0;
+    bool compared = false; // Whether there's been a cmp yet this trip
+
+    for (int i = 0; i < cache->num_recorded; i++) {
+        uint32_t ip = cache->recorded[i];
+        DecodedInstruction instr = cache->program.instrs[ip];
+        switch ((DecodedType)instr.type) {
+            case OP_NOP: case OP_JMP_ABS:
+                break;
+
+            case OP_JNE_ABS: case OP_JE_ABS: case OP_JGT_ABS: case OP_JLT_ABS:
+            case OP_JNZ_ABS: case OP_JZ_ABS: {
+                // Both ways lead to the same place
+                if (instr.target == ip + 1)
+                    break;
+
+                TraceOp guard = {.cond = jump_condition(instr.type), .taken = cache->taken[i],
+                                 .executed = i, .exit = ip};
+                if (guard.cond == COND_NOT_ZERO || guard.cond == COND_ZERO)
+                    guard.type = TRACE_GUARD_ZERO;
+                else if (num_ops > 0 && is_cmp(ops[num_ops - 1].type)) {
+                    TraceOp* cmp = &ops[num_ops - 1];
+                    guard.type = TRACE_GUARD_CMP_REG_REG + (cmp->type - OP_CMP_REG_REG);
+                    guard.a = cmp->a;
+                    guard.b = cmp->b;
+                    *cmp = guard;
+                    break;
+                }
+                else
+                    guard.type = compared ? TRACE_GUARD_LAST_CMP : TRACE_GUARD_FLAGS;
+                ops[num_ops++] = guard;
+                break;
+            }
+
+            case OP_HLT: case OP_TRAP: case OP_END:
+            case OP_SND_REG_REG: case OP_SND_REG_IMM: case OP_SND_IMM_REG: case OP_SND_IMM_IMM:
+            case OP_RCV_REG_REG: case OP_RCV_REG_IMM:
+                free(ops);
+                return NULL;
+
+            default:
+                // Wide and bulk instructions keep their immediates out of line, where a TraceOp can't
+                if (decoded_is_wide(instr.type) || decoded_is_bulk(instr.type)) {
+                    free(ops);
+                    return NULL;
+                }
+                compared |= is_cmp(instr.type);
+                ops[num_ops++] = (TraceOp){.type = instr.type, .a = instr.a, .b = instr.b};
+        }
+    }
+    ops[num_ops++] = (TraceOp){.type = TRACE_LOOP};
+
+    Trace* trace = malloc(sizeof(Trace));
+    *trace = (Trace){.ops = ops, .num_ops = num_ops, .anchor = cache->anchor,
+                     .length = cache->num_recorded};
+    return trace;
+}
+
+/* Called at every backward jump the interpreter
+takes, once it's taken it and `instr_ptr` is on its
+target. Returns the trace to run from there, if there
+is one. */
+Trace* trace_backward_jump(TraceCache* cache, const VM* vm, int num_instrs) {
+    uint32_t anchor = vm->instr_ptr;
+    if (cache->traces != NULL) {
+        if (cache->traces[anchor] != NULL)
+            return cache->traces[anchor];
+        if (cache->given_up[anchor])
+            return NULL;
+    }
+
+    uint8_t* heat = &cache->heat[anchor % TRACE_HEAT_SLOTS];
+    if (cache->recording || ++*heat < TRACE_HOT_LOOP)
+        return NULL;
+    *heat = 0;
+    if (cache->traces == NULL) {
+        cache->num_instrs = num_instrs;
+        cache->traces = calloc(num_instrs, sizeof(Trace*));
+        cache->given_up = calloc(num_instrs, sizeof(bool));
+        cache->recorded = malloc(sizeof(uint32_t) * TRACE_MAX_LENGTH);
+        cache->taken = malloc(sizeof(bool) * TRACE_MAX_LENGTH);
+    }
+    cache->recording = true;
+    cache->anchor = anchor;
+    cache->num_recorded = 0;
+    return NULL;
+}
+
+/* Called after each instruction the interpreter runs
+while recording. The recording ends at the first
+backward jump, which makes a trace if it's back to the
+start, or gives up on the loop if it isn't. */
+void trace_record(TraceCache* cache, const VM* vm, Instruction instrs[], uint32_t ip) {
+    bool taken = vm->instr_ptr != ip;
+    cache->recorded[cache->num_recorded] = ip;
+    cache->taken[cache->num_recorded++] = taken;
+
+    // Jumps leave `instr_ptr` one before their target
+    uint32_t next = vm->instr_ptr + 1;
+    if (taken && next <= ip) {
+        cache->recording = false;
+        if (next == cache->anchor) {
+            if (!cache->decoded) {
+                // The decoder never writes to the labels
+                cache->program = decoder_decode(instrs, cache->num_instrs, (Label*)vm->labels,
+                                                vm->num_labels);
+                cache->decoded = true;
+            }
+            cache->traces[cache->anchor] = compile(cache);
+        }
+        cache->given_up[cache->anchor] = cache->traces[cache->anchor] == NULL;
+    }
+    else if (cache->num_recorded == TRACE_MAX_LENGTH) {
+        cache->recording = false;
+        cache->given_up[cache->anchor] = true;
+    }
+}
+
+static inline bool compare(uint8_t cond, uint32_t a, uint32_t b) {
+    switch (cond) {
+        case COND_NOT_EQUAL:    return a != b;
+        case COND_EQUAL:        return a == b;
+        case COND_GREATER_THAN: return a > b;
+        default:                return a < b;
+    }
+}
+
+static inline bool compare_flag(CompareFlags flags, uint8_t cond) {
+    switch (cond) {
+        case COND_NOT_EQUAL:    return flags.not_equal;
+        case COND_EQUAL:        return flags.equal;
+        case COND_GREATER_THAN: return flags.greater_than;
+        default:                return flags.less_than;
+    }
+}
+
+// See decoder.c
+#if defined(__GNUC__) && !defined(STRVM_NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
+#ifdef USE_COMPUTED_GOTO
+#define TARGET(type) case type: TARGET_##type
+#define DISPATCH()   goto *dispatch_table[op->type]
+#else
+#define TARGET(type) case type
+#define DISPATCH()   goto dispatch
+#endif
+
+#define NEXT() do { op++; DISPATCH(); } while (0)
+
+#define ALU_VARIANTS(OP, expr) \
+    TARGET(OP##_REG_REG): r[op->a] expr r[op->b]; flags.result = r[op->a]; NEXT(); \
+    TARGET(OP##_REG_IMM): r[op->a] expr op->b; flags.result = r[op->a]; NEXT();
+
+#define GUARD(cond) do { \
+        if ((cond) != op->taken) \
+            goto leave; \
+        NEXT(); \
+    } while (0)
+
+#define GUARD_CMP(x, y) do { \
+        flags_cmp(&flags, (x), (y)); \
+        GUARD(compare(op->cond, flags.cmp_a, flags.cmp_b)); \
+    } while (0)
+
+/* Runs round the loop until a guard fails, leaving
+`instr_ptr` on the jump it failed at, or until `slice`
+instructions since `start_pc` have gone by, in which
+case it yields back at the start, exactly like the
+interpreter would. */
+VM_Error trace_run(VM* vm, const Trace* trace, uint32_t start_pc, uint32_t slice) {
+#ifdef USE_COMPUTED_GOTO
+    static const void* dispatch_table[NUM_TRACE_TYPES] = {
+        [OP_MOV_REG_REG] = &&TARGET_OP_MOV_REG_REG, [OP_MOV_REG_IMM] = &&TARGET_OP_MOV_REG_IMM,
+        [OP_ADD_REG_REG] = &&TARGET_OP_ADD_REG_REG, [OP_ADD_REG_IMM] = &&TARGET_OP_ADD_REG_IMM,
+        [OP_ADC_REG_REG] = &&TARGET_OP_ADC_REG_REG, [OP_ADC_REG_IMM] = &&TARGET_OP_ADC_REG_IMM,
+        [OP_SBC_REG_REG] = &&TARGET_OP_SBC_REG_REG, [OP_SBC_REG_IMM] = &&TARGET_OP_SBC_REG_IMM,
+        [OP_SUB_REG_REG] = &&TARGET_OP_SUB_REG_REG, [OP_SUB_REG_IMM] = &&TARGET_OP_SUB_REG_IMM,
+        [OP_MUL_REG_REG] = &&TARGET_OP_MUL_REG_REG, [OP_MUL_REG_IMM] = &&TARGET_OP_MUL_REG_IMM,
+        [OP_DIV_REG_REG] = &&TARGET_OP_DIV_REG_REG, [OP_DIV_REG_IMM] = &&TARGET_OP_DIV_REG_IMM,
+        [OP_SHL_REG_REG] = &&TARGET_OP_SHL_REG_REG, [OP_SHL_REG_IMM] = &&TARGET_OP_SHL_REG_IMM,
+        [OP_SHR_REG_REG] = &&TARGET_OP_SHR_REG_REG, [OP_SHR_REG_IMM] = &&TARGET_OP_SHR_REG_IMM,
+        [OP_CLC] = &&TARGET_OP_CLC,
+        [OP_CLV] = &&TARGET_OP_CLV,
+        [OP_NEG_REG] = &&TARGET_OP_NEG_REG,
+        [OP_STR_REG_REG] = &&TARGET_OP_STR_REG_REG, [OP_STR_REG_IMM] = &&TARGET_OP_STR_REG_IMM,
+        [OP_STR_IMM_REG] = &&TARGET_OP_STR_IMM_REG, [OP_STR_IMM_IMM] = &&TARGET_OP_STR_IMM_IMM,
+        [OP_LD_REG_REG] = &&TARGET_OP_LD_REG_REG, [OP_LD_REG_IMM] = &&TARGET_OP_LD_REG_IMM,
+        [OP_CMP_REG_REG] = &&TARGET_OP_CMP_REG_REG, [OP_CMP_REG_IMM] = &&TARGET_OP_CMP_REG_IMM,
+        [OP_CMP_IMM_REG] = &&TARGET_OP_CMP_IMM_REG, [OP_CMP_IMM_IMM] = &&TARGET_OP_CMP_IMM_IMM,
+        [OP_PTC_REG] = &&TARGET_OP_PTC_REG, [OP_PTC_IMM] = &&TARGET_OP_PTC_IMM,
+        [OP_PTN_REG] = &&TARGET_OP_PTN_REG, [OP_PTN_IMM] = &&TARGET_OP_PTN_IMM,
+        [OP_PTU_REG] = &&TARGET_OP_PTU_REG, [OP_PTU_IMM] = &&TARGET_OP_PTU_IMM,
+        [TRACE_GUARD_CMP_REG_REG] = &&TARGET_TRACE_GUARD_CMP_REG_REG,
+        [TRACE_GUARD_CMP_REG_IMM] = &&TARGET_TRACE_GUARD_CMP_REG_IMM,
+        [TRACE_GUARD_CMP_IMM_REG] = &&TARGET_TRACE_GUARD_CMP_IMM_REG,
+        [TRACE_GUARD_CMP_IMM_IMM] = &&TARGET_TRACE_GUARD_CMP_IMM_IMM,
+        [TRACE_GUARD_LAST_CMP] = &&TARGET_TRACE_GUARD_LAST_CMP,
+        [TRACE_GUARD_FLAGS] = &&TARGET_TRACE_GUARD_FLAGS,
+        [TRACE_GUARD_ZERO] = &&TARGET_TRACE_GUARD_ZERO,
+        [TRACE_LOOP] = &&TARGET_TRACE_LOOP
+    };
+#endif
+
+    uint8_t r[NUM_GP_REGISTERS];
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        r[i] = vm->registers[i].value;
+    LazyFlags flags = flags_load(vm);
+
+    uint32_t pc = vm->program_counter; // As of the start of this trip
+    const TraceOp* op = trace->ops;
+    VM_Error error = {.type = NONE};
+
+#ifdef USE_COMPUTED_GOTO
+    DISPATCH();
+#else
+dispatch:
+#endif
+    switch ((TraceType)op->type) {
+        TARGET(OP_MOV_REG_REG): r[op->a] = r[op->b]; NEXT();
+        TARGET(OP_MOV_REG_IMM): r[op->a] = op->b; NEXT();
+
+        ALU_VARIANTS(OP_ADD, +=)
+        ALU_VARIANTS(OP_SUB, -=)
+        ALU_VARIANTS(OP_MUL, *=)
+        ALU_VARIANTS(OP_DIV, /=)
+        ALU_VARIANTS(OP_SHL, <<=)
+        ALU_VARIANTS(OP_SHR, >>=)
+
+        TARGET(OP_ADC_REG_REG): op_adc(vm, &flags, &r[op->a], r[op->b], false); NEXT();
+        TARGET(OP_ADC_REG_IMM): op_adc(vm, &flags, &r[op->a], op->b, false); NEXT();
+        TARGET(OP_SBC_REG_REG): op_adc(vm, &flags, &r[op->a], r[op->b], true); NEXT();
+        TARGET(OP_SBC_REG_IMM): op_adc(vm, &flags, &r[op->a], op->b, true); NEXT();
+
+        TARGET(OP_CLC): op_clc(vm, &flags); NEXT();
+        TARGET(OP_CLV): op_clv(vm, &flags); NEXT();
+
+        TARGET(OP_NEG_REG): r[op->a] = -r[op->a]; NEXT();
+
+        TARGET(OP_STR_REG_REG): vm->memory[r[op->a]] = r[op->b]; NEXT();
+        TARGET(OP_STR_REG_IMM): vm->memory[r[op->a]] = op->b; NEXT();
+        TARGET(OP_STR_IMM_REG): vm->memory[op->a] = r[op->b]; NEXT();
+        TARGET(OP_STR_IMM_IMM): vm->memory[op->a] = op->b; NEXT();
+
+        TARGET(OP_LD_REG_REG): r[op->a] = vm->memory[r[op->b]]; NEXT();
+        TARGET(OP_LD_REG_IMM): r[op->a] = vm->memory[op->b]; NEXT();
+
+        TARGET(OP_CMP_REG_REG): flags_cmp(&flags, r[op->a], r[op->b]); NEXT();
+        TARGET(OP_CMP_REG_IMM): flags_cmp(&flags, r[op->a], op->b); NEXT();
+        TARGET(OP_CMP_IMM_REG): flags_cmp(&flags, op->a, r[op->b]); NEXT();
+        TARGET(OP_CMP_IMM_IMM): flags_cmp(&flags, op->a, op->b); NEXT();
+
+        TARGET(OP_PTC_REG): op_ptc(vm->output, r[op->a]); NEXT();
+        TARGET(OP_PTC_IMM): op_ptc(vm->output, op->a); NEXT();
+        TARGET(OP_PTN_REG): op_ptn(vm->output, r[op->a]); NEXT();
+        TARGET(OP_PTN_IMM): op_ptn(vm->output, op->a); NEXT();
+        TARGET(OP_PTU_REG): op_ptu(vm->output, r[op->a]); NEXT();
+        TARGET(OP_PTU_IMM): op_ptu(vm->output, op->a); NEXT();
+
+        TARGET(TRACE_GUARD_CMP_REG_REG): GUARD_CMP(r[op->a], r[op->b]);
+        TARGET(TRACE_GUARD_CMP_REG_IMM): GUARD_CMP(r[op->a], op->b);
+        TARGET(TRACE_GUARD_CMP_IMM_REG): GUARD_CMP(op->a, r[op->b]);
+        TARGET(TRACE_GUARD_CMP_IMM_IMM): GUARD_CMP(op->a, op->b);
+        TARGET(TRACE_GUARD_LAST_CMP): GUARD(compare(op->cond, flags.cmp_a, flags.cmp_b));
+        TARGET(TRACE_GUARD_FLAGS): GUARD(compare_flag(flags_compare(vm, &flags), op->cond));
+        TARGET(TRACE_GUARD_ZERO): GUARD((flags.result != 0) == (op->cond == COND_NOT_ZERO));
+
+        TARGET(TRACE_LOOP): {
+            pc += trace->length;
+            if (pc - start_pc >= slice) {
+                error = (VM_Error){.type = YIELD};
+                vm->instr_ptr = trace->anchor;
+                vm->program_counter = pc;
+                goto done;
+            }
+            op = trace->ops;
+            DISPATCH();
+        }
+
+        default: break;
+    }
+
+leave:
+    vm->instr_ptr = op->exit;
+    vm->program_counter = pc + op->executed;
+done:
+    for (int i = 0; i < NUM_GP_REGISTERS; i++)
+        vm->registers[i].value = r[i];
+    flags_settle(vm, &flags);
+    return error;
+}
\ No newline at end of file
@@ -0,0 +1,512 @@
+/* The verifier. Every operand is first checked
+against the same rules execute_instruction() applies as
+it goes, then the program is split into basic blocks,
+and what's known about r0-r7 is followed through them
+until nothing changes: which registers have been
+written to on every path there, and which always hold
+the same value. That's enough to find unreachable code,
+reads of registers that nothing has set, and divisions
+and bulk ranges that can only fail. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "ops.h"
+#include "verifier.h"
+
+typedef enum {
+    ROLE_NONE,
+    ROLE_DST,       // A register that's written to
+    ROLE_DST_VALUE, // A register that's read, then written to
+    ROLE_VALUE,     // A register or an immediate
+    ROLE_LABEL
+} Role;
+
+#define ARITH_ROLES {ROLE_DST_VALUE, ROLE_VALUE}
+#define BULK_ROLES  {ROLE_VALUE, ROLE_VALUE, ROLE_VALUE}
+
+static const uint8_t ROLES[NUM_INSTR_TYPES][NUM_OPERANDS] = {
+    [MOV] = {ROLE_DST, ROLE_VALUE},
+    [ADD] = ARITH_ROLES, [ADC] = ARITH_ROLES, [SUB] = ARITH_ROLES, [SBC] = ARITH_ROLES,
+    [MUL] = ARITH_ROLES, [DIV] = ARITH_ROLES, [SHL] = ARITH_ROLES, [SHR] = ARITH_ROLES,
+    [NEG] = {ROLE_DST_VALUE},
+    [STR] = {ROLE_VALUE, ROLE_VALUE},
+    [LD]  = {ROLE_DST, ROLE_VALUE},
+    [CMP] = {ROLE_VALUE, ROLE_VALUE},
+    [JMP] = {ROLE_LABEL}, [JNE] = {ROLE_LABEL}, [JE] = {ROLE_LABEL}, [JGT] = {ROLE_LABEL},
+    [JLT] = {ROLE_LABEL}, [JNZ] = {ROLE_LABEL}, [JZ] = {ROLE_LABEL},
+    [PTC] = {ROLE_VALUE}, [PTN] = {ROLE_VALUE}, [PTU] = {ROLE_VALUE},
+    [SND] = {ROLE_VALUE, ROLE_VALUE},
+    [RCV] = {ROLE_DST, ROLE_VALUE},
+    [MCPY] = BULK_ROLES, [MSET] = BULK_ROLES, [MCMP] = BULK_ROLES, [MADD] = BULK_ROLES,
+    [MXOR] = BULK_ROLES,
+    [PTS] = {ROLE_VALUE, ROLE_VALUE}
+};
+
+// What's known about r0-r7 on every path to somewhere
+typedef struct {
+    bool reached;
+    uint8_t written; // Bit i is set if r<i> has been written to
+    uint8_t known;   // Bit i is set if r<i> always holds values[i]
+    uint8_t values[NUM_GP_REGISTERS];
+} RegState;
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;    // One past its last instruction
+    int succs[2];    // Other blocks, since running off the end doesn't go anywhere
+    int num_succs;
+} CfgBlock;
+
+typedef struct {
+    const Instruction* instrs;
+    int num_instrs;
+    const Label* labels;
+    int num_labels;
+    bool* bad; // Instructions that fail whenever they're run
+    VerifyResult result;
+    int issues_capacity;
+} Verifier;
+
+static bool is_jump(uint32_t type) {
+    return type >= JMP && type <= JZ;
+}
+
+static bool is_bulk(uint32_t type) {
+    return type >= MCPY && type <= PTS;
+}
+
+// Mirrors execute_wide() and execute_bulk()
+static bool has_wide_version(uint32_t type) {
+    switch (type) {
+        case MOV: case ADD: case SUB: case MUL: case DIV: case SHL: case SHR:
+        case LD: case STR: case CMP:
+            return true;
+        default:
+            return is_bulk(type);
+    }
+}
+
+// The registers a group starting at `reg` takes up
+static uint8_t group_bits(uint32_t reg, uint8_t width) {
+    return ((1u << (1u << width)) - 1) << reg;
+}
+
+static void add_issue(Verifier* v, VerifyIssueType type, uint32_t instr, int operand,
+                      uint32_t detail) {
+    VerifyResult* result = &v->result;
+    if (result->num_issues == v->issues_capacity) {
+        v->issues_capacity = v->issues_capacity ? v->issues_capacity * 2 : 16;
+        result->issues = realloc(result->issues, sizeof(VerifyIssue) * v->issues_capacity);
+    }
+    result->issues[result->num_issues++] = (VerifyIssue){.type = type, .operand = operand,
+                                                         .instr = instr, .detail = detail};
+    result->num_errors += verifier_is_error(type);
+}
+
+/* Mirrors get_operand_register(), get_operand_value()
+and their wide versions, except that immediates have to
+fit in the instruction's width, rather than being cut
+down to it */
+static bool check_operand(Verifier* v, uint32_t i, int n) {
+    const Instruction* instr = &v->instrs[i];
+    Operand op = instr->operands[n];
+    uint32_t group = 1u << instr->width;
+    bool fits = op.value <= NUM_GP_REGISTERS - group;
+    switch (ROLES[instr->type][n]) {
+        case ROLE_DST: case ROLE_DST_VALUE: {
+            if (op.is_register && !op.is_label && fits)
+                return true;
+            break;
+        }
+        case ROLE_VALUE: {
+            // Only instructions on single bytes can read rz
+            bool byte = instr->width == WIDTH_BYTE && !is_bulk(instr->type);
+            if (op.is_register) {
+                if (fits || (byte && op.value == REGISTER_RZ))
+                    return true;
+            }
+            else if (!op.is_label) {
+                if (op.value <= width_mask(instr->width))
+                    return true;
+                add_issue(v, VERIFY_OUT_OF_RANGE, i, n, 0);
+                return false;
+            }
+            break;
+        }
+        case ROLE_LABEL: {
+            if (!op.is_label)
+                break;
+            if (op.value < (uint32_t)v->num_labels && v->labels[op.value].defined)
+                return true;
+            add_issue(v, VERIFY_UNDEFINED_LABEL, i, n, op.value);
+            return false;
+        }
+        default: {
+            return true;
+        }
+    }
+    add_issue(v, VERIFY_BAD_OPERAND, i, n, 0);
+    return false;
+}
+
+// Reports every operand that's wrong, not just the first
+static bool check_instruction(Verifier* v, uint32_t i) {
+    const Instruction* instr = &v->instrs[i];
+    if ((uint32_t)instr->type >= NUM_INSTR_TYPES || instr->width >= NUM_WIDTHS
+        || (instr->width != WIDTH_BYTE && !has_wide_version(instr->type))) {
+        add_issue(v, VERIFY_BAD_INSTRUCTION, i, -1, 0);
+        return false;
+    }
+    bool ok = true;
+    for (int n = 0; n < NUM_OPERANDS; n++)
+        ok &= check_operand(v, i, n);
+    return ok;
+}
+
+/* Where an instruction can go next, with num_instrs
+for running off the end. Instructions that always fail
+don't go anywhere. */
+static int successors(const Verifier* v, uint32_t i, uint32_t succs[2]) {
+    const Instruction* instr = &v->instrs[i];
+    if (v->bad[i] || instr->type == HLT)
+        return 0;
+    int n = 0;
+    if (instr->type != JMP)
+        succs[n++] = i + 1;
+    if (is_jump(instr->type)) {
+        uint32_t target = v->labels[instr->operands[0].value].address;
+        succs[n++] = target < (uint32_t)v->num_instrs ? target : (uint32_t)v->num_instrs;
+    }
+    return n;
+}
+
+/* Blocks start at the first instruction, wherever a
+jump goes, and after anything that doesn't just carry
+on to the next instruction */
+static CfgBlock* build_cfg(Verifier* v, int* num_blocks) {
+    int n = v->num_instrs;
+    bool* leaders = calloc(n + 1, sizeof(bool));
+    leaders[0] = true;
+    for (int i = 0; i < n; i++) {
+        uint32_t succs[2];
+        int num_succs = successors(v, i, succs);
+        if (num_succs == 1 && succs[0] == (uint32_t)i + 1)
+            continue;
+        leaders[i + 1] = true;
+        for (int j = 0; j < num_succs; j++)
+            leaders[succs[j]] = true;
+    }
+
+    int* block_of = malloc(sizeof(int) * (n + 1));
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        count += leaders[i];
+        block_of[i] = count - 1;
+    }
+    CfgBlock* blocks = malloc(sizeof(CfgBlock) * (count ? count : 1));
+    for (int i = 0; i < n; i++) {
+        CfgBlock* block = &blocks[block_of[i]];
+        if (leaders[i])
+            block->start = i;
+        block->end = i + 1;
+    }
+    for (int b = 0; b < count; b++) {
+        CfgBlock* block = &blocks[b];
+        uint32_t succs[2];
+        int num_succs = successors(v, block->end - 1, succs);
+        block->num_succs = 0;
+        for (int j = 0; j < num_succs; j++) {
+            if (succs[j] < (uint32_t)n)
+                block->succs[block->num_succs++] = block_of[succs[j]];
+        }
+    }
+
+    free(leaders);
+    free(block_of);
+    *num_blocks = count;
+    return blocks;
+}
+
+// Returns whether `into` changed
+static bool merge(RegState* into, const RegState* from) {
+    if (!into->reached) {
+        *into = *from;
+        return true;
+    }
+    RegState before = *into;
+    into->written &= from->written;
+    for (int r = 0; r < NUM_GP_REGISTERS; r++) {
+        if (from->values[r] != into->values[r])
+            into->known &= ~(1u << r);
+    }
+    into->known &= from->known;
+    return into->written != before.written || into->known != before.known;
+}
+
+// Whether `op` always holds the same value here, which goes in `value`
+static bool known_value(const RegState* s, Operand op, uint8_t width, uint32_t* value) {
+    if (!op.is_register) {
+        *value = op.value;
+        return true;
+    }
+    if (op.value == REGISTER_RZ) {
+        *value = 0;
+        return true;
+    }
+    uint8_t bits = group_bits(op.value, width);
+    if ((s->known & bits) != bits)
+        return false;
+    *value = 0;
+    for (uint32_t k = 0; k < 1u << width; k++)
+        *value |= (uint32_t)s->values[op.value + k] << 8 * k;
+    return true;
+}
+
+static void write_group(RegState* s, uint32_t reg, uint8_t width, bool known, uint32_t value) {
+    uint8_t bits = group_bits(reg, width);
+    s->written |= bits;
+    if (!known) {
+        s->known &= ~bits;
+        return;
+    }
+    s->known |= bits;
+    for (uint32_t k = 0; k < 1u << width; k++)
+        s->values[reg + k] = value >> 8 * k;
+}
+
+/* Works out arithmetic the way execute_instruction()
+does, for bytes as much as for wide values. Bytes are
+shifted as ints, so shifts of 32 or more are left
+unknown. */
+static bool evaluate(uint32_t type, uint8_t width, uint32_t a, uint32_t b, uint32_t* result) {
+    if (type == ADC || type == SBC || (type == DIV && b == 0))
+        return false;
+    if (width == WIDTH_BYTE && (type == SHL || type == SHR) && b >= 32)
+        return false;
+    *result = op_wide_arith(type, a, b) & width_mask(width);
+    return true;
+}
+
+/* Bulk ranges are proven in bounds for the largest
+values their operands could have, which for anything
+unknown is the most that fits in the width */
+static void check_bulk(Verifier* v, const RegState* s, uint32_t i) {
+    const Instruction* instr = &v->instrs[i];
+    uint32_t most[NUM_OPERANDS] = {0};
+    bool all_known = true;
+    for (int n = 0; n < (instr->type == PTS ? 2 : 3); n++) {
+        if (!known_value(s, instr->operands[n], instr->width, &most[n])) {
+            most[n] = width_mask(instr->width);
+            all_known = false;
+        }
+    }
+    // pts is just an address and a length, and mset's second operand is what it fills with
+    uint32_t len = instr->type == PTS ? most[1] : most[2];
+    bool in_bounds = op_bulk_in_bounds(most[0], len)
+                  && (instr->type == PTS || instr->type == MSET || op_bulk_in_bounds(most[1], len));
+    v->result.num_accesses++;
+    v->result.num_proven += in_bounds;
+    if (!in_bounds && all_known)
+        add_issue(v, VERIFY_OUT_OF_BOUNDS, i, -1, 0);
+}
+
+/* Takes `s` past instruction `i`, and reports what's
+wrong with it along the way if `report` is set */
+static void step(Verifier* v, RegState* s, uint32_t i, bool report) {
+    if (v->bad[i])
+        return;
+    const Instruction* instr = &v->instrs[i];
+    const Operand* ops = instr->operands;
+    uint32_t type = instr->type;
+    uint8_t width = instr->width;
+
+    for (int n = 0; report && n < NUM_OPERANDS; n++) {
+        uint8_t role = ROLES[type][n];
+        if ((role != ROLE_VALUE && role != ROLE_DST_VALUE) || !ops[n].is_register
+            || ops[n].value >= NUM_GP_REGISTERS)
+            continue;
+        uint8_t missing = group_bits(ops[n].value, width) & ~s->written;
+        uint32_t reg = 0;
+        while (missing != 0 && !(missing >> reg & 1))
+            reg++;
+        if (missing != 0)
+            add_issue(v, VERIFY_UNINITIALIZED, i, n, reg);
+    }
+
+    uint32_t a = 0, b = 0, result = 0;
+    switch (type) {
+        case MOV: {
+            bool known = known_value(s, ops[1], width, &b);
+            write_group(s, ops[0].value, width, known, b & width_mask(width));
+            break;
+        }
+        case ADD: case ADC: case SUB: case SBC: case MUL: case DIV: case SHL: case SHR: {
+            bool known_a = known_value(s, ops[0], width, &a);
+            bool known_b = known_value(s, ops[1], width, &b);
+            if (report && type == DIV && known_b && b == 0)
+                add_issue(v, VERIFY_DIVIDE_BY_ZERO, i, 1, 0);
+            bool known = known_a && known_b && evaluate(type, width, a, b, &result);
+            write_group(s, ops[0].value, width, known, result);
+            break;
+        }
+        case NEG: {
+            bool known = known_value(s, ops[0], width, &a);
+            write_group(s, ops[0].value, width, known, -a & width_mask(width));
+            break;
+        }
+        case LD: case RCV: {
+            write_group(s, ops[0].value, width, false, 0);
+            if (report && type == LD) {
+                v->result.num_accesses++;
+                v->result.num_proven++;
+            }
+            break;
+        }
+        case STR: {
+            if (report) {
+                v->result.num_accesses++;
+                v->result.num_proven++;
+            }
+            break;
+        }
+        default: {
+            if (report && is_bulk(type))
+                check_bulk(v, s, i);
+        }
+    }
+}
+
+static int compare_issues(const void* a, const void* b) {
+    const VerifyIssue* x = a;
+    const VerifyIssue* y = b;
+    if (x->instr != y->instr)
+        return x->instr < y->instr ? -1 : 1;
+    if (x->operand != y->operand)
+        return x->operand - y->operand;
+    return x->type - y->type;
+}
+
+VerifyResult verifier_verify(const Instruction instrs[], int num_instrs,
+                             const Label labels[], int num_labels) {
+    Verifier v = {.instrs = instrs, .num_instrs = num_instrs,
+                  .labels = labels, .num_labels = num_labels};
+    v.bad = malloc(sizeof(bool) * (num_instrs ? num_instrs : 1));
+    for (int i = 0; i < num_instrs; i++)
+        v.bad[i] = !check_instruction(&v, i);
+
+    int num_blocks;
+    CfgBlock* blocks = build_cfg(&v, &num_blocks);
+    v.result.num_blocks = num_blocks;
+
+    RegState* in = calloc(num_blocks ? num_blocks : 1, sizeof(RegState));
+    int* worklist = malloc(sizeof(int) * (num_blocks ? num_blocks : 1));
+    bool* queued = calloc(num_blocks ? num_blocks : 1, sizeof(bool));
+    int top = 0;
+    if (num_blocks > 0) {
+        in[0].reached = true;
+        worklist[top++] = 0;
+        queued[0] = true;
+    }
+    while (top > 0) {
+        int b = worklist[--top];
+        queued[b] = false;
+        RegState s = in[b];
+        for (uint32_t i = blocks[b].start; i < blocks[b].end; i++)
+            step(&v, &s, i, false);
+        for (int j = 0; j < blocks[b].num_succs; j++) {
+            int succ = blocks[b].succs[j];
+            if (merge(&in[succ], &s) && !queued[succ]) {
+                worklist[top++] = succ;
+                queued[succ] = true;
+            }
+        }
+    }
+
+    // Only now is what's known at the start of each block final
+    for (int b = 0; b < num_blocks; b++) {
+        if (!in[b].reached) {
+            if (b == 0 || in[b - 1].reached)
+                add_issue(&v, VERIFY_UNREACHABLE, blocks[b].start, -1, 0);
+            continue;
+        }
+        RegState s = in[b];
+        for (uint32_t i = blocks[b].start; i < blocks[b].end; i++)
+            step(&v, &s, i, true);
+    }
+
+    qsort(v.result.issues, v.result.num_issues, sizeof(VerifyIssue), compare_issues);
+    v.result.verified = v.result.num_errors == 0;
+
+    free(v.bad);
+    free(blocks);
+    free(in);
+    free(worklist);
+    free(queued);
+    return v.result;
+}
+
+void verifier_free(VerifyResult* result) {
+    free(result->issues);
+    *result = (VerifyResult){0};
+}
+
+void verifier_report(FILE* file, const VerifyResult* result, const char* filename,
+                     const int* lines, const Label labels[], int num_labels) {
+    int num_warnings = result->num_issues - result->num_errors;
+    for (int i = 0; i < result->num_issues; i++) {
+        const VerifyIssue* issue = &result->issues[i];
+        if (lines != NULL)
+            fprintf(file, "%s:%d: ", filename, lines[issue->instr]);
+        else
+            fprintf(file, "%s: instruction %u: ", filename, issue->instr);
+        fprintf(file, "%s: ", verifier_is_error(issue->type) ? "error" : "warning");
+
+        switch ((VerifyIssueType)issue->type) {
+            case VERIFY_BAD_INSTRUCTION:
+                fprintf(file, "not a valid instruction\n");
+                break;
+            case VERIFY_BAD_OPERAND:
+                fprintf(file, "operand %d can't be used here\n", issue->operand + 1);
+                break;
+            case VERIFY_OUT_OF_RANGE:
+                fprintf(file, "operand %d doesn't fit in the instruction's width\n",
+                        issue->operand + 1);
+                break;
+            case VERIFY_UNDEFINED_LABEL: {
+                const Label* label = issue->detail < (uint32_t)num_labels ? &labels[issue->detail]
+                                                                          : NULL;
+                if (label != NULL && label->name.data != NULL)
+                    fprintf(file, "jumps to \"%.*s\", which is never defined\n",
+                            (int)label->name.len, label->name.data);
+                else
+                    fprintf(file, "jumps to label %u, which is never defined\n", issue->detail);
+                break;
+            }
+            case VERIFY_DIVIDE_BY_ZERO:
+                fprintf(file, "always divides by zero\n");
+                break;
+            case VERIFY_OUT_OF_BOUNDS:
+                fprintf(file, "always goes out of bounds of memory\n");
+                break;
+            case VERIFY_UNREACHABLE:
+                fprintf(file, "can never be reached\n");
+                break;
+            case VERIFY_UNINITIALIZED:
+                fprintf(file, "reads r%u, which might not have been written to yet\n",
+                        issue->detail);
+                break;
+            default:
+                break;
+        }
+    }
+    fprintf(file, "%s: %s, %d error%s, %d warning%s, %d basic blocks, "
+                  "%d of %d memory accesses proven in bounds\n",
+            filename, result->verified ? "verified" : "not verified",
+            result->num_errors, result->num_errors == 1 ? "" : "s",
+            num_warnings, num_warnings == 1 ? "" : "s",
+            result->num_blocks, result->num_proven, result->num_accesses);
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Compiles each program to C with `strvm -C`, builds it,
+# and checks that it prints the same and exits with the
+# same status as running it on strvm does.
+#
+# Usage: tests/aot.sh <strvm> <cc> <dir> <file>...
+
+strvm=$1
+cc=$2
+dir=$3
+shift 3
+mkdir -p "$dir"
+
+failed=0
+for file in "$@"; do
+    "$strvm" -C "$dir/aot.c" "$file" || { echo "Error: couldn't compile \"$file\" to C"; exit 1; }
+    $cc -O1 "$dir/aot.c" -o "$dir/aot.exe" || { echo "Error: the C for \"$file\" didn't build"; exit 1; }
+
+    "$strvm" "$file" > "$dir/expected.txt"
+    expected=$?
+    "$dir/aot.exe" > "$dir/actual.txt"
+    actual=$?
+    if [ $expected -ne $actual ] || ! cmp -s "$dir/expected.txt" "$dir/actual.txt"; then
+        echo "Error: \"$file\" ran differently compiled to C than with strvm"
+        failed=1
+    fi
+done
+exit $failed
@@ -0,0 +1,284 @@
+/* Pins down exactly what every ALU instruction does to
+its destination, rst and rcmp, on every engine.
+
+Each case runs one instruction, or an adc/sbc pair to
+check that carry is passed along between them, from a
+state with r0 and r1 set to 0x00, 0x7f, 0x80 or 0xff,
+and every flag preset both ways, so that a flag that's
+wrongly cleared or set shows up as well as one that's
+wrongly computed. What should come out is worked out by
+reference() below, straight from the definitions:
+- add, sub, mul, div, shl and shr set the zero flag from
+  the result, and leave carry and overflow alone
+- adc sets carry to the carry out of bit 7, and sbc to
+  the borrow, and both set overflow if the result has
+  the wrong sign for signed arithmetic
+- neg leaves every flag alone
+- cmp compares unsigned, and leaves rst alone
+Everything but cmp also leaves rcmp alone. */
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "strvm.h"
+#include "decoder.h"
+#include "batch.h"
+#include "jit.h"
+#include "recorder.h"
+#include "verifier.h"
+
+#define BATCH_LANES 8
+
+typedef enum {
+    ENGINE_INTERP,
+    ENGINE_VERIFIED,
+    ENGINE_DECODED,
+    ENGINE_RECORDED,
+    ENGINE_JIT,
+    ENGINE_BATCH,
+    NUM_ENGINES
+} Engine;
+
+static const char* engine_names[NUM_ENGINES] = {"interp", "verified", "decoded", "recorded", "jit",
+                                                "batch"};
+
+static const char* type_names[NUM_INSTR_TYPES] = {
+    [ADD] = "add", [ADC] = "adc", [SUB] = "sub", [SBC] = "sbc", [MUL] = "mul",
+    [DIV] = "div", [SHL] = "shl", [SHR] = "shr", [NEG] = "neg", [CMP] = "cmp"
+};
+
+static const uint8_t edges[] = {0x00, 0x7f, 0x80, 0xff};
+// Dividing by 0 is left to the host, and shifting by 8 or more isn't interesting
+static const uint8_t divisors[] = {0x01, 0x7f, 0x80, 0xff};
+static const uint8_t shifts[] = {0, 1, 4, 7};
+
+// The state an instruction can change, plus r0 and r1
+typedef struct {
+    uint8_t r0, r1;
+    bool carry, overflow, not_zero;
+    bool not_equal, equal, greater_than, less_than;
+} State;
+
+static State reference(State s, InstructionType type, uint8_t value) {
+    uint8_t a = s.r0;
+    uint8_t result = a;
+    switch (type) {
+        case ADD: result = a + value; break;
+        case SUB: result = a - value; break;
+        case MUL: result = a * value; break;
+        case DIV: result = a / value; break;
+        case SHL: result = a << value; break;
+        case SHR: result = a >> value; break;
+        case ADC:
+            result = a + value + s.carry;
+            s.carry = a + value + s.carry > 0xff;
+            s.overflow = (a >> 7) == (value >> 7) && (result >> 7) != (a >> 7);
+            break;
+        case SBC:
+            result = a - value - s.carry;
+            s.carry = a < value + s.carry;
+            s.overflow = (a >> 7) != (value >> 7) && (result >> 7) != (a >> 7);
+            break;
+        case NEG:
+            s.r0 = -a;
+            return s;
+        default:
+            s.not_equal = a != value;
+            s.equal = a == value;
+            s.greater_than = a > value;
+            s.less_than = a < value;
+            return s;
+    }
+    s.r0 = result;
+    s.not_zero = result != 0;
+    return s;
+}
+
+static VM to_vm(const State* s) {
+    VM vm = vm_init(NULL, 0);
+    vm.registers[0].value = s->r0;
+    vm.registers[1].value = s->r1;
+    vm.status_register = (StatusRegister){.carry = s->carry, .overflow = s->overflow,
+                                          .not_zero = s->not_zero};
+    vm.compare_register = (CompareFlags){.not_equal = s->not_equal, .equal = s->equal,
+                                         .greater_than = s->greater_than, .less_than = s->less_than};
+    return vm;
+}
+
+static State from_vm(const VM* vm) {
+    return (State){.r0 = vm->registers[0].value, .r1 = vm->registers[1].value,
+                   .carry = vm->status_register.carry, .overflow = vm->status_register.overflow,
+                   .not_zero = vm->status_register.not_zero,
+                   .not_equal = vm->compare_register.not_equal,
+                   .equal = vm->compare_register.equal,
+                   .greater_than = vm->compare_register.greater_than,
+                   .less_than = vm->compare_register.less_than};
+}
+
+static bool same_state(const State* a, const State* b) {
+    return a->r0 == b->r0 && a->r1 == b->r1 && a->carry == b->carry && a->overflow == b->overflow
+        && a->not_zero == b->not_zero && a->not_equal == b->not_equal && a->equal == b->equal
+        && a->greater_than == b->greater_than && a->less_than == b->less_than;
+}
+
+// `type` r0 with r1, or with `imm` if it isn't a register
+static Instruction make_instruction(InstructionType type, bool is_reg, uint8_t imm) {
+    Instruction instr = {.type = type, .width = WIDTH_BYTE};
+    instr.operands[0] = (Operand){.is_register = true, .value = 0};
+    if (type != NEG)
+        instr.operands[1] = (Operand){.is_register = is_reg, .value = is_reg ? 1 : imm};
+    return instr;
+}
+
+// Returns whether it ran without an error, since running off the end isn't one
+static bool run(Engine engine, Instruction instrs[], int num_instrs, DecodedProgram* program,
+                VM* vm) {
+    OutputSink discard = output_sink_discard();
+    vm->output = &discard;
+    VM_Error error;
+    switch (engine) {
+        case ENGINE_INTERP:
+            error = vm_run(vm, instrs, num_instrs);
+            break;
+        case ENGINE_VERIFIED: {
+            VerifyResult result = verifier_verify(instrs, num_instrs, NULL, 0);
+            bool verified = result.verified;
+            verifier_free(&result);
+            if (!verified)
+                return false;
+            VM_Budget budget = {.fuel = VM_UNLIMITED_FUEL};
+            error = vm_run_verified(vm, instrs, num_instrs, &budget);
+            break;
+        }
+        case ENGINE_DECODED:
+            error = vm_run_decoded(vm, program);
+            break;
+        case ENGINE_RECORDED: {
+            Recording recording = recorder_create(vm, RECORDER_DEFAULT_CAPACITY,
+                                                  RECORDER_DEFAULT_INTERVAL);
+            error = vm_run_recorded(vm, program, &recording);
+            recorder_free(&recording);
+            break;
+        }
+        case ENGINE_JIT: {
+            JitProgram jit = jit_compile(program);
+            error = vm_run_jit(vm, &jit);
+            jit_free(&jit);
+            break;
+        }
+        default: {
+            VM_Batch batch = vm_batch_create(BATCH_LANES, decoder_memory_reach(program));
+            for (int lane = 0; lane < BATCH_LANES; lane++)
+                vm_batch_load(&batch, lane, vm);
+            vm_batch_run(&batch, program);
+            // Every lane has to come out the same
+            VM first = *vm;
+            vm_batch_store(&batch, 0, &first);
+            error = batch.errors[0];
+            for (int lane = 1; lane < BATCH_LANES; lane++) {
+                VM other = *vm;
+                vm_batch_store(&batch, lane, &other);
+                State a = from_vm(&first), b = from_vm(&other);
+                if (!same_state(&a, &b))
+                    error.type = INVALID_INSTRUCTION;
+            }
+            *vm = first;
+            vm_batch_free(&batch);
+            break;
+        }
+    }
+    return error.type == NONE || error.type == HALT;
+}
+
+static void print_state(const char* label, const State* s) {
+    fprintf(stderr, "  %-8s r0=0x%02x c=%d v=%d nz=%d ne=%d eq=%d gt=%d lt=%d\n", label, s->r0,
+            s->carry, s->overflow, s->not_zero, s->not_equal, s->equal, s->greater_than,
+            s->less_than);
+}
+
+// Runs `instrs` from `start` on every engine, and checks they all end up at `expected`
+static bool check(Instruction instrs[], int num_instrs, const State* start, const State* expected) {
+    DecodedProgram program = decoder_decode(instrs, num_instrs, NULL, 0);
+    bool ok = true;
+    for (int engine = 0; engine < NUM_ENGINES && ok; engine++) {
+        VM vm = to_vm(start);
+        bool ran = run(engine, instrs, num_instrs, &program, &vm);
+        State got = from_vm(&vm);
+        if (ran && same_state(&got, expected))
+            continue;
+
+        fprintf(stderr, "Error: wrong flags on %s%s after", engine_names[engine],
+                ran ? "" : " (or it failed)");
+        for (int i = 0; i < num_instrs; i++) {
+            const Operand* b = &instrs[i].operands[1];
+            fprintf(stderr, "%s %s r0", i ? ";" : "", type_names[instrs[i].type]);
+            if (instrs[i].type != NEG)
+                fprintf(stderr, b->is_register ? ", r%u" : ", %u", b->value);
+        }
+        fprintf(stderr, "\n");
+        print_state("from", start);
+        print_state("expected", expected);
+        print_state("got", &got);
+        ok = false;
+    }
+    decoder_free(&program);
+    return ok;
+}
+
+static const uint8_t* operands_for(InstructionType type) {
+    return type == DIV ? divisors : type == SHL || type == SHR ? shifts : edges;
+}
+
+// Flags start out all set or all clear, and rcmp says "greater" or nothing
+static State start_state(uint8_t a, uint8_t b, bool preset) {
+    return (State){.r0 = a, .r1 = b, .carry = preset, .overflow = preset, .not_zero = preset,
+                   .not_equal = preset, .greater_than = preset};
+}
+
+int main() {
+    static const InstructionType types[] = {ADD, ADC, SUB, SBC, MUL, DIV, SHL, SHR, NEG, CMP};
+    int num_cases = 0;
+    bool ok = true;
+
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        InstructionType type = types[t];
+        const uint8_t* operands = operands_for(type);
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                for (int preset = 0; preset < 2; preset++) {
+                    for (int is_reg = 0; is_reg < 2; is_reg++) {
+                        State start = start_state(edges[i], operands[j], preset);
+                        State expected = reference(start, type, operands[j]);
+                        Instruction instr = make_instruction(type, is_reg, operands[j]);
+                        ok &= check(&instr, 1, &start, &expected);
+                        num_cases++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Chains, where the second instruction has to see the first one's carry
+    static const InstructionType carries[] = {ADC, SBC};
+    for (int first = 0; first < 2; first++) {
+        for (int second = 0; second < 2; second++) {
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    for (int preset = 0; preset < 2; preset++) {
+                        State start = start_state(edges[i], edges[j], preset);
+                        State expected = reference(start, carries[first], edges[j]);
+                        expected = reference(expected, carries[second], edges[j]);
+                        Instruction instrs[2] = {make_instruction(carries[first], true, 0),
+                                                 make_instruction(carries[second], true, 0)};
+                        ok &= check(instrs, 2, &start, &expected);
+                        num_cases++;
+                    }
+                }
+            }
+        }
+    }
+
+    if (ok)
+        printf("flags: %d cases came out the same on every engine\n", num_cases);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,734 @@
+/* Differential fuzzer for the execution engines.
+
+Generates random programs that always run to an end
+(jumps only go forward, except for loops counted down
+in r7, which nothing else writes to), and checks that
+each one runs exactly like it does on the interpreter,
+registers, flags, counters, memory, error and output,
+on every other way of running it:
+- the interpreter, and the decoded engine, in slices of
+  random fuel, which also gets traces and blocks going
+- the interpreter without checks, if the verifier passes
+- the decoded engine, the JIT and the recorder
+- replaying the recording to a random instruction count,
+  against stepping there one instruction at a time
+- the batch engine, with every lane starting from
+  different registers
+- -O1 and -O2, on output and error only
+- a bytecode image, written out and loaded back
+- a snapshot taken partway, restored, and carried on
+- every engine through the libstrvm API
+Once they've all been run, every program is lexed
+again as one big source, on one thread and split
+between several, which have to agree.
+
+With -o, the programs are written out as source files
+instead, for checking engines that aren't linked in,
+like AOT compilation. */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
+#endif
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "strvm.h"
+#include "lexer.h"
+#include "decoder.h"
+#include "batch.h"
+#include "jit.h"
+#include "optimizer.h"
+#include "bytecode.h"
+#include "snapshot.h"
+#include "recorder.h"
+#include "verifier.h"
+#include "libstrvm.h"
+#include "ops.h"
+
+#include "fiesta/str.h"
+
+#define DEFAULT_PROGRAMS 300
+#define DEFAULT_SEED     1
+#define BATCH_LANES      64
+#define LEXER_THREADS    4
+
+typedef struct {
+    OutputSink out;
+    uint64_t state;
+    int program;    // Label names start with it, so that programs can be joined together
+    int num_labels;
+} Generator;
+
+static void emit(OutputSink* out, const char* format, ...) {
+    char line[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    output_put(out, line, len);
+}
+
+// xorshift64*, so that a seed gives the same programs everywhere
+static uint32_t next_random(Generator* g) {
+    g->state ^= g->state >> 12;
+    g->state ^= g->state << 25;
+    g->state ^= g->state >> 27;
+    return (g->state * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
+static uint32_t below(Generator* g, uint32_t n) {
+    return next_random(g) % n;
+}
+
+// Values at the edges of signed and unsigned ranges turn up far more often than they would by chance
+static uint32_t random_value(Generator* g, uint8_t width) {
+    static const uint32_t edges[] = {0, 1, 0x7f, 0x80, 0xff, 0x7fff, 0x8000, 0xffff,
+                                     0x7fffffff, 0x80000000, 0xffffffff};
+    uint32_t value = below(g, 2) ? edges[below(g, sizeof(edges) / sizeof(edges[0]))] : next_random(g);
+    return value & width_mask(width);
+}
+
+static const char* suffix(uint8_t width) {
+    return width == WIDTH_WORD ? ".w" : width == WIDTH_DWORD ? ".d" : "";
+}
+
+/* Registers that can be written are r0-r6, and a wide
+group written to has to fit in them too, so that r7 is
+only ever changed by the loops counting in it */
+static int random_dst(Generator* g, uint8_t width) {
+    return below(g, NUM_GP_REGISTERS - (1 << width));
+}
+
+// A register group or an immediate of the instruction's width
+static void emit_value(Generator* g, uint8_t width) {
+    if (below(g, 2))
+        emit(&g->out, "%u", random_value(g, width));
+    else if (width == WIDTH_BYTE && below(g, 10) == 0)
+        emit(&g->out, "rz");
+    else
+        emit(&g->out, "r%d", below(g, NUM_GP_REGISTERS + 1 - (1 << width)));
+}
+
+static void emit_bulk(Generator* g) {
+    static const char* names[] = {"mcpy", "mset", "mcmp", "madd", "mxor", "pts"};
+    int type = below(g, 6);
+    uint8_t width = below(g, 2) ? WIDTH_WORD : WIDTH_BYTE;
+    uint32_t limit = width == WIDTH_BYTE ? UINT8_MAX + 1 : MEMORY_SIZE;
+    uint32_t a = below(g, limit), b = below(g, limit);
+    uint32_t len = below(g, limit - (a > b ? a : b) + 1);
+    // Out of bounds now and then, which stops the program
+    if (below(g, 20) == 0)
+        len = limit;
+    if (type == 5 && len > 40)
+        len = below(g, 40);
+
+    emit(&g->out, "    %s%s ", names[type], suffix(width));
+    uint32_t operands[3] = {a, type == 1 ? random_value(g, WIDTH_BYTE) : b, len};
+    int num_operands = type == 5 ? 2 : 3;
+    if (type == 5)
+        operands[1] = len;
+    for (int i = 0; i < num_operands; i++) {
+        if (i > 0)
+            emit(&g->out, ", ");
+        if (below(g, 8) == 0)
+            emit(&g->out, "r%d", below(g, NUM_GP_REGISTERS + 1 - (1 << width)));
+        else
+            emit(&g->out, "%u", operands[i]);
+    }
+    emit(&g->out, "\n");
+}
+
+static void emit_instruction(Generator* g) {
+    static const char* alu[] = {"mov", "add", "sub", "adc", "sbc", "mul"};
+    static const char* wide_alu[] = {"mov", "add", "sub", "mul"};
+    static const char* prints[] = {"ptc", "ptn", "ptu"};
+    uint8_t width = below(g, 2) ? WIDTH_WORD : WIDTH_DWORD;
+    switch (below(g, 20)) {
+        case 0: case 1: case 2: case 3:
+            emit(&g->out, "    %s r%d, ", alu[below(g, 6)], random_dst(g, WIDTH_BYTE));
+            emit_value(g, WIDTH_BYTE);
+            break;
+        // Dividing by a register could divide by zero, which every engine leaves to the host
+        case 4:
+            emit(&g->out, "    div r%d, %u", random_dst(g, WIDTH_BYTE), 1 + below(g, 255));
+            break;
+        case 5:
+            emit(&g->out, "    %s r%d, %u", below(g, 2) ? "shl" : "shr",
+                 random_dst(g, WIDTH_BYTE), below(g, 16));
+            break;
+        case 6:
+            emit(&g->out, "    neg r%d", random_dst(g, WIDTH_BYTE));
+            break;
+        case 7:
+            emit(&g->out, "    %s", below(g, 3) == 0 ? "nop" : below(g, 2) ? "clc" : "clv");
+            break;
+        case 8: case 9:
+            emit(&g->out, "    cmp ");
+            emit_value(g, WIDTH_BYTE);
+            emit(&g->out, ", ");
+            emit_value(g, WIDTH_BYTE);
+            break;
+        case 10:
+            emit(&g->out, "    str ");
+            emit_value(g, WIDTH_BYTE);
+            emit(&g->out, ", ");
+            emit_value(g, WIDTH_BYTE);
+            break;
+        case 11:
+            emit(&g->out, "    ld r%d, ", random_dst(g, WIDTH_BYTE));
+            emit_value(g, WIDTH_BYTE);
+            break;
+        case 12:
+            emit(&g->out, "    %s ", prints[below(g, 3)]);
+            emit_value(g, WIDTH_BYTE);
+            break;
+        case 13: case 14:
+            emit(&g->out, "    %s%s r%d, ", wide_alu[below(g, 4)], suffix(width), random_dst(g, width));
+            emit_value(g, width);
+            break;
+        case 15:
+            if (below(g, 3) == 0)
+                emit(&g->out, "    div%s r%d, %u", suffix(width), random_dst(g, width),
+                     1 + random_value(g, width) % (width_mask(width)));
+            else
+                emit(&g->out, "    %s%s r%d, %u", below(g, 2) ? "shl" : "shr", suffix(width),
+                     random_dst(g, width), below(g, 16));
+            break;
+        case 16:
+            emit(&g->out, "    cmp%s ", suffix(width));
+            emit_value(g, width);
+            emit(&g->out, ", ");
+            emit_value(g, width);
+            break;
+        // Addresses near the end of memory make values straddle it
+        case 17: {
+            bool load = below(g, 2);
+            if (load)
+                emit(&g->out, "    ld%s r%d, ", suffix(width), random_dst(g, width));
+            else
+                emit(&g->out, "    str%s ", suffix(width));
+            if (below(g, 2))
+                emit(&g->out, "%u", MEMORY_SIZE - 1 - below(g, 4));
+            else
+                emit_value(g, width);
+            if (!load) {
+                emit(&g->out, ", ");
+                emit_value(g, width);
+            }
+            break;
+        }
+        case 18:
+            emit_bulk(g);
+            return;
+        default:
+            emit(&g->out, "    %s", below(g, 10) == 0 ? "hlt" : "nop");
+            break;
+    }
+    emit(&g->out, "\n");
+}
+
+static int new_label(Generator* g) {
+    return g->num_labels++;
+}
+
+static void emit_label(Generator* g, int label) {
+    emit(&g->out, "p%dl%d:\n", g->program, label);
+}
+
+static void emit_jump(Generator* g, int label) {
+    static const char* jumps[] = {"jmp", "jne", "je", "jgt", "jlt", "jnz", "jz"};
+    emit(&g->out, "    %s p%dl%d\n", jumps[below(g, 7)], g->program, label);
+}
+
+// Straight-line code, with now and then a jump over some of it
+static void emit_straight(Generator* g, int max_len) {
+    int len = 1 + below(g, max_len);
+    for (int i = 0; i < len; i++) {
+        if (below(g, 6) == 0) {
+            int skip = new_label(g);
+            emit_jump(g, skip);
+            for (int j = below(g, 4); j >= 0; j--)
+                emit_instruction(g);
+            emit_label(g, skip);
+        }
+        else
+            emit_instruction(g);
+    }
+}
+
+/* Loops run often enough (32 times) for the
+interpreter to trace them, and to decode their blocks */
+static str generate_program(Generator* g, int program) {
+    g->out = output_sink_arena();
+    g->program = program;
+    g->num_labels = 0;
+    int end = new_label(g);
+    emit(&g->out, "; program %d\n", program);
+    for (int block = below(g, 8); block >= 0; block--) {
+        if (below(g, 3) == 0) {
+            int loop = new_label(g);
+            emit(&g->out, "    mov r7, %u\n", 1 + below(g, 100));
+            emit_label(g, loop);
+            emit_straight(g, 10);
+            emit(&g->out, "    sub r7, 1\n");
+            emit(&g->out, "    jnz p%dl%d\n", program, loop);
+        }
+        else
+            emit_straight(g, 6);
+        // Past the last instruction
+        if (below(g, 10) == 0)
+            emit_jump(g, end);
+    }
+    emit_label(g, end);
+    return (str){.data = g->out.data, .len = g->out.len};
+}
+
+/* Every instruction is on an indented line of its own.
+Nops aren't counted, since blank lines and comments lex
+to them as well. */
+static int count_generated(str src) {
+    int count = 0;
+    for (int i = 0; i < (int)src.len; i++) {
+        bool line_start = i == 0 || src.data[i - 1] == '\n';
+        if (line_start && src.data[i] == ' ' && strncmp(src.data + i, "    nop", 7))
+            count++;
+    }
+    return count;
+}
+
+static int count_lexed(const LexerState* lexed) {
+    int count = 0;
+    for (int i = 0; i <= lexed->cur_instr; i++)
+        count += lexed->instrs[i].type != NOP;
+    return count;
+}
+
+// Everything needed to run one program on any engine
+typedef struct {
+    int index;
+    str src;
+    LexerState lexed;
+    int num_instrs;
+    DecodedProgram program;
+    VM expected;
+    VM_Error expected_error;
+    OutputSink expected_output;
+    Generator* g;
+} Fuzz;
+
+static bool same_flags(const VM* a, const VM* b) {
+    return a->status_register.carry == b->status_register.carry
+        && a->status_register.overflow == b->status_register.overflow
+        && a->status_register.not_zero == b->status_register.not_zero
+        && a->compare_register.not_equal == b->compare_register.not_equal
+        && a->compare_register.equal == b->compare_register.equal
+        && a->compare_register.greater_than == b->compare_register.greater_than
+        && a->compare_register.less_than == b->compare_register.less_than;
+}
+
+static bool same_state(const VM* vm, const VM* expected) {
+    return !memcmp(vm->registers, expected->registers, sizeof(vm->registers))
+        && !memcmp(vm->memory, expected->memory, sizeof(vm->memory))
+        && same_flags(vm, expected)
+        && vm->program_counter == expected->program_counter
+        && vm->instr_ptr == expected->instr_ptr;
+}
+
+static bool same_output(const OutputSink* output, const OutputSink* expected) {
+    return output->len == expected->len && !memcmp(output->data, expected->data, output->len);
+}
+
+static bool check(const Fuzz* f, const char* engine, bool ok) {
+    if (ok)
+        return true;
+    fprintf(stderr, "Error: program %d ran differently with %s than with interp:\n%.*s",
+            f->index, engine, (int)f->src.len, f->src.data);
+    return false;
+}
+
+static bool check_run(const Fuzz* f, const char* engine, const VM* vm, VM_Error error,
+                      const OutputSink* output) {
+    return check(f, engine, same_state(vm, &f->expected) && error.type == f->expected_error.type
+                            && same_output(output, &f->expected_output));
+}
+
+static VM start_vm(Fuzz* f, OutputSink* output) {
+    VM vm = vm_init(f->lexed.labels, f->lexed.num_labels);
+    output->len = 0;
+    vm.output = output;
+    return vm;
+}
+
+static uint64_t random_fuel(Fuzz* f) {
+    return 1 + below(f->g, 200);
+}
+
+static bool check_budgets(Fuzz* f, OutputSink* output) {
+    VM vm = start_vm(f, output);
+    VM_Error error;
+    do {
+        VM_Budget budget = {.fuel = random_fuel(f)};
+        error = vm_run_budget(&vm, f->lexed.instrs, f->num_instrs, &budget);
+    } while (error.type == YIELD);
+    if (!check_run(f, "interp in slices", &vm, error, output))
+        return false;
+
+    vm = start_vm(f, output);
+    do {
+        VM_Budget budget = {.fuel = random_fuel(f)};
+        error = vm_run_decoded_budget(&vm, &f->program, &budget);
+    } while (error.type == YIELD);
+    return check_run(f, "decoded in slices", &vm, error, output);
+}
+
+static bool check_verified(Fuzz* f, OutputSink* output) {
+    VerifyResult result = verifier_verify(f->lexed.instrs, f->num_instrs,
+                                          f->lexed.labels, f->lexed.num_labels);
+    bool verified = result.verified;
+    verifier_free(&result);
+    if (!verified)
+        return true;
+    VM vm = start_vm(f, output);
+    VM_Budget budget = {.fuel = VM_UNLIMITED_FUEL};
+    VM_Error error = vm_run_verified(&vm, f->lexed.instrs, f->num_instrs, &budget);
+    return check_run(f, "verified", &vm, error, output);
+}
+
+static bool check_engines(Fuzz* f, OutputSink* output) {
+    VM vm = start_vm(f, output);
+    VM_Error error = vm_run_decoded(&vm, &f->program);
+    if (!check_run(f, "decoded", &vm, error, output))
+        return false;
+
+    JitProgram jit = jit_compile(&f->program);
+    vm = start_vm(f, output);
+    error = vm_run_jit(&vm, &jit);
+    jit_free(&jit);
+    return check_run(f, "jit", &vm, error, output);
+}
+
+// Lanes print to sinks of their own, so their output can be checked too
+// The reference replay_check() goes by, without the log
+static void run_steps(VM* vm, const Fuzz* f, uint32_t count) {
+    while (vm->program_counter < count && vm->instr_ptr < (uint32_t)f->num_instrs) {
+        if (vm_execute(vm, f->lexed.instrs[vm->instr_ptr]).type != NONE)
+            break;
+        vm->instr_ptr++;
+        vm->program_counter++;
+    }
+}
+
+/* A tiny ring and interval half the time, so that
+checkpoints are taken and dropped all through the run */
+static bool check_recorder(Fuzz* f, OutputSink* output) {
+    bool small = below(f->g, 2);
+    VM vm = start_vm(f, output);
+    Recording recording = recorder_create(&vm, small ? 1 : RECORDER_DEFAULT_CAPACITY,
+                                          small ? 16 : RECORDER_DEFAULT_INTERVAL);
+    VM_Error error = vm_run_recorded(&vm, &f->program, &recording);
+    bool ok = check_run(f, "recorded", &vm, error, output);
+
+    uint32_t first = recorder_first_pc(&recording);
+    uint32_t count = first + below(f->g, vm.program_counter - first + 1);
+    VM replayed = vm_init(f->lexed.labels, f->lexed.num_labels);
+    RecorderError replay_error = recorder_replay(&recording, &replayed, f->lexed.instrs,
+                                                 f->num_instrs, count);
+    OutputSink discard = output_sink_discard();
+    VM stepped = start_vm(f, &discard);
+    run_steps(&stepped, f, count);
+    ok = ok && check(f, "a replay", replay_error == RECORDER_OK && same_state(&replayed, &stepped));
+    recorder_free(&recording);
+    return ok;
+}
+
+// Lanes print to sinks of their own, so their output can be checked too
+static bool check_batch(Fuzz* f) {
+    VM_Batch batch = vm_batch_create(BATCH_LANES, decoder_memory_reach(&f->program));
+    VM starts[BATCH_LANES];
+    OutputSink outputs[BATCH_LANES];
+    for (int lane = 0; lane < BATCH_LANES; lane++) {
+        outputs[lane] = output_sink_arena();
+        starts[lane] = start_vm(f, &outputs[lane]);
+        for (int i = 0; i < NUM_GP_REGISTERS; i++)
+            starts[lane].registers[i].value = next_random(f->g);
+        vm_batch_load(&batch, lane, &starts[lane]);
+    }
+    vm_batch_run(&batch, &f->program);
+
+    bool ok = true;
+    OutputSink expected_output = output_sink_arena();
+    for (int lane = 0; lane < BATCH_LANES && ok; lane++) {
+        VM expected = starts[lane];
+        expected.output = &expected_output;
+        expected_output.len = 0;
+        VM_Error error = vm_run(&expected, f->lexed.instrs, f->num_instrs);
+        VM vm = starts[lane];
+        vm_batch_store(&batch, lane, &vm);
+        ok = check(f, "batch", same_state(&vm, &expected) && batch.errors[lane].type == error.type
+                               && same_output(&outputs[lane], &expected_output));
+    }
+    for (int lane = 0; lane < BATCH_LANES; lane++)
+        output_free(&outputs[lane]);
+    output_free(&expected_output);
+    vm_batch_free(&batch);
+    return ok;
+}
+
+// Optimized programs end with different registers, so only what they print and how they stop is compared
+static bool check_optimizer(Fuzz* f, OutputSink* output) {
+    bool ok = true;
+    for (int level = 1; level <= OPTIMIZER_MAX_LEVEL && ok; level++) {
+        int num_instrs = f->num_instrs;
+        Instruction* instrs = malloc(sizeof(Instruction) * num_instrs);
+        memcpy(instrs, f->lexed.instrs, sizeof(Instruction) * num_instrs);
+        Label* labels = malloc(sizeof(Label) * (f->lexed.num_labels + 1));
+        memcpy(labels, f->lexed.labels, sizeof(Label) * f->lexed.num_labels);
+        optimizer_run(instrs, &num_instrs, labels, f->lexed.num_labels, level);
+
+        VM vm = vm_init(labels, f->lexed.num_labels);
+        output->len = 0;
+        vm.output = output;
+        VM_Error error = vm_run(&vm, instrs, num_instrs);
+        ok = check(f, level == 1 ? "-O1" : "-O2", error.type == f->expected_error.type
+                                                  && same_output(output, &f->expected_output));
+        free(instrs);
+        free(labels);
+    }
+    return ok;
+}
+
+static bool check_bytecode(Fuzz* f, OutputSink* output, const char* path) {
+    if (bytecode_write(path, f->lexed.instrs, f->num_instrs,
+                       f->lexed.labels, f->lexed.num_labels) != BYTECODE_OK) {
+        fprintf(stderr, "Error: couldn't write \"%s\"\n", path);
+        return false;
+    }
+    BytecodeImage image = bytecode_load(path);
+    if (!check(f, "bytecode", image.error == BYTECODE_OK))
+        return false;
+    Label* labels = bytecode_labels(&image);
+    VM vm = vm_init(labels, image.header->num_labels);
+    output->len = 0;
+    vm.output = output;
+    VM_Error error = vm_run_decoded(&vm, &image.decoded);
+    bool ok = check_run(f, "bytecode", &vm, error, output);
+    free(labels);
+    bytecode_unload(&image);
+    return ok;
+}
+
+// Output from before the snapshot is kept in the same sink, since it isn't saved
+static bool check_snapshot(Fuzz* f, OutputSink* output) {
+    VM vm = start_vm(f, output);
+    VM_Budget budget = {.fuel = random_fuel(f)};
+    if (vm_run_budget(&vm, f->lexed.instrs, f->num_instrs, &budget).type != YIELD)
+        return true;
+
+    uint32_t id = snapshot_program_id(f->lexed.instrs, f->num_instrs,
+                                      f->lexed.labels, f->lexed.num_labels);
+    Snapshot snapshot = snapshot_take(&vm, id);
+    VM restored = vm_init(f->lexed.labels, f->lexed.num_labels);
+    restored.output = output;
+    SnapshotError restore_error = snapshot_restore(&restored, &snapshot, id);
+    snapshot_free(&snapshot);
+    if (!check(f, "a snapshot", restore_error == SNAPSHOT_OK))
+        return false;
+    VM_Error error = vm_run_decoded(&restored, &f->program);
+    return check_run(f, "a snapshot", &restored, error, output);
+}
+
+static void write_output(void* user_data, const char* data, size_t len) {
+    output_write(user_data, data, len);
+}
+
+static StrvmStatus expected_status(VM_Error error) {
+    switch (error.type) {
+        case NONE:                return STRVM_OK;
+        case HALT:                return STRVM_HALTED;
+        case INVALID_INSTRUCTION: return STRVM_INVALID_INSTRUCTION;
+        default:                  return STRVM_INVALID_OPERAND;
+    }
+}
+
+// The API only shows registers, memory, the instruction count and output
+static bool check_api(Fuzz* f, OutputSink* output) {
+    static const char* names[] = {"the API on interp", "the API on decoded", "the API on jit"};
+    StrvmProgram* program;
+    if (!check(f, "the API", strvm_compile(f->src.data, f->src.len, 0, &program) == STRVM_OK))
+        return false;
+    StrvmContext* context = strvm_context_create(program);
+    strvm_set_output(context, write_output, output);
+
+    bool ok = true;
+    for (StrvmEngine engine = STRVM_ENGINE_INTERP; engine <= STRVM_ENGINE_JIT && ok; engine++) {
+        strvm_context_reset(context);
+        output->len = 0;
+        // Fuel only goes as far as decoded, so the interpreter gets it in slices
+        StrvmStatus status;
+        do
+            status = strvm_run(context, engine, engine == STRVM_ENGINE_INTERP ? random_fuel(f)
+                                                                              : STRVM_UNLIMITED_FUEL);
+        while (status == STRVM_OUT_OF_FUEL);
+
+        uint8_t memory[MEMORY_SIZE];
+        strvm_read_memory(context, 0, memory, sizeof(memory));
+        bool same = status == expected_status(f->expected_error)
+                 && strvm_instructions_run(context) == f->expected.program_counter
+                 && !memcmp(memory, f->expected.memory, sizeof(memory))
+                 && same_output(output, &f->expected_output);
+        for (int i = 0; i < NUM_GP_REGISTERS; i++)
+            same = same && strvm_get_register(context, i) == f->expected.registers[i].value;
+        ok = check(f, names[engine], same);
+    }
+    strvm_context_free(context);
+    strvm_program_free(program);
+    return ok;
+}
+
+static bool fuzz_program(Generator* g, int index, str src, const char* image_path) {
+    Fuzz f = {.index = index, .src = src, .lexed = lexer_lex(src), .g = g};
+    if (f.lexed.had_error) {
+        fprintf(stderr, "Error: program %d couldn't be parsed:\n%.*s", index, (int)src.len, src.data);
+        lexer_free(&f.lexed);
+        return false;
+    }
+    // Otherwise a lexer that reads nothing would run the same everywhere
+    int generated = count_generated(src);
+    if (count_lexed(&f.lexed) != generated) {
+        fprintf(stderr, "Error: program %d lexed to %d instructions rather than %d:\n%.*s", index,
+                count_lexed(&f.lexed), generated, (int)src.len, src.data);
+        lexer_free(&f.lexed);
+        return false;
+    }
+    f.num_instrs = f.lexed.cur_instr + 1;
+    f.program = decoder_decode(f.lexed.instrs, f.num_instrs, f.lexed.labels, f.lexed.num_labels);
+    f.expected_output = output_sink_arena();
+    f.expected = start_vm(&f, &f.expected_output);
+    f.expected_error = vm_run(&f.expected, f.lexed.instrs, f.num_instrs);
+
+    OutputSink output = output_sink_arena();
+    bool ok = check_budgets(&f, &output)
+           && check_verified(&f, &output)
+           && check_engines(&f, &output)
+           && check_recorder(&f, &output)
+           && check_batch(&f)
+           && check_optimizer(&f, &output)
+           && check_bytecode(&f, &output, image_path)
+           && check_snapshot(&f, &output)
+           && check_api(&f, &output);
+
+    output_free(&output);
+    output_free(&f.expected_output);
+    decoder_free(&f.program);
+    lexer_free(&f.lexed);
+    return ok;
+}
+
+static bool same_lexed(const LexerState* a, const LexerState* b) {
+    if (a->had_error != b->had_error || a->cur_instr != b->cur_instr || a->num_labels != b->num_labels)
+        return false;
+    for (int i = 0; i <= a->cur_instr; i++) {
+        const Instruction* x = &a->instrs[i];
+        const Instruction* y = &b->instrs[i];
+        if (x->type != y->type || x->width != y->width || a->lines[i] != b->lines[i])
+            return false;
+        for (int j = 0; j < NUM_OPERANDS; j++) {
+            if (x->operands[j].is_register != y->operands[j].is_register
+                || x->operands[j].is_label != y->operands[j].is_label
+                || x->operands[j].value != y->operands[j].value)
+                return false;
+        }
+    }
+    for (int i = 0; i < a->num_labels; i++) {
+        const Label* x = &a->labels[i];
+        const Label* y = &b->labels[i];
+        if (x->address != y->address || x->defined != y->defined || x->name.len != y->name.len
+            || memcmp(x->name.data, y->name.data, x->name.len))
+            return false;
+    }
+    return true;
+}
+
+static bool check_parallel_lexer(str src) {
+    LexerState serial = lexer_lex(src);
+    LexerState parallel = lexer_lex_parallel(src, LEXER_THREADS);
+    bool ok = same_lexed(&serial, &parallel);
+    if (!ok)
+        fprintf(stderr, "Error: the programs lexed differently on %d threads than on one\n",
+                LEXER_THREADS);
+    lexer_free(&serial);
+    lexer_free(&parallel);
+    return ok;
+}
+
+static bool write_program(const char* dir, int index, str src) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/fuzz%d.s", dir, index);
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Error: couldn't write \"%s\"\n", path);
+        return false;
+    }
+    fwrite(src.data, 1, src.len, file);
+    fclose(file);
+    return true;
+}
+
+static void print_usage() {
+    printf("Usage: fuzz [-n <programs>] [-s <seed>] [-o <dir>]\n");
+}
+
+int main(int argc, char* argv[]) {
+    int num_programs = DEFAULT_PROGRAMS;
+    uint64_t seed = DEFAULT_SEED;
+    const char* dir = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            num_programs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            dir = argv[++i];
+        else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    // xorshift never leaves 0
+    Generator g = {.state = seed ? seed : DEFAULT_SEED};
+    OutputSink all = output_sink_arena();
+    char image_path[] = "/tmp/strvm-fuzz-XXXXXX";
+    int fd = dir == NULL ? mkstemp(image_path) : -1;
+    if (dir == NULL && fd < 0) {
+        fprintf(stderr, "Error: couldn't create a temporary file\n");
+        return 1;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < num_programs && ok; i++) {
+        str src = generate_program(&g, i);
+        if (dir != NULL)
+            ok = write_program(dir, i, src);
+        else
+            ok = fuzz_program(&g, i, src, image_path);
+        output_put(&all, src.data, src.len);
+        free(src.data);
+    }
+
+    if (dir == NULL) {
+        close(fd);
+        remove(image_path);
+        ok = ok && check_parallel_lexer((str){.data = all.data, .len = all.len});
+        if (ok)
+            printf("fuzz: %d programs ran the same on every engine (seed %llu)\n",
+                   num_programs, (unsigned long long)seed);
+    }
+    output_free(&all);
+    return ok ? 0 : 1;
+}
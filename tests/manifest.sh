@@ -0,0 +1,42 @@
+#!/bin/sh
+# Starts manifest jobs from a snapshot, and checks that
+# they carry on from it just like `strvm -r` does, with
+# only the registers the manifest sets changed, on the
+# thread pool and as green threads alike.
+#
+# Usage: tests/manifest.sh <strvm> <dir>
+
+strvm=$1
+dir=$2
+mkdir -p "$dir"
+
+# r0 and r1 are set before the snapshot, and r2 never is
+cat > "$dir/warm.s" << EOF
+    mov r0, 42
+    mov r1, 7
+warm:
+    ptn r0
+    ptc 32
+    ptn r1
+    ptc 32
+    ptn r2
+    ptc 10
+EOF
+"$strvm" -s "$dir/warm.snap" -a warm "$dir/warm.s" || { echo "Error: couldn't take a snapshot"; exit 1; }
+"$strvm" -r "$dir/warm.snap" "$dir/warm.s" > "$dir/expected.txt"
+echo "1 7 5" >> "$dir/expected.txt"
+
+cat > "$dir/manifest.txt" << EOF
+$dir/warm.s from=$dir/warm.snap
+$dir/warm.s from=$dir/warm.snap r2=5 r0=1
+EOF
+
+failed=0
+for flag in "" -g; do
+    "$strvm" -m "$dir/manifest.txt" $flag > "$dir/actual.txt"
+    if ! cmp -s "$dir/expected.txt" "$dir/actual.txt"; then
+        echo "Error: jobs started from a snapshot didn't carry on from it (-m${flag:+ $flag})"
+        failed=1
+    fi
+done
+exit $failed